@@ -1,7 +1,10 @@
 #include "allocator.h"
 
+#include <assert.h>
+#include <stdalign.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 static void* heap_allocate(void* data, size_t size) {
   (void)data;
@@ -22,9 +25,217 @@ static const Allocator_methods heap_allocator_methods = {
   .allocate = heap_allocate,
   .reallocate = heap_reallocate,
   .free = heap_free,
+  .reset = NULL,
 };
 
 const Allocator heap_allocator = {
   .data = NULL,
   .methods = &heap_allocator_methods,
 };
+
+/// @brief A free block of a pool, linked to the next free block
+typedef struct Pool_block {
+  struct Pool_block* next;
+} Pool_block;
+
+/// @brief A chunk of memory obtained by a pool, linked to the previously obtained chunk
+typedef struct Pool_chunk {
+  struct Pool_chunk* next;
+
+  /// @brief The size requested for an oversized allocation, unused by the chunks holding blocks
+  size_t size;
+} Pool_chunk;
+
+/// @brief The state of a pool allocator
+typedef struct Pool {
+  /// @brief The blocks which were handed out and then freed, available for reuse
+  Pool_block* free_blocks;
+
+  /// @brief The beginning of the blocks of the newest chunk which were never handed out
+  char* fresh_blocks;
+
+  /// @brief The end of the newest chunk
+  char* fresh_blocks_end;
+
+  /// @brief The chunks holding the blocks of the pool, newest first
+  Pool_chunk* chunks;
+
+  /// @brief The allocations larger than a block, newest first
+  Pool_chunk* oversized_chunks;
+
+  /// @brief The size of a block, which is a multiple of its alignment
+  size_t block_size;
+
+  /// @brief The offset of the first block of a chunk, relative to the beginning of the chunk
+  size_t block_offset;
+
+  /// @brief The number of blocks per chunk
+  size_t chunk_size;
+
+  /// @brief The allocator from which chunks are obtained
+  Allocator allocator;
+} Pool;
+
+/// @brief The offset of the memory of an oversized allocation, relative to the beginning of its chunk
+static size_t pool_oversized_offset(void) {
+  Layout layout = {.size = sizeof(Pool_chunk), .alignment = alignof(Pool_chunk)};
+  return layout_add(&layout, (Layout){.size = 0, .alignment = alignof(max_align_t)});
+}
+
+static void* pool_allocate(void* data, size_t size) {
+  Pool* pool = data;
+
+  if (size > pool->block_size) {
+    size_t offset = pool_oversized_offset();
+    Pool_chunk* chunk = allocator_allocate(pool->allocator, offset + size);
+
+    if (chunk == NULL)
+      return NULL;
+
+    chunk->next = pool->oversized_chunks;
+    chunk->size = size;
+    pool->oversized_chunks = chunk;
+    return (char*)chunk + offset;
+  }
+
+  if (pool->free_blocks != NULL) {
+    Pool_block* block = pool->free_blocks;
+    pool->free_blocks = block->next;
+    return block;
+  }
+
+  if (pool->fresh_blocks == pool->fresh_blocks_end) {
+    Pool_chunk* chunk = allocator_allocate(pool->allocator, pool->block_offset + pool->chunk_size * pool->block_size);
+
+    if (chunk == NULL)
+      return NULL;
+
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+    pool->fresh_blocks = (char*)chunk + pool->block_offset;
+    pool->fresh_blocks_end = pool->fresh_blocks + pool->chunk_size * pool->block_size;
+  }
+
+  void* block = pool->fresh_blocks;
+  pool->fresh_blocks += pool->block_size;
+  return block;
+}
+
+static void pool_free(void* data, void* pointer) {
+  Pool* pool = data;
+
+  if (pointer == NULL)
+    return;
+
+  // Oversized allocations are large and aligned enough to be reused as blocks, too:
+  Pool_block* block = pointer;
+  block->next = pool->free_blocks;
+  pool->free_blocks = block;
+}
+
+static void* pool_reallocate(void* data, void* pointer, size_t size) {
+  Pool* pool = data;
+
+  if (pointer == NULL)
+    return pool_allocate(pool, size);
+
+  // Every allocation spans at least a block:
+  if (size <= pool->block_size)
+    return pointer;
+
+  // Oversized allocations, even when reused as blocks, are found among the chunks holding them:
+  size_t offset = pool_oversized_offset();
+  size_t old_size = pool->block_size;
+
+  for (const Pool_chunk* chunk = pool->oversized_chunks; chunk != NULL; chunk = chunk->next) {
+    if ((const char*)chunk + offset == pointer) {
+      old_size = chunk->size;
+      break;
+    }
+  }
+
+  if (size <= old_size)
+    return pointer;
+
+  void* new_pointer = pool_allocate(pool, size);
+
+  if (new_pointer == NULL)
+    return NULL;
+
+  memcpy(new_pointer, pointer, old_size);
+  pool_free(pool, pointer);
+  return new_pointer;
+}
+
+static void pool_reset(void* data) {
+  Pool* pool = data;
+
+  // Retain the newest chunk, so that refilling the pool does not immediately need more memory:
+  if (pool->chunks != NULL) {
+    Pool_chunk* chunk = pool->chunks->next;
+
+    while (chunk != NULL) {
+      Pool_chunk* next_chunk = chunk->next;
+      allocator_free(pool->allocator, chunk);
+      chunk = next_chunk;
+    }
+
+    pool->chunks->next = NULL;
+    pool->fresh_blocks = (char*)pool->chunks + pool->block_offset;
+  }
+
+  pool->free_blocks = NULL;
+}
+
+static const Allocator_methods pool_allocator_methods = {
+  .allocate = pool_allocate,
+  .reallocate = pool_reallocate,
+  .free = pool_free,
+  .reset = pool_reset,
+};
+
+Allocator pool_allocator_new(Layout block_layout, size_t chunk_size) {
+  return pool_allocator_new_with(block_layout, chunk_size, heap_allocator);
+}
+
+Allocator pool_allocator_new_with(Layout block_layout, size_t chunk_size, Allocator allocator) {
+  Pool* pool = allocator_allocate(allocator, sizeof(Pool));
+
+  if (pool != NULL) {
+    Layout layout = layout_empty();
+    layout_add(&layout, block_layout);
+    layout_add(&layout, (Layout){.size = sizeof(Pool_block), .alignment = alignof(Pool_block)});
+    layout_pad(&layout);
+    assert(layout.alignment <= alignof(max_align_t));
+
+    Layout chunk_layout = {.size = sizeof(Pool_chunk), .alignment = alignof(Pool_chunk)};
+
+    pool->free_blocks = NULL;
+    pool->fresh_blocks = NULL;
+    pool->fresh_blocks_end = NULL;
+    pool->chunks = NULL;
+    pool->oversized_chunks = NULL;
+    pool->block_size = layout.size;
+    pool->block_offset = layout_add(&chunk_layout, layout);
+    pool->chunk_size = chunk_size != 0 ? chunk_size : 1;
+    pool->allocator = allocator;
+  }
+
+  return (Allocator){.data = pool, .methods = &pool_allocator_methods};
+}
+
+void pool_allocator_destroy(Allocator pool_allocator) {
+  Pool* pool = pool_allocator.data;
+
+  for (size_t i = 0; i < 2; ++i) {
+    Pool_chunk* chunk = i == 0 ? pool->chunks : pool->oversized_chunks;
+
+    while (chunk != NULL) {
+      Pool_chunk* next_chunk = chunk->next;
+      allocator_free(pool->allocator, chunk);
+      chunk = next_chunk;
+    }
+  }
+
+  allocator_free(pool->allocator, pool);
+}
@@ -1,12 +1,18 @@
 #ifndef ALLOCATOR_H
 #define ALLOCATOR_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
+#include "layout.h"
+
 typedef struct Allocator_methods {
   void* (*allocate)(void* data, size_t size);
   void* (*reallocate)(void* data, void* pointer, size_t size);
   void (*free)(void* data, void* pointer);
+
+  /// @brief Frees all memory handed out by the allocator at once, or @c NULL if unsupported
+  void (*reset)(void* data);
 } Allocator_methods;
 
 typedef struct Allocator {
@@ -26,6 +32,41 @@ static inline void allocator_free(Allocator allocator, void* pointer) {
   allocator.methods->free(allocator.data, pointer);
 }
 
+/// @brief Frees all memory handed out by an allocator at once, if supported by the allocator
+/// @return @c true on success, @c false if unsupported
+static inline bool allocator_reset(Allocator allocator) {
+  if (allocator.methods->reset == NULL)
+    return false;
+
+  allocator.methods->reset(allocator.data);
+  return true;
+}
+
 extern const Allocator heap_allocator;
 
+/// @brief Allocates a pool allocator, handing out fixed-size blocks carved from larger chunks
+/// @param block_layout The layout of the blocks handed out by the allocator
+/// @param chunk_size The number of blocks per chunk
+/// @return The new allocator, whose @c data is @c NULL if memory could not be allocated
+/// @note Requests larger than a block are forwarded to the heap allocator, and only released on destruction
+/// @note Reallocations grow requests past a block by copying them, the size of oversized requests being found in
+/// linear time in their number
+/// @note Resetting the allocator releases all blocks at once, but retains requests larger than a block
+Allocator pool_allocator_new(Layout block_layout, size_t chunk_size);
+
+/// @brief Allocates a pool allocator, handing out fixed-size blocks carved from larger chunks
+/// @param block_layout The layout of the blocks handed out by the allocator
+/// @param chunk_size The number of blocks per chunk
+/// @param allocator The allocator from which chunks are obtained
+/// @return The new allocator, whose @c data is @c NULL if memory could not be allocated
+/// @note Requests larger than a block are forwarded to @p allocator, and only released on destruction
+/// @note Reallocations grow requests past a block by copying them, the size of oversized requests being found in
+/// linear time in their number
+/// @note Resetting the allocator releases all blocks at once, but retains requests larger than a block
+Allocator pool_allocator_new_with(Layout block_layout, size_t chunk_size, Allocator allocator);
+
+/// @brief Deallocates a pool allocator, releasing all of its chunks at once
+/// @note Any memory handed out by the pool allocator is no longer valid afterwards
+void pool_allocator_destroy(Allocator pool_allocator);
+
 #endif
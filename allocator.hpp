@@ -0,0 +1,248 @@
+#ifndef ALLOCATOR_HPP
+#define ALLOCATOR_HPP
+
+#include <cstddef>
+#include <forward_list>
+#include <memory>
+#include <new>
+
+namespace cpp {
+  /// @brief Memory pool handing out fixed-size blocks carved from larger chunks
+  class Pool {
+    /// @brief A free block of the pool, linked to the next free block
+    struct Block {
+      Block* next;
+    };
+
+    /// @brief A chunk of memory obtained by the pool, linked to the previously obtained chunk
+    struct Chunk {
+      Chunk* next;
+    };
+
+    /// @brief The blocks which were handed out and then freed, available for reuse
+    Block* _free_blocks;
+
+    /// @brief The beginning of the blocks of the newest chunk which were never handed out
+    char* _fresh_blocks;
+
+    /// @brief The end of the newest chunk
+    char* _fresh_blocks_end;
+
+    /// @brief The chunks holding the blocks of the pool, newest first
+    Chunk* _chunks;
+
+    /// @brief The size of a block, which is a multiple of its alignment
+    std::size_t _block_size;
+
+    /// @brief The alignment of a block
+    std::size_t _block_alignment;
+
+    /// @brief The number of blocks per chunk
+    std::size_t _chunk_size;
+
+    /// @brief Rounds up a size to the nearest multiple of an alignment
+    static constexpr std::size_t pad(std::size_t size, std::size_t alignment) noexcept {
+      return (size + alignment - 1) / alignment * alignment;
+    }
+
+    /// @brief The alignment of chunks
+    std::align_val_t chunk_alignment() const noexcept {
+      return static_cast<std::align_val_t>(this->_block_alignment > alignof(Chunk) ? this->_block_alignment : alignof(Chunk));
+    }
+
+  public:
+    /// @brief Returns the alignment of the blocks of a pool holding objects of a given alignment
+    static constexpr std::size_t block_alignment_for(std::size_t alignment) noexcept {
+      return alignment > alignof(Block) ? alignment : alignof(Block);
+    }
+
+    /// @brief Returns the size of the blocks of a pool holding objects of a given size and alignment
+    static constexpr std::size_t block_size_for(std::size_t size, std::size_t alignment) noexcept {
+      return Pool::pad(size > sizeof(Block) ? size : sizeof(Block), Pool::block_alignment_for(alignment));
+    }
+
+    /// @brief Initializes an empty pool of blocks large and aligned enough to hold objects of a given size and alignment
+    /// @param chunk_size The number of blocks per chunk
+    Pool(std::size_t size, std::size_t alignment, std::size_t chunk_size) noexcept :
+      _free_blocks(nullptr),
+      _fresh_blocks(nullptr),
+      _fresh_blocks_end(nullptr),
+      _chunks(nullptr),
+      _block_size(Pool::block_size_for(size, alignment)),
+      _block_alignment(Pool::block_alignment_for(alignment)),
+      _chunk_size(chunk_size != 0 ? chunk_size : 1) {}
+
+    Pool(const Pool&) = delete;
+
+    Pool& operator=(const Pool&) = delete;
+
+    /// @brief Deallocates this pool, releasing all of its chunks at once
+    ~Pool() noexcept {
+      this->release();
+    }
+
+    /// @brief Returns the size of the blocks handed out by this pool
+    std::size_t block_size() const noexcept {
+      return this->_block_size;
+    }
+
+    /// @brief Returns the alignment of the blocks handed out by this pool
+    std::size_t block_alignment() const noexcept {
+      return this->_block_alignment;
+    }
+
+    /// @brief Hands out a block
+    /// @exception std::bad_alloc If memory could not be allocated
+    void* allocate() {
+      if (this->_free_blocks != nullptr) {
+        Block* block = this->_free_blocks;
+        this->_free_blocks = block->next;
+        return block;
+      }
+
+      if (this->_fresh_blocks == this->_fresh_blocks_end) {
+        std::size_t block_offset = Pool::pad(sizeof(Chunk), this->_block_alignment);
+        void* memory = ::operator new(block_offset + this->_chunk_size * this->_block_size, this->chunk_alignment());
+        Chunk* chunk = ::new (memory) Chunk{this->_chunks};
+        this->_chunks = chunk;
+        this->_fresh_blocks = static_cast<char*>(memory) + block_offset;
+        this->_fresh_blocks_end = this->_fresh_blocks + this->_chunk_size * this->_block_size;
+      }
+
+      void* block = this->_fresh_blocks;
+      this->_fresh_blocks += this->_block_size;
+      return block;
+    }
+
+    /// @brief Takes back a block previously handed out by this pool
+    void deallocate(void* pointer) noexcept {
+      Block* block = static_cast<Block*>(pointer);
+      block->next = this->_free_blocks;
+      this->_free_blocks = block;
+    }
+
+    /// @brief Takes back all blocks handed out by this pool at once, releasing all of its chunks
+    void release() noexcept {
+      while (this->_chunks != nullptr) {
+        Chunk* next_chunk = this->_chunks->next;
+        ::operator delete(this->_chunks, this->chunk_alignment());
+        this->_chunks = next_chunk;
+      }
+
+      this->_free_blocks = nullptr;
+      this->_fresh_blocks = nullptr;
+      this->_fresh_blocks_end = nullptr;
+    }
+  };
+
+  /// @brief Set of pools, one per block layout
+  struct Pool_set {
+    /// @brief The number of blocks per chunk of each pool
+    std::size_t chunk_size;
+
+    /// @brief The pools, with stable addresses
+    std::forward_list<Pool> pools;
+
+    /// @brief Retrieves the pool holding objects of a given size and alignment, creating it on first use
+    Pool& pool(std::size_t size, std::size_t alignment) {
+      std::size_t block_size = Pool::block_size_for(size, alignment);
+      std::size_t block_alignment = Pool::block_alignment_for(alignment);
+
+      for (Pool& pool : this->pools) {
+        if (pool.block_size() == block_size && pool.block_alignment() == block_alignment)
+          return pool;
+      }
+
+      return this->pools.emplace_front(size, alignment, this->chunk_size);
+    }
+  };
+
+  /// @brief Allocator drawing single objects from pools of fixed-size blocks
+  /// @details Copies and rebinds of an allocator share its pools; they are released when the last of them is destroyed.
+  /// Allocations of multiple objects at a time bypass the pools.
+  /// @tparam T The type of allocated objects
+  template <typename T>
+  class Pool_allocator {
+    template <typename U>
+    friend class Pool_allocator;
+
+    /// @brief The pools shared by copies and rebinds of this allocator
+    std::shared_ptr<Pool_set> _pools;
+
+    /// @brief The pool for objects of type @p T, or @c nullptr if yet to be retrieved
+    Pool* _pool;
+
+  public:
+    using value_type = T;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+
+    using propagate_on_container_move_assignment = std::true_type;
+
+    using propagate_on_container_swap = std::true_type;
+
+    /// @brief Initializes an allocator with no pools yet
+    /// @param chunk_size The number of blocks per chunk of each pool
+    explicit Pool_allocator(std::size_t chunk_size = 1024) : _pools(std::make_shared<Pool_set>(Pool_set{chunk_size, {}})), _pool(nullptr) {}
+
+    /// @brief Initializes an allocator sharing the pools of another allocator
+    template <typename U>
+    Pool_allocator(const Pool_allocator<U>& other) noexcept : _pools(other._pools), _pool(nullptr) {}
+
+    /// @brief Returns the allocator of a container copied from one using this allocator
+    /// @return An allocator with the same chunk size, but no pools yet: copies of containers get pools of their own
+    Pool_allocator select_on_container_copy_construction() const {
+      return Pool_allocator(this->_pools->chunk_size);
+    }
+
+    /// @brief Allocates memory for a given number of objects
+    /// @exception std::bad_alloc If memory could not be allocated
+    T* allocate(std::size_t n) {
+      if (n != 1)
+        return std::allocator<T>().allocate(n);
+
+      if (this->_pool == nullptr)
+        this->_pool = &this->_pools->pool(sizeof(T), alignof(T));
+
+      return static_cast<T*>(this->_pool->allocate());
+    }
+
+    /// @brief Deallocates memory previously allocated by this allocator, or by one equal to it
+    void deallocate(T* pointer, std::size_t n) noexcept {
+      if (n != 1) {
+        std::allocator<T>().deallocate(pointer, n);
+        return;
+      }
+
+      if (this->_pool == nullptr)
+        this->_pool = &this->_pools->pool(sizeof(T), alignof(T));
+
+      this->_pool->deallocate(pointer);
+    }
+
+    /// @brief Takes back all memory handed out by the pools of this allocator at once, unless other allocators share them
+    /// @return @c true if the memory was taken back, @c false if other allocators share the pools
+    bool release() noexcept {
+      if (this->_pools.use_count() != 1)
+        return false;
+
+      for (Pool& pool : this->_pools->pools) {
+        pool.release();
+      }
+
+      return true;
+    }
+
+    template <typename U>
+    bool operator==(const Pool_allocator<U>& other) const noexcept {
+      return this->_pools == other._pools;
+    }
+
+    template <typename U>
+    bool operator!=(const Pool_allocator<U>& other) const noexcept {
+      return this->_pools != other._pools;
+    }
+  };
+}
+
+#endif
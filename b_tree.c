@@ -0,0 +1,974 @@
+#include "b_tree.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define B_TREE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define B_TREE_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define B_TREE_NEON
+#include <arm_neon.h>
+#endif
+
+/// @brief The number of bytes of keys a node holds at most, that of a cache line on most targets
+#define B_TREE_KEYS_SIZE 64
+
+/// @brief The number of searches walked in lockstep by @c b_tree_lookup_many
+#define B_TREE_LOOKUP_BATCH_SIZE 16
+
+/// @brief Hints that the memory at an address is about to be read
+#ifdef __GNUC__
+#define B_TREE_PREFETCH(ADDRESS) __builtin_prefetch(ADDRESS)
+#else
+#define B_TREE_PREFETCH(ADDRESS) ((void)(ADDRESS))
+#endif
+
+/// @brief B-tree node data type
+typedef struct B_node {
+  /// @brief The number of keys stored by the node
+  unsigned short count;
+
+  /// @brief Whether the node has no children
+  bool leaf;
+
+  /// @brief The keys, values and children of the node, each stored contiguously
+  char data[];
+} B_node;
+
+struct B_tree;
+
+/// @brief Function finding the index of the least key of a node greater than or equal to a given key
+/// @param[out] found Whether the key at the returned index is equal to the given key
+typedef size_t B_node_search(const struct B_tree* tree, const B_node* node, const void* key, bool* found);
+
+struct B_tree {
+  /// @brief The root of the tree, or @c NULL if the tree is empty
+  B_node* root;
+
+  /// @brief The number of key-value pairs stored by the tree
+  size_t count;
+
+  /// @brief The minimum degree of the tree: nodes other than the root hold between `degree - 1` and `2 * degree - 1` keys
+  size_t degree;
+
+  /// @brief The offset in which the keys are stored, relative to the beginning of a node
+  size_t key_offset;
+
+  /// @brief The size of each key stored by a node
+  size_t key_size;
+
+  /// @brief The offset in which the values are stored, relative to the beginning of a node
+  size_t value_offset;
+
+  /// @brief The size of each value stored by a node
+  size_t value_size;
+
+  /// @brief The offset in which the children are stored, relative to the beginning of a node
+  size_t children_offset;
+
+  /// @brief The size of leaves, which hold no children
+  size_t leaf_size;
+
+  /// @brief The size of internal nodes
+  size_t internal_size;
+
+  /// @brief The key comparator
+  Comparator comparator;
+
+  /// @brief The search within nodes, specialized for the comparator and the instruction sets of the running processor
+  B_node_search* search;
+
+  /// @brief The allocator of the tree and of its nodes
+  Allocator allocator;
+};
+
+/// @brief Gets the pointer to the key of a node at an index
+static inline void* b_node_key(const B_tree* tree, const B_node* node, size_t index) {
+  return (char*)node + tree->key_offset + index * tree->key_size;
+}
+
+/// @brief Gets the pointer to the value of a node at an index
+static inline void* b_node_value(const B_tree* tree, const B_node* node, size_t index) {
+  return (char*)node + tree->value_offset + index * tree->value_size;
+}
+
+/// @brief Gets the children of an internal node
+static inline B_node** b_node_children(const B_tree* tree, const B_node* node) {
+  return (B_node**)((char*)node + tree->children_offset);
+}
+
+/// @brief Moves key-value pairs between nodes, or within a node
+static void b_node_move_pairs(const B_tree* tree, B_node* target, size_t target_index, const B_node* source, size_t source_index, size_t count) {
+  memmove(b_node_key(tree, target, target_index), b_node_key(tree, source, source_index), count * tree->key_size);
+  memmove(b_node_value(tree, target, target_index), b_node_value(tree, source, source_index), count * tree->value_size);
+}
+
+/// @brief Moves children between internal nodes, or within an internal node
+static void b_node_move_children(const B_tree* tree, B_node* target, size_t target_index, const B_node* source, size_t source_index, size_t count) {
+  memmove(b_node_children(tree, target) + target_index, b_node_children(tree, source) + source_index, count * sizeof(B_node*));
+}
+
+/// @brief Finds the index of the least key of a node greater than or equal to a given key, by binary search
+/// @param[out] found Whether the key at the returned index is equal to the given key
+static size_t b_node_search_custom(const B_tree* tree, const B_node* node, const void* key, bool* found) {
+  size_t low = 0;
+  size_t high = node->count;
+
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    int ordering = comparator_compare(tree->comparator, key, b_node_key(tree, node, middle));
+
+    if (ordering == 0) {
+      *found = true;
+      return middle;
+    }
+
+    if (ordering < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  *found = false;
+  return low;
+}
+
+/// @brief Defines a @c B_node_search for keys of a scalar type, comparing keys inline while searching by bisection
+#define B_NODE_SEARCH_SCALAR(NAME, TYPE)                                                   \
+  static size_t NAME(const B_tree* tree, const B_node* node, const void* key, bool* found) { \
+    const TYPE* keys = b_node_key(tree, node, 0);                                          \
+    TYPE x = *(const TYPE*)key;                                                            \
+    size_t low = 0;                                                                        \
+    size_t high = node->count;                                                             \
+                                                                                           \
+    while (low < high) {                                                                   \
+      size_t middle = low + (high - low) / 2;                                              \
+                                                                                           \
+      if (keys[middle] < x) {                                                              \
+        low = middle + 1;                                                                  \
+      } else {                                                                             \
+        high = middle;                                                                     \
+      }                                                                                    \
+    }                                                                                      \
+                                                                                           \
+    *found = low < node->count && keys[low] == x;                                          \
+    return low;                                                                            \
+  }
+
+B_NODE_SEARCH_SCALAR(b_node_search_i32, int32_t)
+B_NODE_SEARCH_SCALAR(b_node_search_u32, uint32_t)
+B_NODE_SEARCH_SCALAR(b_node_search_i64, int64_t)
+B_NODE_SEARCH_SCALAR(b_node_search_u64, uint64_t)
+
+#undef B_NODE_SEARCH_SCALAR
+
+#if defined(B_TREE_SSE2) || defined(B_TREE_AVX2) || defined(B_TREE_NEON)
+
+/// @brief Counts the bits set in a mask
+static inline size_t b_tree_popcount(unsigned mask) {
+#ifdef __GNUC__
+  return (size_t)__builtin_popcount(mask);
+#else
+  size_t count = 0;
+
+  for (; mask != 0; mask &= mask - 1) {
+    count += 1;
+  }
+
+  return count;
+#endif
+}
+
+/// @brief Defines a @c B_node_search for keys of a scalar type, comparing @p LANES keys at once to the probe @c x
+/// @details @p SETUP declares the variables used by @p LESSER_MASK, which evaluates to the bit mask of the keys from
+/// @c keys + @c index lesser than @c x. Since keys are sorted, lesser keys come first, and the search stops at the first
+/// vector of keys not all lesser. Vectors may extend past the last key, within the keys of the node.
+#define B_NODE_SEARCH_VECTOR(NAME, ATTRIBUTES, TYPE, LANES, SETUP, LESSER_MASK)                       \
+  ATTRIBUTES static size_t NAME(const B_tree* tree, const B_node* node, const void* key, bool* found) { \
+    const TYPE* keys = b_node_key(tree, node, 0);                                                     \
+    TYPE x = *(const TYPE*)key;                                                                       \
+    size_t count = node->count;                                                                       \
+    size_t index = 0;                                                                                 \
+    SETUP                                                                                             \
+                                                                                                      \
+    while (index < count) {                                                                           \
+      unsigned mask = (LESSER_MASK);                                                                  \
+                                                                                                      \
+      if (count - index < (LANES))                                                                    \
+        mask &= (1u << (count - index)) - 1;                                                          \
+                                                                                                      \
+      size_t lesser = b_tree_popcount(mask);                                                          \
+      index += lesser;                                                                                \
+                                                                                                      \
+      if (lesser != (LANES))                                                                          \
+        break;                                                                                        \
+    }                                                                                                 \
+                                                                                                      \
+    *found = index < count && keys[index] == x;                                                       \
+    return index;                                                                                     \
+  }
+
+#endif
+
+#ifdef B_TREE_SSE2
+
+// Unsigned keys are biased into signed keys, ordered the same way, since SSE2 compares signed integers only:
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_sse2_i32,
+  ,
+  int32_t,
+  4,
+  __m128i probe = _mm_set1_epi32(x);,
+  (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(probe, _mm_loadu_si128((const __m128i*)(keys + index)))))
+)
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_sse2_u32,
+  ,
+  uint32_t,
+  4,
+  __m128i bias = _mm_set1_epi32(INT32_MIN); __m128i probe = _mm_xor_si128(_mm_set1_epi32((int32_t)x), bias);,
+  (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(probe, _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + index)), bias))))
+)
+
+#endif
+
+#ifdef B_TREE_AVX2
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_avx2_i32,
+  __attribute__((target("avx2"))),
+  int32_t,
+  8,
+  __m256i probe = _mm256_set1_epi32(x);,
+  (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(probe, _mm256_loadu_si256((const __m256i*)(keys + index)))))
+)
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_avx2_u32,
+  __attribute__((target("avx2"))),
+  uint32_t,
+  8,
+  __m256i bias = _mm256_set1_epi32(INT32_MIN); __m256i probe = _mm256_xor_si256(_mm256_set1_epi32((int32_t)x), bias);,
+  (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(probe, _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + index)), bias))))
+)
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_avx2_i64,
+  __attribute__((target("avx2"))),
+  int64_t,
+  4,
+  __m256i probe = _mm256_set1_epi64x(x);,
+  (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(probe, _mm256_loadu_si256((const __m256i*)(keys + index)))))
+)
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_avx2_u64,
+  __attribute__((target("avx2"))),
+  uint64_t,
+  4,
+  __m256i bias = _mm256_set1_epi64x(INT64_MIN); __m256i probe = _mm256_xor_si256(_mm256_set1_epi64x((int64_t)x), bias);,
+  (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(probe, _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + index)), bias))))
+)
+
+#endif
+
+#ifdef B_TREE_NEON
+
+/// @brief Gathers the lanes of a comparison result of 32-bit lanes into a bit mask
+static inline unsigned b_tree_neon_mask_u32(uint32x4_t lanes) {
+  const uint32_t bits[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(lanes, vld1q_u32(bits)));
+}
+
+/// @brief Gathers the lanes of a comparison result of 64-bit lanes into a bit mask
+static inline unsigned b_tree_neon_mask_u64(uint64x2_t lanes) {
+  const uint64_t bits[2] = {1, 2};
+  return (unsigned)vaddvq_u64(vandq_u64(lanes, vld1q_u64(bits)));
+}
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_neon_i32,
+  ,
+  int32_t,
+  4,
+  int32x4_t probe = vdupq_n_s32(x);,
+  b_tree_neon_mask_u32(vcltq_s32(vld1q_s32(keys + index), probe))
+)
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_neon_u32,
+  ,
+  uint32_t,
+  4,
+  uint32x4_t probe = vdupq_n_u32(x);,
+  b_tree_neon_mask_u32(vcltq_u32(vld1q_u32(keys + index), probe))
+)
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_neon_i64,
+  ,
+  int64_t,
+  2,
+  int64x2_t probe = vdupq_n_s64(x);,
+  b_tree_neon_mask_u64(vcltq_s64(vld1q_s64(keys + index), probe))
+)
+
+B_NODE_SEARCH_VECTOR(
+  b_node_search_neon_u64,
+  ,
+  uint64_t,
+  2,
+  uint64x2_t probe = vdupq_n_u64(x);,
+  b_tree_neon_mask_u64(vcltq_u64(vld1q_u64(keys + index), probe))
+)
+
+#endif
+
+#undef B_NODE_SEARCH_VECTOR
+
+/// @brief Selects the search within the nodes of trees whose keys are compared by a given comparator
+/// @details Keys compared by builtin comparators of integers of 32 or 64 bits are compared inline, several at once if
+/// the running processor supports it.
+static B_node_search* b_tree_select_search(Comparator comparator) {
+  size_t size;
+  bool is_signed;
+
+  switch (comparator_kind(comparator)) {
+    case COMPARATOR_INT:
+      size = sizeof(int);
+      is_signed = true;
+      break;
+
+    case COMPARATOR_LONG:
+      size = sizeof(long);
+      is_signed = true;
+      break;
+
+    case COMPARATOR_LLONG:
+      size = sizeof(long long);
+      is_signed = true;
+      break;
+
+    case COMPARATOR_UINT:
+      size = sizeof(unsigned int);
+      is_signed = false;
+      break;
+
+    case COMPARATOR_ULONG:
+      size = sizeof(unsigned long);
+      is_signed = false;
+      break;
+
+    case COMPARATOR_ULLONG:
+      size = sizeof(unsigned long long);
+      is_signed = false;
+      break;
+
+    default:
+      return b_node_search_custom;
+  }
+
+#ifdef B_TREE_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    if (size == 4)
+      return is_signed ? b_node_search_avx2_i32 : b_node_search_avx2_u32;
+
+    if (size == 8)
+      return is_signed ? b_node_search_avx2_i64 : b_node_search_avx2_u64;
+  }
+#endif
+
+#ifdef B_TREE_NEON
+  if (size == 4)
+    return is_signed ? b_node_search_neon_i32 : b_node_search_neon_u32;
+
+  if (size == 8)
+    return is_signed ? b_node_search_neon_i64 : b_node_search_neon_u64;
+#endif
+
+#ifdef B_TREE_SSE2
+  if (size == 4)
+    return is_signed ? b_node_search_sse2_i32 : b_node_search_sse2_u32;
+#endif
+
+  if (size == 4)
+    return is_signed ? b_node_search_i32 : b_node_search_u32;
+
+  if (size == 8)
+    return is_signed ? b_node_search_i64 : b_node_search_u64;
+
+  return b_node_search_custom;
+}
+
+/// @brief Finds the index of the least key of a node greater than or equal to a given key
+/// @param[out] found Whether the key at the returned index is equal to the given key
+static inline size_t b_node_search(const B_tree* tree, const B_node* node, const void* key, bool* found) {
+  return tree->search(tree, node, key, found);
+}
+
+/// @brief Checks that a subtree respects the invariants of B-trees
+/// @param[in,out] previous_key The greatest key visited so far, or @c NULL if none
+/// @param[in,out] count The number of visited keys
+/// @return The height of the subtree
+static size_t b_node_check(const B_tree* tree, const B_node* node, bool root, const void** previous_key, size_t* count) {
+  (void)root;
+  assert(node->count <= 2 * tree->degree - 1);
+  assert(node->count >= (root ? 1 : tree->degree - 1));
+  *count += node->count;
+  size_t height = 0;
+
+  for (size_t i = 0; i <= node->count; ++i) {
+    if (!node->leaf) {
+      size_t child_height = b_node_check(tree, b_node_children(tree, node)[i], false, previous_key, count);
+      assert(i == 0 || child_height == height);
+      height = child_height;
+    }
+
+    if (i < node->count) {
+      const void* key = b_node_key(tree, node, i);
+      assert(*previous_key == NULL || comparator_compare(tree->comparator, *previous_key, key) < 0);
+      *previous_key = key;
+    }
+  }
+
+  return height + 1;
+}
+
+/// @brief Computes the layout of the nodes of a tree with the given key and value layouts
+/// @return The layout of internal nodes
+static Layout b_tree_lay_out(B_tree* tree, Layout key_layout, Layout value_layout) {
+  size_t degree = (B_TREE_KEYS_SIZE / (key_layout.size != 0 ? key_layout.size : 1) + 1) / 2;
+  tree->degree = degree >= 2 ? degree : 2;
+  size_t capacity = 2 * tree->degree - 1;
+
+  // Keys span at least B_TREE_KEYS_SIZE bytes, so that searches may load whole vectors of keys past the last key:
+  size_t keys_size = capacity * key_layout.size;
+
+  if (keys_size < B_TREE_KEYS_SIZE)
+    keys_size = B_TREE_KEYS_SIZE;
+
+  Layout layout = {.size = offsetof(B_node, data), .alignment = alignof(B_node)};
+  tree->key_offset = layout_add(&layout, (Layout){.size = keys_size, .alignment = key_layout.alignment});
+  tree->key_size = key_layout.size;
+  tree->value_offset = layout_add(&layout, (Layout){.size = capacity * value_layout.size, .alignment = value_layout.alignment});
+  tree->value_size = value_layout.size;
+  tree->leaf_size = layout.size;
+  tree->children_offset = layout_add(&layout, (Layout){.size = (capacity + 1) * sizeof(B_node*), .alignment = alignof(B_node*)});
+  tree->internal_size = layout.size;
+  return layout;
+}
+
+/// @brief Allocates a node holding no keys
+/// @return The new node, or @c NULL if memory could not be allocated
+static B_node* b_tree_new_node(B_tree* tree, bool leaf) {
+  B_node* node = allocator_allocate(tree->allocator, leaf ? tree->leaf_size : tree->internal_size);
+
+  if (node != NULL) {
+    node->count = 0;
+    node->leaf = leaf;
+  }
+
+  return node;
+}
+
+/// @brief Deallocates a subtree
+static void b_tree_free_node(B_tree* tree, B_node* node) {
+  if (!node->leaf) {
+    for (size_t i = 0; i <= node->count; ++i) {
+      b_tree_free_node(tree, b_node_children(tree, node)[i]);
+    }
+  }
+
+  allocator_free(tree->allocator, node);
+}
+
+Layout b_tree_node_layout(Layout key_layout, Layout value_layout) {
+  B_tree tree;
+  return b_tree_lay_out(&tree, key_layout, value_layout);
+}
+
+B_tree* b_tree_new(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator) {
+  B_tree* tree = allocator_allocate(allocator, sizeof(B_tree));
+
+  if (tree != NULL) {
+    b_tree_lay_out(tree, key_layout, value_layout);
+    tree->root = NULL;
+    tree->count = 0;
+    tree->comparator = comparator;
+    tree->search = b_tree_select_search(comparator);
+    tree->allocator = allocator;
+  }
+
+  return tree;
+}
+
+void b_tree_check(const B_tree* tree) {
+  const void* previous_key = NULL;
+  size_t count = 0;
+
+  if (tree->root != NULL)
+    b_node_check(tree, tree->root, true, &previous_key, &count);
+
+  assert(count == tree->count);
+}
+
+size_t b_tree_count(const B_tree* tree) {
+  return tree->count;
+}
+
+void* b_tree_lookup(const B_tree* tree, const void* key) {
+  const B_node* node = tree->root;
+
+  while (node != NULL) {
+    bool found;
+    size_t index = b_node_search(tree, node, key, &found);
+
+    if (found)
+      return b_node_value(tree, node, index);
+
+    node = !node->leaf ? b_node_children(tree, node)[index] : NULL;
+  }
+
+  return NULL;
+}
+
+void b_tree_lookup_many(const B_tree* tree, const void* keys, size_t count, void** values) {
+  for (size_t batch = 0; batch < count; batch += B_TREE_LOOKUP_BATCH_SIZE) {
+    size_t size = count - batch < B_TREE_LOOKUP_BATCH_SIZE ? count - batch : B_TREE_LOOKUP_BATCH_SIZE;
+    const B_node* nodes[B_TREE_LOOKUP_BATCH_SIZE];
+    size_t active = tree->root != NULL ? size : 0;
+
+    for (size_t i = 0; i < size; ++i) {
+      nodes[i] = tree->root;
+      values[batch + i] = NULL;
+    }
+
+    while (active != 0) {
+      active = 0;
+
+      for (size_t i = 0; i < size; ++i) {
+        const B_node* node = nodes[i];
+
+        if (node == NULL)
+          continue;
+
+        bool found;
+        size_t index = b_node_search(tree, node, (const char*)keys + (batch + i) * tree->key_size, &found);
+
+        if (found) {
+          values[batch + i] = b_node_value(tree, node, index);
+          nodes[i] = NULL;
+          continue;
+        }
+
+        node = !node->leaf ? b_node_children(tree, node)[index] : NULL;
+        nodes[i] = node;
+
+        if (node != NULL) {
+          B_TREE_PREFETCH(b_node_key(tree, node, 0));
+          active += 1;
+        }
+      }
+    }
+  }
+}
+
+void* b_tree_find_bound(const B_tree* tree, const void* key, bool greater, bool inclusive) {
+  const B_node* node = tree->root;
+  void* bound = NULL;
+
+  while (node != NULL) {
+    bool found;
+    size_t index = b_node_search(tree, node, key, &found);
+
+    if (found && inclusive)
+      return b_node_value(tree, node, index);
+
+    // The keys of the child at index i lie between the keys at indices i - 1 and i:
+
+    if (greater) {
+      if (found)
+        index += 1;
+
+      if (index < node->count)
+        bound = b_node_value(tree, node, index);
+    } else if (index > 0) {
+      bound = b_node_value(tree, node, index - 1);
+    }
+
+    node = !node->leaf ? b_node_children(tree, node)[index] : NULL;
+  }
+
+  return bound;
+}
+
+void* b_tree_xmost(const B_tree* tree, bool greatest) {
+  const B_node* node = tree->root;
+
+  if (node == NULL)
+    return NULL;
+
+  while (!node->leaf) {
+    node = b_node_children(tree, node)[greatest ? node->count : 0];
+  }
+
+  return b_node_value(tree, node, greatest ? node->count - 1 : 0);
+}
+
+/// @brief Visits the key-value pairs of a subtree whose keys lie in a half-open range, in key order
+/// @param[in,out] count The number of visited key-value pairs
+/// @return @c false if the scan is to stop, @c true otherwise
+static bool b_node_scan(
+  const B_tree* tree,
+  const B_node* node,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, void* value, void* data),
+  void* data,
+  size_t* count
+) {
+  size_t index = 0;
+  bool found = false;
+
+  if (low != NULL)
+    index = b_node_search(tree, node, low, &found);
+
+  // Past the first visited child, all keys are greater than the lower bound:
+
+  for (; index <= node->count; ++index) {
+    if (!node->leaf && !found && !b_node_scan(tree, b_node_children(tree, node)[index], low, high, visit, data, count))
+      return false;
+
+    low = NULL;
+    found = false;
+
+    if (index == node->count)
+      break;
+
+    const void* key = b_node_key(tree, node, index);
+
+    if (high != NULL && comparator_compare(tree->comparator, key, high) >= 0)
+      return false;
+
+    *count += 1;
+
+    if (!visit(key, b_node_value(tree, node, index), data))
+      return false;
+  }
+
+  return true;
+}
+
+size_t b_tree_scan(const B_tree* tree, const void* low, const void* high, bool (*visit)(const void* key, void* value, void* data), void* data) {
+  size_t count = 0;
+
+  if (tree->root != NULL)
+    b_node_scan(tree, tree->root, low, high, visit, data, &count);
+
+  return count;
+}
+
+/// @brief Splits the full child of a node at a given index in two, raising its median key-value pair into the node
+/// @pre The node is not full
+/// @return @c true on success, @c false if memory could not be allocated
+static bool b_node_split_child(B_tree* tree, B_node* node, size_t index) {
+  B_node** children = b_node_children(tree, node);
+  B_node* child = children[index];
+  B_node* sibling = b_tree_new_node(tree, child->leaf);
+
+  if (sibling == NULL)
+    return false;
+
+  size_t degree = tree->degree;
+  b_node_move_pairs(tree, sibling, 0, child, degree, degree - 1);
+
+  if (!child->leaf)
+    b_node_move_children(tree, sibling, 0, child, degree, degree);
+
+  sibling->count = (unsigned short)(degree - 1);
+  child->count = (unsigned short)(degree - 1);
+
+  b_node_move_pairs(tree, node, index + 1, node, index, node->count - index);
+  b_node_move_children(tree, node, index + 2, node, index + 1, node->count - index);
+  b_node_move_pairs(tree, node, index, child, degree - 1, 1);
+  children[index + 1] = sibling;
+  node->count += 1;
+  return true;
+}
+
+void* b_tree_insert(B_tree* tree, const void* key, const void* value) {
+  // Full nodes are split on the way down, so that the leaf eventually reached has room for the key:
+
+  if (tree->root == NULL) {
+    tree->root = b_tree_new_node(tree, true);
+
+    if (tree->root == NULL)
+      return NULL;
+  } else if (tree->root->count == 2 * tree->degree - 1) {
+    B_node* root = b_tree_new_node(tree, false);
+
+    if (root == NULL)
+      return NULL;
+
+    b_node_children(tree, root)[0] = tree->root;
+
+    if (!b_node_split_child(tree, root, 0)) {
+      allocator_free(tree->allocator, root);
+      return NULL;
+    }
+
+    tree->root = root;
+  }
+
+  B_node* node = tree->root;
+
+  while (true) {
+    bool found;
+    size_t index = b_node_search(tree, node, key, &found);
+
+    if (found) {
+      memmove(b_node_value(tree, node, index), value, tree->value_size);
+      return b_node_value(tree, node, index);
+    }
+
+    if (node->leaf) {
+      b_node_move_pairs(tree, node, index + 1, node, index, node->count - index);
+      memmove(b_node_key(tree, node, index), key, tree->key_size);
+      memmove(b_node_value(tree, node, index), value, tree->value_size);
+      node->count += 1;
+      tree->count += 1;
+      return b_node_value(tree, node, index);
+    }
+
+    if (b_node_children(tree, node)[index]->count == 2 * tree->degree - 1) {
+      if (!b_node_split_child(tree, node, index))
+        return NULL;
+
+      int ordering = comparator_compare(tree->comparator, key, b_node_key(tree, node, index));
+
+      if (ordering == 0) {
+        memmove(b_node_value(tree, node, index), value, tree->value_size);
+        return b_node_value(tree, node, index);
+      }
+
+      if (ordering > 0)
+        index += 1;
+    }
+
+    node = b_node_children(tree, node)[index];
+  }
+}
+
+/// @brief Merges the child of a node at a given index, the key-value pair at the index and the next child into one node
+/// @pre Both children hold `degree - 1` keys
+static void b_node_merge_children(B_tree* tree, B_node* node, size_t index) {
+  B_node** children = b_node_children(tree, node);
+  B_node* child = children[index];
+  B_node* sibling = children[index + 1];
+
+  b_node_move_pairs(tree, child, child->count, node, index, 1);
+  b_node_move_pairs(tree, child, child->count + 1, sibling, 0, sibling->count);
+
+  if (!child->leaf)
+    b_node_move_children(tree, child, child->count + 1, sibling, 0, sibling->count + 1);
+
+  child->count += 1 + sibling->count;
+  b_node_move_pairs(tree, node, index, node, index + 1, node->count - index - 1);
+  b_node_move_children(tree, node, index + 1, node, index + 2, node->count - index - 1);
+  node->count -= 1;
+  allocator_free(tree->allocator, sibling);
+}
+
+/// @brief Ensures that the child of a node at a given index holds more than `degree - 1` keys, by moving a key-value
+/// pair from a sibling through the node, or by merging the child with a sibling
+/// @pre The node is the root or holds more than `degree - 1` keys
+/// @return The child now holding the keys of the child at @p index
+static B_node* b_node_fill_child(B_tree* tree, B_node* node, size_t index) {
+  B_node** children = b_node_children(tree, node);
+  B_node* child = children[index];
+
+  if (child->count >= tree->degree)
+    return child;
+
+  if (index > 0 && children[index - 1]->count >= tree->degree) {
+    B_node* sibling = children[index - 1];
+    b_node_move_pairs(tree, child, 1, child, 0, child->count);
+    b_node_move_pairs(tree, child, 0, node, index - 1, 1);
+    b_node_move_pairs(tree, node, index - 1, sibling, sibling->count - 1, 1);
+
+    if (!child->leaf) {
+      b_node_move_children(tree, child, 1, child, 0, child->count + 1);
+      b_node_children(tree, child)[0] = b_node_children(tree, sibling)[sibling->count];
+    }
+
+    sibling->count -= 1;
+    child->count += 1;
+    return child;
+  }
+
+  if (index < node->count && children[index + 1]->count >= tree->degree) {
+    B_node* sibling = children[index + 1];
+    b_node_move_pairs(tree, child, child->count, node, index, 1);
+    b_node_move_pairs(tree, node, index, sibling, 0, 1);
+    b_node_move_pairs(tree, sibling, 0, sibling, 1, sibling->count - 1);
+
+    if (!child->leaf) {
+      b_node_children(tree, child)[child->count + 1] = b_node_children(tree, sibling)[0];
+      b_node_move_children(tree, sibling, 0, sibling, 1, sibling->count);
+    }
+
+    sibling->count -= 1;
+    child->count += 1;
+    return child;
+  }
+
+  if (index == node->count)
+    index -= 1;
+
+  b_node_merge_children(tree, node, index);
+  return children[index];
+}
+
+/// @brief Removes the least or greatest key-value pair of a subtree, moving it to given locations
+/// @param node The root of the subtree, holding more than `degree - 1` keys
+static void b_node_remove_xmost(B_tree* tree, B_node* node, bool greatest, void* key, void* value) {
+  while (!node->leaf) {
+    node = b_node_fill_child(tree, node, greatest ? node->count : 0);
+  }
+
+  size_t index = greatest ? node->count - 1 : 0;
+  memmove(key, b_node_key(tree, node, index), tree->key_size);
+  memmove(value, b_node_value(tree, node, index), tree->value_size);
+  b_node_move_pairs(tree, node, index, node, index + 1, node->count - index - 1);
+  node->count -= 1;
+}
+
+bool b_tree_remove(B_tree* tree, const void* key) {
+  // Nodes holding `degree - 1` keys are filled on the way down, so that the node eventually holding the key can lose it:
+
+  B_node* node = tree->root;
+  bool removed = false;
+
+  while (node != NULL) {
+    bool found;
+    size_t index = b_node_search(tree, node, key, &found);
+
+    if (node->leaf) {
+      if (found) {
+        b_node_move_pairs(tree, node, index, node, index + 1, node->count - index - 1);
+        node->count -= 1;
+        removed = true;
+      }
+
+      break;
+    }
+
+    B_node** children = b_node_children(tree, node);
+
+    if (!found) {
+      node = b_node_fill_child(tree, node, index);
+    } else if (children[index]->count >= tree->degree) {
+      b_node_remove_xmost(tree, children[index], true, b_node_key(tree, node, index), b_node_value(tree, node, index));
+      removed = true;
+      break;
+    } else if (children[index + 1]->count >= tree->degree) {
+      b_node_remove_xmost(tree, children[index + 1], false, b_node_key(tree, node, index), b_node_value(tree, node, index));
+      removed = true;
+      break;
+    } else {
+      b_node_merge_children(tree, node, index);
+      node = children[index];
+    }
+  }
+
+  // Merging the children of the root may leave it empty:
+
+  B_node* root = tree->root;
+
+  if (root != NULL && root->count == 0) {
+    tree->root = !root->leaf ? b_node_children(tree, root)[0] : NULL;
+    allocator_free(tree->allocator, root);
+  }
+
+  if (removed)
+    tree->count -= 1;
+
+  return removed;
+}
+
+/// @brief Allocates a copy of a subtree
+/// @return The copied subtree, or @c NULL if memory could not be allocated
+static B_node* b_tree_copy_node(B_tree* tree, const B_node* node) {
+  B_node* new_node = allocator_allocate(tree->allocator, node->leaf ? tree->leaf_size : tree->internal_size);
+
+  if (new_node == NULL)
+    return NULL;
+
+  memcpy(new_node, node, tree->leaf_size);
+
+  if (!node->leaf) {
+    for (size_t i = 0; i <= node->count; ++i) {
+      B_node* child = b_tree_copy_node(tree, b_node_children(tree, node)[i]);
+
+      if (child == NULL) {
+        while (i-- > 0) {
+          b_tree_free_node(tree, b_node_children(tree, new_node)[i]);
+        }
+
+        allocator_free(tree->allocator, new_node);
+        return NULL;
+      }
+
+      b_node_children(tree, new_node)[i] = child;
+    }
+  }
+
+  return new_node;
+}
+
+B_tree* b_tree_copy(const B_tree* tree, Allocator allocator) {
+  B_tree* new_tree = allocator_allocate(allocator, sizeof(B_tree));
+
+  if (new_tree == NULL)
+    return NULL;
+
+  *new_tree = *tree;
+  new_tree->allocator = allocator;
+
+  if (tree->root != NULL) {
+    new_tree->root = b_tree_copy_node(new_tree, tree->root);
+
+    if (new_tree->root == NULL) {
+      allocator_free(allocator, new_tree);
+      return NULL;
+    }
+  }
+
+  return new_tree;
+}
+
+void b_tree_clear(B_tree* tree) {
+  if (tree->root != NULL)
+    b_tree_free_node(tree, tree->root);
+
+  tree->root = NULL;
+  tree->count = 0;
+}
+
+void b_tree_destroy(B_tree* tree) {
+  b_tree_clear(tree);
+  allocator_free(tree->allocator, tree);
+}
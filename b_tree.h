@@ -0,0 +1,70 @@
+#ifndef B_TREE_H
+#define B_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "allocator.h"
+#include "comparator.h"
+#include "layout.h"
+
+/// @brief B-tree engine of maps created with the @c b_tree option
+/// @details Each node stores its keys contiguously, followed by its values and, unless it is a leaf, its children. Nodes
+/// hold up to as many keys as fit in a cache line, and at least 3 keys, so that 2-3-4 trees are the narrowest B-trees
+/// used. Keys and values move between nodes as the tree is updated, so values are pointed to until the next insertion
+/// into or removal from the tree.
+typedef struct B_tree B_tree;
+
+/// @brief Returns the layout of the largest nodes allocated by B-trees with the given key and value layouts
+Layout b_tree_node_layout(Layout key_layout, Layout value_layout);
+
+/// @brief Allocates an empty B-tree
+/// @returns The new B-tree, or @c NULL if memory could not be allocated
+B_tree* b_tree_new(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator);
+
+/// @brief Verifies that a B-tree is valid: that is, that no internal invariants are violated
+void b_tree_check(const B_tree* tree);
+
+/// @brief Returns the number of key-value pairs stored by a B-tree
+size_t b_tree_count(const B_tree* tree);
+
+/// @brief Finds the value associated to a given key, if any
+void* b_tree_lookup(const B_tree* tree, const void* key);
+
+/// @brief Finds the values associated to several keys, walking their searches in lockstep
+/// @see map_lookup_many
+void b_tree_lookup_many(const B_tree* tree, const void* keys, size_t count, void** values);
+
+/// @brief Finds the value associated to the nearest key to a given key on a given side, if any
+/// @param greater @c true for the least greater key, @c false for the greatest lesser key
+/// @param inclusive If @c true, the value associated to the given key itself is found if any
+void* b_tree_find_bound(const B_tree* tree, const void* key, bool greater, bool inclusive);
+
+/// @brief Finds the value associated to the least or greatest key, if any
+/// @param greatest @c true for the greatest key, @c false for the least key
+void* b_tree_xmost(const B_tree* tree, bool greatest);
+
+/// @brief Visits the key-value pairs whose keys lie in a half-open range, in key order
+/// @see map_scan
+size_t b_tree_scan(const B_tree* tree, const void* low, const void* high, bool (*visit)(const void* key, void* value, void* data), void* data);
+
+/// @brief Associates a key to a value
+/// @return The value associated to the key, or @c NULL if memory could not be allocated
+void* b_tree_insert(B_tree* tree, const void* key, const void* value);
+
+/// @brief Removes the value associated to a key, if any
+/// @return @c true if an association to the key existed prior to removal, @c false otherwise
+bool b_tree_remove(B_tree* tree, const void* key);
+
+/// @brief Copies a B-tree
+/// @param allocator The allocator of the copied B-tree and of its nodes
+/// @return The copied B-tree, or @c NULL if memory could not be allocated
+B_tree* b_tree_copy(const B_tree* tree, Allocator allocator);
+
+/// @brief Clears a B-tree, removing all key-value associations
+void b_tree_clear(B_tree* tree);
+
+/// @brief Clears and deallocates a B-tree
+void b_tree_destroy(B_tree* tree);
+
+#endif
@@ -0,0 +1,1205 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Maps generated by MAP_DEFINE draw their nodes from the counting allocator of C maps:
+#define MAP_DEFINE_ALLOCATE(SIZE) counting_allocate(nullptr, SIZE)
+#define MAP_DEFINE_FREE(POINTER) counting_free(nullptr, POINTER)
+
+extern "C" {
+#include "allocator.h"
+#include "comparator.h"
+#include "concurrent_map.h"
+#include "layout.h"
+#include "map.h"
+#include "map_define.h"
+#include "map_image.h"
+#include "map_stream.h"
+#include "persistent_map.h"
+#include "sharded_map.h"
+}
+
+#include "map.hpp"
+#include "sharded_map.hpp"
+
+namespace {
+  void* counting_allocate(void*, std::size_t size);
+  void counting_free(void*, void* pointer);
+}
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// @brief Sink of the results of the measured operations, so that they are not optimized away
+  volatile std::size_t sink;
+
+  /// @brief Options of a run of the benchmarks
+  struct Options {
+    /// @brief @c "csv" or @c "json"
+    std::string format = "csv";
+
+    /// @brief The base-2 logarithms of the map sizes
+    std::vector<int> shifts = {10, 14, 18};
+
+    /// @brief The number of measured runs of each benchmark, following a warm-up run
+    std::size_t runs = 5;
+
+    /// @brief The substring the names of the run benchmarks contain, or empty to run all benchmarks
+    std::string filter;
+
+    /// @brief The greatest number of reader threads
+    std::size_t max_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+  };
+
+  /// @brief The measurements of a benchmark
+  struct Result {
+    /// @brief The operations measured, such as @c "lookup_random"
+    std::string benchmark;
+
+    /// @brief The data structure measured, such as @c "Map+pool"
+    std::string container;
+
+    /// @brief The type of keys, such as @c "int"
+    std::string key;
+
+    std::size_t key_size;
+    std::size_t value_size;
+
+    /// @brief The number of key-value pairs of the map
+    std::size_t count;
+
+    /// @brief The number of threads running the operations
+    std::size_t threads;
+
+    /// @brief The number of operations per run
+    std::size_t operations;
+
+    /// @brief The duration of each measured run, in nanoseconds
+    std::vector<double> run_ns;
+
+    /// @brief The memory allocated per key-value pair after the last run, in bytes, or NaN if not measured
+    double bytes_per_entry = std::numeric_limits<double>::quiet_NaN();
+  };
+
+  /// @brief Writes results as they are measured, as CSV rows or as the elements of a JSON array
+  class Reporter {
+    std::ostream& _os;
+    bool _json;
+    bool _first = true;
+
+    /// @brief Escapes a string as a JSON string literal
+    static std::string quote(const std::string& string) {
+      std::string quoted = "\"";
+
+      for (char c : string) {
+        if (c == '"' || c == '\\')
+          quoted += '\\';
+
+        quoted += c;
+      }
+
+      return quoted + '"';
+    }
+
+    /// @brief Formats a number, or @c null if NaN
+    std::string number(double x) const {
+      if (std::isnan(x))
+        return this->_json ? "null" : "";
+
+      std::ostringstream os;
+      os << std::setprecision(6) << x;
+      return os.str();
+    }
+
+  public:
+    Reporter(std::ostream& os, bool json) : _os(os), _json(json) {
+      if (json) {
+        os << "{\n  \"context\": {\"compact_nodes\": "
+#ifdef MAP_COMPACT_NODES
+           << "true"
+#else
+           << "false"
+#endif
+           << ", \"hardware_concurrency\": " << std::thread::hardware_concurrency() << "},\n  \"results\": [";
+      } else {
+        os << "benchmark,container,key,key_size,value_size,count,threads,operations,runs,"
+              "min_ns_per_op,median_ns_per_op,mean_ns_per_op,stddev_ns_per_op,bytes_per_entry\n";
+      }
+    }
+
+    ~Reporter() {
+      if (this->_json)
+        this->_os << "\n  ]\n}\n";
+    }
+
+    void report(const Result& result) {
+      // Statistics of the time per operation of the runs:
+
+      std::vector<double> ns = result.run_ns;
+
+      for (double& run_ns : ns) {
+        run_ns /= static_cast<double>(std::max<std::size_t>(1, result.operations));
+      }
+
+      std::sort(ns.begin(), ns.end());
+      double min = ns.front();
+      double median = ns.size() % 2 != 0 ? ns[ns.size() / 2] : (ns[ns.size() / 2 - 1] + ns[ns.size() / 2]) / 2;
+      double mean = std::accumulate(ns.begin(), ns.end(), 0.0) / static_cast<double>(ns.size());
+      double variance = 0;
+
+      for (double x : ns) {
+        variance += (x - mean) * (x - mean);
+      }
+
+      double stddev = ns.size() > 1 ? std::sqrt(variance / static_cast<double>(ns.size() - 1)) : 0;
+
+      if (this->_json) {
+        this->_os << (this->_first ? "\n" : ",\n") << "    {\"benchmark\": " << quote(result.benchmark)
+                  << ", \"container\": " << quote(result.container) << ", \"key\": " << quote(result.key)
+                  << ", \"key_size\": " << result.key_size << ", \"value_size\": " << result.value_size
+                  << ", \"count\": " << result.count << ", \"threads\": " << result.threads
+                  << ", \"operations\": " << result.operations << ", \"runs\": " << ns.size()
+                  << ", \"min_ns_per_op\": " << this->number(min) << ", \"median_ns_per_op\": " << this->number(median)
+                  << ", \"mean_ns_per_op\": " << this->number(mean) << ", \"stddev_ns_per_op\": " << this->number(stddev)
+                  << ", \"bytes_per_entry\": " << this->number(result.bytes_per_entry) << "}";
+      } else {
+        this->_os << result.benchmark << ',' << result.container << ',' << result.key << ',' << result.key_size << ','
+                  << result.value_size << ',' << result.count << ',' << result.threads << ',' << result.operations << ','
+                  << ns.size() << ',' << this->number(min) << ',' << this->number(median) << ',' << this->number(mean)
+                  << ',' << this->number(stddev) << ',' << this->number(result.bytes_per_entry) << '\n';
+      }
+
+      this->_os.flush();
+      this->_first = false;
+    }
+  };
+
+  /// @brief The number of bytes currently allocated through the counting allocators
+  std::size_t allocated_bytes;
+
+  /// @brief Standard allocator counting the bytes it allocates
+  template <typename T>
+  struct Counting_allocator {
+    using value_type = T;
+
+    Counting_allocator() noexcept = default;
+
+    template <typename U>
+    Counting_allocator(const Counting_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+      allocated_bytes += n * sizeof(T);
+      return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* pointer, std::size_t n) noexcept {
+      allocated_bytes -= n * sizeof(T);
+      std::allocator<T>().deallocate(pointer, n);
+    }
+
+    friend bool operator==(const Counting_allocator&, const Counting_allocator&) noexcept {
+      return true;
+    }
+
+    friend bool operator!=(const Counting_allocator&, const Counting_allocator&) noexcept {
+      return false;
+    }
+  };
+
+  /// @brief The header of the blocks of the counting allocator of C maps, recording their size
+  union alignas(std::max_align_t) Counted_block {
+    std::size_t size;
+  };
+
+  void* counting_allocate(void*, std::size_t size) {
+    Counted_block* block = static_cast<Counted_block*>(std::malloc(sizeof(Counted_block) + size));
+
+    if (block == nullptr)
+      return nullptr;
+
+    block->size = size;
+    allocated_bytes += size;
+    return block + 1;
+  }
+
+  void counting_free(void*, void* pointer) {
+    if (pointer != nullptr) {
+      Counted_block* block = static_cast<Counted_block*>(pointer) - 1;
+      allocated_bytes -= block->size;
+      std::free(block);
+    }
+  }
+
+  void* counting_reallocate(void* data, void* pointer, std::size_t size) {
+    void* new_pointer = counting_allocate(data, size);
+
+    if (new_pointer != nullptr && pointer != nullptr) {
+      std::memcpy(new_pointer, pointer, std::min(size, (static_cast<Counted_block*>(pointer) - 1)->size));
+      counting_free(data, pointer);
+    }
+
+    return new_pointer;
+  }
+
+  const Allocator_methods counting_allocator_methods = {counting_allocate, counting_reallocate, counting_free, nullptr};
+
+  /// @brief Allocator of C maps counting the bytes it allocates
+  const Allocator counting_allocator = {nullptr, &counting_allocator_methods};
+
+  /// @brief Trivially copyable bytes, ordered as by @c memcmp
+  template <std::size_t Size>
+  struct Blob {
+    unsigned char bytes[Size];
+
+    friend bool operator<(const Blob& x, const Blob& y) noexcept {
+      return std::memcmp(x.bytes, y.bytes, Size) < 0;
+    }
+  };
+
+  template <std::size_t Size>
+  int blob_compare(const void*, const void* x, const void* y) {
+    return std::memcmp(x, y, Size);
+  }
+
+  template <std::size_t Size>
+  const Comparator_methods blob_comparator_methods = {blob_compare<Size>, COMPARATOR_CUSTOM};
+
+  /// @brief Describes the keys of the benchmarks, made in strictly increasing order, and their representation in C maps
+  template <typename Key>
+  struct Key_traits;
+
+  template <>
+  struct Key_traits<int> {
+    /// @brief The type of the keys of C maps
+    using C_key = int;
+
+    static std::string name() {
+      return "int";
+    }
+
+    static constexpr std::size_t size = sizeof(int);
+
+    /// @brief Whether C map images and streams may hold the keys, which must not be pointers
+    static constexpr bool is_flat = true;
+
+    static std::vector<int> make(std::size_t count, std::default_random_engine&) {
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      return keys;
+    }
+
+    static Comparator comparator() {
+      return int_comparator;
+    }
+
+    static const C_key& c_key(const int& key) {
+      return key;
+    }
+  };
+
+  template <std::size_t Size>
+  struct Key_traits<Blob<Size>> {
+    using C_key = Blob<Size>;
+
+    static std::string name() {
+      return "blob" + std::to_string(Size);
+    }
+
+    static constexpr std::size_t size = Size;
+    static constexpr bool is_flat = true;
+
+    /// @brief Makes keys of random leading bytes, made distinct by their trailing bytes
+    static std::vector<Blob<Size>> make(std::size_t count, std::default_random_engine& engine) {
+      static_assert(Size >= sizeof(std::uint32_t));
+      std::vector<Blob<Size>> keys(count);
+      std::uniform_int_distribution<int> byte(0, 255);
+
+      for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t j = 0; j < Size - sizeof(std::uint32_t); ++j) {
+          keys[i].bytes[j] = static_cast<unsigned char>(byte(engine));
+        }
+
+        for (std::size_t j = 0; j < sizeof(std::uint32_t); ++j) {
+          keys[i].bytes[Size - 1 - j] = static_cast<unsigned char>(i >> (8 * j));
+        }
+      }
+
+      std::sort(keys.begin(), keys.end());
+      return keys;
+    }
+
+    static Comparator comparator() {
+      return Comparator{nullptr, &blob_comparator_methods<Size>};
+    }
+
+    static const C_key& c_key(const Blob<Size>& key) {
+      return key;
+    }
+  };
+
+  /// @brief Strings of random hexadecimal digits, stored by C maps as @c Map_string keys
+  template <std::size_t Length>
+  struct String {
+    std::string chars;
+
+    /// @brief The key of C maps, referring to @c chars
+    Map_string c_key;
+  };
+
+  template <std::size_t Length>
+  struct Key_traits<String<Length>> {
+    using C_key = Map_string;
+
+    static std::string name() {
+      return "string" + std::to_string(Length);
+    }
+
+    static constexpr std::size_t size = Length;
+    static constexpr bool is_flat = false;
+
+    static std::vector<String<Length>> make(std::size_t count, std::default_random_engine& engine) {
+      std::vector<std::string> chars(count);
+      std::uniform_int_distribution<int> digit(0, 15);
+
+      for (std::size_t i = 0; i < count; ++i) {
+        // The trailing digits of the index keep keys distinct:
+
+        for (std::size_t j = 0; j < Length; ++j) {
+          chars[i] += "0123456789abcdef"[j + 8 < Length ? digit(engine) : (i >> (4 * (Length - 1 - j))) % 16];
+        }
+      }
+
+      std::sort(chars.begin(), chars.end());
+      std::vector<String<Length>> keys(count);
+
+      for (std::size_t i = 0; i < count; ++i) {
+        keys[i].chars = std::move(chars[i]);
+        keys[i].c_key = map_string(keys[i].chars.data(), keys[i].chars.size());
+      }
+
+      return keys;
+    }
+
+    static Comparator comparator() {
+      return map_string_comparator;
+    }
+
+    static const C_key& c_key(const String<Length>& key) {
+      return key.c_key;
+    }
+  };
+
+  /// @brief The key of standard and C++ maps, the string of characters for strings
+  template <typename Key>
+  struct Cpp_key {
+    using type = Key;
+
+    static const Key& of(const Key& key) {
+      return key;
+    }
+  };
+
+  template <std::size_t Length>
+  struct Cpp_key<String<Length>> {
+    using type = std::string;
+
+    static const std::string& of(const String<Length>& key) {
+      return key.chars;
+    }
+  };
+
+  /// @brief Access patterns, as sequences of the indices of keys
+  namespace patterns {
+    std::vector<std::size_t> sequential(std::size_t count, unsigned) {
+      std::vector<std::size_t> indices(count);
+      std::iota(indices.begin(), indices.end(), 0);
+      return indices;
+    }
+
+    std::vector<std::size_t> random(std::size_t count, unsigned seed) {
+      std::vector<std::size_t> indices = sequential(count, seed);
+      std::shuffle(indices.begin(), indices.end(), std::default_random_engine(seed));
+      return indices;
+    }
+
+    /// @brief Draws indices following Zipf's law of exponent 0.99, whose popular keys are scattered among the others
+    std::vector<std::size_t> zipfian(std::size_t count, unsigned seed) {
+      std::vector<double> weights(count);
+
+      for (std::size_t rank = 0; rank < count; ++rank) {
+        weights[rank] = 1 / std::pow(static_cast<double>(rank + 1), 0.99);
+      }
+
+      std::default_random_engine engine(seed);
+      std::discrete_distribution<std::size_t> distribution(weights.begin(), weights.end());
+      std::vector<std::size_t> ranked = random(count, seed + 1);
+      std::vector<std::size_t> indices(count);
+
+      for (std::size_t& index : indices) {
+        index = ranked[distribution(engine)];
+      }
+
+      return indices;
+    }
+  }
+
+  /// @brief @c std::map, holding keys given by their index into the keys of a benchmark
+  template <typename Key, typename Value>
+  class Std_bench_map {
+    using K = typename Cpp_key<Key>::type;
+
+    const std::vector<Key>& _keys;
+    std::map<K, Value, std::less<K>, Counting_allocator<std::pair<const K, Value>>> _map;
+
+  public:
+    Std_bench_map(const std::vector<Key>& keys) : _keys(keys), _map() {}
+
+    void insert(std::size_t index, const Value& value) {
+      this->_map.insert_or_assign(Cpp_key<Key>::of(this->_keys[index]), value);
+    }
+
+    bool lookup(std::size_t index) const {
+      return this->_map.find(Cpp_key<Key>::of(this->_keys[index])) != this->_map.end();
+    }
+
+    bool remove(std::size_t index) {
+      return this->_map.erase(Cpp_key<Key>::of(this->_keys[index])) != 0;
+    }
+  };
+
+  /// @brief @c cpp::Map, holding keys given by their index into the keys of a benchmark
+  template <typename Key, typename Value>
+  class Cpp_bench_map {
+    using K = typename Cpp_key<Key>::type;
+
+    const std::vector<Key>& _keys;
+    cpp::Map<K, Value, std::less<K>, Counting_allocator<std::pair<const K, Value>>> _map;
+
+  public:
+    Cpp_bench_map(const std::vector<Key>& keys) : _keys(keys), _map() {}
+
+    void insert(std::size_t index, const Value& value) {
+      this->_map.insert(Cpp_key<Key>::of(this->_keys[index]), value);
+    }
+
+    bool lookup(std::size_t index) const {
+      return this->_map.lookup(Cpp_key<Key>::of(this->_keys[index])) != nullptr;
+    }
+
+    bool remove(std::size_t index) {
+      return this->_map.remove(Cpp_key<Key>::of(this->_keys[index]));
+    }
+  };
+
+  /// @brief C @c Map, holding keys given by their index into the keys of a benchmark
+  template <typename Key, typename Value>
+  class C_bench_map {
+    using C_key = typename Key_traits<Key>::C_key;
+
+    const std::vector<Key>& _keys;
+    Map* _map;
+
+  public:
+    C_bench_map(const std::vector<Key>& keys, Map_options options) : _keys(keys), _map(nullptr) {
+      options.string_keys = std::is_same_v<C_key, Map_string>;
+
+      this->_map = map_new_with_options(
+        Layout{sizeof(C_key), alignof(C_key)},
+        Layout{sizeof(Value), alignof(Value)},
+        Key_traits<Key>::comparator(),
+        counting_allocator,
+        options
+      );
+
+      if (this->_map == nullptr)
+        throw std::bad_alloc();
+    }
+
+    C_bench_map(const C_bench_map&) = delete;
+
+    C_bench_map& operator=(const C_bench_map&) = delete;
+
+    ~C_bench_map() {
+      map_destroy(this->_map);
+    }
+
+    Map* map() const noexcept {
+      return this->_map;
+    }
+
+    const C_key* key(std::size_t index) const {
+      return &Key_traits<Key>::c_key(this->_keys[index]);
+    }
+
+    void insert(std::size_t index, const Value& value) {
+      if (!map_insert(this->_map, this->key(index), &value))
+        throw std::bad_alloc();
+    }
+
+    bool lookup(std::size_t index) const {
+      return map_lookup(this->_map, this->key(index)) != nullptr;
+    }
+
+    bool remove(std::size_t index) {
+      return map_remove(this->_map, this->key(index));
+    }
+  };
+
+  /// @brief Measures the duration of a call
+  template <typename F>
+  Clock::duration time(F&& f) {
+    Clock::time_point t0 = Clock::now();
+    f();
+    return Clock::now() - t0;
+  }
+
+  /// @brief Runs the benchmarks selected by the options, reporting their results
+  class Runner {
+    const Options& _options;
+    Reporter& _reporter;
+
+  public:
+    Runner(const Options& options, Reporter& reporter) : _options(options), _reporter(reporter) {}
+
+    const Options& options() const noexcept {
+      return this->_options;
+    }
+
+    /// @brief Determines if a benchmark is selected, by the name joining its benchmark, container and key
+    bool selected(const Result& result) const {
+      std::string name = result.benchmark + '/' + result.container + '/' + result.key;
+      return name.find(this->_options.filter) != std::string::npos;
+    }
+
+    /// @brief Runs a benchmark once to warm up, then for the measured runs, and reports its result
+    /// @param setup The function making the state of a run, untimed
+    /// @param body The function running the benchmark on the state of a run, returning its duration
+    /// @param measure_memory If @c true, the bytes allocated by the state of the last run are measured
+    template <typename Setup, typename Body>
+    void run(Result result, Setup setup, Body body, bool measure_memory = false) {
+      if (!this->selected(result))
+        return;
+
+      for (std::size_t run = 0; run <= this->_options.runs; ++run) {
+        std::size_t bytes = allocated_bytes;
+        auto state = setup();
+        Clock::duration duration = body(state);
+
+        if (run != 0)
+          result.run_ns.push_back(std::chrono::duration<double, std::nano>(duration).count());
+
+        if (measure_memory && run == this->_options.runs)
+          result.bytes_per_entry = static_cast<double>(allocated_bytes - bytes) / static_cast<double>(result.count);
+      }
+
+      this->_reporter.report(result);
+    }
+  };
+
+  /// @brief Map generated by @c MAP_DEFINE, holding keys given by their index into the keys of a benchmark
+  template <typename Key, typename Value>
+  class Defined_bench_map;
+
+  /// @brief Generates a map of @c int keys and values of a given type, along with its benchmark adapter
+#define BENCH_DEFINE_MAP(NAME, VALUE)                                       \
+  MAP_DEFINE(NAME, int, VALUE, (*a > *b) - (*a < *b))                       \
+                                                                            \
+  template <>                                                               \
+  class Defined_bench_map<int, VALUE> {                                     \
+    const std::vector<int>& _keys;                                          \
+    NAME* _map;                                                             \
+                                                                            \
+  public:                                                                   \
+    Defined_bench_map(const std::vector<int>& keys) :                       \
+      _keys(keys), _map(NAME##_new()) {                                     \
+      if (this->_map == nullptr)                                            \
+        throw std::bad_alloc();                                             \
+    }                                                                       \
+                                                                            \
+    Defined_bench_map(const Defined_bench_map&) = delete;                   \
+                                                                            \
+    Defined_bench_map& operator=(const Defined_bench_map&) = delete;        \
+                                                                            \
+    ~Defined_bench_map() {                                                  \
+      NAME##_destroy(this->_map);                                           \
+    }                                                                       \
+                                                                            \
+    void insert(std::size_t index, const VALUE& value) {                    \
+      if (!NAME##_insert(this->_map, &this->_keys[index], &value))          \
+        throw std::bad_alloc();                                             \
+    }                                                                       \
+                                                                            \
+    bool lookup(std::size_t index) const {                                  \
+      return NAME##_lookup(this->_map, &this->_keys[index]) != nullptr;     \
+    }                                                                       \
+                                                                            \
+    bool remove(std::size_t index) {                                        \
+      return NAME##_remove(this->_map, &this->_keys[index]);                \
+    }                                                                       \
+  };
+
+  BENCH_DEFINE_MAP(Blob_4_map, Blob<4>)
+  BENCH_DEFINE_MAP(Blob_64_map, Blob<64>)
+
+#undef BENCH_DEFINE_MAP
+
+  /// @brief Runs the benchmarks of single-threaded operations common to all maps
+  /// @param make The function making an empty map
+  template <typename Key, typename Value, typename Make>
+  void bench_operations(Runner& runner, const std::string& container, const std::vector<Key>& keys, Make make) {
+    using M = decltype(*make());
+
+    std::size_t count = keys.size();
+    Value value{};
+    Result result{"", container, Key_traits<Key>::name(), Key_traits<Key>::size, sizeof(Value), count, 1, count, {}};
+
+    auto empty = [&] {
+      return make();
+    };
+
+    auto full = [&] {
+      auto map = make();
+
+      for (std::size_t i = 0; i < count; ++i) {
+        map->insert(i, value);
+      }
+
+      return map;
+    };
+
+    std::vector<std::size_t> sequential = patterns::sequential(count, 0);
+    std::vector<std::size_t> random = patterns::random(count, 1);
+    std::vector<std::size_t> zipfian = patterns::zipfian(count, 2);
+
+    for (const auto& [name, indices] : {std::pair{"insert_sequential", &sequential}, std::pair{"insert_random", &random}}) {
+      result.benchmark = name;
+
+      runner.run(result, empty, [&](auto& map) {
+        return time([&] {
+          for (std::size_t index : *indices) {
+            map->insert(index, value);
+          }
+        });
+      }, true);
+    }
+
+    auto lookups = [&](const char* name, const std::vector<std::size_t>& indices) {
+      result.benchmark = name;
+      std::shared_ptr<std::remove_reference_t<M>> map;
+
+      runner.run(result, [&] {
+        if (map == nullptr)
+          map = full();
+
+        return map;
+      }, [&](auto& map) {
+        return time([&] {
+          std::size_t found = 0;
+
+          for (std::size_t index : indices) {
+            found += map->lookup(index);
+          }
+
+          sink = found;
+        });
+      });
+    };
+
+    lookups("lookup_sequential", sequential);
+    lookups("lookup_random", random);
+    lookups("lookup_zipfian", zipfian);
+    result.benchmark = "remove_random";
+
+    runner.run(result, full, [&](auto& map) {
+      return time([&] {
+        for (std::size_t index : random) {
+          map->remove(index);
+        }
+      });
+    });
+
+    // Mixed operations, on a map holding half the keys: half of them lookups, a quarter insertions and a quarter
+    // removals:
+
+    result.benchmark = "mixed_random";
+    std::vector<std::size_t> operations = patterns::random(count, 3);
+
+    runner.run(result, [&] {
+      auto map = make();
+
+      for (std::size_t i = 0; i < count; i += 2) {
+        map->insert(i, value);
+      }
+
+      return map;
+    }, [&](auto& map) {
+      return time([&] {
+        std::size_t found = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+          switch (operations[i] % 4) {
+            case 0:
+              map->insert(random[i], value);
+              break;
+
+            case 1:
+              map->remove(random[i]);
+              break;
+
+            default:
+              found += map->lookup(random[i]);
+              break;
+          }
+        }
+
+        sink = found;
+      });
+    });
+  }
+
+  /// @brief Owning pointer to a C map
+  using Map_pointer = std::unique_ptr<Map, decltype(&map_destroy)>;
+
+  /// @brief Runs the benchmarks of operations specific to C maps
+  template <typename Key, typename Value>
+  void bench_c_operations(Runner& runner, const std::string& container, const std::vector<Key>& keys, Map_options options) {
+    using C_key = typename Key_traits<Key>::C_key;
+
+    std::size_t count = keys.size();
+    Result result{"", container, Key_traits<Key>::name(), Key_traits<Key>::size, sizeof(Value), count, 1, count, {}};
+    std::vector<std::size_t> random = patterns::random(count, 1);
+    std::vector<C_key> sorted_keys(count);
+    std::vector<C_key> random_keys(count);
+    std::vector<Value> values(count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+      sorted_keys[i] = Key_traits<Key>::c_key(keys[i]);
+      random_keys[i] = Key_traits<Key>::c_key(keys[random[i]]);
+    }
+
+    auto make = [&] {
+      return std::make_shared<C_bench_map<Key, Value>>(keys, options);
+    };
+
+    std::shared_ptr<C_bench_map<Key, Value>> full;
+
+    auto make_full = [&] {
+      if (full == nullptr) {
+        full = make();
+
+        if (!map_build(full->map(), sorted_keys.data(), values.data(), count))
+          throw std::bad_alloc();
+      }
+
+      return full;
+    };
+
+    result.benchmark = "build";
+
+    runner.run(result, make, [&](auto& map) {
+      return time([&] {
+        if (!map_build(map->map(), sorted_keys.data(), values.data(), count))
+          throw std::bad_alloc();
+      });
+    }, true);
+
+    result.benchmark = "lookup_many_random";
+
+    runner.run(result, make_full, [&](auto& map) {
+      std::vector<void*> found(count);
+
+      return time([&] {
+        map_lookup_many(map->map(), random_keys.data(), count, found.data());
+        sink = found[count / 2] != nullptr;
+      });
+    });
+
+    result.benchmark = "scan";
+
+    runner.run(result, make_full, [&](auto& map) {
+      return time([&] {
+        sink = map_scan(map->map(), nullptr, nullptr, [](const void*, void*, void*) {
+          return true;
+        }, nullptr);
+      });
+    });
+
+    result.benchmark = "copy";
+
+    runner.run(result, [&] {
+      return std::pair<std::shared_ptr<C_bench_map<Key, Value>>, Map_pointer>(make_full(), Map_pointer(nullptr, map_destroy));
+    }, [&](auto& state) {
+      return time([&] {
+        state.second.reset(map_copy(state.first->map()));
+
+        if (state.second == nullptr)
+          throw std::bad_alloc();
+      });
+    });
+
+    if constexpr (Key_traits<Key>::is_flat) {
+      Layout key_layout{sizeof(C_key), alignof(C_key)};
+      Layout value_layout{sizeof(Value), alignof(Value)};
+      std::string stream;
+
+      auto dump = [&] {
+        if (stream.empty()) {
+          map_dump(make_full()->map(), key_layout, value_layout, [](void* data, const void* bytes, std::size_t size) {
+            static_cast<std::string*>(data)->append(static_cast<const char*>(bytes), size);
+            return true;
+          }, &stream);
+        }
+      };
+
+      result.benchmark = "stream_load";
+
+      runner.run(result, [&] {
+        dump();
+        return std::pair<std::shared_ptr<C_bench_map<Key, Value>>, std::size_t>(make(), 0);
+      }, [&](auto& state) {
+        return time([&] {
+          bool loaded = map_load(state.first->map(), key_layout, value_layout, [](void* data, void* bytes, std::size_t size) {
+            auto* source = static_cast<std::pair<const std::string*, std::size_t>*>(data);
+            size = std::min(size, source->first->size() - source->second);
+            std::memcpy(bytes, source->first->data() + source->second, size);
+            source->second += size;
+            return size;
+          }, std::make_unique<std::pair<const std::string*, std::size_t>>(&stream, 0).get());
+
+          if (!loaded)
+            throw std::bad_alloc();
+        });
+      });
+
+      // Images are written to a temporary file, and mapped back for lookups:
+
+      std::string path = (std::filesystem::temp_directory_path() / ("bench_image_" + std::to_string(count))).string();
+      std::unique_ptr<Map_image, decltype(&map_image_close)> image(nullptr, map_image_close);
+      result.benchmark = "image_lookup_random";
+
+      runner.run(result, [&] {
+        if (image == nullptr) {
+          std::FILE* file = std::fopen(path.c_str(), "wb");
+
+          if (file == nullptr || !map_image_write(make_full()->map(), key_layout, value_layout, file))
+            throw std::runtime_error("could not write " + path);
+
+          std::fclose(file);
+          image.reset(map_image_open(path.c_str(), key_layout, value_layout, Key_traits<Key>::comparator()));
+          std::filesystem::remove(path);
+
+          if (image == nullptr)
+            throw std::runtime_error("could not open " + path);
+        }
+
+        return image.get();
+      }, [&](Map_image* image) {
+        return time([&] {
+          std::size_t found = 0;
+
+          for (const C_key& key : random_keys) {
+            found += map_image_lookup(image, &key) != nullptr;
+          }
+
+          sink = found;
+        });
+      });
+    }
+  }
+
+  /// @brief Runs all single-threaded benchmarks of keys and values of given types
+  template <typename Key, typename Value>
+  void bench_maps(Runner& runner, std::default_random_engine& engine) {
+    for (int shift : runner.options().shifts) {
+      std::vector<Key> keys = Key_traits<Key>::make(std::size_t{1} << shift, engine);
+
+      bench_operations<Key, Value>(runner, "std::map", keys, [&] {
+        return std::make_unique<Std_bench_map<Key, Value>>(keys);
+      });
+
+      bench_operations<Key, Value>(runner, "cpp::Map", keys, [&] {
+        return std::make_unique<Cpp_bench_map<Key, Value>>(keys);
+      });
+
+      if constexpr (std::is_same_v<Key, int>) {
+        bench_operations<Key, Value>(runner, "MAP_DEFINE", keys, [&] {
+          return std::make_unique<Defined_bench_map<Key, Value>>(keys);
+        });
+      }
+
+      std::vector<std::pair<std::string, Map_options>> variants = {
+        {"Map", Map_options{}},
+        {"Map+pool", Map_options{}},
+        {"Map+order_statistics", Map_options{}},
+      };
+
+      variants[1].second.pool_chunk_size = 1024;
+      variants[2].second.order_statistics = true;
+
+      if (Key_traits<Key>::is_flat) {
+        variants.emplace_back("Map+b_tree", Map_options{});
+        variants.back().second.b_tree = true;
+      }
+
+      for (const auto& [container, options] : variants) {
+        bench_operations<Key, Value>(runner, container, keys, [&, options = options] {
+          return std::make_unique<C_bench_map<Key, Value>>(keys, options);
+        });
+
+        bench_c_operations<Key, Value>(runner, container, keys, options);
+      }
+    }
+  }
+
+  /// @brief Runs reader threads, each looking up keys in a random order, along with an optional writer thread
+  /// reinserting keys until the readers are done
+  /// @return The duration from the start of the readers to the end of the last one
+  template <typename Lookup, typename Write>
+  Clock::duration run_readers(std::size_t threads, std::size_t operations, std::size_t count, Lookup lookup, Write write) {
+    std::atomic<std::size_t> ready(0);
+    std::atomic<bool> started(false);
+    std::atomic<std::size_t> running(threads);
+    std::vector<std::thread> workers;
+
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers.emplace_back([&, i] {
+        std::vector<std::size_t> indices = patterns::random(count, static_cast<unsigned>(i + 1));
+        ready += 1;
+
+        while (!started) {
+          std::this_thread::yield();
+        }
+
+        std::size_t found = 0;
+
+        for (std::size_t j = 0; j < operations; ++j) {
+          found += lookup(static_cast<int>(indices[j % count]));
+        }
+
+        sink = found;
+        running -= 1;
+      });
+    }
+
+    std::thread writer([&] {
+      while (!started) {
+        std::this_thread::yield();
+      }
+
+      for (std::size_t j = 0; running != 0; ++j) {
+        if (!write(static_cast<int>(j % count)))
+          break;
+      }
+    });
+
+    while (ready != threads) {
+      std::this_thread::yield();
+    }
+
+    Clock::time_point t0 = Clock::now();
+    started = true;
+
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+
+    Clock::duration duration = Clock::now() - t0;
+    writer.join();
+    return duration;
+  }
+
+  /// @brief Runs the benchmarks of reader threads on the maps which support concurrent reads
+  void bench_readers(Runner& runner) {
+    Layout int_layout{sizeof(int), alignof(int)};
+
+    for (int shift : runner.options().shifts) {
+      std::size_t count = std::size_t{1} << shift;
+
+      // Enough lookups per thread that starting threads is negligible:
+      std::size_t operations = std::max<std::size_t>(count, std::size_t{1} << 16);
+
+      Map_pointer c_map(map_new(int_layout, int_layout, int_comparator), map_destroy);
+      std::unique_ptr<Concurrent_map, decltype(&concurrent_map_destroy)> concurrent_map(concurrent_map_new(int_layout, int_layout, int_comparator), concurrent_map_destroy);
+      std::unique_ptr<Persistent_map, decltype(&persistent_map_destroy)> persistent_map(persistent_map_new(int_layout, int_layout, int_comparator), persistent_map_destroy);
+
+      Sharded_map_partition partition = {[](void*, const void* key) {
+        return static_cast<std::size_t>(*static_cast<const int*>(key)) * 2654435761u;
+      }, nullptr, nullptr};
+
+      std::unique_ptr<Sharded_map, decltype(&sharded_map_destroy)> sharded_map(sharded_map_new(int_layout, int_layout, int_comparator, 16, partition, Map_options{}), sharded_map_destroy);
+      cpp::Sharded_map<int, int> cpp_sharded_map(16);
+
+      if (c_map == nullptr || concurrent_map == nullptr || persistent_map == nullptr || sharded_map == nullptr)
+        throw std::bad_alloc();
+
+      for (int key = 0; key < static_cast<int>(count); ++key) {
+        if (!map_insert(c_map.get(), &key, &key) || !concurrent_map_insert(concurrent_map.get(), &key, &key) ||
+            !persistent_map_insert(persistent_map.get(), &key, &key) || !sharded_map_insert(sharded_map.get(), &key, &key))
+          throw std::bad_alloc();
+
+        cpp_sharded_map.insert_or_assign(key, key);
+      }
+
+      std::unique_ptr<Persistent_map, decltype(&persistent_map_destroy)> snapshot(persistent_map_snapshot(persistent_map.get()), persistent_map_destroy);
+
+      if (snapshot == nullptr)
+        throw std::bad_alloc();
+
+      auto no_writer = [](int) {
+        return false;
+      };
+
+      for (std::size_t threads = 1; threads <= runner.options().max_threads; threads *= 2) {
+        Result result{"", "", "int", sizeof(int), sizeof(int), count, threads, threads * operations, {}};
+
+        auto readers = [&](const char* benchmark, const char* container, auto lookup, auto write) {
+          result.benchmark = benchmark;
+          result.container = container;
+
+          runner.run(result, [] {
+            return 0;
+          }, [&](int) {
+            return run_readers(threads, operations, count, lookup, write);
+          });
+        };
+
+        readers("readers_random", "Map", [&](int key) {
+          return map_lookup(c_map.get(), &key) != nullptr;
+        }, no_writer);
+
+        readers("readers_random", "Persistent_map", [&](int key) {
+          return persistent_map_lookup(snapshot.get(), &key) != nullptr;
+        }, no_writer);
+
+        struct Writable {
+          const char* container;
+          std::function<bool(int)> lookup;
+          std::function<bool(int)> write;
+        };
+
+        const Writable writables[] = {
+          {"Concurrent_map", [&](int key) {
+            int value;
+            return concurrent_map_lookup(concurrent_map.get(), &key, &value);
+          }, [&](int key) {
+            return concurrent_map_insert(concurrent_map.get(), &key, &key);
+          }},
+          {"Sharded_map", [&](int key) {
+            int value;
+            return sharded_map_lookup(sharded_map.get(), &key, &value);
+          }, [&](int key) {
+            return sharded_map_insert(sharded_map.get(), &key, &key);
+          }},
+          {"cpp::Sharded_map", [&](int key) {
+            return cpp_sharded_map.lookup(key).has_value();
+          }, [&](int key) {
+            cpp_sharded_map.insert_or_assign(key, key);
+            return true;
+          }},
+        };
+
+        for (const Writable& writable : writables) {
+          readers("readers_random", writable.container, writable.lookup, no_writer);
+          readers("readers_with_writer", writable.container, writable.lookup, writable.write);
+        }
+      }
+    }
+  }
+
+  /// @brief Parses a nonnegative integer
+  std::size_t parse_size(const std::string& string) {
+    std::size_t end;
+    unsigned long long size = std::stoull(string, &end);
+
+    if (end != string.size() || size > std::numeric_limits<std::size_t>::max())
+      throw std::invalid_argument(string);
+
+    return static_cast<std::size_t>(size);
+  }
+
+  void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--format=csv|json] [--shifts=S,...] [--runs=N] [--threads=N] [--filter=NAME]\n"
+              << "  --format   output format (default: csv)\n"
+              << "  --shifts   base-2 logarithms of the map sizes (default: 10,14,18)\n"
+              << "  --runs     measured runs of each benchmark, after a warm-up run (default: 5)\n"
+              << "  --threads  greatest number of reader threads (default: hardware concurrency)\n"
+              << "  --filter   runs the benchmarks whose benchmark/container/key name contains NAME\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string argument = argv[i];
+      std::size_t equals = argument.find('=');
+      std::string name = argument.substr(0, equals);
+      std::string value = equals != std::string::npos ? argument.substr(equals + 1) : "";
+
+      if (name == "--format" && (value == "csv" || value == "json")) {
+        options.format = value;
+      } else if (name == "--shifts" && !value.empty()) {
+        options.shifts.clear();
+        std::istringstream shifts(value);
+
+        for (std::string shift; std::getline(shifts, shift, ',');) {
+          std::size_t parsed = parse_size(shift);
+
+          if (parsed > 30)
+            throw std::out_of_range(shift);
+
+          options.shifts.push_back(static_cast<int>(parsed));
+        }
+      } else if (name == "--runs" && !value.empty()) {
+        options.runs = std::max<std::size_t>(1, parse_size(value));
+      } else if (name == "--threads" && !value.empty()) {
+        options.max_threads = std::max<std::size_t>(1, parse_size(value));
+      } else if (name == "--filter") {
+        options.filter = value;
+      } else {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+  } catch (const std::logic_error&) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::default_random_engine engine(0);
+  Reporter reporter(std::cout, options.format == "json");
+  Runner runner(options, reporter);
+
+  bench_maps<int, Blob<4>>(runner, engine);
+  bench_maps<int, Blob<64>>(runner, engine);
+  bench_maps<Blob<16>, Blob<16>>(runner, engine);
+  bench_maps<String<8>, Blob<4>>(runner, engine);
+  bench_maps<String<32>, Blob<4>>(runner, engine);
+  bench_readers(runner);
+  return EXIT_SUCCESS;
+}
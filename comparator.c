@@ -14,6 +14,7 @@ static int char_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods char_comparator_methods = {
   .compare = char_compare,
+  .kind = COMPARATOR_CHAR,
 };
 
 const Comparator char_comparator = {
@@ -30,6 +31,7 @@ static int wchar_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods wchar_comparator_methods = {
   .compare = wchar_compare,
+  .kind = COMPARATOR_WCHAR,
 };
 
 const Comparator wchar_comparator = {
@@ -46,6 +48,7 @@ static int schar_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods schar_comparator_methods = {
   .compare = schar_compare,
+  .kind = COMPARATOR_SCHAR,
 };
 
 const Comparator schar_comparator = {
@@ -62,6 +65,7 @@ static int short_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods short_comparator_methods = {
   .compare = short_compare,
+  .kind = COMPARATOR_SHORT,
 };
 
 const Comparator short_comparator = {
@@ -78,6 +82,7 @@ static int int_compare(const void* comparator, const void* _x, const void* _y) {
 
 static const Comparator_methods int_comparator_methods = {
   .compare = int_compare,
+  .kind = COMPARATOR_INT,
 };
 
 const Comparator int_comparator = {
@@ -94,6 +99,7 @@ static int long_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods long_comparator_methods = {
   .compare = long_compare,
+  .kind = COMPARATOR_LONG,
 };
 
 const Comparator long_comparator = {
@@ -110,6 +116,7 @@ static int llong_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods llong_comparator_methods = {
   .compare = llong_compare,
+  .kind = COMPARATOR_LLONG,
 };
 
 const Comparator llong_comparator = {
@@ -126,6 +133,7 @@ static int uchar_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods uchar_comparator_methods = {
   .compare = uchar_compare,
+  .kind = COMPARATOR_UCHAR,
 };
 
 const Comparator uchar_comparator = {
@@ -142,6 +150,7 @@ static int ushort_compare(const void* comparator, const void* _x, const void* _y
 
 static const Comparator_methods ushort_comparator_methods = {
   .compare = ushort_compare,
+  .kind = COMPARATOR_USHORT,
 };
 
 const Comparator ushort_comparator = {
@@ -158,6 +167,7 @@ static int uint_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods uint_comparator_methods = {
   .compare = uint_compare,
+  .kind = COMPARATOR_UINT,
 };
 
 const Comparator uint_comparator = {
@@ -174,6 +184,7 @@ static int ulong_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods ulong_comparator_methods = {
   .compare = ulong_compare,
+  .kind = COMPARATOR_ULONG,
 };
 
 const Comparator ulong_comparator = {
@@ -190,6 +201,7 @@ static int ullong_compare(const void* comparator, const void* _x, const void* _y
 
 static const Comparator_methods ullong_comparator_methods = {
   .compare = ullong_compare,
+  .kind = COMPARATOR_ULLONG,
 };
 
 const Comparator ullong_comparator = {
@@ -229,6 +241,7 @@ static int float_compare(const void* comparator, const void* _x, const void* _y)
 
 static const Comparator_methods float_comparator_methods = {
   .compare = float_compare,
+  .kind = COMPARATOR_FLOAT,
 };
 
 const Comparator float_comparator = {
@@ -268,6 +281,7 @@ static int double_compare(const void* comparator, const void* _x, const void* _y
 
 static const Comparator_methods double_comparator_methods = {
   .compare = double_compare,
+  .kind = COMPARATOR_DOUBLE,
 };
 
 const Comparator double_comparator = {
@@ -307,6 +321,7 @@ static int ldouble_compare(const void* comparator, const void* _x, const void* _
 
 static const Comparator_methods ldouble_comparator_methods = {
   .compare = ldouble_compare,
+  .kind = COMPARATOR_LDOUBLE,
 };
 
 const Comparator ldouble_comparator = {
@@ -323,6 +338,7 @@ static int string_compare(const void* comparator, const void* _x, const void* _y
 
 static const Comparator_methods string_comparator_methods = {
   .compare = string_compare,
+  .kind = COMPARATOR_STRING,
 };
 
 const Comparator string_comparator = {
@@ -339,6 +355,7 @@ static int wstring_compare(const void* comparator, const void* _x, const void* _
 
 static const Comparator_methods wstring_comparator_methods = {
   .compare = wstring_compare,
+  .kind = COMPARATOR_WSTRING,
 };
 
 const Comparator wstring_comparator = {
@@ -1,8 +1,36 @@
 #ifndef COMPARATOR_H
 #define COMPARATOR_H
 
+/// @brief Identification of the builtin comparators, whose comparisons maps may perform inline
+typedef enum Comparator_kind {
+  COMPARATOR_CUSTOM = 0,
+  COMPARATOR_CHAR,
+  COMPARATOR_WCHAR,
+  COMPARATOR_SCHAR,
+  COMPARATOR_SHORT,
+  COMPARATOR_INT,
+  COMPARATOR_LONG,
+  COMPARATOR_LLONG,
+  COMPARATOR_UCHAR,
+  COMPARATOR_USHORT,
+  COMPARATOR_UINT,
+  COMPARATOR_ULONG,
+  COMPARATOR_ULLONG,
+  COMPARATOR_FLOAT,
+  COMPARATOR_DOUBLE,
+  COMPARATOR_LDOUBLE,
+  COMPARATOR_STRING,
+  COMPARATOR_WSTRING,
+
+  /// @brief @c map_string_comparator, declared along with the keys it compares
+  COMPARATOR_MAP_STRING,
+} Comparator_kind;
+
 typedef struct Comparator_methods {
   int (*compare)(const void* data, const void* x, const void* y);
+
+  /// @brief The kind of the comparator: @c COMPARATOR_CUSTOM unless @c compare behaves as a builtin comparator
+  Comparator_kind kind;
 } Comparator_methods;
 
 typedef struct Comparator {
@@ -14,6 +42,11 @@ static inline int comparator_compare(Comparator comparator, const void* x, const
   return comparator.methods->compare(comparator.data, x, y);
 }
 
+/// @brief Returns the kind of a comparator
+static inline Comparator_kind comparator_kind(Comparator comparator) {
+  return comparator.methods->kind;
+}
+
 extern const Comparator char_comparator;
 extern const Comparator wchar_comparator;
 
@@ -0,0 +1,369 @@
+#include "concurrent_map.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cow_tree.h"
+#include "mutex.h"
+
+/// @brief The maximum number of nodes a single insertion or removal retires: those along the path and their siblings,
+/// plus a few around the removed node and the final rotation
+#define CONCURRENT_WRITE_RETIREMENTS (3 * COW_PATH_CAPACITY + 8)
+
+/// @brief The number of retired nodes past which writers wait for readers to exit so as to free them
+#define CONCURRENT_RECLAMATION_THRESHOLD 1024
+
+/// @brief The number of reader counts per epoch, among which readers spread so as not to contend on a single cache line
+#define CONCURRENT_READER_STRIPES 16
+
+/// @brief The assumed size of cache lines, by which reader counts are spaced
+#define CONCURRENT_CACHE_LINE_SIZE 64
+
+/// @brief Counts of the readers which entered during even and odd epochs, occupying a cache line of their own
+typedef struct Concurrent_stripe {
+  atomic_size_t readers[2];
+  char padding[CONCURRENT_CACHE_LINE_SIZE - 2 * sizeof(atomic_size_t)];
+} Concurrent_stripe;
+
+struct Concurrent_map {
+  /// @brief The root of the published tree, or @c NULL if the map is empty
+  _Atomic(Cow_node*) root;
+
+  /// @brief The number of key-value pairs stored by the published tree
+  atomic_size_t count;
+
+  /// @brief The epoch readers enter, advanced by writers before waiting for the readers of the former epoch to exit
+  atomic_size_t epoch;
+
+  /// @brief The reader counts, allocated apart so that readers update them through a map they do not modify
+  Concurrent_stripe* stripes;
+
+  /// @brief The lock serializing writers, which guards all of the following members
+  Mutex lock;
+
+  /// @brief The tree being written, whose nodes of the version of the write are modified in place
+  Cow_tree draft;
+
+  /// @brief The version of the write in progress, or of the last write
+  size_t version;
+
+  /// @brief The nodes no longer reachable from the draft, to be freed once no reader may reach them
+  Cow_node** retired;
+
+  /// @brief The number of retired nodes
+  size_t retired_count;
+
+  /// @brief The number of retired nodes the array can hold
+  size_t retired_capacity;
+
+  /// @brief The allocator
+  Allocator allocator;
+};
+
+/// @brief The number of reader stripes assigned to threads so far, from which each thread takes its own
+static atomic_size_t concurrent_stripe_assignments;
+
+/// @brief The reader stripe of the running thread, or @c SIZE_MAX until it first reads a map
+static _Thread_local size_t concurrent_stripe = SIZE_MAX;
+
+/// @brief Announces a reader to the writers, which then do not free the nodes of the trees it may walk until it exits
+/// @return The reader count to decrement on exit
+static atomic_size_t* concurrent_map_enter(const Concurrent_map* map) {
+  if (concurrent_stripe == SIZE_MAX)
+    concurrent_stripe = atomic_fetch_add_explicit(&concurrent_stripe_assignments, 1, memory_order_relaxed) % CONCURRENT_READER_STRIPES;
+
+  Concurrent_stripe* stripe = &map->stripes[concurrent_stripe];
+
+  while (true) {
+    // Once counted in an epoch it did not miss the end of, the reader is waited for by any writer retiring nodes later:
+
+    size_t epoch = atomic_load(&((Concurrent_map*)map)->epoch);
+    atomic_size_t* readers = &stripe->readers[epoch & 1];
+    atomic_fetch_add(readers, 1);
+
+    if (atomic_load(&((Concurrent_map*)map)->epoch) == epoch)
+      return readers;
+
+    atomic_fetch_sub_explicit(readers, 1, memory_order_release);
+  }
+}
+
+/// @brief Announces to the writers that a reader no longer walks the tree it loaded on entry
+static inline void concurrent_map_exit(atomic_size_t* readers) {
+  atomic_fetch_sub_explicit(readers, 1, memory_order_release);
+}
+
+/// @brief Loads the root of the published tree, on behalf of a reader which entered
+static inline const Cow_node* concurrent_map_load(const Concurrent_map* map) {
+  return atomic_load_explicit(&((Concurrent_map*)map)->root, memory_order_acquire);
+}
+
+/// @brief Frees the retired nodes, once the readers which may still reach them have exited
+/// @details Readers enter the current epoch, or the former one, from which the epoch is advanced: the readers of the
+/// former epoch that remain then entered before the retirement of the nodes, and are the only ones to be waited for.
+static void concurrent_map_reclaim(Concurrent_map* map) {
+  size_t epoch = atomic_fetch_add(&map->epoch, 1);
+
+  for (size_t i = 0; i < CONCURRENT_READER_STRIPES; i += 1) {
+    while (atomic_load(&map->stripes[i].readers[epoch & 1]) != 0)
+      thread_yield();
+  }
+
+  // Synchronizes with the decrements of exiting readers, so that their reads happen before the nodes are freed:
+  atomic_thread_fence(memory_order_acquire);
+
+  for (size_t i = 0; i < map->retired_count; i += 1)
+    allocator_free(map->allocator, map->retired[i]);
+
+  map->retired_count = 0;
+}
+
+/// @brief Frees the nodes of a tree
+static void concurrent_map_free_tree(Concurrent_map* map, Cow_node* node) {
+  while (node != NULL) {
+    concurrent_map_free_tree(map, node->children[LEFT]);
+    Cow_node* right = node->children[RIGHT];
+    allocator_free(map->allocator, node);
+    node = right;
+  }
+}
+
+/// @brief Frees the nodes of a draft tree allocated by the write in progress, which are only reachable from their
+/// parents allocated by the same write
+static void concurrent_map_free_draft(Concurrent_map* map, Cow_node* node) {
+  while (node != NULL && node->version == map->version) {
+    concurrent_map_free_draft(map, node->children[LEFT]);
+    Cow_node* right = node->children[RIGHT];
+    allocator_free(map->allocator, node);
+    node = right;
+  }
+}
+
+/// @brief Begins a write, with the writer lock held
+/// @return @c true on success, @c false if memory could not be reserved for the nodes the write may retire
+static bool concurrent_map_begin(Concurrent_map* map) {
+  size_t capacity = map->retired_count + CONCURRENT_WRITE_RETIREMENTS;
+
+  if (capacity > map->retired_capacity) {
+    if (capacity < 2 * map->retired_capacity)
+      capacity = 2 * map->retired_capacity;
+
+    Cow_node** retired = map->retired != NULL
+      ? allocator_reallocate(map->allocator, map->retired, capacity * sizeof(Cow_node*))
+      : allocator_allocate(map->allocator, capacity * sizeof(Cow_node*));
+
+    if (retired == NULL)
+      return false;
+
+    map->retired = retired;
+    map->retired_capacity = capacity;
+  }
+
+  map->version += 1;
+  map->draft.root = atomic_load_explicit(&map->root, memory_order_relaxed);
+  return true;
+}
+
+/// @brief Ends a write by publishing the draft tree, then frees the retired nodes if they are numerous enough
+static void concurrent_map_publish(Concurrent_map* map, size_t count) {
+  assert(map->draft.root == NULL || (map->draft.root->version == map->version && map->draft.root->color == BLACK));
+  atomic_store_explicit(&map->root, map->draft.root, memory_order_release);
+  atomic_store_explicit(&map->count, count, memory_order_relaxed);
+
+  if (map->retired_count >= CONCURRENT_RECLAMATION_THRESHOLD)
+    concurrent_map_reclaim(map);
+}
+
+/// @brief Aborts a write, freeing the nodes it allocated and restoring the nodes it retired
+/// @param retired_count The number of retired nodes as of the beginning of the write
+static void concurrent_map_abort(Concurrent_map* map, size_t retired_count) {
+  concurrent_map_free_draft(map, map->draft.root);
+  map->draft.root = atomic_load_explicit(&map->root, memory_order_relaxed);
+  map->retired_count = retired_count;
+}
+
+/// @brief Allocates a node for the write in progress, as a @c Cow_ownership
+static Cow_node* concurrent_map_allocate(void* owner) {
+  Concurrent_map* map = owner;
+  Cow_node* node = allocator_allocate(map->allocator, map->draft.node_size);
+
+  if (node != NULL)
+    node->version = map->version;
+
+  return node;
+}
+
+/// @brief Retires a node no longer reachable from the draft tree, freeing it at once if never published, as a
+/// @c Cow_ownership
+static void concurrent_map_retire(void* owner, Cow_node* node) {
+  Concurrent_map* map = owner;
+
+  if (node->version == map->version) {
+    allocator_free(map->allocator, node);
+  } else {
+    assert(map->retired_count < map->retired_capacity);
+    map->retired[map->retired_count++] = node;
+  }
+}
+
+/// @brief Gets a node the write in progress may modify in place, copying a published node and retiring it, as a
+/// @c Cow_ownership
+static Cow_node* concurrent_map_own(void* owner, Cow_node* node) {
+  Concurrent_map* map = owner;
+
+  if (node->version == map->version)
+    return node;
+
+  Cow_node* copy = allocator_allocate(map->allocator, map->draft.node_size);
+
+  if (copy != NULL) {
+    memcpy(copy, node, map->draft.node_size);
+    copy->version = map->version;
+    concurrent_map_retire(map, node);
+  }
+
+  return copy;
+}
+
+/// @brief Checks that a node was allocated for a past or current version, as a @c Cow_ownership
+static void concurrent_map_check_version(const void* owner, const Cow_node* node) {
+  assert(node->version <= ((const Concurrent_map*)owner)->version);
+  (void)owner;
+  (void)node;
+}
+
+/// @brief The ownership of draft trees, whose nodes may be modified in place during the write which allocated them
+static const Cow_ownership concurrent_ownership = {
+  .reserve = NULL,
+  .allocate = concurrent_map_allocate,
+  .own = concurrent_map_own,
+  .unlink = concurrent_map_retire,
+  .check = concurrent_map_check_version,
+};
+
+Concurrent_map* concurrent_map_new(Layout key_layout, Layout value_layout, Comparator comparator) {
+  return concurrent_map_new_with(key_layout, value_layout, comparator, heap_allocator);
+}
+
+Concurrent_map* concurrent_map_new_with(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator) {
+  Concurrent_map* map = allocator_allocate(allocator, sizeof(Concurrent_map));
+
+  if (map == NULL)
+    return NULL;
+
+  map->stripes = allocator_allocate(allocator, CONCURRENT_READER_STRIPES * sizeof(Concurrent_stripe));
+
+  if (map->stripes == NULL || !mutex_init(&map->lock)) {
+    if (map->stripes != NULL)
+      allocator_free(allocator, map->stripes);
+
+    allocator_free(allocator, map);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < CONCURRENT_READER_STRIPES; i += 1) {
+    atomic_init(&map->stripes[i].readers[0], 0);
+    atomic_init(&map->stripes[i].readers[1], 0);
+  }
+
+  cow_tree_init(&map->draft, key_layout, value_layout, comparator);
+  atomic_init(&map->root, NULL);
+  atomic_init(&map->count, 0);
+  atomic_init(&map->epoch, 0);
+  map->version = 0;
+  map->retired = NULL;
+  map->retired_count = 0;
+  map->retired_capacity = 0;
+  map->allocator = allocator;
+  return map;
+}
+
+void concurrent_map_check(const Concurrent_map* map) {
+  assert(cow_tree_check(&map->draft, concurrent_map_load(map), &concurrent_ownership, map) == concurrent_map_count(map));
+  assert(map->retired_count < CONCURRENT_RECLAMATION_THRESHOLD);
+  (void)map;
+}
+
+size_t concurrent_map_count(const Concurrent_map* map) {
+  return atomic_load_explicit(&((Concurrent_map*)map)->count, memory_order_relaxed);
+}
+
+bool concurrent_map_lookup(const Concurrent_map* map, const void* key, void* value) {
+  atomic_size_t* readers = concurrent_map_enter(map);
+  const Cow_node* node = cow_tree_lookup(&map->draft, concurrent_map_load(map), key);
+
+  if (node != NULL && value != NULL)
+    memcpy(value, cow_tree_value(&map->draft, node), map->draft.value_size);
+
+  concurrent_map_exit(readers);
+  return node != NULL;
+}
+
+size_t concurrent_map_scan(
+  const Concurrent_map* map,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, const void* value, void* data),
+  void* data
+) {
+  atomic_size_t* readers = concurrent_map_enter(map);
+  size_t count = cow_tree_scan(&map->draft, concurrent_map_load(map), low, high, visit, data);
+  concurrent_map_exit(readers);
+  return count;
+}
+
+bool concurrent_map_insert(Concurrent_map* map, const void* key, const void* value) {
+  mutex_lock(&map->lock);
+  size_t retired_count = map->retired_count;
+  size_t count = atomic_load_explicit(&map->count, memory_order_relaxed);
+  bool success = concurrent_map_begin(map);
+
+  if (success) {
+    success = cow_tree_insert(&map->draft, &concurrent_ownership, map, key, value, &count);
+
+    if (success) {
+      concurrent_map_publish(map, count);
+    } else {
+      concurrent_map_abort(map, retired_count);
+    }
+  }
+
+  mutex_unlock(&map->lock);
+  return success;
+}
+
+bool concurrent_map_remove(Concurrent_map* map, const void* key) {
+  mutex_lock(&map->lock);
+  size_t retired_count = map->retired_count;
+  size_t count = atomic_load_explicit(&map->count, memory_order_relaxed);
+  bool success = concurrent_map_begin(map);
+
+  if (success) {
+    success = cow_tree_remove(&map->draft, &concurrent_ownership, map, key, &count);
+
+    if (success) {
+      concurrent_map_publish(map, count);
+    } else {
+      concurrent_map_abort(map, retired_count);
+    }
+  }
+
+  mutex_unlock(&map->lock);
+  return success;
+}
+
+void concurrent_map_destroy(Concurrent_map* map) {
+  concurrent_map_free_tree(map, atomic_load_explicit(&map->root, memory_order_relaxed));
+
+  for (size_t i = 0; i < map->retired_count; i += 1)
+    allocator_free(map->allocator, map->retired[i]);
+
+  if (map->retired != NULL)
+    allocator_free(map->allocator, map->retired);
+
+  mutex_destroy(&map->lock);
+  allocator_free(map->allocator, map->stripes);
+  allocator_free(map->allocator, map);
+}
@@ -0,0 +1,70 @@
+#ifndef CONCURRENT_MAP_H
+#define CONCURRENT_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "allocator.h"
+#include "comparator.h"
+#include "layout.h"
+
+/// @brief Abstract ordered map data type, associating keys to values, whose lookups and scans take no lock, running
+/// concurrently with one another and with insertions and removals
+/// @details Nodes are never modified once reachable from the published root. Writers, serialized by a lock, copy the
+/// nodes they update along with their ancestors, rebalancing the copies as @c Map does, and publish the root of the new
+/// tree, which shares the untouched subtrees of the former one. Readers thus walk a consistent tree, taken as of the
+/// last publication before they entered. The nodes replaced by writers are freed in batches, once the readers which
+/// entered before their replacement have exited, as tracked by per-epoch reader counts spread over a few cache lines.
+/// Only writers allocate and free nodes, so the allocator needs not be thread-safe.
+typedef struct Concurrent_map Concurrent_map;
+
+/// @brief Allocates an empty map
+/// @returns The new map, or @c NULL if memory or the writer lock could not be allocated
+Concurrent_map* concurrent_map_new(Layout key_layout, Layout value_layout, Comparator comparator);
+
+/// @brief Allocates an empty map
+/// @param allocator The allocator of the map and of its nodes, only called by one writer at a time
+/// @returns The new map, or @c NULL if memory or the writer lock could not be allocated
+Concurrent_map* concurrent_map_new_with(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator);
+
+/// @brief Verifies that a map is valid: that is, that no internal invariants are violated
+/// @pre No writer runs concurrently
+void concurrent_map_check(const Concurrent_map* map);
+
+/// @brief Returns the number of key-value pairs stored by a map, as of the last insertion or removal
+size_t concurrent_map_count(const Concurrent_map* map);
+
+/// @brief Finds the value associated to a given key, if any, taking no lock
+/// @param[out] value The memory the value is copied into if found, or @c NULL
+/// @return @c true if the key was found, @c false otherwise
+bool concurrent_map_lookup(const Concurrent_map* map, const void* key, void* value);
+
+/// @brief Visits the key-value pairs whose keys lie in a half-open range, in key order, taking no lock
+/// @details The visited pairs are those of the map as of the beginning of the scan, regardless of concurrent writes.
+/// @param low The inclusive lower bound of the range, or @c NULL if unbounded
+/// @param high The exclusive upper bound of the range, or @c NULL if unbounded
+/// @param visit The function called on each key-value pair along with @p data, returning @c false to stop the scan.
+/// It must not insert into or remove from the map, which may wait for the scan to end.
+/// @return The number of visited key-value pairs
+size_t concurrent_map_scan(
+  const Concurrent_map* map,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, const void* value, void* data),
+  void* data
+);
+
+/// @brief Associates a key to a value, taking the writer lock
+/// @return @c true on success, @c false if memory could not be allocated, in which case the map is left unchanged
+bool concurrent_map_insert(Concurrent_map* map, const void* key, const void* value);
+
+/// @brief Removes the value associated to a key, if any, taking the writer lock
+/// @return @c true if an association to the key existed prior to removal, @c false otherwise or if memory could not be
+/// allocated, in which case the map is left unchanged
+bool concurrent_map_remove(Concurrent_map* map, const void* key);
+
+/// @brief Clears and deallocates a map
+/// @pre No reader nor writer runs concurrently
+void concurrent_map_destroy(Concurrent_map* map);
+
+#endif
@@ -0,0 +1,446 @@
+#include "cow_tree.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <string.h>
+
+/// @brief Path from the root of a tree down to a node, excluding the node
+typedef struct Cow_path {
+  /// @brief The ancestors of the node, from the root down
+  Cow_node* nodes[COW_PATH_CAPACITY];
+
+  /// @brief The directions taken from each ancestor to reach the next
+  unsigned char directions[COW_PATH_CAPACITY];
+
+  /// @brief The number of ancestors of the node
+  size_t length;
+} Cow_path;
+
+void cow_tree_init(Cow_tree* tree, Layout key_layout, Layout value_layout, Comparator comparator) {
+  Layout layout = {.size = offsetof(Cow_node, data), .alignment = alignof(Cow_node)};
+  tree->key_offset = layout_add(&layout, key_layout);
+  tree->key_size = key_layout.size;
+  tree->value_offset = layout_add(&layout, value_layout);
+  tree->value_size = value_layout.size;
+  tree->node_size = layout_pad(&layout);
+  tree->root = NULL;
+  tree->comparator = comparator;
+}
+
+/// @brief Checks that a tree respects the invariants of 2-3 red-black trees
+/// @param[in,out] count The number of visited nodes
+/// @return The black depth of the tree
+static size_t cow_tree_check_node(
+  const Cow_tree* tree,
+  const Cow_node* node,
+  const Cow_ownership* ownership,
+  const void* owner,
+  size_t* count
+) {
+  if (node == NULL)
+    return 1;
+
+  *count += 1;
+  ownership->check(owner, node);
+  assert(!cow_tree_is_red(node->children[LEFT]) || !cow_tree_is_red(node->children[RIGHT]));
+  assert(node->color == BLACK || (!cow_tree_is_red(node->children[LEFT]) && !cow_tree_is_red(node->children[RIGHT])));
+
+  if (node->children[LEFT] != NULL)
+    assert(comparator_compare(tree->comparator, cow_tree_key(tree, node->children[LEFT]), cow_tree_key(tree, node)) < 0);
+
+  if (node->children[RIGHT] != NULL)
+    assert(comparator_compare(tree->comparator, cow_tree_key(tree, node), cow_tree_key(tree, node->children[RIGHT])) < 0);
+
+  size_t left_black_depth = cow_tree_check_node(tree, node->children[LEFT], ownership, owner, count);
+  size_t right_black_depth = cow_tree_check_node(tree, node->children[RIGHT], ownership, owner, count);
+  assert(left_black_depth == right_black_depth);
+  (void)right_black_depth;
+
+  return left_black_depth + (node->color == BLACK ? 1 : 0);
+}
+
+size_t cow_tree_check(const Cow_tree* tree, const Cow_node* root, const Cow_ownership* ownership, const void* owner) {
+  assert(!cow_tree_is_red(root));
+  size_t count = 0;
+  cow_tree_check_node(tree, root, ownership, owner, &count);
+  return count;
+}
+
+/// @brief Gets the child of a modifiable node as a modifiable node, linking it in place of the child
+/// @return The modifiable child, or @c NULL if memory could not be allocated
+/// @pre `parent->children[direction] != NULL`, and the parent is modifiable
+static Cow_node* cow_tree_own_child(const Cow_ownership* ownership, void* owner, Cow_node* parent, Direction direction) {
+  Cow_node* child = ownership->own(owner, parent->children[direction]);
+
+  if (child != NULL)
+    parent->children[direction] = child;
+
+  return child;
+}
+
+/// @brief Rotates a tree of modifiable nodes
+/// @return The root of the now rotated tree
+/// @note It is the callee’s responsibility to update the relevant child of the parent
+/// @pre `node->children[1 - direction] != NULL`, and both are modifiable
+static Cow_node* cow_tree_rotate(Cow_node* B, Direction direction) {
+  // See node_rotate in map.c: the node rising to the root of the tree takes the color of the former root.
+
+  Cow_node* CA = B->children[1 - direction];
+  unsigned char B_color = B->color;
+
+  B->children[1 - direction] = CA->children[direction];
+  B->color = CA->color;
+
+  CA->children[direction] = B;
+  CA->color = B_color;
+
+  return CA;
+}
+
+/// @brief Links a node, or its absence, where a path of modifiable nodes leads
+/// @param depth The number of ancestors of the node along @p path
+static void cow_tree_link(Cow_tree* tree, const Cow_path* path, size_t depth, Cow_node* node) {
+  if (depth != 0) {
+    path->nodes[depth - 1]->children[path->directions[depth - 1]] = node;
+  } else {
+    tree->root = node;
+  }
+}
+
+/// @brief Searches a tree for the node holding a key, recording the path to it
+/// @param[out] path The path to the found node, or to where the key would be attached if not found
+/// @return The node holding the key, or @c NULL if not found
+static Cow_node* cow_tree_find(const Cow_tree* tree, const void* key, Cow_path* path) {
+  Cow_node* node = tree->root;
+  path->length = 0;
+
+  while (node != NULL) {
+    int ordering = comparator_compare(tree->comparator, key, cow_tree_key(tree, node));
+
+    if (ordering == 0)
+      break;
+
+    Direction direction = ordering < 0 ? LEFT : RIGHT;
+    assert(path->length < COW_PATH_CAPACITY);
+    path->nodes[path->length] = node;
+    path->directions[path->length] = direction;
+    path->length += 1;
+    node = node->children[direction];
+  }
+
+  return node;
+}
+
+/// @brief Reserves the nodes an update may allocate, if its ownership reserves nodes, and replaces the nodes along a
+/// path by modifiable ones, from the root down
+/// @param count The number of nodes the update may allocate
+/// @return @c true on success, @c false if memory could not be allocated
+static bool cow_tree_own_path(Cow_tree* tree, const Cow_ownership* ownership, void* owner, Cow_path* path, size_t count) {
+  if (ownership->reserve != NULL && !ownership->reserve(owner, count))
+    return false;
+
+  for (size_t depth = 0; depth < path->length; depth += 1) {
+    Cow_node* node = ownership->own(owner, path->nodes[depth]);
+
+    if (node == NULL)
+      return false;
+
+    cow_tree_link(tree, path, depth, node);
+    path->nodes[depth] = node;
+  }
+
+  return true;
+}
+
+const Cow_node* cow_tree_lookup(const Cow_tree* tree, const Cow_node* root, const void* key) {
+  const Cow_node* node = root;
+
+  while (node != NULL) {
+    int ordering = comparator_compare(tree->comparator, key, cow_tree_key(tree, node));
+
+    if (ordering == 0)
+      break;
+
+    node = node->children[ordering < 0 ? LEFT : RIGHT];
+  }
+
+  return node;
+}
+
+size_t cow_tree_scan(
+  const Cow_tree* tree,
+  const Cow_node* root,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, const void* value, void* data),
+  void* data
+) {
+  // See index_map_scan: the stack holds the nodes whose key is yet to be visited, along with their right subtree.
+
+  const Cow_node* stack[COW_PATH_CAPACITY];
+  size_t stack_size = 0;
+  const Cow_node* node = root;
+  size_t count = 0;
+
+  while (node != NULL) {
+    if (low == NULL || comparator_compare(tree->comparator, low, cow_tree_key(tree, node)) <= 0) {
+      stack[stack_size++] = node;
+      node = node->children[LEFT];
+    } else {
+      node = node->children[RIGHT];
+    }
+  }
+
+  while (stack_size != 0) {
+    node = stack[--stack_size];
+
+    if (high != NULL && comparator_compare(tree->comparator, cow_tree_key(tree, node), high) >= 0)
+      break;
+
+    count += 1;
+
+    if (!visit(cow_tree_key(tree, node), cow_tree_value(tree, node), data))
+      break;
+
+    node = node->children[RIGHT];
+
+    while (node != NULL) {
+      stack[stack_size++] = node;
+      node = node->children[LEFT];
+    }
+  }
+
+  return count;
+}
+
+bool cow_tree_insert(
+  Cow_tree* tree,
+  const Cow_ownership* ownership,
+  void* owner,
+  const void* key,
+  const void* value,
+  size_t* count
+) {
+  // Top-down pass, copying the path so that it can be modified, once the nodes the insertion may allocate are
+  // reserved: the path, the inserted node, and the siblings recolored on the way back up.
+
+  Cow_path path;
+  Cow_node* node = cow_tree_find(tree, key, &path);
+
+  if (!cow_tree_own_path(tree, ownership, owner, &path, 2 * path.length + 1))
+    return false;
+
+  if (node != NULL) {
+    node = ownership->own(owner, node);
+
+    if (node == NULL)
+      return false;
+
+    cow_tree_link(tree, &path, path.length, node);
+    memmove(cow_tree_value(tree, node), value, tree->value_size);
+    return true;
+  }
+
+  node = ownership->allocate(owner);
+
+  if (node == NULL)
+    return false;
+
+  node->children[LEFT] = NULL;
+  node->children[RIGHT] = NULL;
+  node->color = RED;
+  memmove(cow_tree_key(tree, node), key, tree->key_size);
+  memmove(cow_tree_value(tree, node), value, tree->value_size);
+  cow_tree_link(tree, &path, path.length, node);
+  *count += 1;
+
+  // Bottom-up pass, following index_map_insert, where only siblings are yet to be copied:
+
+  size_t depth = path.length;
+
+  while (depth != 0) {
+    Cow_node* parent = path.nodes[depth - 1];
+    Direction direction = path.directions[depth - 1];
+
+    if (parent->color == RED) {
+      // The parent is red, hence not the root:
+
+      Direction parent_direction = path.directions[depth - 2];
+
+      if (direction != parent_direction) {
+        // Rule from Figure 9a:
+        Cow_node* B = cow_tree_rotate(parent, parent_direction);
+        cow_tree_link(tree, &path, depth - 1, B);
+        node = parent;
+        path.nodes[depth - 1] = B;
+        path.directions[depth - 1] = parent_direction;
+        direction = parent_direction;
+      }
+
+      // Rule from Figure 9b:
+      Cow_node* B = cow_tree_rotate(path.nodes[depth - 2], 1 - direction);
+      cow_tree_link(tree, &path, depth - 2, B);
+      path.nodes[depth - 2] = B;
+      path.directions[depth - 2] = direction;
+      depth -= 1;
+      parent = B;
+    }
+
+    if (cow_tree_is_red(parent->children[1 - direction])) {
+      // Rule from Figure 9c:
+      Cow_node* sibling = cow_tree_own_child(ownership, owner, parent, 1 - direction);
+
+      if (sibling == NULL)
+        return false;
+
+      node->color = BLACK;
+      sibling->color = BLACK;
+      parent->color = RED;
+      node = parent;
+      depth -= 1;
+    } else {
+      break;
+    }
+  }
+
+  tree->root->color = BLACK;
+  return true;
+}
+
+bool cow_tree_remove(Cow_tree* tree, const Cow_ownership* ownership, void* owner, const void* key, size_t* count) {
+  // Top-down pass, copying the path so that it can be modified, once the nodes the removal may allocate are reserved:
+  // the path down to the in-order predecessor, the child of the removed node, and the siblings and nephews rotated or
+  // recolored on the way back up.
+
+  Cow_path path;
+  Cow_node* node = cow_tree_find(tree, key, &path);
+
+  if (node == NULL)
+    return false;
+
+  size_t length = path.length;
+
+  if (node->children[LEFT] != NULL && node->children[RIGHT] != NULL) {
+    length += 1;
+
+    for (const Cow_node* ancestor = node->children[LEFT]; ancestor->children[RIGHT] != NULL; ancestor = ancestor->children[RIGHT])
+      length += 1;
+  }
+
+  if (!cow_tree_own_path(tree, ownership, owner, &path, 2 * length + 8))
+    return false;
+
+  if (node->children[LEFT] != NULL && node->children[RIGHT] != NULL) {
+    node = ownership->own(owner, node);
+
+    if (node == NULL)
+      return false;
+
+    cow_tree_link(tree, &path, path.length, node);
+    Cow_node* in_order_predecessor = node->children[LEFT];
+    path.nodes[path.length] = node;
+    path.directions[path.length] = LEFT;
+    path.length += 1;
+
+    while (in_order_predecessor->children[RIGHT] != NULL) {
+      in_order_predecessor = ownership->own(owner, in_order_predecessor);
+
+      if (in_order_predecessor == NULL)
+        return false;
+
+      cow_tree_link(tree, &path, path.length, in_order_predecessor);
+      path.nodes[path.length] = in_order_predecessor;
+      path.directions[path.length] = RIGHT;
+      path.length += 1;
+      in_order_predecessor = in_order_predecessor->children[RIGHT];
+    }
+
+    memmove(cow_tree_key(tree, node), cow_tree_key(tree, in_order_predecessor), tree->key_size);
+    memmove(cow_tree_value(tree, node), cow_tree_value(tree, in_order_predecessor), tree->value_size);
+    node = in_order_predecessor;
+  }
+
+  assert(path.length == length);
+  size_t depth = path.length;
+  Color color = node->color;
+  Cow_node* child = node->children[LEFT] != NULL ? node->children[LEFT] : node->children[RIGHT];
+
+  // The node is dropped before its child is owned, so that a child it shared is copied:
+  ownership->unlink(owner, node);
+
+  if (child != NULL) {
+    child = ownership->own(owner, child);
+
+    if (child == NULL)
+      return false;
+
+    child->color = color;
+  }
+
+  cow_tree_link(tree, &path, depth, child);
+  *count -= 1;
+
+  if (child == NULL && color == BLACK && depth != 0) {
+    // Bottom-up pass, following index_map_remove, where siblings are copied before being modified:
+
+    Cow_node* ancestor;
+
+    do {
+      Cow_node* parent = path.nodes[depth - 1];
+      Direction direction = path.directions[depth - 1];
+      Cow_node* sibling = cow_tree_own_child(ownership, owner, parent, 1 - direction);
+
+      if (sibling == NULL)
+        return false;
+
+      if (sibling->color == RED) {
+        // Rule from Figure 13c:
+        Cow_node* DB = cow_tree_rotate(parent, direction);
+        cow_tree_link(tree, &path, depth - 1, DB);
+        assert(depth < COW_PATH_CAPACITY);
+        path.nodes[depth - 1] = DB;
+        path.directions[depth - 1] = direction;
+        path.nodes[depth] = parent;
+        path.directions[depth] = direction;
+        depth += 1;
+        sibling = cow_tree_own_child(ownership, owner, parent, 1 - direction);
+
+        if (sibling == NULL)
+          return false;
+      }
+
+      // Rule from Figure 13b:
+      sibling->color = RED;
+
+      if (cow_tree_is_red(sibling->children[LEFT]) || cow_tree_is_red(sibling->children[RIGHT])) {
+        if (!cow_tree_is_red(sibling->children[1 - direction])) {
+          // Rule from Figure 15a:
+          if (cow_tree_own_child(ownership, owner, sibling, direction) == NULL)
+            return false;
+
+          sibling = cow_tree_rotate(sibling, 1 - direction);
+          parent->children[1 - direction] = sibling;
+        }
+
+        // Rules from Figures 15b and 15c:
+        Cow_node* B = cow_tree_rotate(parent, direction);
+        cow_tree_link(tree, &path, depth - 1, B);
+
+        if (cow_tree_own_child(ownership, owner, B, LEFT) == NULL || cow_tree_own_child(ownership, owner, B, RIGHT) == NULL)
+          return false;
+
+        B->children[LEFT]->color = BLACK;
+        B->children[RIGHT]->color = BLACK;
+        return true;
+      }
+
+      ancestor = parent;
+      depth -= 1;
+    } while (depth != 0 && ancestor->color == BLACK);
+
+    // Rule from Figure 13a:
+    ancestor->color = BLACK;
+  }
+
+  return true;
+}
@@ -0,0 +1,163 @@
+#ifndef COW_TREE_H
+#define COW_TREE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "comparator.h"
+#include "layout.h"
+
+/// @file
+/// @brief Internal 2-3 red-black tree updated by path copying, shared by @c Concurrent_map and @c Persistent_map
+/// @details Updates copy the nodes along the path they modify rather than modifying published nodes in place. They
+/// delegate to an ownership the decisions of which nodes may be modified in place, of how copies are allocated and of
+/// when replaced nodes are freed.
+
+/// @brief Red-black color enumeration
+typedef enum Color {
+  BLACK = 0,
+  RED = 1,
+} Color;
+
+/// @brief Left-right direction enumeration
+typedef enum Direction {
+  LEFT = 0,
+  RIGHT = 1,
+} Direction;
+
+/// @brief The maximum length of the path from the root to a node, in a tree of at most @c SIZE_MAX nodes, plus one
+/// for the node temporarily pushed down by rebalancing after removal
+#define COW_PATH_CAPACITY (2 * 8 * sizeof(size_t) + 1)
+
+/// @brief Red-black tree node data type
+typedef struct Cow_node {
+  /// @brief The children of the node, or @c NULL
+  struct Cow_node* children[2];
+
+  union {
+    /// @brief For concurrent maps, the version of the map the node was allocated for, during which the writer may
+    /// modify it in place
+    size_t version;
+
+    /// @brief For persistent maps, the number of parents and maps referencing the node, beyond which it may not be
+    /// modified in place
+    atomic_size_t references;
+  };
+
+  /// @brief The color of the node
+  unsigned char color;
+
+  /// @brief The key-value pair stored by the node
+  char data[];
+} Cow_node;
+
+/// @brief Tree of nodes holding key-value pairs of given layouts
+typedef struct Cow_tree {
+  /// @brief The root of the tree being updated, or @c NULL if empty
+  Cow_node* root;
+
+  /// @brief The size of a node
+  size_t node_size;
+
+  /// @brief The offset in which the key is stored, relative to the beginning of a node
+  size_t key_offset;
+
+  /// @brief The size of the key stored by a node
+  size_t key_size;
+
+  /// @brief The offset in which the value is stored, relative to the beginning of a node
+  size_t value_offset;
+
+  /// @brief The size of the value stored by a node
+  size_t value_size;
+
+  /// @brief The key comparator
+  Comparator comparator;
+} Cow_tree;
+
+/// @brief The policy by which updates get nodes they may modify in place, called along with its owner
+typedef struct Cow_ownership {
+  /// @brief Ensures that the next allocations and copies of up to a number of nodes succeed, or @c NULL if the
+  /// ownership allocates nodes as they are needed
+  /// @return @c true on success, @c false if memory could not be allocated
+  bool (*reserve)(void* owner, size_t count);
+
+  /// @brief Allocates a node which may be modified in place, its children, color and data left for the caller
+  /// @return The new node, or @c NULL if memory could not be allocated
+  Cow_node* (*allocate)(void* owner);
+
+  /// @brief Gets a node which may be modified in place, either the node itself or a copy replacing it
+  /// @return The modifiable node, or @c NULL if memory could not be allocated
+  /// @note It is the callee’s responsibility to link the returned node in place of the node
+  Cow_node* (*own)(void* owner, Cow_node* node);
+
+  /// @brief Drops a node removed from the tree, whose links to its children the caller takes over
+  void (*unlink)(void* owner, Cow_node* node);
+
+  /// @brief Checks the invariants the ownership keeps on a node of the tree
+  void (*check)(const void* owner, const Cow_node* node);
+} Cow_ownership;
+
+/// @brief Initializes an empty tree of nodes holding key-value pairs of given layouts
+void cow_tree_init(Cow_tree* tree, Layout key_layout, Layout value_layout, Comparator comparator);
+
+/// @brief Gets the pointer to the key stored by a node
+static inline void* cow_tree_key(const Cow_tree* tree, const Cow_node* node) {
+  return (char*)node + tree->key_offset;
+}
+
+/// @brief Gets the pointer to the value stored by a node
+static inline void* cow_tree_value(const Cow_tree* tree, const Cow_node* node) {
+  return (char*)node + tree->value_offset;
+}
+
+/// @brief Determines if a node is red
+/// @note @c NULL is considered black
+static inline bool cow_tree_is_red(const Cow_node* node) {
+  return node != NULL && node->color == RED;
+}
+
+/// @brief Checks that a tree respects the invariants of 2-3 red-black trees and those of its ownership
+/// @param root The root of the tree, such as one published from @c tree->root
+/// @return The number of nodes of the tree
+size_t cow_tree_check(const Cow_tree* tree, const Cow_node* root, const Cow_ownership* ownership, const void* owner);
+
+/// @brief Finds the node holding a key in a tree, if any
+/// @param root The root of the tree, such as one published from @c tree->root
+const Cow_node* cow_tree_lookup(const Cow_tree* tree, const Cow_node* root, const void* key);
+
+/// @brief Visits the key-value pairs of a tree whose keys lie in a half-open range, in key order
+/// @param root The root of the tree, such as one published from @c tree->root
+/// @param low The inclusive lower bound of the range, or @c NULL if unbounded
+/// @param high The exclusive upper bound of the range, or @c NULL if unbounded
+/// @return The number of visited key-value pairs
+size_t cow_tree_scan(
+  const Cow_tree* tree,
+  const Cow_node* root,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, const void* value, void* data),
+  void* data
+);
+
+/// @brief Associates a key to a value in a tree, copying the nodes it modifies as its ownership requires
+/// @param[in,out] count The number of key-value pairs of the tree, incremented if the key is inserted
+/// @return @c true on success, @c false if memory could not be allocated, the tree being then left partially updated
+/// for the ownership to roll back, unless it reserves nodes
+bool cow_tree_insert(
+  Cow_tree* tree,
+  const Cow_ownership* ownership,
+  void* owner,
+  const void* key,
+  const void* value,
+  size_t* count
+);
+
+/// @brief Dissociates a key from its value in a tree, copying the nodes it modifies as its ownership requires
+/// @param[in,out] count The number of key-value pairs of the tree, decremented if the key is removed
+/// @return @c true if the key was removed, @c false if it was not found or memory could not be allocated, the tree
+/// being then left partially updated for the ownership to roll back, unless it reserves nodes
+bool cow_tree_remove(Cow_tree* tree, const Cow_ownership* ownership, void* owner, const void* key, size_t* count);
+
+#endif
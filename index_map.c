@@ -0,0 +1,514 @@
+#include "index_map.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
+
+/// @brief Red-black color enumeration
+typedef enum Color {
+  BLACK = 0,
+  RED = 1,
+} Color;
+
+/// @brief Left-right direction enumeration
+typedef enum Direction {
+  LEFT = 0,
+  RIGHT = 1,
+} Direction;
+
+/// @brief The index standing for the absence of a node
+#define NIL UINT32_MAX
+
+/// @brief The maximum length of the path from the root to a node, in a tree of at most @c UINT32_MAX nodes, plus one
+/// for the node temporarily pushed down by rebalancing after removal
+#define INDEX_PATH_CAPACITY (2 * 32 + 1)
+
+/// @brief Red-black tree node data type
+typedef struct Index_node {
+  /// @brief The indices of the children of the node, or @c NIL
+  uint32_t children[2];
+
+  /// @brief The color of the node
+  unsigned char color;
+
+  /// @brief The key-value pair stored by the node
+  char data[];
+} Index_node;
+
+/// @brief Path from the root of a tree down to a node, excluding the node
+typedef struct Index_path {
+  /// @brief The indices of the ancestors of the node, from the root down
+  uint32_t nodes[INDEX_PATH_CAPACITY];
+
+  /// @brief The directions taken from each ancestor to reach the next
+  unsigned char directions[INDEX_PATH_CAPACITY];
+
+  /// @brief The number of ancestors of the node
+  size_t length;
+} Index_path;
+
+struct Index_map {
+  /// @brief The array of nodes, of which the first @c count are in use
+  char* nodes;
+
+  /// @brief The index of the root of the red-black tree internal to the map, or @c NIL if the tree is empty
+  uint32_t root;
+
+  /// @brief The number of key-value pairs stored by the map, which is also the number of nodes in use
+  uint32_t count;
+
+  /// @brief The number of nodes the array can hold
+  uint32_t capacity;
+
+  /// @brief The distance between consecutive nodes of the array, which is the padded size of a node
+  size_t node_size;
+
+  /// @brief The offset in which the key is stored, relative to the beginning of a node
+  size_t key_offset;
+
+  /// @brief The size of the key stored by a node
+  size_t key_size;
+
+  /// @brief The offset in which the value is stored, relative to the beginning of a node
+  size_t value_offset;
+
+  /// @brief The size of the value stored by a node
+  size_t value_size;
+
+  /// @brief The key comparator
+  Comparator comparator;
+
+  /// @brief The allocator
+  Allocator allocator;
+};
+
+/// @brief Gets the node stored at an index
+/// @pre `index < map->capacity`
+static inline Index_node* index_map_node(const Index_map* map, uint32_t index) {
+  return (Index_node*)(map->nodes + (size_t)index * map->node_size);
+}
+
+/// @brief Gets the pointer to the key stored by the node at an index
+static inline void* index_map_key(const Index_map* map, uint32_t index) {
+  return (char*)index_map_node(map, index) + map->key_offset;
+}
+
+/// @brief Gets the pointer to the value stored by the node at an index
+static inline void* index_map_value(const Index_map* map, uint32_t index) {
+  return (char*)index_map_node(map, index) + map->value_offset;
+}
+
+/// @brief Determines if the node at an index is red
+/// @note @c NIL is considered black
+static inline bool index_map_is_red(const Index_map* map, uint32_t index) {
+  return index != NIL && index_map_node(map, index)->color == RED;
+}
+
+/// @brief Checks that a tree respects the invariants of 2-3 red-black trees
+/// @param[in,out] count The number of visited nodes
+/// @return The black depth of the tree
+static size_t index_map_check_node(const Index_map* map, uint32_t index, size_t* count) {
+  if (index == NIL)
+    return 1;
+
+  assert(index < map->count);
+  *count += 1;
+
+  const Index_node* node = index_map_node(map, index);
+  assert(!index_map_is_red(map, node->children[LEFT]) || !index_map_is_red(map, node->children[RIGHT]));
+  assert(node->color == BLACK || (!index_map_is_red(map, node->children[LEFT]) && !index_map_is_red(map, node->children[RIGHT])));
+
+  size_t left_black_depth = index_map_check_node(map, node->children[LEFT], count);
+  size_t right_black_depth = index_map_check_node(map, node->children[RIGHT], count);
+  assert(left_black_depth == right_black_depth);
+  (void)right_black_depth;
+
+  return left_black_depth + (node->color == BLACK ? 1 : 0);
+}
+
+/// @brief Rotates a tree
+/// @return The index of the root of the now rotated tree
+/// @note It is the callee’s responsibility to update the relevant child index of the parent
+/// @pre `index_map_node(map, index)->children[1 - direction] != NIL`
+static uint32_t index_map_rotate(Index_map* map, uint32_t index, Direction direction) {
+  // See node_rotate in map.c: the node rising to the root of the tree takes the color of the former root.
+
+  Index_node* B = index_map_node(map, index);
+  uint32_t CA_index = B->children[1 - direction];
+  Index_node* CA = index_map_node(map, CA_index);
+  unsigned char B_color = B->color;
+
+  B->children[1 - direction] = CA->children[direction];
+  B->color = CA->color;
+
+  CA->children[direction] = index;
+  CA->color = B_color;
+
+  return CA_index;
+}
+
+/// @brief Links a node, or its absence, where a path leads
+/// @param depth The number of ancestors of the node along @p path
+static void index_map_link(Index_map* map, const Index_path* path, size_t depth, uint32_t index) {
+  if (depth != 0) {
+    index_map_node(map, path->nodes[depth - 1])->children[path->directions[depth - 1]] = index;
+  } else {
+    map->root = index;
+  }
+}
+
+/// @brief Searches the tree internal to a map for the node holding a key, recording the path to it
+/// @param[out] path The path to the found node, or to where the key would be attached if not found
+/// @return The index of the node holding the key, or @c NIL if not found
+static uint32_t index_map_find(const Index_map* map, const void* key, Index_path* path) {
+  uint32_t index = map->root;
+  path->length = 0;
+
+  while (index != NIL) {
+    int ordering = comparator_compare(map->comparator, key, index_map_key(map, index));
+
+    if (ordering == 0)
+      break;
+
+    Direction direction = ordering < 0 ? LEFT : RIGHT;
+    assert(path->length < INDEX_PATH_CAPACITY);
+    path->nodes[path->length] = index;
+    path->directions[path->length] = direction;
+    path->length += 1;
+    index = index_map_node(map, index)->children[direction];
+  }
+
+  return index;
+}
+
+/// @brief Grows the array of nodes, if needed, to hold a given number of nodes
+/// @return @c true on success, @c false if memory could not be allocated
+static bool index_map_reserve(Index_map* map, uint32_t count) {
+  if (count <= map->capacity)
+    return true;
+
+  size_t capacity = map->capacity != 0 ? 2 * (size_t)map->capacity : 16;
+
+  if (capacity > UINT32_MAX)
+    capacity = UINT32_MAX;
+
+  char* nodes = map->nodes != NULL
+    ? allocator_reallocate(map->allocator, map->nodes, capacity * map->node_size)
+    : allocator_allocate(map->allocator, capacity * map->node_size);
+
+  if (nodes == NULL)
+    return false;
+
+  map->nodes = nodes;
+  map->capacity = (uint32_t)capacity;
+  return true;
+}
+
+Index_map* index_map_new(Layout key_layout, Layout value_layout, Comparator comparator) {
+  return index_map_new_with(key_layout, value_layout, comparator, heap_allocator);
+}
+
+Index_map* index_map_new_with(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator) {
+  Index_map* map = allocator_allocate(allocator, sizeof(Index_map));
+
+  if (map != NULL) {
+    Layout layout = {.size = offsetof(Index_node, data), .alignment = alignof(Index_node)};
+    map->key_offset = layout_add(&layout, key_layout);
+    map->key_size = key_layout.size;
+    map->value_offset = layout_add(&layout, value_layout);
+    map->value_size = value_layout.size;
+    map->node_size = layout_pad(&layout);
+    map->nodes = NULL;
+    map->root = NIL;
+    map->count = 0;
+    map->capacity = 0;
+    map->comparator = comparator;
+    map->allocator = allocator;
+  }
+
+  return map;
+}
+
+void index_map_check(const Index_map* map) {
+  assert(!index_map_is_red(map, map->root));
+  size_t count = 0;
+  index_map_check_node(map, map->root, &count);
+  assert(count == map->count);
+  assert(map->count <= map->capacity);
+}
+
+size_t index_map_count(const Index_map* map) {
+  return map->count;
+}
+
+void* index_map_lookup(const Index_map* map, const void* key) {
+  Index_path path;
+  uint32_t index = index_map_find(map, key, &path);
+  return index != NIL ? index_map_value(map, index) : NULL;
+}
+
+bool index_map_insert(Index_map* map, const void* key, const void* value) {
+  // Top-down pass:
+
+  Index_path path;
+  uint32_t index = index_map_find(map, key, &path);
+
+  if (index != NIL) {
+    memmove(index_map_value(map, index), value, map->value_size);
+    return true;
+  }
+
+  if (map->count == NIL || !index_map_reserve(map, map->count + 1))
+    return false;
+
+  index = map->count;
+  Index_node* node = index_map_node(map, index);
+  node->children[LEFT] = NIL;
+  node->children[RIGHT] = NIL;
+  node->color = RED;
+  memmove(index_map_key(map, index), key, map->key_size);
+  memmove(index_map_value(map, index), value, map->value_size);
+  index_map_link(map, &path, path.length, index);
+  map->count += 1;
+
+  // Bottom-up pass, following map_attach in map.c with parents taken from the path:
+
+  size_t depth = path.length;
+
+  while (depth != 0) {
+    uint32_t parent = path.nodes[depth - 1];
+    Direction direction = path.directions[depth - 1];
+
+    if (index_map_node(map, parent)->color == RED) {
+      // The parent is red, hence not the root:
+
+      Direction parent_direction = path.directions[depth - 2];
+
+      if (direction != parent_direction) {
+        // Rule from Figure 9a:
+        uint32_t B = index_map_rotate(map, parent, parent_direction);
+        index_map_link(map, &path, depth - 1, B);
+        index = parent;
+        path.nodes[depth - 1] = B;
+        path.directions[depth - 1] = parent_direction;
+        direction = parent_direction;
+      }
+
+      // Rule from Figure 9b:
+      uint32_t B = index_map_rotate(map, path.nodes[depth - 2], 1 - direction);
+      index_map_link(map, &path, depth - 2, B);
+      path.nodes[depth - 2] = B;
+      path.directions[depth - 2] = direction;
+      depth -= 1;
+      parent = B;
+    }
+
+    uint32_t sibling = index_map_node(map, parent)->children[1 - direction];
+
+    if (index_map_is_red(map, sibling)) {
+      // Rule from Figure 9c:
+      index_map_node(map, index)->color = BLACK;
+      index_map_node(map, sibling)->color = BLACK;
+      index_map_node(map, parent)->color = RED;
+      index = parent;
+      depth -= 1;
+    } else {
+      break;
+    }
+  }
+
+  index_map_node(map, map->root)->color = BLACK;
+  return true;
+}
+
+/// @brief Moves the last node of the array into the slot of a node no longer in the tree, keeping the array dense
+/// @pre `hole <= map->count`, where @c map->count no longer accounts for the node at @p hole
+static void index_map_fill(Index_map* map, uint32_t hole) {
+  uint32_t last = map->count;
+
+  if (hole == last)
+    return;
+
+  Index_path path;
+  uint32_t found = index_map_find(map, index_map_key(map, last), &path);
+  assert(found == last);
+  (void)found;
+  memcpy(index_map_node(map, hole), index_map_node(map, last), map->node_size);
+  index_map_link(map, &path, path.length, hole);
+}
+
+bool index_map_remove(Index_map* map, const void* key) {
+  // Top-down pass:
+
+  Index_path path;
+  uint32_t index = index_map_find(map, key, &path);
+
+  if (index == NIL)
+    return false;
+
+  Index_node* node = index_map_node(map, index);
+
+  if (node->children[LEFT] != NIL && node->children[RIGHT] != NIL) {
+    uint32_t in_order_predecessor = node->children[LEFT];
+    path.nodes[path.length] = index;
+    path.directions[path.length] = LEFT;
+    path.length += 1;
+
+    while (index_map_node(map, in_order_predecessor)->children[RIGHT] != NIL) {
+      path.nodes[path.length] = in_order_predecessor;
+      path.directions[path.length] = RIGHT;
+      path.length += 1;
+      in_order_predecessor = index_map_node(map, in_order_predecessor)->children[RIGHT];
+    }
+
+    memmove(index_map_key(map, index), index_map_key(map, in_order_predecessor), map->key_size);
+    memmove(index_map_value(map, index), index_map_value(map, in_order_predecessor), map->value_size);
+    index = in_order_predecessor;
+    node = index_map_node(map, index);
+  }
+
+  size_t depth = path.length;
+  Color color = node->color;
+  uint32_t child = node->children[LEFT] != NIL ? node->children[LEFT] : node->children[RIGHT];
+  index_map_link(map, &path, depth, child);
+  map->count -= 1;
+
+  if (child != NIL) {
+    index_map_node(map, child)->color = color;
+  } else if (color == BLACK && depth != 0) {
+    // Bottom-up pass, following map_remove in map.c with parents taken from the path:
+
+    uint32_t ancestor;
+
+    do {
+      uint32_t parent = path.nodes[depth - 1];
+      Direction direction = path.directions[depth - 1];
+      uint32_t sibling = index_map_node(map, parent)->children[1 - direction];
+
+      if (index_map_node(map, sibling)->color == RED) {
+        // Rule from Figure 13c:
+        uint32_t DB = index_map_rotate(map, parent, direction);
+        index_map_link(map, &path, depth - 1, DB);
+        assert(depth < INDEX_PATH_CAPACITY);
+        path.nodes[depth - 1] = DB;
+        path.directions[depth - 1] = direction;
+        path.nodes[depth] = parent;
+        path.directions[depth] = direction;
+        depth += 1;
+        sibling = index_map_node(map, parent)->children[1 - direction];
+      }
+
+      // Rule from Figure 13b:
+      Index_node* sibling_node = index_map_node(map, sibling);
+      sibling_node->color = RED;
+
+      if (index_map_is_red(map, sibling_node->children[LEFT]) || index_map_is_red(map, sibling_node->children[RIGHT])) {
+        if (!index_map_is_red(map, sibling_node->children[1 - direction])) {
+          // Rule from Figure 15a:
+          sibling = index_map_rotate(map, sibling, 1 - direction);
+          index_map_node(map, parent)->children[1 - direction] = sibling;
+        }
+
+        // Rules from Figures 15b and 15c:
+        uint32_t B = index_map_rotate(map, parent, direction);
+        index_map_link(map, &path, depth - 1, B);
+        index_map_node(map, index_map_node(map, B)->children[LEFT])->color = BLACK;
+        index_map_node(map, index_map_node(map, B)->children[RIGHT])->color = BLACK;
+        goto fill;
+      }
+
+      ancestor = parent;
+      depth -= 1;
+    } while (depth != 0 && index_map_node(map, ancestor)->color == BLACK);
+
+    // Rule from Figure 13a:
+    index_map_node(map, ancestor)->color = BLACK;
+  }
+
+fill:
+  index_map_fill(map, index);
+  return true;
+}
+
+size_t index_map_scan(
+  const Index_map* map,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, void* value, void* data),
+  void* data
+) {
+  // The stack holds the nodes whose key is yet to be visited, along with their right subtree:
+
+  uint32_t stack[INDEX_PATH_CAPACITY];
+  size_t stack_size = 0;
+  uint32_t index = map->root;
+  size_t count = 0;
+
+  while (index != NIL) {
+    if (low == NULL || comparator_compare(map->comparator, low, index_map_key(map, index)) <= 0) {
+      stack[stack_size++] = index;
+      index = index_map_node(map, index)->children[LEFT];
+    } else {
+      index = index_map_node(map, index)->children[RIGHT];
+    }
+  }
+
+  while (stack_size != 0) {
+    index = stack[--stack_size];
+
+    if (high != NULL && comparator_compare(map->comparator, index_map_key(map, index), high) >= 0)
+      break;
+
+    count += 1;
+
+    if (!visit(index_map_key(map, index), index_map_value(map, index), data))
+      break;
+
+    index = index_map_node(map, index)->children[RIGHT];
+
+    while (index != NIL) {
+      stack[stack_size++] = index;
+      index = index_map_node(map, index)->children[LEFT];
+    }
+  }
+
+  return count;
+}
+
+Index_map* index_map_copy(const Index_map* map) {
+  Index_map* new_map = allocator_allocate(map->allocator, sizeof(Index_map));
+
+  if (new_map == NULL)
+    return NULL;
+
+  *new_map = *map;
+  new_map->nodes = NULL;
+  new_map->capacity = 0;
+
+  if (map->count != 0) {
+    new_map->nodes = allocator_allocate(map->allocator, (size_t)map->count * map->node_size);
+
+    if (new_map->nodes == NULL) {
+      allocator_free(map->allocator, new_map);
+      return NULL;
+    }
+
+    memcpy(new_map->nodes, map->nodes, (size_t)map->count * map->node_size);
+    new_map->capacity = map->count;
+  }
+
+  return new_map;
+}
+
+void index_map_clear(Index_map* map) {
+  map->root = NIL;
+  map->count = 0;
+}
+
+void index_map_destroy(Index_map* map) {
+  if (map->nodes != NULL)
+    allocator_free(map->allocator, map->nodes);
+
+  allocator_free(map->allocator, map);
+}
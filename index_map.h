@@ -0,0 +1,71 @@
+#ifndef INDEX_MAP_H
+#define INDEX_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "allocator.h"
+#include "comparator.h"
+#include "layout.h"
+
+/// @brief Abstract ordered map data type, associating keys to values, whose nodes are stored contiguously in one array
+/// @details Nodes link to their children by 32-bit indices into the array, and hold no link to their parent: the tree
+/// is rebalanced along the path recorded while descending it. Removed nodes are filled in by the last node of the array,
+/// which therefore stays dense, so that copying a map copies its array at once. Since nodes hold no pointers, the array
+/// can also be moved around in memory as is.
+typedef struct Index_map Index_map;
+
+/// @brief Allocates an empty map
+/// @returns The new map, or @c NULL if memory could not be allocated
+Index_map* index_map_new(Layout key_layout, Layout value_layout, Comparator comparator);
+
+/// @brief Allocates an empty map
+/// @param allocator The allocator of the map and of its array of nodes, which is grown through @c reallocate
+/// @returns The new map, or @c NULL if memory could not be allocated
+Index_map* index_map_new_with(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator);
+
+/// @brief Verifies that a map is valid: that is, that no internal invariants are violated
+void index_map_check(const Index_map* map);
+
+/// @brief Returns the number of key-value pairs stored by a map
+size_t index_map_count(const Index_map* map);
+
+/// @brief Finds the value associated to a given key, if any
+/// @note Values are pointed to until the next insertion into or removal from the map, which may move nodes
+void* index_map_lookup(const Index_map* map, const void* key);
+
+/// @brief Associates a key to a value
+/// @return @c true on success, @c false if memory could not be allocated or the map holds @c UINT32_MAX key-value
+/// pairs already
+bool index_map_insert(Index_map* map, const void* key, const void* value);
+
+/// @brief Removes the value associated to a key, if any
+/// @return @c true if an association to the key existed prior to removal, @c false otherwise
+bool index_map_remove(Index_map* map, const void* key);
+
+/// @brief Visits the key-value pairs whose keys lie in a half-open range, in key order, in `O(log n + k)` time
+/// @param low The inclusive lower bound of the range, or @c NULL if unbounded
+/// @param high The exclusive upper bound of the range, or @c NULL if unbounded
+/// @param visit The function called on each key-value pair along with @p data, returning @c false to stop the scan.
+/// It must not insert into or remove from the map.
+/// @return The number of visited key-value pairs
+size_t index_map_scan(
+  const Index_map* map,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, void* value, void* data),
+  void* data
+);
+
+/// @brief Copies a map, copying its array of nodes at once
+/// @return The copied map, or @c NULL if memory could not be allocated
+Index_map* index_map_copy(const Index_map* map);
+
+/// @brief Clears a map, removing all key-value associations
+/// @note The array of nodes is retained, to be refilled without growing
+void index_map_clear(Index_map* map);
+
+/// @brief Clears and deallocates a map
+void index_map_destroy(Index_map* map);
+
+#endif
@@ -2,7 +2,11 @@
 
 #include <assert.h>
 #include <stdalign.h>
+#include <stdint.h>
 #include <string.h>
+#include <wchar.h>
+
+#include "b_tree.h"
 
 /// @brief Red-black color enumeration
 typedef enum Color {
@@ -17,10 +21,16 @@ typedef enum Direction {
 } Direction;
 
 /// @brief Red-black tree node data type
+/// @note If @c MAP_COMPACT_NODES is defined, the direction and color of nodes are packed into the low-order bits of their
+/// parent pointer, sparing a word per node at the cost of masking on each access
 typedef struct Node {
   /// @brief The children of the node
   struct Node* children[2];
 
+#ifdef MAP_COMPACT_NODES
+  /// @brief The parent of the node, whose lowest bit holds the direction of the node and next lowest bit its color
+  uintptr_t parent_direction_color;
+#else
   /// @brief The parent of the node
   struct Node* parent;
 
@@ -29,16 +39,105 @@ typedef struct Node {
 
   /// @brief The color of the node
   unsigned char color;
+#endif
 
   /// @brief The key-value pair stored by the node
   char data[];
 } Node;
 
+#ifdef MAP_COMPACT_NODES
+static_assert(alignof(Node) >= 4, "nodes are too loosely aligned to pack their direction and color");
+
+/// @brief The bit of @c Node::parent_direction_color holding the direction
+#define NODE_DIRECTION_BIT ((uintptr_t)1)
+
+/// @brief The bit of @c Node::parent_direction_color holding the color
+#define NODE_COLOR_BIT ((uintptr_t)2)
+
+/// @brief Gets the parent of a node
+static inline Node* node_get_parent(const Node* node) {
+  return (Node*)(node->parent_direction_color & ~(NODE_DIRECTION_BIT | NODE_COLOR_BIT));
+}
+
+/// @brief Gets the direction of a node, determining if it is the left or right child of its parent
+static inline Direction node_get_direction(const Node* node) {
+  return (node->parent_direction_color & NODE_DIRECTION_BIT) != 0 ? RIGHT : LEFT;
+}
+
+/// @brief Gets the color of a node
+static inline Color node_get_color(const Node* node) {
+  return (node->parent_direction_color & NODE_COLOR_BIT) != 0 ? RED : BLACK;
+}
+
+/// @brief Sets the parent of a node
+static inline void node_set_parent(Node* node, const Node* parent) {
+  node->parent_direction_color = (uintptr_t)parent | (node->parent_direction_color & (NODE_DIRECTION_BIT | NODE_COLOR_BIT));
+}
+
+/// @brief Sets the direction of a node
+static inline void node_set_direction(Node* node, Direction direction) {
+  node->parent_direction_color = (node->parent_direction_color & ~NODE_DIRECTION_BIT) | (direction == RIGHT ? NODE_DIRECTION_BIT : 0);
+}
+
+/// @brief Sets the color of a node
+static inline void node_set_color(Node* node, Color color) {
+  node->parent_direction_color = (node->parent_direction_color & ~NODE_COLOR_BIT) | (color == RED ? NODE_COLOR_BIT : 0);
+}
+
+/// @brief Initializes the parent, direction and color of a node
+static inline void node_init_links(Node* node, const Node* parent, Direction direction, Color color) {
+  node->parent_direction_color = (uintptr_t)parent | (direction == RIGHT ? NODE_DIRECTION_BIT : 0) | (color == RED ? NODE_COLOR_BIT : 0);
+}
+
+#undef NODE_COLOR_BIT
+#undef NODE_DIRECTION_BIT
+#else
+/// @brief Gets the parent of a node
+static inline Node* node_get_parent(const Node* node) {
+  return node->parent;
+}
+
+/// @brief Gets the direction of a node, determining if it is the left or right child of its parent
+static inline Direction node_get_direction(const Node* node) {
+  return node->direction;
+}
+
+/// @brief Gets the color of a node
+static inline Color node_get_color(const Node* node) {
+  return node->color;
+}
+
+/// @brief Sets the parent of a node
+static inline void node_set_parent(Node* node, const Node* parent) {
+  node->parent = (Node*)parent;
+}
+
+/// @brief Sets the direction of a node
+static inline void node_set_direction(Node* node, Direction direction) {
+  node->direction = direction;
+}
+
+/// @brief Sets the color of a node
+static inline void node_set_color(Node* node, Color color) {
+  node->color = color;
+}
+
+/// @brief Initializes the parent, direction and color of a node
+static inline void node_init_links(Node* node, const Node* parent, Direction direction, Color color) {
+  node->parent = (Node*)parent;
+  node->direction = direction;
+  node->color = color;
+}
+#endif
+
 /// @brief The layout of a @c Node
 typedef struct Node_layout {
   /// @brief The total size of the node, including the key-value pair stored in its FAM
   size_t size;
 
+  /// @brief The alignment of the node, accounting for the key-value pair stored in its FAM
+  size_t alignment;
+
   /// @brief The offset in which the key is stored, relative to the beginning of the node
   size_t key_offset;
 
@@ -50,8 +149,28 @@ typedef struct Node_layout {
 
   /// @brief The size of the value stored by the node
   size_t value_size;
+
+  /// @brief The offset in which the size of the subtree rooted at the node is stored, relative to the beginning of the
+  /// node, or @c 0 if subtree sizes are not maintained
+  size_t size_offset;
+
+  /// @brief The offset in which the node stores whether it is a tombstone, relative to the beginning of the node, or
+  /// @c 0 if removals free nodes right away
+  size_t tombstone_offset;
+
+#ifdef MAP_STATS
+  /// @brief The operation counts of the map using the layout, reachable from functions given only the layout
+  Map_stats* stats;
+#endif
 } Node_layout;
 
+#ifdef MAP_STATS
+/// @brief Adds to one of the operation counts of the map using a node layout
+#define MAP_STATS_ADD(LAYOUT, COUNT, N) ((LAYOUT)->stats->COUNT += (N))
+#else
+#define MAP_STATS_ADD(LAYOUT, COUNT, N) ((void)(LAYOUT))
+#endif
+
 /// @brief Gets the pointer to the key stored by a node
 static inline void* node_key(const Node* node, const Node_layout* layout) {
   return (char*)node + layout->key_offset;
@@ -62,16 +181,51 @@ static inline void* node_value(const Node* node, const Node_layout* layout) {
   return (char*)node + layout->value_offset;
 }
 
+/// @brief Gets the pointer to the node storing a value
+static inline Node* value_node(const void* value, const Node_layout* layout) {
+  return (Node*)((char*)value - layout->value_offset);
+}
+
+/// @brief Gets the pointer to the size of the subtree rooted at a node
+/// @pre `layout->size_offset != 0`
+static inline size_t* node_size_p(const Node* node, const Node_layout* layout) {
+  return (size_t*)((char*)node + layout->size_offset);
+}
+
+/// @brief Gets the size of a tree
+/// @note @c NULL is considered an empty tree
+/// @pre `layout->size_offset != 0`
+static inline size_t node_size(const Node* node, const Node_layout* layout) {
+  return node != NULL ? *node_size_p(node, layout) : 0;
+}
+
+/// @brief Gets the pointer to the flag marking a node as a tombstone
+/// @pre `layout->tombstone_offset != 0`
+static inline bool* node_tombstone_p(const Node* node, const Node_layout* layout) {
+  return (bool*)((char*)node + layout->tombstone_offset);
+}
+
+/// @brief Determines if a node is a tombstone, whose key-value pair was removed
+static inline bool node_is_tombstone(const Node* node, const Node_layout* layout) {
+  return layout->tombstone_offset != 0 && *node_tombstone_p(node, layout);
+}
+
+/// @brief Recomputes the size of the subtree rooted at a node from the sizes of the subtrees rooted at its children
+/// @pre `layout->size_offset != 0`
+static inline void node_update_size(Node* node, const Node_layout* layout) {
+  *node_size_p(node, layout) = node_size(node->children[LEFT], layout) + 1 + node_size(node->children[RIGHT], layout);
+}
+
 /// @brief Determines if a node is black
 /// @note @c NULL is considered black
 static inline bool node_is_black(const Node* node) {
-  return node == NULL || node->color == BLACK;
+  return node == NULL || node_get_color(node) == BLACK;
 }
 
 /// @brief Determines if a node is red
 /// @note @c NULL is considered black
 static inline bool node_is_red(const Node* node) {
-  return node != NULL && node->color == RED;
+  return node != NULL && node_get_color(node) == RED;
 }
 
 /// @brief Checks that a tree respects the invariants of 2-3 red-black trees
@@ -80,9 +234,9 @@ static size_t node_check(const Node* node) {
   if (node == NULL)
     return 1;
 
-  if (node->parent != NULL) {
-    assert(node->parent->children[node->direction] == node);
-    assert(node->color == BLACK || node->parent->color == BLACK);
+  if (node_get_parent(node) != NULL) {
+    assert(node_get_parent(node)->children[node_get_direction(node)] == node);
+    assert(node_get_color(node) == BLACK || node_get_color(node_get_parent(node)) == BLACK);
   }
 
   assert(node_is_black(node->children[LEFT]) || node_is_black(node->children[RIGHT]));
@@ -91,7 +245,18 @@ static size_t node_check(const Node* node) {
   size_t right_black_depth = node_check(node->children[RIGHT]);
   assert(left_black_depth == right_black_depth);
 
-  return left_black_depth + (node->color == BLACK ? 1 : 0);
+  return left_black_depth + (node_get_color(node) == BLACK ? 1 : 0);
+}
+
+/// @brief Checks that the subtree sizes stored by the nodes of a tree are exact
+/// @return The size of the tree
+static size_t node_check_sizes(const Node* node, const Node_layout* layout) {
+  if (node == NULL)
+    return 0;
+
+  size_t size = node_check_sizes(node->children[LEFT], layout) + 1 + node_check_sizes(node->children[RIGHT], layout);
+  assert(*node_size_p(node, layout) == size);
+  return size;
 }
 
 /// @brief Retrieves the leftmost or rightmost descendant of a node
@@ -121,11 +286,35 @@ static Node* node_xmost_leaf(const Node* node, Direction direction) {
 /// @brief Retrieves the post-order predecessor or successor of a node, if any
 /// @param direction @c LEFT for the post-order predecessor, @c RIGHT for the post-order successor
 static Node* node_post_order_xcessor(const Node* node, Direction direction) {
-  if (node->direction != direction && node->parent != NULL && node->parent->children[direction] != NULL) {
-    return node_xmost_leaf(node->parent->children[direction], 1 - direction);
+  if (node_get_direction(node) != direction && node_get_parent(node) != NULL && node_get_parent(node)->children[direction] != NULL) {
+    return node_xmost_leaf(node_get_parent(node)->children[direction], 1 - direction);
   } else {
-    return node->parent;
+    return node_get_parent(node);
+  }
+}
+
+/// @brief Retrieves the in-order predecessor or successor of a node, if any
+/// @param direction @c LEFT for the in-order predecessor, @c RIGHT for the in-order successor
+static Node* node_in_order_xcessor(const Node* node, Direction direction) {
+  if (node->children[direction] != NULL)
+    return node_xmost_node(node->children[direction], 1 - direction);
+
+  while (node_get_parent(node) != NULL && node_get_direction(node) == direction) {
+    node = node_get_parent(node);
+  }
+
+  return node_get_parent(node);
+}
+
+/// @brief Retrieves the nearest node to a node in a given direction which is not a tombstone, the node itself included
+/// @param direction @c LEFT for the nearest predecessor, @c RIGHT for the nearest successor
+/// @note @c NULL is considered an empty tree
+static Node* node_skip_tombstones(const Node* node, Direction direction, const Node_layout* layout) {
+  while (node != NULL && node_is_tombstone(node, layout)) {
+    node = node_in_order_xcessor(node, direction);
   }
+
+  return (Node*)node;
 }
 
 /// @brief Counts the number of nodes in a tree
@@ -144,11 +333,11 @@ static size_t node_count(const Node* node) {
   return count;
 }
 
-/// @brief Rotates a tree
+/// @brief Rotates a tree, maintaining subtree sizes if the layout stores them
 /// @return The root of the now rotated tree
 /// @note It is the callee’s responsibility to update the relevant child pointer of the parent
 /// @pre `node->children[1 - direction] != NULL`
-static Node* node_rotate(Node* node, Direction direction) {
+static Node* node_rotate(Node* node, Direction direction, const Node_layout* layout) {
   //       C                         A
   //     ┌╌┴╌┐         →B          ┌╌┴╌┐
   //    →B   d       ┌╌╌┴╌╌┐       a   B←
@@ -157,29 +346,35 @@ static Node* node_rotate(Node* node, Direction direction) {
   // ┌╌┴╌┐         a   b c   d         ┌╌┴╌┐
   // a   b                             c   d
 
+  MAP_STATS_ADD(layout, rotations, 1);
   Node* B = node;
   Node* CA = B->children[1 - direction];
-  Node* parent = B->parent;
-  Direction B_direction = B->direction;
-  Color B_color = B->color;
+  Node* parent = node_get_parent(B);
+  Direction B_direction = node_get_direction(B);
+  Color B_color = node_get_color(B);
 
   Node* cb = CA->children[direction];
-  Color cb_color = CA->color;
+  Color cb_color = node_get_color(CA);
 
   if (cb != NULL) {
-    cb->parent = B;
-    cb->direction = 1 - direction;
+    node_set_parent(cb, B);
+    node_set_direction(cb, 1 - direction);
   }
 
   B->children[1 - direction] = cb;
-  B->parent = CA;
-  B->direction = direction;
-  B->color = cb_color;
+  node_set_parent(B, CA);
+  node_set_direction(B, direction);
+  node_set_color(B, cb_color);
 
   CA->children[direction] = B;
-  CA->parent = parent;
-  CA->direction = B_direction;
-  CA->color = B_color;
+  node_set_parent(CA, parent);
+  node_set_direction(CA, B_direction);
+  node_set_color(CA, B_color);
+
+  if (layout->size_offset != 0) {
+    *node_size_p(CA, layout) = *node_size_p(B, layout);
+    node_update_size(B, layout);
+  }
 
   return CA;
 }
@@ -188,15 +383,36 @@ struct Map {
   /// @brief The root of the red-black tree internal to the map
   Node* root;
 
+  /// @brief The leftmost and rightmost nodes of the tree, or @c NULL if the tree is empty
+  Node* xmost_nodes[2];
+
   /// @brief The number of key-value pairs stored by the map
   size_t count;
 
+  /// @brief The number of nodes marked as tombstones, in addition to those holding the key-value pairs
+  size_t tombstone_count;
+
   /// @brief The layout of nodes, providing information to allocate nodes or access their data
   Node_layout node_layout;
 
+#ifdef MAP_STATS
+  /// @brief The operation counts of the map, pointed to by its node layout
+  Map_stats stats;
+#endif
+
   /// @brief The key comparator
   Comparator comparator;
 
+  /// @brief The options the map was created with
+  Map_options options;
+
+  /// @brief The B-tree storing the key-value pairs in place of the red-black tree, if the map was created with the
+  /// @c b_tree option, or @c NULL
+  B_tree* b_tree;
+
+  /// @brief The allocator of nodes, either the allocator of the map or a pool owned by the map
+  Allocator node_allocator;
+
   /// @brief The allocator
   Allocator allocator;
 };
@@ -204,119 +420,626 @@ struct Map {
 /// @brief The size of the @c Map struct, excluding trailing padding bytes
 #define MAP_SIZE (offsetof(Map, allocator) + sizeof(Allocator))
 
+/// @brief Compares two keys through the comparator of a map
+static inline int map_compare(const Map* map, const void* x, const void* y) {
+  MAP_STATS_ADD(&map->node_layout, comparisons, 1);
+  return comparator_compare(map->comparator, x, y);
+}
+
+/// @brief Allocates memory for a node or for the characters of a string key of a map
+static inline void* map_allocate(const Map* map, Allocator allocator, size_t size) {
+  MAP_STATS_ADD(&map->node_layout, allocations, 1);
+  return allocator_allocate(allocator, size);
+}
+
+/// @brief Frees memory allocated by @c map_allocate
+static inline void map_deallocate(const Map* map, Allocator allocator, void* pointer) {
+  MAP_STATS_ADD(&map->node_layout, deallocations, 1);
+  allocator_free(allocator, pointer);
+}
+
+/// @brief Gets the characters of a string key following its prefix
+static inline const char* map_string_suffix(const Map_string* string) {
+  return string->length <= MAP_STRING_INLINE_LENGTH ? string->suffix : string->chars + MAP_STRING_PREFIX_LENGTH;
+}
+
+/// @brief Compares string keys, deciding by their prefixes alone unless they are equal
+/// @details Padding characters are null characters, which compare equal to null characters and lesser than others, so
+/// that padded characters order keys as their characters do up to the length of the shorter one.
+static inline int map_string_compare(const Map_string* x, const Map_string* y) {
+  int ordering = memcmp(x->prefix, y->prefix, MAP_STRING_PREFIX_LENGTH);
+
+  if (ordering != 0)
+    return ordering;
+
+  uint32_t length = x->length < y->length ? x->length : y->length;
+
+  if (length > MAP_STRING_PREFIX_LENGTH) {
+    ordering = memcmp(map_string_suffix(x), map_string_suffix(y), length - MAP_STRING_PREFIX_LENGTH);
+
+    if (ordering != 0)
+      return ordering;
+  }
+
+  return (x->length > y->length) - (x->length < y->length);
+}
+
+static int map_string_compare_keys(const void* comparator, const void* x, const void* y) {
+  (void)comparator;
+  return map_string_compare(x, y);
+}
+
+static const Comparator_methods map_string_comparator_methods = {
+  .compare = map_string_compare_keys,
+  .kind = COMPARATOR_MAP_STRING,
+};
+
+const Comparator map_string_comparator = {
+  .data = NULL,
+  .methods = &map_string_comparator_methods,
+};
+
+Map_string map_string(const char* chars, size_t length) {
+  assert(length <= UINT32_MAX);
+  Map_string string = {.length = (uint32_t)length};
+
+  if (length <= MAP_STRING_INLINE_LENGTH) {
+    size_t prefix_length = length < MAP_STRING_PREFIX_LENGTH ? length : MAP_STRING_PREFIX_LENGTH;
+    memcpy(string.prefix, chars, prefix_length);
+    memcpy(string.suffix, chars + prefix_length, length - prefix_length);
+  } else {
+    memcpy(string.prefix, chars, MAP_STRING_PREFIX_LENGTH);
+    string.chars = chars;
+  }
+
+  return string;
+}
+
+const char* map_string_chars(const Map_string* string, char* buffer) {
+  if (string->length > MAP_STRING_INLINE_LENGTH)
+    return string->chars;
+
+  memcpy(buffer, string->prefix, MAP_STRING_PREFIX_LENGTH);
+  memcpy(buffer + MAP_STRING_PREFIX_LENGTH, string->suffix, sizeof(string->suffix));
+  return buffer;
+}
+
+/// @brief Expands to a switch on the kind of the comparator of a map, in which keys compared by builtin comparators are
+/// compared inline, sparing an indirect call per comparison
+/// @details @p SEARCH(ORDERING) is expanded with @c ORDERING comparing @c key to @c node_key, and
+/// @p SEARCH_SCALAR(TYPE, TIE) is expanded for keys of a scalar type, with @c TIE ordering keys which are neither lesser
+/// nor greater than one another. Floating-point keys which are neither lesser nor greater are NaNs or zeros, whose
+/// ordering is up to the comparator.
+#define MAP_SWITCH_COMPARATOR(SEARCH, SEARCH_SCALAR)                                 \
+  switch (comparator_kind(map->comparator)) {                                        \
+    case COMPARATOR_CHAR:                                                            \
+      SEARCH_SCALAR(char, 0)                                                         \
+      break;                                                                         \
+    case COMPARATOR_WCHAR:                                                           \
+      SEARCH_SCALAR(wchar_t, 0)                                                      \
+      break;                                                                         \
+    case COMPARATOR_SCHAR:                                                           \
+      SEARCH_SCALAR(signed char, 0)                                                  \
+      break;                                                                         \
+    case COMPARATOR_SHORT:                                                           \
+      SEARCH_SCALAR(short, 0)                                                        \
+      break;                                                                         \
+    case COMPARATOR_INT:                                                             \
+      SEARCH_SCALAR(int, 0)                                                          \
+      break;                                                                         \
+    case COMPARATOR_LONG:                                                            \
+      SEARCH_SCALAR(long, 0)                                                         \
+      break;                                                                         \
+    case COMPARATOR_LLONG:                                                           \
+      SEARCH_SCALAR(long long, 0)                                                    \
+      break;                                                                         \
+    case COMPARATOR_UCHAR:                                                           \
+      SEARCH_SCALAR(unsigned char, 0)                                                \
+      break;                                                                         \
+    case COMPARATOR_USHORT:                                                          \
+      SEARCH_SCALAR(unsigned short, 0)                                               \
+      break;                                                                         \
+    case COMPARATOR_UINT:                                                            \
+      SEARCH_SCALAR(unsigned int, 0)                                                 \
+      break;                                                                         \
+    case COMPARATOR_ULONG:                                                           \
+      SEARCH_SCALAR(unsigned long, 0)                                                \
+      break;                                                                         \
+    case COMPARATOR_ULLONG:                                                          \
+      SEARCH_SCALAR(unsigned long long, 0)                                           \
+      break;                                                                         \
+    case COMPARATOR_FLOAT:                                                           \
+      SEARCH_SCALAR(float, comparator_compare(map->comparator, key, node_key))       \
+      break;                                                                         \
+    case COMPARATOR_DOUBLE:                                                          \
+      SEARCH_SCALAR(double, comparator_compare(map->comparator, key, node_key))      \
+      break;                                                                         \
+    case COMPARATOR_LDOUBLE:                                                         \
+      SEARCH_SCALAR(long double, comparator_compare(map->comparator, key, node_key)) \
+      break;                                                                         \
+    case COMPARATOR_STRING:                                                          \
+      SEARCH(strcmp(key, node_key))                                                  \
+      break;                                                                         \
+    case COMPARATOR_WSTRING:                                                         \
+      SEARCH(wcscmp(key, node_key))                                                  \
+      break;                                                                         \
+    case COMPARATOR_MAP_STRING:                                                      \
+      SEARCH(map_string_compare(key, node_key))                                      \
+      break;                                                                         \
+    case COMPARATOR_CUSTOM:                                                          \
+    default:                                                                         \
+      SEARCH(comparator_compare(map->comparator, key, node_key))                     \
+      break;                                                                         \
+  }
+
+/// @brief Searches a tree for the node orderly equivalent to a key, going left or right as long as @p ORDERING
+/// (comparing @c key to @c node_key) is negative or positive
+#define MAP_FIND(ORDERING)                                    \
+  while (node != NULL) {                                      \
+    const void* node_key = (const char*)node + key_offset;    \
+    int ordering = (ORDERING);                                \
+    depth += 1;                                               \
+                                                              \
+    if (ordering == 0)                                        \
+      break;                                                  \
+                                                              \
+    parent = node;                                            \
+    direction = ordering < 0 ? LEFT : RIGHT;                  \
+    node = node->children[direction];                         \
+  }
+
+/// @brief Searches a tree for the node holding a key of a scalar type, resorting to the comparator only to break ties
+#define MAP_FIND_SCALAR(TYPE, TIE)                                                       \
+  {                                                                                      \
+    TYPE x = *(const TYPE*)key;                                                          \
+    MAP_FIND(x < *(const TYPE*)node_key ? -1 : (x > *(const TYPE*)node_key ? +1 : (TIE))) \
+  }
+
+/// @brief Searches the tree internal to a map for the node holding a key
+/// @details Keys compared by builtin comparators are compared inline, sparing an indirect call per visited node.
+/// @param[out] parent The parent of the found node, or the node the key would be attached to if not found
+/// @param[out] direction The direction of the found node, or the direction the key would be attached in if not found
+/// @return The node holding the key, or @c NULL if not found
+static Node* map_find(const Map* map, const void* key, Node** parent_p, Direction* direction_p) {
+  Node* node = map->root;
+  Node* parent = NULL;
+  Direction direction = LEFT;
+  size_t key_offset = map->node_layout.key_offset;
+  size_t depth = 0;
+
+  MAP_SWITCH_COMPARATOR(MAP_FIND, MAP_FIND_SCALAR)
+
+#ifdef MAP_STATS
+  Map_stats* stats = map->node_layout.stats;
+  stats->comparisons += depth;
+  stats->searches += 1;
+  stats->total_depth += depth;
+  stats->max_depth = depth > stats->max_depth ? depth : stats->max_depth;
+#else
+  (void)depth;
+#endif
+
+  *parent_p = parent;
+  *direction_p = direction;
+  return node;
+}
+
+#undef MAP_FIND_SCALAR
+#undef MAP_FIND
+
+/// @brief Computes the layout of the nodes of maps with the given key and value layouts and options
+static Node_layout map_layout_nodes(Layout key_layout, Layout value_layout, Map_options options) {
+  Layout layout = {.size = offsetof(Node, data), .alignment = alignof(Node)};
+  size_t size_offset = options.order_statistics ? layout_add(&layout, (Layout){.size = sizeof(size_t), .alignment = alignof(size_t)}) : 0;
+  size_t key_offset = layout_add(&layout, key_layout);
+  size_t value_offset = layout_add(&layout, value_layout);
+  size_t tombstone_offset = options.tombstone_fraction != 0 ? layout_add(&layout, (Layout){.size = sizeof(bool), .alignment = alignof(bool)}) : 0;
+
+  return (Node_layout){
+    .size = layout.size,
+    .alignment = layout.alignment,
+    .key_offset = key_offset,
+    .key_size = key_layout.size,
+    .value_offset = value_offset,
+    .value_size = value_layout.size,
+    .size_offset = size_offset,
+    .tombstone_offset = tombstone_offset,
+  };
+}
+
+Layout map_node_layout(Layout key_layout, Layout value_layout) {
+  return map_node_layout_with_options(key_layout, value_layout, (Map_options){0});
+}
+
+Layout map_node_layout_with_options(Layout key_layout, Layout value_layout, Map_options options) {
+  if (options.b_tree)
+    return b_tree_node_layout(key_layout, value_layout);
+
+  Node_layout node_layout = map_layout_nodes(key_layout, value_layout, options);
+  return (Layout){.size = node_layout.size, .alignment = node_layout.alignment};
+}
+
 Map* map_new(Layout key_layout, Layout value_layout, Comparator comparator) {
   return map_new_with(key_layout, value_layout, comparator, heap_allocator);
 }
 
 Map* map_new_with(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator) {
+  return map_new_with_options(key_layout, value_layout, comparator, allocator, (Map_options){0});
+}
+
+/// @brief Allocates an empty map, given the layout of its nodes
+/// @returns The new map, or @c NULL if memory could not be allocated
+static Map* map_new_with_node_layout(Node_layout node_layout, Comparator comparator, Allocator allocator, Map_options options) {
   Map* map = allocator_allocate(allocator, MAP_SIZE);
 
   if (map != NULL) {
     map->root = NULL;
+    map->xmost_nodes[LEFT] = NULL;
+    map->xmost_nodes[RIGHT] = NULL;
     map->count = 0;
-
-    Layout layout = {.size = offsetof(Node, data), .alignment = alignof(Node)};
-    size_t key_offset = layout_add(&layout, key_layout);
-    size_t value_offset = layout_add(&layout, value_layout);
-    map->node_layout.size = layout.size;
-    map->node_layout.key_offset = key_offset;
-    map->node_layout.key_size = key_layout.size;
-    map->node_layout.value_offset = value_offset;
-    map->node_layout.value_size = value_layout.size;
-
+    map->tombstone_count = 0;
+    map->node_layout = node_layout;
+#ifdef MAP_STATS
+    map->node_layout.stats = &map->stats;
+    map->stats = (Map_stats){0};
+#endif
     map->comparator = comparator;
+    map->options = options;
+    map->b_tree = NULL;
     map->allocator = allocator;
+
+    if (options.pool_chunk_size != 0) {
+      Layout layout = {.size = node_layout.size, .alignment = node_layout.alignment};
+      map->node_allocator = pool_allocator_new_with(layout, options.pool_chunk_size, allocator);
+
+      if (map->node_allocator.data == NULL) {
+        allocator_free(allocator, map);
+        return NULL;
+      }
+    } else {
+      map->node_allocator = allocator;
+    }
+  }
+
+  return map;
+}
+
+Map* map_new_with_options(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator, Map_options options) {
+  assert(!options.b_tree || (options.pool_chunk_size == 0 && !options.order_statistics));
+  assert(!options.string_keys || (key_layout.size == sizeof(Map_string) && comparator_kind(comparator) == COMPARATOR_MAP_STRING && !options.b_tree));
+  assert(options.tombstone_fraction >= 0 && options.tombstone_fraction <= 1);
+  assert(options.tombstone_fraction == 0 || (!options.order_statistics && !options.b_tree));
+  Map* map = map_new_with_node_layout(map_layout_nodes(key_layout, value_layout, options), comparator, allocator, options);
+
+  if (map != NULL && options.b_tree) {
+    map->b_tree = b_tree_new(key_layout, value_layout, comparator, allocator);
+
+    if (map->b_tree == NULL) {
+      allocator_free(allocator, map);
+      return NULL;
+    }
   }
 
   return map;
 }
 
 void map_check(const Map* map) {
+  if (map->b_tree != NULL) {
+    b_tree_check(map->b_tree);
+    return;
+  }
+
   assert(node_is_black(map->root));
   node_check(map->root);
-  assert(node_count(map->root) == map->count);
+  assert(node_count(map->root) == map->count + map->tombstone_count);
+  assert(map->xmost_nodes[LEFT] == (map->root != NULL ? node_xmost_node(map->root, LEFT) : NULL));
+  assert(map->xmost_nodes[RIGHT] == (map->root != NULL ? node_xmost_node(map->root, RIGHT) : NULL));
+
+  if (map->node_layout.size_offset != 0)
+    node_check_sizes(map->root, &map->node_layout);
+
+  if (map->node_layout.tombstone_offset != 0) {
+    size_t tombstone_count = 0;
+
+    for (const Node* node = map->xmost_nodes[LEFT]; node != NULL; node = node_in_order_xcessor(node, RIGHT)) {
+      tombstone_count += node_is_tombstone(node, &map->node_layout) ? 1 : 0;
+    }
+
+    assert(tombstone_count == map->tombstone_count);
+  }
 }
 
 size_t map_count(const Map* map) {
-  return map->count;
+  return map->b_tree != NULL ? b_tree_count(map->b_tree) : map->count;
+}
+
+bool map_stats(const Map* map, Map_stats* stats) {
+#ifdef MAP_STATS
+  *stats = map->stats;
+  return true;
+#else
+  (void)map;
+  *stats = (Map_stats){0};
+  return false;
+#endif
+}
+
+void map_reset_stats(Map* map) {
+#ifdef MAP_STATS
+  map->stats = (Map_stats){0};
+#else
+  (void)map;
+#endif
 }
 
 void* map_lookup(const Map* map, const void* key) {
-  const Node* node = map->root;
+  if (map->b_tree != NULL)
+    return b_tree_lookup(map->b_tree, key);
 
-  while (node != NULL) {
-    int ordering = comparator_compare(map->comparator, key, node_key(node, &map->node_layout));
+  Node* parent;
+  Direction direction;
+  const Node* node = map_find(map, key, &parent, &direction);
+  return node != NULL && !node_is_tombstone(node, &map->node_layout) ? node_value(node, &map->node_layout) : NULL;
+}
 
-    if (ordering < 0) {
-      node = node->children[LEFT];
-    } else if (ordering > 0) {
-      node = node->children[RIGHT];
-    } else {
-      return node_value(node, &map->node_layout);
+/// @brief The number of searches walked in lockstep by @c map_lookup_many
+#define MAP_LOOKUP_BATCH_SIZE 16
+
+/// @brief Hints that the memory at an address is about to be read
+#ifdef __GNUC__
+#define MAP_PREFETCH(ADDRESS) __builtin_prefetch(ADDRESS)
+#else
+#define MAP_PREFETCH(ADDRESS) ((void)(ADDRESS))
+#endif
+
+/// @brief Walks the searches of a batch of keys in lockstep, going left or right as long as @p ORDERING (comparing
+/// @c key to @c node_key) is negative or positive, and prefetching the next node of each search
+#define MAP_LOOKUP_MANY(ORDERING)                                      \
+  while (active != 0) {                                                \
+    active = 0;                                                        \
+                                                                       \
+    for (size_t i = 0; i < size; ++i) {                                \
+      const Node* node = nodes[i];                                     \
+                                                                       \
+      if (node == NULL)                                                \
+        continue;                                                      \
+                                                                       \
+      const void* key = (const char*)keys + (batch + i) * key_size;    \
+      const void* node_key = (const char*)node + key_offset;           \
+      int ordering = (ORDERING);                                       \
+      MAP_STATS_ADD(&map->node_layout, comparisons, 1);                \
+                                                                       \
+      if (ordering == 0) {                                             \
+        if (!node_is_tombstone(node, &map->node_layout))               \
+          values[batch + i] = (char*)node + value_offset;              \
+                                                                       \
+        nodes[i] = NULL;                                               \
+        continue;                                                      \
+      }                                                                \
+                                                                       \
+      node = node->children[ordering < 0 ? LEFT : RIGHT];              \
+      nodes[i] = node;                                                 \
+                                                                       \
+      if (node != NULL) {                                              \
+        MAP_PREFETCH((const char*)node + key_offset);                  \
+        active += 1;                                                   \
+      }                                                                \
+    }                                                                  \
+  }
+
+/// @brief Walks the searches of a batch of keys of a scalar type in lockstep, resorting to the comparator only to
+/// break ties
+#define MAP_LOOKUP_MANY_SCALAR(TYPE, TIE)                                 \
+  MAP_LOOKUP_MANY(                                                        \
+    *(const TYPE*)key < *(const TYPE*)node_key                            \
+      ? -1                                                                \
+      : (*(const TYPE*)key > *(const TYPE*)node_key ? +1 : (TIE))         \
+  )
+
+void map_lookup_many(const Map* map, const void* keys, size_t count, void** values) {
+  if (map->b_tree != NULL) {
+    b_tree_lookup_many(map->b_tree, keys, count, values);
+    return;
+  }
+
+  size_t key_size = map->node_layout.key_size;
+  size_t key_offset = map->node_layout.key_offset;
+  size_t value_offset = map->node_layout.value_offset;
+
+  for (size_t batch = 0; batch < count; batch += MAP_LOOKUP_BATCH_SIZE) {
+    size_t size = count - batch < MAP_LOOKUP_BATCH_SIZE ? count - batch : MAP_LOOKUP_BATCH_SIZE;
+    const Node* nodes[MAP_LOOKUP_BATCH_SIZE];
+    size_t active = map->root != NULL ? size : 0;
+
+    for (size_t i = 0; i < size; ++i) {
+      nodes[i] = map->root;
+      values[batch + i] = NULL;
     }
+
+    MAP_SWITCH_COMPARATOR(MAP_LOOKUP_MANY, MAP_LOOKUP_MANY_SCALAR)
+  }
+}
+
+#undef MAP_LOOKUP_MANY_SCALAR
+#undef MAP_LOOKUP_MANY
+#undef MAP_PREFETCH
+#undef MAP_LOOKUP_BATCH_SIZE
+#undef MAP_SWITCH_COMPARATOR
+
+/// @brief Finds the node holding the nearest key to a given key on a given side, if any
+/// @param direction @c LEFT for the greatest lesser key, @c RIGHT for the least greater key
+/// @param inclusive If @c true, the node holding the given key itself is found if any
+static Node* map_find_bound(const Map* map, const void* key, Direction direction, bool inclusive) {
+  Node* parent;
+  Direction parent_direction;
+  Node* node = map_find(map, key, &parent, &parent_direction);
+
+  if (node != NULL) {
+    node = inclusive ? node : node_in_order_xcessor(node, direction);
+  } else if (parent == NULL || parent_direction != direction) {
+    // The key would be attached to the parent, which is the nearest key on the other side of the attachment:
+    node = parent;
+  } else {
+    node = node_in_order_xcessor(parent, direction);
   }
 
-  return NULL;
+  return node_skip_tombstones(node, direction, &map->node_layout);
 }
 
-bool map_insert(Map* map, const void* key, const void* value) {
-  // Top-down pass:
+void* map_lower_bound(const Map* map, const void* key) {
+  if (map->b_tree != NULL)
+    return b_tree_find_bound(map->b_tree, key, true, true);
+
+  Node* node = map_find_bound(map, key, RIGHT, true);
+  return node != NULL ? node_value(node, &map->node_layout) : NULL;
+}
+
+void* map_upper_bound(const Map* map, const void* key) {
+  if (map->b_tree != NULL)
+    return b_tree_find_bound(map->b_tree, key, true, false);
+
+  Node* node = map_find_bound(map, key, RIGHT, false);
+  return node != NULL ? node_value(node, &map->node_layout) : NULL;
+}
+
+void* map_floor(const Map* map, const void* key) {
+  if (map->b_tree != NULL)
+    return b_tree_find_bound(map->b_tree, key, false, true);
+
+  Node* node = map_find_bound(map, key, LEFT, true);
+  return node != NULL ? node_value(node, &map->node_layout) : NULL;
+}
+
+size_t map_scan(const Map* map, const void* low, const void* high, bool (*visit)(const void* key, void* value, void* data), void* data) {
+  if (low != NULL && high != NULL && map_compare(map, low, high) >= 0)
+    return 0;
+
+  if (map->b_tree != NULL)
+    return b_tree_scan(map->b_tree, low, high, visit, data);
+
+  Node* node = low != NULL ? map_find_bound(map, low, RIGHT, true) : node_skip_tombstones(map->xmost_nodes[LEFT], RIGHT, &map->node_layout);
+  Node* end = high != NULL ? map_find_bound(map, high, RIGHT, true) : NULL;
+  size_t count = 0;
+
+  while (node != end) {
+    count += 1;
+
+    if (!visit(node_key(node, &map->node_layout), node_value(node, &map->node_layout), data))
+      break;
+
+    node = node_skip_tombstones(node_in_order_xcessor(node, RIGHT), RIGHT, &map->node_layout);
+  }
+
+  return count;
+}
+
+/// @brief Computes the number of keys less than that held by a node, walking up from the node
+static size_t map_node_rank(const Map* map, const Node* node) {
+  size_t rank = node_size(node->children[LEFT], &map->node_layout);
+
+  for (; node_get_parent(node) != NULL; node = node_get_parent(node)) {
+    if (node_get_direction(node) == RIGHT)
+      rank += node_size(node_get_parent(node)->children[LEFT], &map->node_layout) + 1;
+  }
+
+  return rank;
+}
+
+size_t map_rank(const Map* map, const void* key) {
+  assert(map->node_layout.size_offset != 0);
+  Node* parent;
+  Direction direction;
+  Node* node = map_find(map, key, &parent, &direction);
+
+  if (node != NULL)
+    return map_node_rank(map, node);
+
+  if (parent == NULL)
+    return 0;
+
+  return map_node_rank(map, parent) + (direction == RIGHT ? 1 : 0);
+}
+
+void* map_select(const Map* map, size_t index) {
+  assert(map->node_layout.size_offset != 0);
+
+  if (index >= map->count)
+    return NULL;
 
   Node* node = map->root;
-  Node* parent = NULL;
-  Direction node_direction = LEFT;
 
-  while (node != NULL) {
-    int ordering = comparator_compare(map->comparator, key, node_key(node, &map->node_layout));
+  while (true) {
+    size_t left_size = node_size(node->children[LEFT], &map->node_layout);
 
-    if (ordering < 0) {
-      parent = node;
-      node = node->children[node_direction = LEFT];
-    } else if (ordering > 0) {
-      parent = node;
-      node = node->children[node_direction = RIGHT];
+    if (index < left_size) {
+      node = node->children[LEFT];
+    } else if (index > left_size) {
+      index -= left_size + 1;
+      node = node->children[RIGHT];
     } else {
-      memmove(
-        node_value(node, &map->node_layout),
-        value,
-        map->node_layout.value_size
-      );
-
-      return true;
+      return node_value(node, &map->node_layout);
     }
   }
+}
 
-  if ((node = allocator_allocate(map->allocator, map->node_layout.size)) == NULL)
-    return false;
+size_t map_count_range(const Map* map, const void* low, const void* high) {
+  if (low != NULL && high != NULL && map_compare(map, low, high) >= 0)
+    return 0;
 
-  node->children[LEFT] = NULL;
-  node->children[RIGHT] = NULL;
-  node->parent = parent;
-  node->direction = node_direction;
-  node->color = RED;
+  size_t low_rank = low != NULL ? map_rank(map, low) : 0;
+  size_t high_rank = high != NULL ? map_rank(map, high) : map->count;
+  return high_rank - low_rank;
+}
 
-  memmove(
-    node_key(node, &map->node_layout),
-    key,
-    map->node_layout.key_size
-  );
+void* map_first(const Map* map) {
+  if (map->b_tree != NULL)
+    return b_tree_xmost(map->b_tree, false);
 
-  memmove(
-    node_value(node, &map->node_layout),
-    value,
-    map->node_layout.value_size
-  );
+  Node* node = node_skip_tombstones(map->xmost_nodes[LEFT], RIGHT, &map->node_layout);
+  return node != NULL ? node_value(node, &map->node_layout) : NULL;
+}
 
-  *(parent != NULL ? &parent->children[node_direction] : &map->root) = node;
-  map->count += 1;
+void* map_last(const Map* map) {
+  if (map->b_tree != NULL)
+    return b_tree_xmost(map->b_tree, true);
+
+  Node* node = node_skip_tombstones(map->xmost_nodes[RIGHT], LEFT, &map->node_layout);
+  return node != NULL ? node_value(node, &map->node_layout) : NULL;
+}
+
+void* map_next(const Map* map, const void* value) {
+  assert(map->b_tree == NULL);
+  Node* node = node_in_order_xcessor(value_node(value, &map->node_layout), RIGHT);
+  node = node_skip_tombstones(node, RIGHT, &map->node_layout);
+  return node != NULL ? node_value(node, &map->node_layout) : NULL;
+}
 
+void* map_previous(const Map* map, const void* value) {
+  assert(map->b_tree == NULL);
+  Node* node = node_in_order_xcessor(value_node(value, &map->node_layout), LEFT);
+  node = node_skip_tombstones(node, LEFT, &map->node_layout);
+  return node != NULL ? node_value(node, &map->node_layout) : NULL;
+}
+
+const void* map_key(const Map* map, const void* value) {
+  assert(map->b_tree == NULL);
+  return node_key(value_node(value, &map->node_layout), &map->node_layout);
+}
+
+/// @brief Rebalances a tree after a red node is linked into it, without recoloring its root
+/// @details Subtree sizes are maintained if the layout stores them, but not updated for the linked node.
+/// @param[in,out] root The root of the tree, updated if rotated
+/// @pre The tree respects the invariants of 2-3 red-black trees, except that @p node may have a red parent, and its root
+/// may be red
+static void node_fix_insertion(Node* node, Node** root, const Node_layout* layout) {
   // Bottom-up pass:
 
-  while (node->parent != NULL) {
-    assert(node->color == RED);
+  while (node_get_parent(node) != NULL) {
+    assert(node_get_color(node) == RED);
+    MAP_STATS_ADD(layout, insertion_fixups, 1);
 
-    if (node->parent->color == RED) {
-      if (node->direction != node->parent->direction) {
+    if (node_get_color(node_get_parent(node)) == RED) {
+      if (node_get_direction(node) != node_get_direction(node_get_parent(node))) {
         //              Rule from Figure 9a:
         //   A           A        ╎        C           C
         // ┌─┶━┓       ┌─┶━┓      ╎      ┏━┵─┐       ┏━┵─┐
@@ -325,9 +1048,9 @@ bool map_insert(Map* map, const void* key, const void* value) {
         //  →B   δ       b   C←   ╎   →A   c       a   B←
         // ┌─┴─┐           ┌─┴─┐  ╎  ┌─┴─┐           ┌─┴─┐
         // b   c           c   d  ╎  a   b           b   c
-        node = node->parent;
-        Node* B = node_rotate(node, node->direction);
-        B->parent->children[B->direction] = B;
+        node = node_get_parent(node);
+        Node* B = node_rotate(node, node_get_direction(node), layout);
+        node_get_parent(B)->children[node_get_direction(B)] = B;
       }
 
       //                  Rule from Figure 9b:
@@ -338,11 +1061,11 @@ bool map_insert(Map* map, const void* key, const void* value) {
       //  →A   c       ┌─┴─┐ ┌─┴─┐  ╎  ┌─┴─┐ ┌─┴─┐       b   C←
       // ┌─┴─┐         a   b c   d  ╎  a   b c   d         ┌─┴─┐
       // a   b                      ╎                      c   d
-      Node* B = node_rotate(node->parent->parent, 1 - node->direction);
-      *(B->parent != NULL ? &B->parent->children[B->direction] : &map->root) = B;
+      Node* B = node_rotate(node_get_parent(node_get_parent(node)), 1 - node_get_direction(node), layout);
+      *(node_get_parent(B) != NULL ? &node_get_parent(B)->children[node_get_direction(B)] : root) = B;
     }
 
-    if (node_is_red(node->parent->children[1 - node->direction])) {
+    if (node_is_red(node_get_parent(node)->children[1 - node_get_direction(node)])) {
       //            Rule from Figure 9c:
       //      ╷               ╻               ╷
       //      B              →B               B
@@ -350,46 +1073,238 @@ bool map_insert(Map* map, const void* key, const void* value) {
       //  →A     C         A     C         A     C←
       // ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐
       // a   b c   d     a   b c   d     a   b c   d
-      node->color = BLACK;
-      node->parent->children[1 - node->direction]->color = BLACK;
-      node->parent->color = RED;
-      node = node->parent;
-    } else {  // if (node_is_black(node->parent->children[1 - node->direction]))
+      node_set_color(node, BLACK);
+      node_set_color(node_get_parent(node)->children[1 - node_get_direction(node)], BLACK);
+      node_set_color(node_get_parent(node), RED);
+      node = node_get_parent(node);
+    } else {  // if (node_is_black(node_get_parent(node)->children[1 - node_get_direction(node)]))
       break;
     }
   }
-
-  map->root->color = BLACK;
-  return true;
 }
 
-bool map_remove(Map* map, const void* key) {
-  // Top-down pass:
+/// @brief Copies the characters of the key of a node to memory owned by the map, if it is a string key too long to hold
+/// them inline
+/// @return @c true on success, @c false if memory could not be allocated
+static bool map_own_key(Map* map, Node* node) {
+  if (!map->options.string_keys)
+    return true;
 
-  Node* node = map->root;
+  Map_string* string = node_key(node, &map->node_layout);
 
-  while (true) {
-    if (node != NULL) {
-      int ordering = comparator_compare(map->comparator, key, node_key(node, &map->node_layout));
+  if (string->length <= MAP_STRING_INLINE_LENGTH)
+    return true;
 
-      if (ordering < 0) {
-        node = node->children[LEFT];
-      } else if (ordering > 0) {
-        node = node->children[RIGHT];
-      } else {
-        break;
-      }
-    } else {
-      return false;
-    }
-  }
+  char* chars = map_allocate(map, map->allocator, string->length);
 
-  if (node->children[LEFT] != NULL && node->children[RIGHT] != NULL) {
-    Node* in_order_predecessor = node_xmost_node(node->children[LEFT], RIGHT);
+  if (chars == NULL)
+    return false;
 
-    memmove(
-      node_key(node, &map->node_layout),
-      node_key(in_order_predecessor, &map->node_layout),
+  memcpy(chars, string->chars, string->length);
+  string->chars = chars;
+  return true;
+}
+
+/// @brief Frees the memory owned by the map for the key of a node, if any
+static void map_release_key(Map* map, Node* node) {
+  if (!map->options.string_keys)
+    return;
+
+  Map_string* string = node_key(node, &map->node_layout);
+
+  if (string->length > MAP_STRING_INLINE_LENGTH)
+    map_deallocate(map, map->allocator, (char*)string->chars);
+}
+
+/// @brief Frees a node, along with the memory owned by the map for its key
+static void map_free_node(Map* map, Node* node) {
+  map_release_key(map, node);
+  map_deallocate(map, map->node_allocator, node);
+}
+
+/// @brief Associates the key of a node to a value, reviving the node if it is a tombstone
+static void map_set_value(Map* map, Node* node, const void* value) {
+  memmove(
+    node_value(node, &map->node_layout),
+    value,
+    map->node_layout.value_size
+  );
+
+  if (node_is_tombstone(node, &map->node_layout)) {
+    *node_tombstone_p(node, &map->node_layout) = false;
+    map->tombstone_count -= 1;
+    map->count += 1;
+  }
+}
+
+/// @brief Allocates a new red node with no children, holding a key-value pair, and links it to a parent
+/// @details The tree is then rebalanced, and the extreme nodes of the map are updated.
+/// @pre `parent != NULL ? parent->children[direction] == NULL : map->root == NULL`
+/// @return The new node, or @c NULL if memory could not be allocated
+static Node* map_attach(Map* map, Node* parent, Direction direction, const void* key, const void* value) {
+  Node* node = map_allocate(map, map->node_allocator, map->node_layout.size);
+
+  if (node == NULL)
+    return NULL;
+
+  node->children[LEFT] = NULL;
+  node->children[RIGHT] = NULL;
+  node_init_links(node, parent, direction, RED);
+
+  memmove(
+    node_key(node, &map->node_layout),
+    key,
+    map->node_layout.key_size
+  );
+
+  memmove(
+    node_value(node, &map->node_layout),
+    value,
+    map->node_layout.value_size
+  );
+
+  if (!map_own_key(map, node)) {
+    map_deallocate(map, map->node_allocator, node);
+    return NULL;
+  }
+
+  if (parent != NULL) {
+    parent->children[direction] = node;
+
+    if (parent == map->xmost_nodes[direction])
+      map->xmost_nodes[direction] = node;
+  } else {
+    map->root = node;
+    map->xmost_nodes[LEFT] = node;
+    map->xmost_nodes[RIGHT] = node;
+  }
+
+  if (map->node_layout.tombstone_offset != 0)
+    *node_tombstone_p(node, &map->node_layout) = false;
+
+  if (map->node_layout.size_offset != 0) {
+    *node_size_p(node, &map->node_layout) = 1;
+
+    for (Node* ancestor = parent; ancestor != NULL; ancestor = node_get_parent(ancestor)) {
+      *node_size_p(ancestor, &map->node_layout) += 1;
+    }
+  }
+
+  map->count += 1;
+  node_fix_insertion(node, &map->root, &map->node_layout);
+  node_set_color(map->root, BLACK);
+  return node;
+}
+
+/// @brief Associates a key to a value
+/// @return The node holding the key-value pair, or @c NULL if memory could not be allocated
+static Node* map_put(Map* map, const void* key, const void* value) {
+  // Top-down pass:
+
+  Node* parent;
+  Direction node_direction;
+  Node* node = map_find(map, key, &parent, &node_direction);
+
+  if (node != NULL) {
+    map_set_value(map, node, value);
+    return node;
+  }
+
+  return map_attach(map, parent, node_direction, key, value);
+}
+
+bool map_insert(Map* map, const void* key, const void* value) {
+  if (map->b_tree != NULL)
+    return b_tree_insert(map->b_tree, key, value) != NULL;
+
+  return map_put(map, key, value) != NULL;
+}
+
+void* map_insert_near(Map* map, void* hint, const void* key, const void* value) {
+  if (map->b_tree != NULL)
+    return b_tree_insert(map->b_tree, key, value);
+
+  Node* node;
+
+  if (hint == NULL) {
+    node = map_put(map, key, value);
+    return node != NULL ? node_value(node, &map->node_layout) : NULL;
+  }
+
+  node = value_node(hint, &map->node_layout);
+  int ordering = map_compare(map, key, node_key(node, &map->node_layout));
+
+  if (ordering != 0) {
+    // The key belongs between the hint and its in-order neighbor (if any) on the side of the key:
+
+    Direction direction = ordering < 0 ? LEFT : RIGHT;
+    Node* neighbor = node != map->xmost_nodes[direction] ? node_in_order_xcessor(node, direction) : NULL;
+    int neighbor_ordering = neighbor != NULL ? map_compare(map, key, node_key(neighbor, &map->node_layout)) : -ordering;
+
+    if (neighbor_ordering == 0) {
+      node = neighbor;
+    } else {
+      if ((neighbor_ordering < 0) == (ordering < 0)) {
+        node = map_put(map, key, value);
+      } else if (node->children[direction] == NULL) {
+        node = map_attach(map, node, direction, key, value);
+      } else {  // if (neighbor->children[1 - direction] == NULL)
+        node = map_attach(map, neighbor, 1 - direction, key, value);
+      }
+
+      return node != NULL ? node_value(node, &map->node_layout) : NULL;
+    }
+  }
+
+  map_set_value(map, node, value);
+  return node_value(node, &map->node_layout);
+}
+
+bool map_append(Map* map, const void* key, const void* value) {
+  if (map->b_tree != NULL)
+    return map_insert(map, key, value);
+
+  Node* rightmost_node = map->xmost_nodes[RIGHT];
+
+  if (rightmost_node == NULL || map_compare(map, key, node_key(rightmost_node, &map->node_layout)) > 0)
+    return map_attach(map, rightmost_node, RIGHT, key, value) != NULL;
+
+  return map_insert(map, key, value);
+}
+
+bool map_remove(Map* map, const void* key) {
+  if (map->b_tree != NULL)
+    return b_tree_remove(map->b_tree, key);
+
+  // Top-down pass:
+
+  Node* parent;
+  Direction node_direction;
+  Node* node = map_find(map, key, &parent, &node_direction);
+
+  if (node == NULL || node_is_tombstone(node, &map->node_layout))
+    return false;
+
+  if (map->node_layout.tombstone_offset != 0) {
+    *node_tombstone_p(node, &map->node_layout) = true;
+    map->tombstone_count += 1;
+    map->count -= 1;
+
+    if ((double)map->tombstone_count > map->options.tombstone_fraction * (double)(map->count + map->tombstone_count))
+      map_compact(map);
+
+    return true;
+  }
+
+  // The key of the removed node is released, and that of its predecessor, if any, moved into it:
+  map_release_key(map, node);
+
+  if (node->children[LEFT] != NULL && node->children[RIGHT] != NULL) {
+    Node* in_order_predecessor = node_xmost_node(node->children[LEFT], RIGHT);
+
+    memmove(
+      node_key(node, &map->node_layout),
+      node_key(in_order_predecessor, &map->node_layout),
       map->node_layout.key_size
     );
 
@@ -402,24 +1317,35 @@ bool map_remove(Map* map, const void* key) {
     node = in_order_predecessor;
   }
 
-  Node* parent = node->parent;
-  Direction node_direction = node->direction;
-  Color node_color = node->color;
+  for (size_t i = 0; i < 2; ++i) {
+    if (node == map->xmost_nodes[i])
+      map->xmost_nodes[i] = node->children[1 - i] != NULL ? node->children[1 - i] : node_get_parent(node);
+  }
+
+  if (map->node_layout.size_offset != 0) {
+    for (Node* ancestor = node_get_parent(node); ancestor != NULL; ancestor = node_get_parent(ancestor)) {
+      *node_size_p(ancestor, &map->node_layout) -= 1;
+    }
+  }
+
+  parent = node_get_parent(node);
+  node_direction = node_get_direction(node);
+  Color node_color = node_get_color(node);
 
   for (size_t i = 0; i < 2; ++i) {
     if (node->children[i] != NULL) {
       Node* child = node->children[i];
-      child->parent = parent;
-      child->direction = node_direction;
-      child->color = node_color;
-      allocator_free(map->allocator, node);
+      node_set_parent(child, parent);
+      node_set_direction(child, node_direction);
+      node_set_color(child, node_color);
+      map_deallocate(map, map->node_allocator, node);
       *(parent != NULL ? &parent->children[node_direction] : &map->root) = child;
       map->count -= 1;
       return true;
     }
   }
 
-  allocator_free(map->allocator, node);
+  map_deallocate(map, map->node_allocator, node);
   *(parent != NULL ? &parent->children[node_direction] : &map->root) = NULL;
   map->count -= 1;
 
@@ -429,9 +1355,10 @@ bool map_remove(Map* map, const void* key) {
     return true;
 
   do {
+    MAP_STATS_ADD(&map->node_layout, removal_fixups, 1);
     Node* sibling = parent->children[1 - node_direction];
 
-    if (sibling->color == RED) {
+    if (node_get_color(sibling) == RED) {
       //                              Rule from Figure 13c:
       //          D                 B           ╎           D                 B
       //      ┏━━━┵───┐         ┌───┶━━━┓       ╎       ┏━━━┵───┐         ┌───┶━━━┓
@@ -440,8 +1367,8 @@ bool map_remove(Map* map, const void* key) {
       //   A     C  e   f     a   b  C     E←   ╎   →A     C  e   f     a   b  C     E
       // ┌─┴─┐ ┌─┴─┐               ┌─┴─┐ ┌─┴─┐  ╎  ┌─┴─┐ ┌─┴─┐               ┌─┴─┐ ┌─┴─┐
       // a   b c   d               c   d e   f  ╎  a   b c   d               c   d e   f
-      Node* DB = node_rotate(parent, node_direction);
-      *(DB->parent != NULL ? &DB->parent->children[DB->direction] : &map->root) = DB;
+      Node* DB = node_rotate(parent, node_direction, &map->node_layout);
+      *(node_get_parent(DB) != NULL ? &node_get_parent(DB)->children[node_get_direction(DB)] : &map->root) = DB;
       sibling = parent->children[1 - node_direction];
     }
 
@@ -451,10 +1378,10 @@ bool map_remove(Map* map, const void* key) {
     //  →A     C    ▷    A     C    ╎    A     C    ◁    A     C←
     // ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐  ╎  ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐
     // a   b c   d     a   b c   d  ╎  a   b c   d     a   b c   d
-    sibling->color = RED;
+    node_set_color(sibling, RED);
 
     if (node_is_red(sibling->children[LEFT]) || node_is_red(sibling->children[RIGHT])) {
-      if (node_is_black(sibling->children[sibling->direction])) {
+      if (node_is_black(sibling->children[node_get_direction(sibling)])) {
         //                     Rule from Figure 15a:
         //                    A          ╎          D
         //    A             ┌─┶━┓        ╎        ┏━┵─┐             D
@@ -465,8 +1392,8 @@ bool map_remove(Map* map, const void* key) {
         // ┌─┴─┐ ┌─┴─┐          c   D    ╎    A   c          ┌─┴─┐ ┌─┴─┐
         // b   c d   e            ┌─┴─┐  ╎  ┌─┴─┐            a   b c   d
         //                        d   e  ╎  a   b
-        sibling = node_rotate(sibling, sibling->direction);
-        parent->children[sibling->direction] = sibling;
+        sibling = node_rotate(sibling, node_get_direction(sibling), &map->node_layout);
+        parent->children[node_get_direction(sibling)] = sibling;
       }
 
       //                    Rule from Figure 15b:
@@ -477,8 +1404,8 @@ bool map_remove(Map* map, const void* key) {
       //   A   c        ┌─┴─┐ ┌─┴─┐   ╎   ┌─┴─┐ ┌─┴─┐        b   C
       // ┌─┴─┐          a   b c   d←  ╎  →a   b c   d          ┌─┴─┐
       // a   b                        ╎                        c   d
-      Node* B = node_rotate(parent, node_direction);
-      *(B->parent != NULL ? &B->parent->children[B->direction] : &map->root) = B;
+      Node* B = node_rotate(parent, node_direction, &map->node_layout);
+      *(node_get_parent(B) != NULL ? &node_get_parent(B)->children[node_get_direction(B)] : &map->root) = B;
 
       //    Rule from Figure 15c:
       //      B               B
@@ -486,141 +1413,1301 @@ bool map_remove(Map* map, const void* key) {
       //   A     C    ▷    A     C
       // ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐
       // a   b c   d     a   b c   d
-      B->children[LEFT]->color = BLACK;
-      B->children[RIGHT]->color = BLACK;
+      node_set_color(B->children[LEFT], BLACK);
+      node_set_color(B->children[RIGHT], BLACK);
       return true;
     }
 
     node = parent;
-    parent = node->parent;
-    node_direction = node->direction;
-  } while (parent != NULL && node->color == BLACK);
+    parent = node_get_parent(node);
+    node_direction = node_get_direction(node);
+  } while (parent != NULL && node_get_color(node) == BLACK);
 
   // Rule from Figure 13a:
   //      ╻         ╷
   //      A    ▷    A
   //    ┌─┴─┐     ┌─┴─┐
   //    a   b     a   b
-  node->color = BLACK;
+  node_set_color(node, BLACK);
   return true;
 }
 
-Map* map_copy(const Map* map) {
-  return map_copy_with(map, heap_allocator);
+/// @brief Frees the nodes of a tree whose root has no parent
+/// @return The number of freed nodes
+static size_t map_free_tree(Map* map, Node* root) {
+  size_t count = 0;
+
+  if (root != NULL) {
+    Node* node = node_xmost_leaf(root, LEFT);
+
+    do {
+      Node* post_order_successor = node_post_order_xcessor(node, RIGHT);
+      map_free_node(map, node);
+      node = post_order_successor;
+      count += 1;
+    } while (node != NULL);
+  }
+
+  return count;
 }
 
-Map* map_copy_with(const Map* map, Allocator allocator) {
-  Map* new_map = allocator_allocate(allocator, MAP_SIZE);
-
-  if (new_map != NULL) {
-    if (map->root != NULL) {
-      const Node* node0 = map->root;
-      Node* node1 = allocator_allocate(allocator, map->node_layout.size);
-
-      if (node1 != NULL) {
-        node1->children[LEFT] = NULL;
-        node1->children[RIGHT] = NULL;
-        node1->parent = NULL;
-        node1->direction = node0->direction;
-        node1->color = node0->color;
-
-        memmove(
-          node_key(node1, &map->node_layout),
-          node_key(node0, &map->node_layout),
-          map->node_layout.key_size
-        );
-
-        memmove(
-          node_value(node1, &map->node_layout),
-          node_value(node0, &map->node_layout),
-          map->node_layout.value_size
-        );
-
-        new_map->root = node1;
-
-        while (true) {
-          Direction direction;
-
-          if (node0->children[LEFT] != NULL) {
-            direction = LEFT;
-          } else {
-            while (node0->children[RIGHT] == NULL || node1->children[RIGHT] != NULL) {
-              if (node0->parent == NULL) {
-                new_map->count = map->count;
-                new_map->node_layout = map->node_layout;
-                new_map->comparator = map->comparator;
-                new_map->allocator = allocator;
-                return new_map;
-              }
-
-              node0 = node0->parent;
-              node1 = node1->parent;
-            }
-
-            direction = RIGHT;
-          }
-
-          Node* new_node1 = allocator_allocate(allocator, map->node_layout.size);
-
-          if (new_node1 != NULL) {
-            new_node1->children[LEFT] = NULL;
-            new_node1->children[RIGHT] = NULL;
-            new_node1->parent = node1;
-            new_node1->direction = direction;
-            new_node1->color = node0->children[direction]->color;
-
-            memmove(
-              node_key(new_node1, &map->node_layout),
-              node_key(node0->children[direction], &map->node_layout),
-              map->node_layout.key_size
-            );
-
-            memmove(
-              node_value(new_node1, &map->node_layout),
-              node_value(node0->children[direction], &map->node_layout),
-              map->node_layout.value_size
-            );
-
-            node1->children[direction] = new_node1;
-            node0 = node0->children[direction];
-            node1 = node1->children[direction];
-          } else {  // if (new_node1 == NULL)
-            map_destroy(new_map);
-            return NULL;
-          }
-        }
-      } else {  // if (node1 == NULL)
-        allocator_free(allocator, new_map);
-        return NULL;
-      }
-    } else {  // if (map->root == NULL)
-      new_map->root = NULL;
-      new_map->count = 0;
-      new_map->node_layout = map->node_layout;
-      new_map->comparator = map->comparator;
-      new_map->allocator = allocator;
+/// @brief Links a child to a node, if any
+static void node_link(Node* node, Direction direction, Node* child) {
+  node->children[direction] = child;
+
+  if (child != NULL) {
+    node_set_parent(child, node);
+    node_set_direction(child, direction);
+  }
+}
+
+/// @brief Allocates a new red node with no parent nor children, holding a key-value pair
+/// @return The new node, or @c NULL if memory could not be allocated
+static Node* map_allocate_node(Map* map, const void* key, const void* value) {
+  Node* node = map_allocate(map, map->node_allocator, map->node_layout.size);
+
+  if (node != NULL) {
+    node_init_links(node, NULL, LEFT, RED);
+    node->children[LEFT] = NULL;
+    node->children[RIGHT] = NULL;
+    memmove(node_key(node, &map->node_layout), key, map->node_layout.key_size);
+    memmove(node_value(node, &map->node_layout), value, map->node_layout.value_size);
+
+    if (map->node_layout.tombstone_offset != 0)
+      *node_tombstone_p(node, &map->node_layout) = false;
+
+    if (!map_own_key(map, node)) {
+      map_deallocate(map, map->node_allocator, node);
+      return NULL;
     }
   }
 
-  return new_map;
+  return node;
 }
 
-void map_clear(Map* map) {
+/// @brief The smallest number of key-value pairs worth building or combining a tree of concurrently with another
+#define MAP_PARALLEL_GRAIN 4096
+
+/// @brief Returns the number of levels of recursion to run concurrently through an executor, so that it gets a few
+/// tasks per unit of concurrency to balance
+static size_t map_fork_depth(const Map_executor* executor) {
+  size_t depth = 0;
+
+  while (depth < 8 * sizeof(size_t) - 3 && ((size_t)1 << depth) < 4 * executor->concurrency) {
+    depth += 1;
+  }
+
+  return depth;
+}
+
+/// @brief Shares the key-value pairs of a tree to build between its logical 2-3 root node and its subtrees
+/// @param count The number of key-value pairs of the tree
+/// @param subtree_capacity The maximum number of key-value pairs each subtree can hold
+/// @param[out] subtree_shares The numbers of key-value pairs of the subtrees, from left to right
+/// @return The number of key-value pairs of the root node, @c 1 or @c 2
+static size_t map_share_tree(size_t count, size_t subtree_capacity, size_t subtree_shares[3]) {
+  size_t node_count = count <= 2 * subtree_capacity + 1 ? 1 : 2;
+  size_t subtree_count = count - node_count;
+
+  for (size_t i = 0; i <= node_count; ++i) {
+    subtree_shares[i] = (subtree_count + (node_count - i)) / (node_count + 1 - i);
+    subtree_count -= subtree_shares[i];
+  }
+
+  return node_count;
+}
+
+/// @brief Links the nodes of the logical 2-3 root node of a built tree to its subtrees, coloring them
+/// @param nodes The nodes of the root node, in key order
+/// @param node_count The number of nodes of the root node, @c 1 or @c 2
+/// @param subtrees The subtrees, from left to right
+/// @return The root of the tree
+static Node* map_link_tree(Map* map, Node* const* nodes, size_t node_count, Node* const* subtrees) {
+  Node* root = nodes[node_count - 1];
+  node_link(nodes[0], LEFT, subtrees[0]);
+  node_link(nodes[0], RIGHT, subtrees[1]);
+
+  if (node_count == 2) {
+    node_link(nodes[1], LEFT, nodes[0]);
+    node_link(nodes[1], RIGHT, subtrees[2]);
+  }
+
+  node_set_color(root, BLACK);
+
+  if (map->node_layout.size_offset != 0) {
+    for (size_t i = 0; i < node_count; ++i) {
+      node_update_size(nodes[i], &map->node_layout);
+    }
+  }
+
+  return root;
+}
+
+/// @brief Frees the nodes and subtrees of a tree whose building failed
+static void map_free_built_tree(Map* map, Node* const* nodes, Node* const* subtrees) {
+  for (size_t i = 0; i < 3; ++i) {
+    map_free_tree(map, subtrees[i]);
+  }
+
+  for (size_t i = 0; i < 2; ++i) {
+    if (nodes[i] != NULL)
+      map_free_node(map, nodes[i]);
+  }
+}
+
+static bool map_build_tree(
+  Map* map,
+  const char** keys,
+  const char** values,
+  size_t count,
+  size_t capacity,
+  const Map_executor* executor,
+  size_t depth,
+  Node** root
+);
+
+/// @brief The building of a tree out of key-value pairs, run as a task
+typedef struct Map_build_task {
+  /// @brief The map the tree is built for
+  Map* map;
+
+  /// @brief The keys
+  const char* keys;
+
+  /// @brief The values
+  const char* values;
+
+  /// @brief The number of key-value pairs
+  size_t count;
+
+  /// @brief The maximum number of key-value pairs a tree of the black height to build can hold
+  size_t capacity;
+
+  /// @brief The executor running the levels of recursion left to run concurrently
+  const Map_executor* executor;
+
+  /// @brief The number of levels of recursion left to run concurrently
+  size_t depth;
+
+  /// @brief The root of the built tree, or @c NULL
+  Node* root;
+
+  /// @brief @c true if the tree was built, @c false if memory could not be allocated
+  bool success;
+} Map_build_task;
+
+/// @brief Runs a @c Map_build_task
+static void map_run_build_task(void* argument) {
+  Map_build_task* task = argument;
+  task->success = map_build_tree(task->map, &task->keys, &task->values, task->count, task->capacity, task->executor, task->depth, &task->root);
+}
+
+/// @brief Builds a tree out of key-value pairs sorted in increasing key order, allocating nodes in the same order
+/// unless subtrees are built concurrently
+/// @details Each logical 2-3 node is a single black node if @p count allows its two subtrees to fit under @p capacity,
+/// or a black node with a red left child otherwise.
+/// @param[in,out] keys The keys, advanced past the consumed ones
+/// @param[in,out] values The values, advanced past the consumed ones
+/// @param count The number of key-value pairs, at least `2^h - 1` if @p capacity is `3^h - 1`
+/// @param capacity The maximum number of key-value pairs a tree of the black height to build can hold
+/// @param executor The executor through which subtrees are built concurrently, or @c NULL
+/// @param depth The number of levels of recursion left to run concurrently through @p executor
+/// @param[out] root The root of the built tree, without parent, or @c NULL if @p count is @c 0
+/// @return @c true on success, @c false if memory could not be allocated, in which case nothing is left allocated
+static bool map_build_tree(
+  Map* map,
+  const char** keys,
+  const char** values,
+  size_t count,
+  size_t capacity,
+  const Map_executor* executor,
+  size_t depth,
+  Node** root
+) {
+  *root = NULL;
+
+  if (count == 0)
+    return true;
+
+  size_t subtree_capacity = (capacity - 2) / 3;
+  size_t subtree_shares[3] = {0, 0, 0};
+  size_t node_count = map_share_tree(count, subtree_capacity, subtree_shares);
+  Node* subtrees[3] = {NULL, NULL, NULL};
+  Node* nodes[2] = {NULL, NULL};
+
+  if (executor != NULL && depth > 0 && count >= MAP_PARALLEL_GRAIN) {
+    Map_build_task tasks[3];
+    void* arguments[3];
+    size_t offset = 0;
+
+    for (size_t i = 0; i <= node_count; ++i) {
+      tasks[i] = (Map_build_task){
+        map,
+        *keys + offset * map->node_layout.key_size,
+        *values + offset * map->node_layout.value_size,
+        subtree_shares[i],
+        subtree_capacity,
+        executor,
+        depth - 1,
+        NULL,
+        false,
+      };
+
+      arguments[i] = &tasks[i];
+      offset += subtree_shares[i];
+
+      if (i == node_count)
+        break;
+
+      nodes[i] = map_allocate_node(map, *keys + offset * map->node_layout.key_size, *values + offset * map->node_layout.value_size);
+      offset += 1;
+
+      if (nodes[i] == NULL)
+        goto failure;
+    }
+
+    executor->run(executor->data, map_run_build_task, arguments, node_count + 1);
+    bool success = true;
+
+    for (size_t i = 0; i <= node_count; ++i) {
+      subtrees[i] = tasks[i].root;
+      success = success && tasks[i].success;
+    }
+
+    if (!success)
+      goto failure;
+
+    *keys += count * map->node_layout.key_size;
+    *values += count * map->node_layout.value_size;
+  } else {
+    for (size_t i = 0; i <= node_count; ++i) {
+      if (!map_build_tree(map, keys, values, subtree_shares[i], subtree_capacity, NULL, 0, &subtrees[i]))
+        goto failure;
+
+      if (i == node_count)
+        break;
+
+      nodes[i] = map_allocate_node(map, *keys, *values);
+
+      if (nodes[i] == NULL)
+        goto failure;
+
+      *keys += map->node_layout.key_size;
+      *values += map->node_layout.value_size;
+    }
+  }
+
+  *root = map_link_tree(map, nodes, node_count, subtrees);
+  return true;
+
+failure:
+  map_free_built_tree(map, nodes, subtrees);
+  return false;
+}
+
+/// @brief Replaces the key-value pairs of a map with ones sorted in strictly increasing key order
+/// @param executor The executor through which subtrees are built concurrently, or @c NULL
+static bool map_build_using(Map* map, const void* keys, const void* values, size_t count, const Map_executor* executor) {
+#ifndef NDEBUG
+  for (size_t i = 1; i < count; ++i) {
+    const char* key = (const char*)keys + i * map->node_layout.key_size;
+    assert(comparator_compare(map->comparator, key - map->node_layout.key_size, key) < 0);
+  }
+#endif
+
+  map_clear(map);
+
+  if (map->b_tree != NULL) {
+    for (size_t i = 0; i < count; ++i) {
+      const char* key = (const char*)keys + i * map->node_layout.key_size;
+      const char* value = (const char*)values + i * map->node_layout.value_size;
+
+      if (b_tree_insert(map->b_tree, key, value) == NULL) {
+        map_clear(map);
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // The smallest black height whose 2-3 trees can hold all key-value pairs:
+  size_t capacity = 0;
+
+  while (capacity < count) {
+    capacity = 3 * capacity + 2;
+  }
+
+  const char* key = keys;
+  const char* value = values;
+  size_t depth = executor != NULL ? map_fork_depth(executor) : 0;
+
+  if (!map_build_tree(map, &key, &value, count, capacity, executor, depth, &map->root))
+    return false;
+
   if (map->root != NULL) {
-    Node* node = node_xmost_leaf(map->root, LEFT);
+    map->xmost_nodes[LEFT] = node_xmost_node(map->root, LEFT);
+    map->xmost_nodes[RIGHT] = node_xmost_node(map->root, RIGHT);
+  }
 
-    do {
-      Node* post_order_successor = node_post_order_xcessor(node, RIGHT);
-      allocator_free(map->allocator, node);
-      node = post_order_successor;
-    } while (node != NULL);
+  map->count = count;
+  return true;
+}
+
+bool map_build(Map* map, const void* keys, const void* values, size_t count) {
+  return map_build_using(map, keys, values, count, NULL);
+}
+
+bool map_build_parallel(Map* map, const void* keys, const void* values, size_t count, const Map_executor* executor) {
+  assert(map->options.pool_chunk_size == 0);
+  return map_build_using(map, keys, values, count, executor);
+}
+
+/// @brief A source of key-value pairs in strictly increasing key order, read into the nodes of a tree as it is built
+typedef struct Map_build_source {
+  bool (*read)(void* data, void* key, void* value);
+  void* data;
+
+  /// @brief The last key read, or @c NULL
+  const void* last_key;
+} Map_build_source;
+
+/// @brief Allocates a new red node with no parent nor children, holding the next key-value pair of a source
+/// @return The new node, or @c NULL if memory could not be allocated, the source could not be read, or the key read
+/// is not greater than the previous one
+static Node* map_read_node(Map* map, Map_build_source* source) {
+  Node* node = map_allocate(map, map->node_allocator, map->node_layout.size);
+
+  if (node == NULL)
+    return NULL;
+
+  node_init_links(node, NULL, LEFT, RED);
+  node->children[LEFT] = NULL;
+  node->children[RIGHT] = NULL;
+
+  if (map->node_layout.tombstone_offset != 0)
+    *node_tombstone_p(node, &map->node_layout) = false;
+
+  void* key = node_key(node, &map->node_layout);
+
+  if (!source->read(source->data, key, node_value(node, &map->node_layout)) ||
+      (source->last_key != NULL && map_compare(map, source->last_key, key) >= 0)) {
+    map_deallocate(map, map->node_allocator, node);
+    return NULL;
   }
 
-  map->root = NULL;
-  map->count = 0;
+  if (!map_own_key(map, node)) {
+    map_deallocate(map, map->node_allocator, node);
+    return NULL;
+  }
+
+  source->last_key = key;
+  return node;
 }
 
-void map_destroy(Map* map) {
+/// @brief Builds a tree out of key-value pairs read from a source, allocating and reading nodes in key order
+/// @details The tree is shaped as by @c map_build_tree, building each subtree before the node following it.
+/// @param count The number of key-value pairs, at least `2^h - 1` if @p capacity is `3^h - 1`
+/// @param capacity The maximum number of key-value pairs a tree of the black height to build can hold
+/// @param[out] root The root of the built tree, without parent, or @c NULL if @p count is @c 0
+/// @return @c true on success, @c false if @c map_read_node failed, in which case nothing is left allocated
+static bool map_build_tree_from(Map* map, Map_build_source* source, size_t count, size_t capacity, Node** root) {
+  *root = NULL;
+
+  if (count == 0)
+    return true;
+
+  size_t subtree_capacity = (capacity - 2) / 3;
+  size_t subtree_shares[3] = {0, 0, 0};
+  size_t node_count = map_share_tree(count, subtree_capacity, subtree_shares);
+  Node* subtrees[3] = {NULL, NULL, NULL};
+  Node* nodes[2] = {NULL, NULL};
+
+  for (size_t i = 0; i <= node_count; ++i) {
+    if (!map_build_tree_from(map, source, subtree_shares[i], subtree_capacity, &subtrees[i]))
+      goto failure;
+
+    if (i == node_count)
+      break;
+
+    nodes[i] = map_read_node(map, source);
+
+    if (nodes[i] == NULL)
+      goto failure;
+  }
+
+  *root = map_link_tree(map, nodes, node_count, subtrees);
+  return true;
+
+failure:
+  map_free_built_tree(map, nodes, subtrees);
+  return false;
+}
+
+bool map_build_from(Map* map, size_t count, bool (*read)(void* data, void* key, void* value), void* data) {
   map_clear(map);
+
+  if (map->b_tree != NULL) {
+    // Reading each key-value pair into either of two scratch nodes, the other holding the previous key:
+
+    Node* scratch[2] = {
+      map_allocate(map, map->node_allocator, map->node_layout.size),
+      map_allocate(map, map->node_allocator, map->node_layout.size),
+    };
+
+    bool success = scratch[0] != NULL && scratch[1] != NULL;
+
+    for (size_t i = 0; i < count && success; ++i) {
+      void* key = node_key(scratch[i % 2], &map->node_layout);
+      void* value = node_value(scratch[i % 2], &map->node_layout);
+      const void* last_key = node_key(scratch[(i + 1) % 2], &map->node_layout);
+
+      success = read(data, key, value) && (i == 0 || map_compare(map, last_key, key) < 0) &&
+        b_tree_insert(map->b_tree, key, value) != NULL;
+    }
+
+    for (size_t i = 0; i < 2; ++i) {
+      if (scratch[i] != NULL)
+        map_deallocate(map, map->node_allocator, scratch[i]);
+    }
+
+    if (!success)
+      map_clear(map);
+
+    return success;
+  }
+
+  // The smallest black height whose 2-3 trees can hold all key-value pairs:
+  size_t capacity = 0;
+
+  while (capacity < count) {
+    capacity = 3 * capacity + 2;
+  }
+
+  Map_build_source source = {.read = read, .data = data, .last_key = NULL};
+
+  if (!map_build_tree_from(map, &source, count, capacity, &map->root))
+    return false;
+
+  if (map->root != NULL) {
+    map->xmost_nodes[LEFT] = node_xmost_node(map->root, LEFT);
+    map->xmost_nodes[RIGHT] = node_xmost_node(map->root, RIGHT);
+  }
+
+  map->count = count;
+  return true;
+}
+
+/// @brief A tree detached from a map, along with its black height
+typedef struct Subtree {
+  /// @brief The black root of the tree, without parent, or @c NULL if the tree is empty
+  Node* root;
+
+  /// @brief The number of black nodes on any path from the root down to a leaf, excluding the leaf
+  size_t black_height;
+} Subtree;
+
+/// @brief Detaches the subtree rooted at a child of the root of a tree, blackening its root
+static Subtree subtree_detach(Subtree tree, Direction direction) {
+  Subtree subtree = {tree.root->children[direction], tree.black_height - 1};
+  tree.root->children[direction] = NULL;
+
+  if (subtree.root != NULL) {
+    node_set_parent(subtree.root, NULL);
+
+    if (node_get_color(subtree.root) == RED) {
+      node_set_color(subtree.root, BLACK);
+      subtree.black_height += 1;
+    }
+  }
+
+  return subtree;
+}
+
+/// @brief Joins two trees on either side of a node, whose key is greater than all keys of the left tree and lesser than
+/// all keys of the right tree, in `O(|h_L - h_R| + 1)` time for trees of black heights @c h_L and @c h_R
+/// @details The node is linked as a black root if both trees are of equal black height. Otherwise, it is linked as a
+/// red node along the spine of the taller tree facing the shorter one, in place of the black node of equal black height
+/// to the shorter tree, which becomes its child along with the shorter tree; the tree is then rebalanced as if the node
+/// had just been inserted.
+/// @pre @p node has no children
+static Subtree map_join_subtrees(const Map* map, Subtree left, Node* node, Subtree right) {
+  const Node_layout* layout = &map->node_layout;
+
+  if (left.black_height == right.black_height) {
+    node_init_links(node, NULL, LEFT, BLACK);
+    node_link(node, LEFT, left.root);
+    node_link(node, RIGHT, right.root);
+
+    if (layout->size_offset != 0)
+      node_update_size(node, layout);
+
+    return (Subtree){node, left.black_height + 1};
+  }
+
+  Direction side = left.black_height > right.black_height ? RIGHT : LEFT;
+  Subtree taller = side == RIGHT ? left : right;
+  Subtree shorter = side == RIGHT ? right : left;
+
+  // The black node of the spine of equal black height to the shorter tree:
+  Node* parent = NULL;
+  Node* child = taller.root;
+
+  for (size_t black_height = taller.black_height; black_height > shorter.black_height; --black_height) {
+    parent = child;
+    child = child->children[side];
+
+    if (node_is_red(child)) {
+      parent = child;
+      child = child->children[side];
+    }
+  }
+
+  node_init_links(node, parent, side, RED);
+  parent->children[side] = node;
+  node_link(node, 1 - side, child);
+  node_link(node, side, shorter.root);
+
+  if (layout->size_offset != 0) {
+    node_update_size(node, layout);
+
+    for (Node* ancestor = parent; ancestor != NULL; ancestor = node_get_parent(ancestor)) {
+      *node_size_p(ancestor, layout) += 1 + node_size(shorter.root, layout);
+    }
+  }
+
+  node_fix_insertion(node, &taller.root, layout);
+
+  if (node_get_color(taller.root) == RED) {
+    node_set_color(taller.root, BLACK);
+    taller.black_height += 1;
+  }
+
+  return taller;
+}
+
+/// @brief Detaches the node holding the greatest key of a non-empty tree
+/// @param[out] last The detached node, without children
+/// @return The rest of the tree
+static Subtree map_split_last(const Map* map, Subtree tree, Node** last) {
+  Node* root = tree.root;
+  Subtree left = subtree_detach(tree, LEFT);
+  Subtree right = subtree_detach(tree, RIGHT);
+
+  if (right.root == NULL) {
+    *last = root;
+    return left;
+  }
+
+  return map_join_subtrees(map, left, root, map_split_last(map, right, last));
+}
+
+/// @brief Joins two trees, the keys of the left tree being lesser than all keys of the right tree
+static Subtree map_concatenate_subtrees(const Map* map, Subtree left, Subtree right) {
+  if (left.root == NULL)
+    return right;
+
+  if (right.root == NULL)
+    return left;
+
+  Node* last;
+  left = map_split_last(map, left, &last);
+  return map_join_subtrees(map, left, last, right);
+}
+
+/// @brief Splits a tree around a key
+/// @param[out] greater The tree of the nodes holding keys greater than @p key, or not lesser if @p found is @c NULL
+/// @param[out] found The detached node holding @p key, without children, left untouched if not found, or @c NULL to
+/// leave it in @p greater
+/// @return The tree of the nodes holding keys lesser than @p key
+static Subtree map_split_subtree(const Map* map, Subtree tree, const void* key, Subtree* greater, Node** found) {
+  if (tree.root == NULL) {
+    *greater = tree;
+    return tree;
+  }
+
+  Node* root = tree.root;
+  Subtree left = subtree_detach(tree, LEFT);
+  Subtree right = subtree_detach(tree, RIGHT);
+  int ordering = map_compare(map, key, node_key(root, &map->node_layout));
+
+  if (ordering == 0 && found != NULL) {
+    *found = root;
+    *greater = right;
+    return left;
+  } else if (ordering <= 0) {
+    Subtree lesser = map_split_subtree(map, left, key, &left, found);
+    *greater = map_join_subtrees(map, left, root, right);
+    return lesser;
+  } else {
+    Subtree lesser = map_split_subtree(map, right, key, greater, found);
+    return map_join_subtrees(map, left, root, lesser);
+  }
+}
+
+/// @brief Builds a tree out of nodes sorted in increasing key order, relinking them as @c map_build_tree links the nodes
+/// it allocates
+/// @param[in,out] nodes The list of the nodes, linked through their right children, advanced past the consumed ones
+/// @param count The number of nodes, at least `2^h - 1` if @p capacity is `3^h - 1`
+/// @param capacity The maximum number of nodes a tree of the black height to build can hold
+/// @return The root of the built tree, without parent, or @c NULL if @p count is @c 0
+static Node* map_relink_tree(Map* map, Node** nodes, size_t count, size_t capacity) {
+  if (count == 0)
+    return NULL;
+
+  size_t subtree_capacity = (capacity - 2) / 3;
+  size_t subtree_shares[3] = {0, 0, 0};
+  size_t node_count = map_share_tree(count, subtree_capacity, subtree_shares);
+  Node* subtrees[3] = {NULL, NULL, NULL};
+  Node* root_nodes[2] = {NULL, NULL};
+
+  for (size_t i = 0; i <= node_count; ++i) {
+    subtrees[i] = map_relink_tree(map, nodes, subtree_shares[i], subtree_capacity);
+
+    if (i == node_count)
+      break;
+
+    root_nodes[i] = *nodes;
+    *nodes = root_nodes[i]->children[RIGHT];
+    node_init_links(root_nodes[i], NULL, LEFT, RED);
+  }
+
+  return map_link_tree(map, root_nodes, node_count, subtrees);
+}
+
+void map_compact(Map* map) {
+  if (map->tombstone_count == 0)
+    return;
+
+  // The nodes are sorted into a list of tombstones and a list of the other nodes in key order, linked through their
+  // right children, which in-order traversals no longer read once past a node:
+
+  Node* nodes = NULL;
+  Node** last_node_p = &nodes;
+  Node* tombstones = NULL;
+
+  for (Node* node = map->xmost_nodes[LEFT]; node != NULL;) {
+    Node* in_order_successor = node_in_order_xcessor(node, RIGHT);
+
+    if (node_is_tombstone(node, &map->node_layout)) {
+      node->children[RIGHT] = tombstones;
+      tombstones = node;
+    } else {
+      *last_node_p = node;
+      last_node_p = &node->children[RIGHT];
+    }
+
+    node = in_order_successor;
+  }
+
+  *last_node_p = NULL;
+
+  while (tombstones != NULL) {
+    Node* next_tombstone = tombstones->children[RIGHT];
+    map_free_node(map, tombstones);
+    tombstones = next_tombstone;
+  }
+
+  // The smallest black height whose 2-3 trees can hold all key-value pairs:
+  size_t capacity = 0;
+
+  while (capacity < map->count) {
+    capacity = 3 * capacity + 2;
+  }
+
+  map->root = map_relink_tree(map, &nodes, map->count, capacity);
+  map->xmost_nodes[LEFT] = map->root != NULL ? node_xmost_node(map->root, LEFT) : NULL;
+  map->xmost_nodes[RIGHT] = map->root != NULL ? node_xmost_node(map->root, RIGHT) : NULL;
+  map->tombstone_count = 0;
+}
+
+/// @brief Detaches the tree internal to a map, leaving the map empty
+static Subtree map_detach_subtree(Map* map) {
+  Subtree tree = {map->root, 0};
+
+  for (const Node* node = map->root; node != NULL; node = node->children[LEFT]) {
+    tree.black_height += node_get_color(node) == BLACK ? 1 : 0;
+  }
+
+  map->root = NULL;
+  map->xmost_nodes[LEFT] = NULL;
+  map->xmost_nodes[RIGHT] = NULL;
+  map->count = 0;
+  return tree;
+}
+
+/// @brief Attaches a tree to an empty map
+static void map_attach_subtree(Map* map, Subtree tree, size_t count) {
+  map->root = tree.root;
+  map->count = count;
+
+  if (tree.root != NULL) {
+    map->xmost_nodes[LEFT] = node_xmost_node(tree.root, LEFT);
+    map->xmost_nodes[RIGHT] = node_xmost_node(tree.root, RIGHT);
+  }
+}
+
+/// @brief A batch of insertions and removals sorted in strictly increasing key order
+typedef struct Map_batch {
+  /// @brief The keys
+  const char* keys;
+
+  /// @brief The values
+  const char* values;
+
+  /// @brief The removal flags, or @c NULL
+  const bool* removals;
+} Map_batch;
+
+/// @brief Applies the updates of a batch within a range to a tree, whose keys the keys of the range are bounded by
+/// @details The root of the tree is detached, and the updates to either side of its key are applied recursively to
+/// the subtrees rooted at its children, which are joined back together around the root unless it is removed.
+/// @param[in,out] failed Set to @c true if a node could not be allocated, in which case its key is not inserted
+static Subtree map_apply_tree(Map* map, Subtree tree, const Map_batch* batch, size_t low, size_t high, bool* failed) {
+  if (low == high)
+    return tree;
+
+  const Node_layout* layout = &map->node_layout;
+
+  if (tree.root == NULL) {
+    // Nodes are allocated in key order, for pools to lay them out contiguously:
+    size_t middle = low + (high - low) / 2;
+    Subtree left = map_apply_tree(map, tree, batch, low, middle, failed);
+    Node* node = NULL;
+
+    if (batch->removals == NULL || !batch->removals[middle]) {
+      node = map_allocate_node(map, batch->keys + middle * layout->key_size, batch->values + middle * layout->value_size);
+
+      if (node != NULL) {
+        map->count += 1;
+      } else {
+        *failed = true;
+      }
+    }
+
+    Subtree right = map_apply_tree(map, tree, batch, middle + 1, high, failed);
+    return node != NULL ? map_join_subtrees(map, left, node, right) : map_concatenate_subtrees(map, left, right);
+  }
+
+  Node* root = tree.root;
+  const void* root_key = node_key(root, layout);
+
+  // The first key of the range not lesser than the key of the root:
+  size_t lower = low;
+  size_t upper = high;
+
+  while (lower < upper) {
+    size_t middle = lower + (upper - lower) / 2;
+
+    if (map_compare(map, batch->keys + middle * layout->key_size, root_key) < 0) {
+      lower = middle + 1;
+    } else {
+      upper = middle;
+    }
+  }
+
+  bool found = lower < high && map_compare(map, batch->keys + lower * layout->key_size, root_key) == 0;
+  Subtree left = map_apply_tree(map, subtree_detach(tree, LEFT), batch, low, lower, failed);
+  Subtree right = map_apply_tree(map, subtree_detach(tree, RIGHT), batch, found ? lower + 1 : lower, high, failed);
+
+  if (found) {
+    if (batch->removals != NULL && batch->removals[lower]) {
+      map_free_node(map, root);
+      map->count -= 1;
+      return map_concatenate_subtrees(map, left, right);
+    }
+
+    memmove(node_value(root, layout), batch->values + lower * layout->value_size, layout->value_size);
+  }
+
+  return map_join_subtrees(map, left, root, right);
+}
+
+bool map_apply(Map* map, const void* keys, const void* values, const bool* removals, size_t count) {
+#ifndef NDEBUG
+  for (size_t i = 1; i < count; ++i) {
+    const char* key = (const char*)keys + i * map->node_layout.key_size;
+    assert(comparator_compare(map->comparator, key - map->node_layout.key_size, key) < 0);
+  }
+#endif
+
+  if (map->b_tree != NULL) {
+    bool success = true;
+
+    for (size_t i = 0; i < count; ++i) {
+      const char* key = (const char*)keys + i * map->node_layout.key_size;
+      const char* value = (const char*)values + i * map->node_layout.value_size;
+
+      if (removals != NULL && removals[i]) {
+        b_tree_remove(map->b_tree, key);
+      } else if (b_tree_insert(map->b_tree, key, value) == NULL) {
+        success = false;
+      }
+    }
+
+    return success;
+  }
+
+  map_compact(map);
+  Map_batch batch = {keys, values, removals};
+  bool failed = false;
+  size_t map_count = map->count;
+  Subtree tree = map_detach_subtree(map);
+
+  // The count is maintained as nodes are inserted or removed:
+  map->count = map_count;
+  tree = map_apply_tree(map, tree, &batch, 0, count, &failed);
+  map_attach_subtree(map, tree, map->count);
+  return !failed;
+}
+
+#ifndef NDEBUG
+/// @brief Determines if two maps can exchange nodes: that is, if their nodes are laid out alike and drawn from the same
+/// allocator
+/// @note Node layouts are compared up to their last offset, past which builds defining @c MAP_STATS point each to the
+/// counts of its own map
+static bool map_shares_nodes(const Map* map, const Map* other) {
+  return map->b_tree == NULL && other->b_tree == NULL &&
+    map->options.pool_chunk_size == 0 && other->options.pool_chunk_size == 0 &&
+    memcmp(&map->node_layout, &other->node_layout, offsetof(Node_layout, tombstone_offset) + sizeof(size_t)) == 0 &&
+    map->allocator.data == other->allocator.data && map->allocator.methods == other->allocator.methods;
+}
+#endif
+
+/// @brief Counts the nodes of a tree split in two, in time linear in the size of the smaller part
+/// @param count The number of nodes of both parts
+/// @return The number of nodes of the right part
+static size_t node_count_right(const Node* left, const Node* right, size_t count) {
+  const Node* nodes[2] = {
+    left != NULL ? node_xmost_leaf(left, LEFT) : NULL,
+    right != NULL ? node_xmost_leaf(right, LEFT) : NULL,
+  };
+
+  size_t counts[2] = {0, 0};
+
+  while (nodes[LEFT] != NULL && nodes[RIGHT] != NULL) {
+    for (size_t i = 0; i < 2; ++i) {
+      counts[i] += 1;
+      nodes[i] = node_post_order_xcessor(nodes[i], RIGHT);
+    }
+  }
+
+  return nodes[RIGHT] == NULL ? counts[RIGHT] : count - counts[LEFT];
+}
+
+void map_split(Map* map, const void* key, Map* greater) {
+  map_compact(map);
+  map_compact(greater);
+  assert(map_shares_nodes(map, greater));
+  assert(greater->count == 0);
+
+  size_t count = map->count;
+  Subtree right;
+  Subtree left = map_split_subtree(map, map_detach_subtree(map), key, &right, NULL);
+
+  size_t right_count = map->node_layout.size_offset != 0
+    ? node_size(right.root, &map->node_layout)
+    : node_count_right(left.root, right.root, count);
+
+  map_attach_subtree(map, left, count - right_count);
+  map_attach_subtree(greater, right, right_count);
+}
+
+bool map_join(Map* map, const void* key, const void* value, Map* greater) {
+  map_compact(map);
+  map_compact(greater);
+  assert(map_shares_nodes(map, greater));
+  assert(map->count == 0 || comparator_compare(map->comparator, node_key(map->xmost_nodes[RIGHT], &map->node_layout), key) < 0);
+  assert(greater->count == 0 || comparator_compare(map->comparator, key, node_key(greater->xmost_nodes[LEFT], &map->node_layout)) < 0);
+
+  Node* node = map_allocate_node(map, key, value);
+
+  if (node == NULL)
+    return false;
+
+  size_t count = map->count + 1 + greater->count;
+  Subtree left = map_detach_subtree(map);
+  map_attach_subtree(map, map_join_subtrees(map, left, node, map_detach_subtree(greater)), count);
+  return true;
+}
+
+void map_concatenate(Map* map, Map* greater) {
+  map_compact(map);
+  map_compact(greater);
+  assert(map_shares_nodes(map, greater));
+  assert(
+    map->count == 0 || greater->count == 0 ||
+    comparator_compare(map->comparator, node_key(map->xmost_nodes[RIGHT], &map->node_layout), node_key(greater->xmost_nodes[LEFT], &map->node_layout)) < 0
+  );
+
+  size_t count = map->count + greater->count;
+  Subtree left = map_detach_subtree(map);
+  map_attach_subtree(map, map_concatenate_subtrees(map, left, map_detach_subtree(greater)), count);
+}
+
+/// @brief Set operation combining a map with another map
+typedef enum Map_combinator {
+  /// @brief Associates the keys of the other map to their values, merging values of keys associated in both maps
+  MAP_UNION,
+
+  /// @brief Removes the keys missing from the other map
+  MAP_INTERSECTION,
+
+  /// @brief Removes the keys found in the other map
+  MAP_DIFFERENCE,
+} Map_combinator;
+
+/// @brief The combination of a map with another map, or of a part of their trees
+typedef struct Map_combination {
+  /// @brief The combined map
+  Map* map;
+
+  /// @brief The other map, which is only read
+  const Map* other;
+
+  /// @brief The set operation
+  Map_combinator combinator;
+
+  /// @brief The function merging values of keys associated in both maps, or @c NULL, for unions
+  void (*merge)(const void* key, void* value, const void* other_value, void* data);
+
+  /// @brief The data passed along to @c merge
+  void* data;
+
+  /// @brief The executor through which parts of the trees are combined concurrently, or @c NULL
+  const Map_executor* executor;
+
+  /// @brief The number of inserted nodes minus the number of removed nodes, modulo `SIZE_MAX + 1`
+  size_t count_change;
+
+  /// @brief Set to @c true if a node could not be allocated, in which case its key is not inserted
+  bool failed;
+} Map_combination;
+
+/// @brief Combines the node of a map holding the key of a node of the other map, if any, with that node
+/// @return The node to join back into the tree, or @c NULL
+static Node* map_combine_node(Map_combination* combination, Node* node, const Node* other_node) {
+  Map* map = combination->map;
+  const void* other_value = node_value(other_node, &combination->other->node_layout);
+
+  // The key of a tombstone of the other map is missing from it:
+  if (node_is_tombstone(other_node, &combination->other->node_layout)) {
+    if (node == NULL || combination->combinator != MAP_INTERSECTION)
+      return node;
+
+    map_free_node(map, node);
+    combination->count_change -= 1;
+    return NULL;
+  }
+
+  switch (combination->combinator) {
+    case MAP_UNION:
+      if (node == NULL) {
+        node = map_allocate_node(map, node_key(other_node, &combination->other->node_layout), other_value);
+
+        if (node != NULL) {
+          combination->count_change += 1;
+        } else {
+          combination->failed = true;
+        }
+      } else if (combination->merge != NULL) {
+        combination->merge(node_key(node, &map->node_layout), node_value(node, &map->node_layout), other_value, combination->data);
+      } else {
+        memmove(node_value(node, &map->node_layout), other_value, map->node_layout.value_size);
+      }
+
+      return node;
+
+    case MAP_INTERSECTION:
+      return node;
+
+    case MAP_DIFFERENCE:
+    default:
+      if (node != NULL) {
+        map_free_node(map, node);
+        combination->count_change -= 1;
+      }
+
+      return NULL;
+  }
+}
+
+static Subtree map_combine_subtree(Map_combination* combination, Subtree tree, const Node* other_node, size_t count, size_t depth);
+
+/// @brief The combination of a part of the trees of two maps, run as a task
+typedef struct Map_combination_task {
+  /// @brief The combination, with changes of its own
+  Map_combination combination;
+
+  /// @brief The tree of the map, replaced by the combined tree
+  Subtree tree;
+
+  /// @brief The tree of the other map
+  const Node* other_node;
+
+  /// @brief The estimated number of nodes of both trees
+  size_t count;
+
+  /// @brief The number of levels of recursion left to run concurrently
+  size_t depth;
+} Map_combination_task;
+
+/// @brief Runs a @c Map_combination_task
+static void map_run_combination_task(void* argument) {
+  Map_combination_task* task = argument;
+  task->tree = map_combine_subtree(&task->combination, task->tree, task->other_node, task->count, task->depth);
+}
+
+/// @brief Combines a tree with a tree of the other map
+/// @details The tree is split around the key of the root of the other tree, detaching the node holding the key if
+/// any, and either part is combined recursively with the subtree rooted at the child of the other root on its side.
+/// Both parts are then joined back together, around the node holding the key if kept.
+/// @param count The estimated number of nodes of both trees, halved at each level of recursion, below which the trees
+/// are combined sequentially
+/// @param depth The number of levels of recursion left to run concurrently through the executor, if any
+static Subtree map_combine_subtree(Map_combination* combination, Subtree tree, const Node* other_node, size_t count, size_t depth) {
+  Map* map = combination->map;
+
+  if (other_node == NULL) {
+    if (combination->combinator == MAP_INTERSECTION) {
+      combination->count_change -= map_free_tree(map, tree.root);
+      return (Subtree){NULL, 0};
+    }
+
+    return tree;
+  }
+
+  if (tree.root == NULL && combination->combinator != MAP_UNION)
+    return tree;
+
+  Node* node = NULL;
+  Subtree greater;
+  Subtree lesser = map_split_subtree(map, tree, node_key(other_node, &combination->other->node_layout), &greater, &node);
+
+  if (combination->executor != NULL && depth > 0 && count >= MAP_PARALLEL_GRAIN) {
+    node = map_combine_node(combination, node, other_node);
+    Map_combination_task tasks[2];
+    void* arguments[2];
+
+    for (size_t i = 0; i < 2; ++i) {
+      tasks[i] = (Map_combination_task){*combination, i == LEFT ? lesser : greater, other_node->children[i], count / 2, depth - 1};
+      tasks[i].combination.count_change = 0;
+      tasks[i].combination.failed = false;
+      arguments[i] = &tasks[i];
+    }
+
+    combination->executor->run(combination->executor->data, map_run_combination_task, arguments, 2);
+
+    for (size_t i = 0; i < 2; ++i) {
+      combination->count_change += tasks[i].combination.count_change;
+      combination->failed = combination->failed || tasks[i].combination.failed;
+    }
+
+    lesser = tasks[LEFT].tree;
+    greater = tasks[RIGHT].tree;
+  } else {
+    // Nodes are allocated in key order, for pools to lay them out contiguously:
+    lesser = map_combine_subtree(combination, lesser, other_node->children[LEFT], 0, 0);
+    node = map_combine_node(combination, node, other_node);
+    greater = map_combine_subtree(combination, greater, other_node->children[RIGHT], 0, 0);
+  }
+
+  return node != NULL ? map_join_subtrees(map, lesser, node, greater) : map_concatenate_subtrees(map, lesser, greater);
+}
+
+/// @brief Combines a map with another map
+/// @return @c true on success, @c false if memory could not be allocated
+static bool map_combine(
+  Map* map,
+  const Map* other,
+  Map_combinator combinator,
+  void (*merge)(const void* key, void* value, const void* other_value, void* data),
+  void* data,
+  const Map_executor* executor
+) {
+  assert(map != other && map->b_tree == NULL && other->b_tree == NULL);
+  assert(map->node_layout.key_size == other->node_layout.key_size);
+  assert(combinator != MAP_UNION || map->node_layout.value_size == other->node_layout.value_size);
+
+  map_compact(map);
+  Map_combination combination = {map, other, combinator, merge, data, executor, 0, false};
+  size_t count = map->count;
+  size_t depth = executor != NULL ? map_fork_depth(executor) : 0;
+  Subtree tree = map_combine_subtree(&combination, map_detach_subtree(map), other->root, count + other->count, depth);
+  map_attach_subtree(map, tree, count + combination.count_change);
+  return !combination.failed;
+}
+
+bool map_union(Map* map, const Map* other, void (*merge)(const void* key, void* value, const void* other_value, void* data), void* data) {
+  return map_combine(map, other, MAP_UNION, merge, data, NULL);
+}
+
+void map_intersection(Map* map, const Map* other) {
+  map_combine(map, other, MAP_INTERSECTION, NULL, NULL, NULL);
+}
+
+void map_difference(Map* map, const Map* other) {
+  map_combine(map, other, MAP_DIFFERENCE, NULL, NULL, NULL);
+}
+
+bool map_union_parallel(
+  Map* map,
+  const Map* other,
+  void (*merge)(const void* key, void* value, const void* other_value, void* data),
+  void* data,
+  const Map_executor* executor
+) {
+  assert(map->options.pool_chunk_size == 0);
+  return map_combine(map, other, MAP_UNION, merge, data, executor);
+}
+
+void map_intersection_parallel(Map* map, const Map* other, const Map_executor* executor) {
+  assert(map->options.pool_chunk_size == 0);
+  map_combine(map, other, MAP_INTERSECTION, NULL, NULL, executor);
+}
+
+void map_difference_parallel(Map* map, const Map* other, const Map_executor* executor) {
+  assert(map->options.pool_chunk_size == 0);
+  map_combine(map, other, MAP_DIFFERENCE, NULL, NULL, executor);
+}
+
+Map* map_from_sorted(Layout key_layout, Layout value_layout, Comparator comparator, const void* keys, const void* values, size_t count) {
+  Map* map = map_new(key_layout, value_layout, comparator);
+
+  if (map != NULL && !map_build(map, keys, values, count)) {
+    map_destroy(map);
+    return NULL;
+  }
+
+  return map;
+}
+
+Map* map_copy(const Map* map) {
+  return map_copy_with(map, heap_allocator);
+}
+
+/// @brief Allocates a copy of a node, with no children
+/// @return The copied node, or @c NULL if memory could not be allocated
+static Node* map_copy_node(Map* map, const Node* node, Node* parent) {
+  Node* new_node = map_allocate(map, map->node_allocator, map->node_layout.size);
+
+  if (new_node != NULL) {
+    new_node->children[LEFT] = NULL;
+    new_node->children[RIGHT] = NULL;
+    node_init_links(new_node, parent, node_get_direction(node), node_get_color(node));
+
+    memmove(
+      node_key(new_node, &map->node_layout),
+      node_key(node, &map->node_layout),
+      map->node_layout.key_size
+    );
+
+    memmove(
+      node_value(new_node, &map->node_layout),
+      node_value(node, &map->node_layout),
+      map->node_layout.value_size
+    );
+
+    if (map->node_layout.size_offset != 0)
+      *node_size_p(new_node, &map->node_layout) = *node_size_p(node, &map->node_layout);
+
+    if (map->node_layout.tombstone_offset != 0)
+      *node_tombstone_p(new_node, &map->node_layout) = *node_tombstone_p(node, &map->node_layout);
+
+    if (!map_own_key(map, new_node)) {
+      map_deallocate(map, map->node_allocator, new_node);
+      return NULL;
+    }
+  }
+
+  return new_node;
+}
+
+Map* map_copy_with(const Map* map, Allocator allocator) {
+  Map* new_map = map_new_with_node_layout(map->node_layout, map->comparator, allocator, map->options);
+
+  if (new_map != NULL && map->b_tree != NULL) {
+    new_map->b_tree = b_tree_copy(map->b_tree, allocator);
+
+    if (new_map->b_tree == NULL) {
+      allocator_free(allocator, new_map);
+      return NULL;
+    }
+  }
+
+  if (new_map == NULL || map->root == NULL)
+    return new_map;
+
+  const Node* node0 = map->root;
+  Node* node1 = new_map->root = map_copy_node(new_map, node0, NULL);
+
+  if (node1 == NULL) {
+    map_destroy(new_map);
+    return NULL;
+  }
+
+  while (true) {
+    Direction direction;
+
+    if (node0->children[LEFT] != NULL) {
+      direction = LEFT;
+    } else {
+      while (node0->children[RIGHT] == NULL || node1->children[RIGHT] != NULL) {
+        if (node_get_parent(node0) == NULL) {
+          new_map->xmost_nodes[LEFT] = node_xmost_node(new_map->root, LEFT);
+          new_map->xmost_nodes[RIGHT] = node_xmost_node(new_map->root, RIGHT);
+          new_map->count = map->count;
+          new_map->tombstone_count = map->tombstone_count;
+          return new_map;
+        }
+
+        node0 = node_get_parent(node0);
+        node1 = node_get_parent(node1);
+      }
+
+      direction = RIGHT;
+    }
+
+    Node* new_node1 = map_copy_node(new_map, node0->children[direction], node1);
+
+    if (new_node1 == NULL) {
+      map_destroy(new_map);
+      return NULL;
+    }
+
+    node1->children[direction] = new_node1;
+    node0 = node0->children[direction];
+    node1 = new_node1;
+  }
+}
+
+void map_clear(Map* map) {
+  if (map->b_tree != NULL) {
+    b_tree_clear(map->b_tree);
+  } else if (map->options.pool_chunk_size != 0 && !map->options.string_keys) {
+    allocator_reset(map->node_allocator);
+  } else {
+    map_free_tree(map, map->root);
+  }
+
+  map->root = NULL;
+  map->xmost_nodes[LEFT] = NULL;
+  map->xmost_nodes[RIGHT] = NULL;
+  map->count = 0;
+  map->tombstone_count = 0;
+}
+
+void map_destroy(Map* map) {
+  if (map->b_tree != NULL) {
+    b_tree_destroy(map->b_tree);
+  } else if (map->options.pool_chunk_size != 0) {
+    if (map->options.string_keys)
+      map_clear(map);
+
+    pool_allocator_destroy(map->node_allocator);
+  } else {
+    map_clear(map);
+  }
+
   allocator_free(map->allocator, map);
 }
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "allocator.h"
 #include "comparator.h"
@@ -11,6 +12,135 @@
 /// @brief Abstract ordered map data type, associating keys to values
 typedef struct Map Map;
 
+/// @brief Optional features of a map, fixed at creation
+/// @note Zero-initialized options select the defaults
+typedef struct Map_options {
+  /// @brief If nonzero, nodes are drawn from a pool owned by the map, obtaining memory for this many nodes at a time;
+  /// clearing or destroying the map then releases all nodes at once, without visiting them
+  size_t pool_chunk_size;
+
+  /// @brief If @c true, each node stores the size of its subtree, enabling @c map_rank, @c map_select and
+  /// @c map_count_range in logarithmic time at the cost of one @c size_t per node
+  bool order_statistics;
+
+  /// @brief If @c true, key-value pairs are stored in a B-tree whose nodes each hold a cache line of keys contiguously,
+  /// so that lookups into large maps take fewer cache misses. Values are then pointed to until the next insertion into
+  /// or removal from the map, @c map_next, @c map_previous and @c map_key are unavailable, and hints are ignored.
+  /// @pre @c pool_chunk_size is zero and @c order_statistics is @c false
+  bool b_tree;
+
+  /// @brief If @c true, keys are @c Map_string keys compared by @c map_string_comparator, and the map stores copies of
+  /// the characters of those too long to be stored inline, obtained from its allocator and freed along with their node.
+  /// Keys passed to the map then only need to remain valid for the duration of the call.
+  /// @pre The key layout is that of @c Map_string, the comparator is @c map_string_comparator, and @c b_tree is
+  /// @c false
+  bool string_keys;
+
+  /// @brief If nonzero, removals only mark the nodes of their keys as tombstones, which lookups and traversals skip and
+  /// insertions of the same keys revive, sparing them rebalancing and deallocation. Once tombstones make up more than
+  /// this fraction of the nodes, the next removal rebuilds the tree out of the other nodes in linear time, as does
+  /// @c map_compact, so that bursts of removals take predictable time. Each node then stores one more @c bool.
+  /// @note The C++ @c cpp::Map offers the same mode through its @c Tombstones template parameter.
+  /// @pre `0 <= tombstone_fraction && tombstone_fraction <= 1`, @c 1 leaving compaction to @c map_compact, and
+  /// @c order_statistics and @c b_tree are @c false
+  double tombstone_fraction;
+} Map_options;
+
+/// @brief The number of leading characters of string keys held within the keys, compared before their other characters
+#define MAP_STRING_PREFIX_LENGTH 4
+
+/// @brief The greatest length of string keys whose characters are all held within the keys
+#define MAP_STRING_INLINE_LENGTH (MAP_STRING_PREFIX_LENGTH + sizeof(const char*))
+
+/// @brief Variable-length string key, ordered bytewise as by @c memcmp, and then by length
+/// @details Keys no longer than @c MAP_STRING_INLINE_LENGTH hold their characters inline, sparing comparisons an
+/// indirection. Longer keys point to their characters, while caching their prefix, so that comparisons with keys of
+/// another prefix are decided without following the pointer. Maps whose keys are compared this way miss the cache
+/// once per level of their searches, rather than twice as if keys pointed to strings stored apart.
+/// @note Made by @c map_string, to pad characters which are held inline
+typedef struct Map_string {
+  /// @brief The number of characters
+  uint32_t length;
+
+  /// @brief The leading characters, padded with null characters
+  char prefix[MAP_STRING_PREFIX_LENGTH];
+
+  union {
+    /// @brief The characters following the prefix, padded with null characters, if the key is no longer than
+    /// @c MAP_STRING_INLINE_LENGTH
+    char suffix[sizeof(const char*)];
+
+    /// @brief All characters otherwise
+    const char* chars;
+  };
+} Map_string;
+
+/// @brief Makes a string key referring to characters, which are not copied unless held inline
+/// @pre `length <= UINT32_MAX`
+Map_string map_string(const char* chars, size_t length);
+
+/// @brief Gets the characters of a string key
+/// @param buffer Memory of @c MAP_STRING_INLINE_LENGTH characters, into which the characters held inline are copied
+/// @return The @c length characters of the key, not followed by a null character
+const char* map_string_chars(const Map_string* string, char* buffer);
+
+/// @brief The comparator of @c Map_string keys, which maps run inline
+extern const Comparator map_string_comparator;
+
+/// @brief Operation counts of a map, gathered only by builds defining @c MAP_STATS
+/// @details Counts accumulate from the creation of the map or its last @c map_reset_stats, and are not gathered for
+/// maps created with the @c b_tree option. Concurrent readers of a map race on its counts, which are then approximate.
+typedef struct Map_stats {
+  /// @brief The number of key comparisons, whether inline or through the comparator
+  size_t comparisons;
+
+  /// @brief The number of tree rotations
+  size_t rotations;
+
+  /// @brief The number of iterations of the rebalancing passes following insertions
+  size_t insertion_fixups;
+
+  /// @brief The number of iterations of the rebalancing passes following removals
+  size_t removal_fixups;
+
+  /// @brief The number of allocations of nodes and of copies of string keys
+  size_t allocations;
+
+  /// @brief The number of deallocations of nodes and of copies of string keys, excluding pools released at once
+  size_t deallocations;
+
+  /// @brief The number of searches for single keys
+  size_t searches;
+
+  /// @brief The total number of nodes visited by those searches, over which their average depth is taken
+  size_t total_depth;
+
+  /// @brief The greatest number of nodes visited by one of those searches
+  size_t max_depth;
+} Map_stats;
+
+/// @brief Fork-join executor, provided by the caller to run independent parts of an operation concurrently
+typedef struct Map_executor {
+  /// @brief Runs a task on each of some arguments, possibly concurrently, returning once all runs have completed
+  /// @details Tasks may themselves run tasks through the executor: a thread pool must not block its workers while
+  /// nested runs wait for a worker.
+  void (*run)(void* data, void (*task)(void* argument), void* const* arguments, size_t count);
+
+  /// @brief The data passed along to @c run
+  void* data;
+
+  /// @brief The number of tasks worth running concurrently, such as the number of worker threads
+  size_t concurrency;
+} Map_executor;
+
+/// @brief Returns the layout of the nodes allocated by maps with the given key and value layouts
+/// @note Useful to size the blocks of a pool allocator dedicated to such nodes
+Layout map_node_layout(Layout key_layout, Layout value_layout);
+
+/// @brief Returns the layout of the nodes allocated by maps with the given key and value layouts and options
+/// @note Useful to size the blocks of a pool allocator dedicated to such nodes
+Layout map_node_layout_with_options(Layout key_layout, Layout value_layout, Map_options options);
+
 /// @brief Allocates an empty map
 /// @returns The new map, or @c NULL if memory could not be allocated
 Map* map_new(Layout key_layout, Layout value_layout, Comparator comparator);
@@ -19,28 +149,235 @@ Map* map_new(Layout key_layout, Layout value_layout, Comparator comparator);
 /// @returns The new map, or @c NULL if memory could not be allocated
 Map* map_new_with(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator);
 
+/// @brief Allocates an empty map
+/// @returns The new map, or @c NULL if memory could not be allocated
+Map* map_new_with_options(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator, Map_options options);
+
+/// @brief Allocates a map holding key-value pairs sorted in strictly increasing key order, in linear time
+/// @param keys The array of @p count keys
+/// @param values The array of @p count values
+/// @returns The new map, or @c NULL if memory could not be allocated
+Map* map_from_sorted(Layout key_layout, Layout value_layout, Comparator comparator, const void* keys, const void* values, size_t count);
+
 /// @brief Verifies that a map is valid: that is, that no internal invariants are violated
 void map_check(const Map* map);
 
 /// @brief Returns the number of key-value pairs stored by a map
 size_t map_count(const Map* map);
 
+/// @brief Gets the operation counts of a map
+/// @param[out] stats The counts, all zero in builds not defining @c MAP_STATS
+/// @return @c true if counts are gathered by this build, @c false otherwise
+bool map_stats(const Map* map, Map_stats* stats);
+
+/// @brief Resets the operation counts of a map to zero
+void map_reset_stats(Map* map);
+
 /// @brief Finds the value associated to a given key, if any
 void* map_lookup(const Map* map, const void* key);
 
+/// @brief Finds the values associated to several keys, walking their searches in lockstep so that their cache misses
+/// overlap
+/// @param keys The array of @p count keys
+/// @param[out] values The array of @p count values found, or @c NULL for keys not found
+void map_lookup_many(const Map* map, const void* keys, size_t count, void** values);
+
+/// @brief Finds the value associated to the least key greater than or equal to a given key, that is its ceiling, if any
+void* map_lower_bound(const Map* map, const void* key);
+
+/// @brief Finds the value associated to the least key greater than a given key, if any
+void* map_upper_bound(const Map* map, const void* key);
+
+/// @brief Finds the value associated to the greatest key less than or equal to a given key, if any
+void* map_floor(const Map* map, const void* key);
+
+/// @brief Visits the key-value pairs whose keys lie in a half-open range, in key order, in `O(log n + k)` time
+/// @param low The inclusive lower bound of the range, or @c NULL if unbounded
+/// @param high The exclusive upper bound of the range, or @c NULL if unbounded
+/// @param visit The function called on each key-value pair along with @p data, returning @c false to stop the scan.
+/// It must not insert into or remove from the map.
+/// @return The number of visited key-value pairs
+size_t map_scan(const Map* map, const void* low, const void* high, bool (*visit)(const void* key, void* value, void* data), void* data);
+
+/// @brief Returns the number of keys less than a given key, in logarithmic time
+/// @pre The map was created with the @c order_statistics option
+size_t map_rank(const Map* map, const void* key);
+
+/// @brief Finds the value associated to the key of a given rank, that is the key preceded by @p index lesser keys, if any,
+/// in logarithmic time
+/// @pre The map was created with the @c order_statistics option
+void* map_select(const Map* map, size_t index);
+
+/// @brief Counts the keys lying in a half-open range, in logarithmic time
+/// @param low The inclusive lower bound of the range, or @c NULL if unbounded
+/// @param high The exclusive upper bound of the range, or @c NULL if unbounded
+/// @pre The map was created with the @c order_statistics option
+size_t map_count_range(const Map* map, const void* low, const void* high);
+
+/// @brief Finds the value associated to the least key, if any
+/// @note Values serve as cursors for in-order traversals, as returned by @c map_lookup, @c map_first, @c map_last,
+/// @c map_next, @c map_previous or @c map_insert_near, until the next removal from the map
+void* map_first(const Map* map);
+
+/// @brief Finds the value associated to the greatest key, if any
+void* map_last(const Map* map);
+
+/// @brief Finds the value associated to the key following that of a given value, if any
+/// @param value A value of the map, used as a cursor
+/// @note Traversing the whole map this way takes linear time
+/// @pre The map was not created with the @c b_tree option
+void* map_next(const Map* map, const void* value);
+
+/// @brief Finds the value associated to the key preceding that of a given value, if any
+/// @param value A value of the map, used as a cursor
+/// @note Traversing the whole map this way takes linear time
+/// @pre The map was not created with the @c b_tree option
+void* map_previous(const Map* map, const void* value);
+
+/// @brief Gets the key associated to a given value
+/// @param value A value of the map, used as a cursor
+/// @pre The map was not created with the @c b_tree option
+const void* map_key(const Map* map, const void* value);
+
 /// @brief Associates a key to a value
 /// @return @c true on success, @c false if memory could not be allocated
 bool map_insert(Map* map, const void* key, const void* value);
 
+/// @brief Associates a key to a value, looking for the key next to an existing key-value pair first
+/// @param hint The value of a key-value pair whose key is expected to be adjacent to @p key, or @c NULL for no hint.
+/// Values are pointed to as returned by @c map_lookup or @c map_insert_near, until the next removal from the map.
+/// @return The value associated to the key, or @c NULL if memory could not be allocated
+/// @note If @p key falls right before or after the key of @p hint, the tree is not searched
+void* map_insert_near(Map* map, void* hint, const void* key, const void* value);
+
+/// @brief Associates a key to a value, in amortized constant time if the key is greater than all keys of the map
+/// @return @c true on success, @c false if memory could not be allocated
+bool map_append(Map* map, const void* key, const void* value);
+
 /// @brief Removes the value associated to a key, if any
 /// @return @c true if an association to the key existed prior to removal, @c false otherwise
 bool map_remove(Map* map, const void* key);
 
-/// @brief Copies a map
+/// @brief Frees the nodes marked as tombstones by the removals from a map created with the @c tombstone_fraction option,
+/// rebuilding its tree out of the other nodes in linear time, without allocating memory
+/// @note Set operations, splits and joins compact the maps they modify first
+void map_compact(Map* map);
+
+/// @brief Replaces the key-value pairs of a map with ones sorted in strictly increasing key order, in linear time
+/// @param keys The array of @p count keys
+/// @param values The array of @p count values
+/// @return @c true on success, @c false if memory could not be allocated, in which case the map is left empty
+/// @note Nodes are allocated in key order: maps drawing nodes from a pool lay them out contiguously
+bool map_build(Map* map, const void* keys, const void* values, size_t count);
+
+/// @brief Replaces the key-value pairs of a map with ones read one at a time in strictly increasing key order, in
+/// linear time, holding no more of them at once than the nodes they are read into
+/// @param count The number of key-value pairs to read
+/// @param read The function called along with @p data to read the next key-value pair into the given key and value,
+/// returning @c false if it could not
+/// @return @c true on success, @c false if memory could not be allocated, @p read failed, or the keys read were not in
+/// strictly increasing order, in which case the map is left empty
+/// @note Nodes are allocated in key order: maps drawing nodes from a pool lay them out contiguously
+bool map_build_from(Map* map, size_t count, bool (*read)(void* data, void* key, void* value), void* data);
+
+/// @brief Applies a batch of insertions and removals sorted in strictly increasing key order, in
+/// `O(m log(n / m + 1))` time for a batch of @c m keys and a map of @c n key-value pairs
+/// @details The batch is merged into the tree at once: the tree is split around the keys of the batch, and the pieces
+/// are joined back together, rebalancing the tree once rather than once per key.
+/// @param keys The array of @p count keys
+/// @param values The array of @p count values, associated to their keys unless removed
+/// @param removals The array of @p count flags, @c true to remove the key instead of associating it to its value, or
+/// @c NULL to remove no key
+/// @return @c true on success, @c false if memory could not be allocated, in which case some keys of the batch might not
+/// have been inserted, while all other updates are applied
+bool map_apply(Map* map, const void* keys, const void* values, const bool* removals, size_t count);
+
+/// @brief Moves the key-value pairs of a map whose keys are not lesser than a given key into another map, in
+/// `O(log n)` time if the maps maintain order statistics, or `O(log n + min(k, n - k))` time otherwise for @c k moved
+/// key-value pairs out of @c n, which are then counted
+/// @pre @p greater is empty
+/// @pre Both maps were created with the same layouts, comparator, allocator and options, and neither with the
+/// @c pool_chunk_size nor the @c b_tree option, so that they may exchange nodes
+void map_split(Map* map, const void* key, Map* greater);
+
+/// @brief Moves the key-value pairs of a map, along with a key-value pair in between, into another map, in `O(log n)`
+/// time
+/// @details The trees are joined along the black height of the shorter one, so that only the nodes on the facing spine
+/// of the taller one are visited.
+/// @param greater The map whose key-value pairs are moved, left empty
+/// @return @c true on success, @c false if memory could not be allocated, in which case neither map is modified
+/// @pre The keys of @p map are lesser than @p key, itself lesser than the keys of @p greater
+/// @pre Both maps were created with the same layouts, comparator, allocator and options, and neither with the
+/// @c pool_chunk_size nor the @c b_tree option, so that they may exchange nodes
+bool map_join(Map* map, const void* key, const void* value, Map* greater);
+
+/// @brief Moves the key-value pairs of a map into another map, in `O(log n)` time
+/// @param greater The map whose key-value pairs are moved, left empty
+/// @pre The keys of @p map are lesser than the keys of @p greater
+/// @pre Both maps were created with the same layouts, comparator, allocator and options, and neither with the
+/// @c pool_chunk_size nor the @c b_tree option, so that they may exchange nodes
+void map_concatenate(Map* map, Map* greater);
+
+/// @brief Associates the keys of another map to their values in a map, in `O(m log(n / m + 1))` time for @c m
+/// key-value pairs in @p other and @c n in @p map
+/// @details The map is split around the key of the root of the other map, whose subtrees are merged recursively into
+/// either part, which are then joined back together: the other map is best the smaller one.
+/// @param merge The function called on each key associated in both maps, along with its value in @p map, its value in
+/// @p other and @p data, to merge the latter into the former, or @c NULL for values of @p other to replace those of
+/// @p map
+/// @return @c true on success, @c false if memory could not be allocated, in which case some keys of @p other might not
+/// have been inserted, while all other updates are applied
+/// @pre Both maps were created with the same layouts and comparator, and neither with the @c b_tree option
+/// @pre `map != other`
+bool map_union(Map* map, const Map* other, void (*merge)(const void* key, void* value, const void* other_value, void* data), void* data);
+
+/// @brief Removes the keys of a map missing from another map, in `O(m log(n / m + 1))` time for @c m key-value pairs
+/// in @p other and @c n in @p map, plus the time to free the removed nodes
+/// @pre Both maps were created with the same key layout and comparator, and neither with the @c b_tree option
+/// @pre `map != other`
+void map_intersection(Map* map, const Map* other);
+
+/// @brief Removes the keys of a map found in another map, in `O(m log(n / m + 1))` time for @c m key-value pairs in
+/// @p other and @c n in @p map
+/// @pre Both maps were created with the same key layout and comparator, and neither with the @c b_tree option
+/// @pre `map != other`
+void map_difference(Map* map, const Map* other);
+
+/// @brief Replaces the key-value pairs of a map with ones sorted in strictly increasing key order, building
+/// independent subtrees concurrently
+/// @see map_build
+/// @pre The map was not created with the @c pool_chunk_size option, and its allocator may be called concurrently
+bool map_build_parallel(Map* map, const void* keys, const void* values, size_t count, const Map_executor* executor);
+
+/// @brief Associates the keys of another map to their values in a map, combining independent parts of both trees
+/// concurrently
+/// @details @p merge may be called concurrently, on distinct keys.
+/// @see map_union
+/// @pre The map was not created with the @c pool_chunk_size option, and its allocator may be called concurrently
+bool map_union_parallel(
+  Map* map,
+  const Map* other,
+  void (*merge)(const void* key, void* value, const void* other_value, void* data),
+  void* data,
+  const Map_executor* executor
+);
+
+/// @brief Removes the keys of a map missing from another map, combining independent parts of both trees concurrently
+/// @see map_intersection
+/// @pre The map was not created with the @c pool_chunk_size option, and its allocator may be called concurrently
+void map_intersection_parallel(Map* map, const Map* other, const Map_executor* executor);
+
+/// @brief Removes the keys of a map found in another map, combining independent parts of both trees concurrently
+/// @see map_difference
+/// @pre The map was not created with the @c pool_chunk_size option, and its allocator may be called concurrently
+void map_difference_parallel(Map* map, const Map* other, const Map_executor* executor);
+
+/// @brief Copies a map, along with its options
 /// @return The copied map, or @c NULL if memory could not be allocated
+/// @note All nodes are copied: see @c Persistent_map for snapshots taken in constant time
 Map* map_copy(const Map* map);
 
-/// @brief Copies a map
+/// @brief Copies a map, along with its options
 /// @return The copied map, or @c NULL if memory could not be allocated
 Map* map_copy_with(const Map* map, Allocator allocator);
 
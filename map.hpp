@@ -3,17 +3,74 @@
 
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace cpp {
+  /// @brief Operation counts of a map, gathered only by builds defining @c MAP_STATS
+  /// @details Counts accumulate from the construction of the map or its last @c reset_stats. Concurrent readers of a
+  /// map race on its counts, which are then approximate.
+  struct Map_stats {
+    /// @brief The number of key comparisons
+    std::size_t comparisons;
+
+    /// @brief The number of tree rotations
+    std::size_t rotations;
+
+    /// @brief The number of iterations of the rebalancing passes following insertions
+    std::size_t insertion_fixups;
+
+    /// @brief The number of iterations of the rebalancing passes following removals
+    std::size_t removal_fixups;
+
+    /// @brief The number of node allocations
+    std::size_t allocations;
+
+    /// @brief The number of node deallocations, excluding allocators released at once
+    std::size_t deallocations;
+
+    /// @brief The number of searches for single keys
+    std::size_t searches;
+
+    /// @brief The total number of nodes visited by those searches, over which their average depth is taken
+    std::size_t total_depth;
+
+    /// @brief The greatest number of nodes visited by one of those searches
+    std::size_t max_depth;
+  };
+
   /// @brief Ordered map data type, associating keys to values
   /// @tparam Key The type of keys
   /// @tparam Value The type of values
   /// @tparam Less The type of the key comparator
-  template <typename Key, typename Value, typename Less = std::less<Key>>
+  /// @tparam Allocator The type of the allocator, rebound to allocate nodes
+  /// @tparam Order_statistics If @c true, each node stores the size of its subtree, enabling @c rank, @c select and
+  /// @c count_range in logarithmic time at the cost of one @c std::size_t per node
+  /// @tparam Compact_nodes If @c true, the direction and color of nodes are packed into the low-order bits of their parent
+  /// pointer, sparing a word per node at the cost of masking on each access
+  /// @tparam Tombstones If @c true, removals only mark the nodes of their keys as tombstones, which lookups and
+  /// iterators skip and insertions of the same keys revive, sparing them rebalancing and deallocation. Once tombstones
+  /// make up more than @c tombstone_fraction() of the nodes, the next removal rebuilds the tree out of the other nodes in
+  /// linear time, as does @c compact, so that bursts of removals take predictable time. The keys and values of tombstones
+  /// are destroyed along with their nodes on compaction. Each node then stores one more @c bool, and
+  /// @p Order_statistics must be @c false.
+  template <
+    typename Key,
+    typename Value,
+    typename Less = std::less<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>,
+    bool Order_statistics = false,
+    bool Compact_nodes = false,
+    bool Tombstones = false>
   class Map {
+    static_assert(!(Tombstones && Order_statistics), "Tombstones requires Order_statistics to be false");
+
     /// @brief Red-black color enumeration
     enum Color : unsigned char {
       BLACK = 0,
@@ -26,8 +83,55 @@ namespace cpp {
       RIGHT = 1,
     };
 
+    /// @brief The size of the subtree rooted at a node, stored if order statistics are maintained
+    struct Subtree_size {
+      /// @brief The number of nodes in the subtree rooted at the node
+      std::size_t size = 1;
+    };
+
+    /// @brief Nothing, stored in place of the size of the subtree rooted at a node if order statistics are not maintained
+    struct No_subtree_size {};
+
+    /// @brief Whether a node is a tombstone, whose key-value pair was removed, stored if removals mark tombstones
+    struct Tombstone_flag {
+      /// @brief @c true if the node is a tombstone
+      bool tombstone = false;
+    };
+
+    /// @brief Nothing, stored in place of the tombstone flag of a node if removals do not mark tombstones
+    struct No_tombstone_flag {};
+
+    struct Node;
+
+    /// @brief The parent, direction and color of a node, stored apart
+    struct Links {
+      /// @brief The parent of the node
+      Node* parent;
+
+      /// @brief The direction of the node, determining if it is the left or right child of its parent
+      Direction direction;
+
+      /// @brief The color of the node
+      Color color;
+    };
+
+    /// @brief The parent, direction and color of a node, packed into the parent pointer as the lowest bit for the
+    /// direction and the next lowest bit for the color
+    struct Compact_links {
+      /// @brief The bit holding the direction
+      static constexpr std::uintptr_t DIRECTION_BIT = 1;
+
+      /// @brief The bit holding the color
+      static constexpr std::uintptr_t COLOR_BIT = 2;
+
+      /// @brief The packed parent pointer, direction and color
+      std::uintptr_t parent_direction_color;
+    };
+
     /// @brief Red-black tree node data type
-    struct Node {
+    struct Node :
+      std::conditional_t<Order_statistics, Subtree_size, No_subtree_size>,
+      std::conditional_t<Tombstones, Tombstone_flag, No_tombstone_flag> {
       /// @brief The key stored by the node
       Key key;
 
@@ -37,25 +141,102 @@ namespace cpp {
       /// @brief The children of the node
       Node* children[2];
 
-      /// @brief The parent of the node
-      Node* parent;
+      /// @brief The parent, direction and color of the node
+      std::conditional_t<Compact_nodes, Compact_links, Links> links;
+
+      /// @brief Initializes a node with no children, constructing its key and value in place
+      template <typename K, typename... Args>
+      Node(Node* parent, Direction direction, Color color, K&& key, Args&&... args) :
+        key(std::forward<K>(key)),
+        value(std::forward<Args>(args)...),
+        children{nullptr, nullptr},
+        links() {
+        if constexpr (Compact_nodes) {
+          static_assert(alignof(Node) >= 4, "nodes are too loosely aligned to pack their direction and color");
+          this->links.parent_direction_color = reinterpret_cast<std::uintptr_t>(parent) |
+            (direction == RIGHT ? Compact_links::DIRECTION_BIT : 0) |
+            (color == RED ? Compact_links::COLOR_BIT : 0);
+        } else {
+          this->links = {parent, direction, color};
+        }
+      }
 
-      /// @brief The direction of the node, determining if it is the left or right child of its parent
-      Direction direction;
+      /// @brief Gets the parent of this node
+      Node* parent() const noexcept {
+        if constexpr (Compact_nodes) {
+          return reinterpret_cast<Node*>(this->links.parent_direction_color & ~(Compact_links::DIRECTION_BIT | Compact_links::COLOR_BIT));
+        } else {
+          return this->links.parent;
+        }
+      }
 
-      /// @brief The color of the node
-      Color color;
+      /// @brief Gets the direction of this node, determining if it is the left or right child of its parent
+      Direction direction() const noexcept {
+        if constexpr (Compact_nodes) {
+          return (this->links.parent_direction_color & Compact_links::DIRECTION_BIT) != 0 ? RIGHT : LEFT;
+        } else {
+          return this->links.direction;
+        }
+      }
+
+      /// @brief Gets the color of this node
+      Color color() const noexcept {
+        if constexpr (Compact_nodes) {
+          return (this->links.parent_direction_color & Compact_links::COLOR_BIT) != 0 ? RED : BLACK;
+        } else {
+          return this->links.color;
+        }
+      }
+
+      /// @brief Sets the parent of this node
+      void set_parent(Node* parent) noexcept {
+        if constexpr (Compact_nodes) {
+          std::uintptr_t bits = this->links.parent_direction_color & (Compact_links::DIRECTION_BIT | Compact_links::COLOR_BIT);
+          this->links.parent_direction_color = reinterpret_cast<std::uintptr_t>(parent) | bits;
+        } else {
+          this->links.parent = parent;
+        }
+      }
+
+      /// @brief Sets the direction of this node
+      void set_direction(Direction direction) noexcept {
+        if constexpr (Compact_nodes) {
+          std::uintptr_t bits = this->links.parent_direction_color & ~Compact_links::DIRECTION_BIT;
+          this->links.parent_direction_color = bits | (direction == RIGHT ? Compact_links::DIRECTION_BIT : 0);
+        } else {
+          this->links.direction = direction;
+        }
+      }
+
+      /// @brief Sets the color of this node
+      void set_color(Color color) noexcept {
+        if constexpr (Compact_nodes) {
+          std::uintptr_t bits = this->links.parent_direction_color & ~Compact_links::COLOR_BIT;
+          this->links.parent_direction_color = bits | (color == RED ? Compact_links::COLOR_BIT : 0);
+        } else {
+          this->links.color = color;
+        }
+      }
+
+      /// @brief Determines if this node is a tombstone, whose key-value pair was removed
+      bool is_tombstone() const noexcept {
+        if constexpr (Tombstones) {
+          return this->tombstone;
+        } else {
+          return false;
+        }
+      }
 
       /// @brief Determines if a node is black
       /// @note @c nullptr is considered black
       static constexpr bool is_black(const Node* node) noexcept {
-        return node == nullptr || node->color == BLACK;
+        return node == nullptr || node->color() == BLACK;
       }
 
       /// @brief Determines if a node is red
       /// @note @c nullptr is considered black
       static constexpr bool is_red(const Node* node) noexcept {
-        return node != nullptr && node->color == RED;
+        return node != nullptr && node->color() == RED;
       }
 
       /// @brief Checks that a tree respects the invariants of 2-3 red-black trees
@@ -65,12 +246,12 @@ namespace cpp {
         if (node == nullptr)
           return 1;
 
-        if (node->parent != nullptr) {
-          if (node->parent->children[node->direction] != node)
-            throw std::logic_error("node->parent->children[node->direction] != node");
+        if (node->parent() != nullptr) {
+          if (node->parent()->children[node->direction()] != node)
+            throw std::logic_error("node->parent()->children[node->direction()] != node");
 
-          if (node->color == RED && node->parent->color == RED)
-            throw std::logic_error("node->color == RED && node->parent->color == RED");
+          if (node->color() == RED && node->parent()->color() == RED)
+            throw std::logic_error("node->color() == RED && node->parent()->color() == RED");
         }
 
         if (Node::is_red(node->children[LEFT]) && Node::is_red(node->children[RIGHT]))
@@ -82,7 +263,35 @@ namespace cpp {
         if (left_black_depth != right_black_depth)
           throw std::logic_error("Node::check(node->children[LEFT]) != Node::check(node->children[RIGHT])");
 
-        return left_black_depth + (node->color == BLACK ? 1 : 0);
+        return left_black_depth + (node->color() == BLACK ? 1 : 0);
+      }
+
+      /// @brief Gets the size of a tree
+      /// @note @c nullptr is considered an empty tree
+      static std::size_t subtree_size(const Node* node) noexcept {
+        static_assert(Order_statistics);
+        return node != nullptr ? node->size : 0;
+      }
+
+      /// @brief Recomputes the size of the subtree rooted at this node from the sizes of the subtrees rooted at its children
+      void update_size() noexcept {
+        static_assert(Order_statistics);
+        this->size = Node::subtree_size(this->children[LEFT]) + 1 + Node::subtree_size(this->children[RIGHT]);
+      }
+
+      /// @brief Checks that the subtree sizes stored by the nodes of a tree are exact
+      /// @return The size of the tree
+      /// @exception std::logic_error If a subtree size is inexact
+      static std::size_t check_sizes(const Node* node) {
+        if (node == nullptr)
+          return 0;
+
+        std::size_t size = Node::check_sizes(node->children[LEFT]) + 1 + Node::check_sizes(node->children[RIGHT]);
+
+        if (node->size != size)
+          throw std::logic_error("node->size != size");
+
+        return size;
       }
 
       /// @brief Retrieves the leftmost or rightmost descendant of this node
@@ -128,10 +337,10 @@ namespace cpp {
       /// @brief Retrieves the post-order predecessor or successor of this node, if any
       /// @param direction @c LEFT for the post-order predecessor, @c RIGHT for the post-order successor
       const Node* post_order_xcessor(Direction direction) const noexcept {
-        if (this->direction != direction && this->parent != nullptr && this->parent->children[direction] != nullptr) {
-          return this->parent->children[direction]->xmost_leaf(static_cast<Direction>(1 - direction));
+        if (this->direction() != direction && this->parent() != nullptr && this->parent()->children[direction] != nullptr) {
+          return this->parent()->children[direction]->xmost_leaf(static_cast<Direction>(1 - direction));
         } else {
-          return this->parent;
+          return this->parent();
         }
       }
 
@@ -141,6 +350,37 @@ namespace cpp {
         return const_cast<Node*>(const_cast<const Node*>(this)->post_order_xcessor(direction));
       }
 
+      /// @brief Retrieves the in-order predecessor or successor of this node, if any
+      /// @param direction @c LEFT for the in-order predecessor, @c RIGHT for the in-order successor
+      const Node* in_order_xcessor(Direction direction) const noexcept {
+        if (this->children[direction] != nullptr)
+          return this->children[direction]->xmost_node(static_cast<Direction>(1 - direction));
+
+        const Node* node = this;
+
+        while (node->parent() != nullptr && node->direction() == direction) {
+          node = node->parent();
+        }
+
+        return node->parent();
+      }
+
+      /// @brief Retrieves the in-order predecessor or successor of this node, if any
+      /// @param direction @c LEFT for the in-order predecessor, @c RIGHT for the in-order successor
+      Node* in_order_xcessor(Direction direction) noexcept {
+        return const_cast<Node*>(const_cast<const Node*>(this)->in_order_xcessor(direction));
+      }
+
+      /// @brief Links a child, if any, to this node
+      void link(Direction direction, Node* child) noexcept {
+        this->children[direction] = child;
+
+        if (child != nullptr) {
+          child->set_parent(this);
+          child->set_direction(direction);
+        }
+      }
+
       /// @brief Counts the number of nodes in a tree
       static std::size_t count(const Node* node) noexcept {
         std::size_t count = 0;
@@ -172,186 +412,469 @@ namespace cpp {
 
         Node* B = this;
         Node* CA = B->children[1 - direction];
-        Node* parent = B->parent;
-        Direction B_direction = B->direction;
-        Color B_color = B->color;
+        Node* parent = B->parent();
+        Direction B_direction = B->direction();
+        Color B_color = B->color();
 
         Node* cb = CA->children[direction];
-        Color cb_color = CA->color;
+        Color cb_color = CA->color();
 
         if (cb != nullptr) {
-          cb->parent = B;
-          cb->direction = static_cast<Direction>(1 - direction);
+          cb->set_parent(B);
+          cb->set_direction(static_cast<Direction>(1 - direction));
         }
 
         B->children[1 - direction] = cb;
-        B->parent = CA;
-        B->direction = direction;
-        B->color = cb_color;
+        B->set_parent(CA);
+        B->set_direction(direction);
+        B->set_color(cb_color);
 
         CA->children[direction] = B;
-        CA->parent = parent;
-        CA->direction = B_direction;
-        CA->color = B_color;
+        CA->set_parent(parent);
+        CA->set_direction(B_direction);
+        CA->set_color(B_color);
+
+        if constexpr (Order_statistics) {
+          CA->size = B->size;
+          B->update_size();
+        }
 
         return CA;
       }
     };
 
+    /// @brief The allocator of nodes
+    using Node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+
+    /// @brief The traits of the allocator of nodes
+    using Node_allocator_traits = std::allocator_traits<Node_allocator>;
+
     /// @brief The root of the red-black tree internal to the map
     Node* _root;
 
+    /// @brief The leftmost and rightmost nodes of the tree, or @c nullptr if the tree is empty
+    Node* _xmost_nodes[2];
+
     /// @brief The number of key-value pairs stored by the map
     std::size_t _count;
 
+    /// @brief The number of nodes marked as tombstones, in addition to those holding the key-value pairs, always @c 0
+    /// unless removals mark tombstones
+    std::size_t _tombstone_count;
+
+    /// @brief The fraction of the nodes which tombstones may make up before a removal compacts the tree
+    double _tombstone_fraction;
+
     /// @brief The key comparator
     Less _less;
 
-  public:
-    /// @brief Initializes an empty map
-    Map(Less less = std::less<Key>()) noexcept : _root(nullptr), _count(0), _less(less) {}
+    /// @brief The allocator of nodes
+    Node_allocator _allocator;
 
-    /// @brief Copies a map
-    Map(const Map& map) {
-      if (map._root != nullptr) {
-        const Node* node0 = map._root;
+#ifdef MAP_STATS
+    /// @brief The operation counts of the map, updated by read-only operations too
+    mutable Map_stats _stats{};
+#endif
 
-        Node* node1 = this->_root = new Node{
-          node0->key,
-          node0->value,
-          {nullptr, nullptr},
-          nullptr,
-          node0->direction,
-          node0->color,
-        };
+    /// @brief Adds to one of the operation counts of this map, if gathered
+    void add_stat([[maybe_unused]] std::size_t Map_stats::*count, [[maybe_unused]] std::size_t n = 1) const noexcept {
+#ifdef MAP_STATS
+      this->_stats.*count += n;
+#endif
+    }
 
-        while (true) {
-          Direction direction;
+    /// @brief Compares two keys through the comparator of this map
+    template <typename K0, typename K1>
+    bool is_less(const K0& key0, const K1& key1) const {
+      this->add_stat(&Map_stats::comparisons);
+      return this->_less(key0, key1);
+    }
 
-          if (node0->children[LEFT] != nullptr) {
-            direction = LEFT;
-          } else {
-            while (node0->children[RIGHT] == nullptr || node1->children[RIGHT] != nullptr) {
-              if (node0->parent == nullptr) {
-                this->_count = map._count;
-                return;
-              }
+    /// @brief Rotates a tree, as does @c Node::rotate
+    Node* rotate(Node* node, Direction direction) const noexcept {
+      this->add_stat(&Map_stats::rotations);
+      return node->rotate(direction);
+    }
 
-              node0 = node0->parent;
-              node1 = node1->parent;
-            }
+    /// @brief Determines if an allocator can take back all memory it handed out at once, through @c release
+    template <typename A, typename = void>
+    struct Is_releasable : std::false_type {};
 
-            direction = RIGHT;
-          }
+    template <typename A>
+    struct Is_releasable<A, std::void_t<decltype(std::declval<A&>().release())>> : std::true_type {};
 
-          node1->children[direction] = new Node{
-            node0->children[direction]->key,
-            node0->children[direction]->value,
-            {nullptr, nullptr},
-            node1,
-            direction,
-            node0->children[direction]->color,
-          };
+    /// @brief Determines if a comparator can compare keys to values of other types, as signaled by @c is_transparent
+    template <typename L, typename = void>
+    struct Is_transparent : std::false_type {};
 
-          node0 = node0->children[direction];
-          node1 = node1->children[direction];
+    template <typename L>
+    struct Is_transparent<L, std::void_t<typename L::is_transparent>> : std::true_type {};
+
+    /// @brief Searches the tree internal to this map for the node holding a key
+    /// @param[out] parent The parent of the found node, or the node the key would be attached to if not found
+    /// @param[out] direction The direction of the found node, or the direction the key would be attached in if not found
+    /// @return The node holding the key, or @c nullptr if not found
+    template <typename K>
+    Node* find(const K& key, Node*& parent, Direction& direction) const noexcept {
+      Node* node = this->_root;
+      parent = nullptr;
+      direction = LEFT;
+      [[maybe_unused]] std::size_t depth = 0;
+
+      while (node != nullptr) {
+        depth += 1;
+
+        if (this->is_less(key, node->key)) {
+          parent = node;
+          node = node->children[direction = LEFT];
+        } else if (this->is_less(node->key, key)) {
+          parent = node;
+          node = node->children[direction = RIGHT];
+        } else {
+          break;
         }
-      } else {  // if (map._root == nullptr)
-        this->_root = nullptr;
-        this->_count = 0;
       }
-    }
 
-    /// @brief Moves a map
-    Map(Map&& other) noexcept : _root(other._root), _count(other._count) {
-      other._root = nullptr;
-      other._count = 0;
+#ifdef MAP_STATS
+      this->_stats.searches += 1;
+      this->_stats.total_depth += depth;
+      this->_stats.max_depth = depth > this->_stats.max_depth ? depth : this->_stats.max_depth;
+#endif
+      return node;
     }
 
-    /// @brief Clears and deallocates this map
-    ~Map() noexcept {
-      this->clear();
+    /// @brief Searches the tree internal to this map for the node holding the nearest key to a given key on a given side
+    /// @param direction @c LEFT for the greatest lesser key, @c RIGHT for the least greater key
+    /// @param inclusive If @c true, the node holding the given key itself is found if any
+    /// @return The found node, or @c nullptr if none
+    template <typename K>
+    Node* find_bound(const K& key, Direction direction, bool inclusive) const noexcept {
+      Node* parent;
+      Direction parent_direction;
+      Node* node = this->find(key, parent, parent_direction);
+
+      if (node != nullptr)
+        return Map::skip_tombstones(inclusive ? node : node->in_order_xcessor(direction), direction);
+
+      // The key would be attached to the parent, which is the nearest key on the other side of the attachment:
+
+      if (parent == nullptr || parent_direction != direction)
+        return Map::skip_tombstones(parent, direction);
+
+      return Map::skip_tombstones(parent->in_order_xcessor(direction), direction);
     }
 
-    /// @brief Verifies that this map is valid: that is, that no internal invariants are violated
-    /// @exception std::logic_error If an invariant is violated
-    void check() const {
-      if (Node::is_red(this->_root))
-        throw std::logic_error("Node::is_red(this->_root)");
+    /// @brief Retrieves the nearest node to a node in a given direction which is not a tombstone, the node itself included
+    /// @return The found node, or @c nullptr if none
+    template <typename N>
+    static N* skip_tombstones(N* node, Direction direction) noexcept {
+      if constexpr (Tombstones) {
+        while (node != nullptr && node->tombstone) {
+          node = node->in_order_xcessor(direction);
+        }
+      }
 
-      Node::check(this->_root);
+      return node;
+    }
 
-      if (Node::count(this->_root) != this->_count)
-        throw std::logic_error("Node::count(this->_root) != this->_count");
+    /// @brief Searches the tree internal to this map for the node holding a key, unless it is a tombstone
+    /// @return The node holding the key, or @c nullptr if not found
+    template <typename K>
+    Node* find_live(const K& key) const noexcept {
+      Node* parent;
+      Direction direction;
+      Node* node = this->find(key, parent, direction);
+      return node != nullptr && !node->is_tombstone() ? node : nullptr;
     }
 
-    /// @brief Returns the number of key-value pairs stored by a map
-    std::size_t count() const noexcept {
-      return this->_count;
+    /// @brief Assigns a value to a node, reviving the node if it is a tombstone
+    /// @return @c true if the node was revived, @c false if it already held a key-value pair
+    template <typename V>
+    bool assign(Node* node, V&& value) {
+      node->value = std::forward<V>(value);
+      return this->revive(node);
     }
 
-    /// @brief Finds the value associated to a given key, if any
-    const Value* lookup(const Key& key) const noexcept {
-      const Node* node = this->_root;
+    /// @brief Revives a node if it is a tombstone, once its value is assigned
+    /// @return @c true if the node was revived, @c false if it already held a key-value pair
+    bool revive([[maybe_unused]] Node* node) noexcept {
+      if constexpr (Tombstones) {
+        if (node->tombstone) {
+          node->tombstone = false;
+          this->_tombstone_count -= 1;
+          this->_count += 1;
+          return true;
+        }
+      }
 
-      while (node != nullptr) {
-        if (this->_less(key, node->key)) {
-          node = node->children[LEFT];
-        } else if (this->_less(node->key, key)) {
-          node = node->children[RIGHT];
-        } else {
-          return std::addressof(node->value);
+      return false;
+    }
+
+    /// @brief The number of searches walked in lockstep by @c lookup_many
+    static constexpr std::size_t LOOKUP_BATCH_SIZE = 16;
+
+    /// @brief Finds the values associated to several keys, walking their searches in lockstep and prefetching the next
+    /// node of each search
+    template <typename V>
+    void lookup_many_values(const Key* keys, std::size_t count, V** values) const noexcept {
+      for (std::size_t batch = 0; batch < count; batch += LOOKUP_BATCH_SIZE) {
+        std::size_t size = count - batch < LOOKUP_BATCH_SIZE ? count - batch : LOOKUP_BATCH_SIZE;
+        const Node* nodes[LOOKUP_BATCH_SIZE];
+        std::size_t active = this->_root != nullptr ? size : 0;
+
+        for (std::size_t i = 0; i < size; ++i) {
+          nodes[i] = this->_root;
+          values[batch + i] = nullptr;
+        }
+
+        while (active != 0) {
+          active = 0;
+
+          for (std::size_t i = 0; i < size; ++i) {
+            const Node* node = nodes[i];
+
+            if (node == nullptr)
+              continue;
+
+            const Key& key = keys[batch + i];
+
+            if (this->is_less(key, node->key)) {
+              node = node->children[LEFT];
+            } else if (this->is_less(node->key, key)) {
+              node = node->children[RIGHT];
+            } else {
+              values[batch + i] = !node->is_tombstone() ? const_cast<V*>(std::addressof(node->value)) : nullptr;
+              node = nullptr;
+            }
+
+            nodes[i] = node;
+
+            if (node != nullptr) {
+#ifdef __GNUC__
+              __builtin_prefetch(node);
+#endif
+              active += 1;
+            }
+          }
         }
       }
+    }
+
+    /// @brief Allocates and initializes a node
+    template <typename... Args>
+    Node* new_node(Args&&... args) {
+      Node* node = Node_allocator_traits::allocate(this->_allocator, 1);
+      this->add_stat(&Map_stats::allocations);
+
+      try {
+        Node_allocator_traits::construct(this->_allocator, node, std::forward<Args>(args)...);
+      } catch (...) {
+        Node_allocator_traits::deallocate(this->_allocator, node, 1);
+        this->add_stat(&Map_stats::deallocations);
+        throw;
+      }
 
-      return nullptr;
+      return node;
     }
 
-    /// @brief Finds the value associated to a key, if any
-    Value* lookup(const Key& key) noexcept {
-      return const_cast<Value*>(const_cast<const Map*>(this)->lookup(key));
+    /// @brief Destroys and deallocates a node
+    void delete_node(Node* node) noexcept {
+      Node_allocator_traits::destroy(this->_allocator, node);
+      Node_allocator_traits::deallocate(this->_allocator, node, 1);
+      this->add_stat(&Map_stats::deallocations);
     }
 
-    /// @brief Associates a key to a value
-    void insert(const Key& key, const Value& value) {
-      // Top-down pass:
+    /// @brief Destroys and deallocates the nodes of a tree whose root has no parent
+    void delete_tree(Node* root) noexcept {
+      if (root != nullptr) {
+        Node* node = root->xmost_leaf(LEFT);
 
-      Node* node = this->_root;
-      Node* parent = nullptr;
-      Direction node_direction = LEFT;
+        do {
+          Node* post_order_successor = node->post_order_xcessor(RIGHT);
+          this->delete_node(node);
+          node = post_order_successor;
+        } while (node != nullptr);
+      }
+    }
 
-      while (node != nullptr) {
-        if (this->_less(key, node->key)) {
-          parent = node;
-          node = node->children[node_direction = LEFT];
-        } else if (this->_less(node->key, key)) {
-          parent = node;
-          node = node->children[node_direction = RIGHT];
-        } else {
-          node->value = value;
-          return;
+    /// @brief The maximum number of key-value pairs a tree of the smallest black height holding a number of them can hold
+    static std::size_t tree_capacity(std::size_t count) noexcept {
+      std::size_t capacity = 0;
+
+      while (capacity < count) {
+        capacity = 3 * capacity + 2;
+      }
+
+      return capacity;
+    }
+
+    /// @brief Builds a tree out of nodes obtained in increasing key order
+    /// @details Each logical 2-3 node is a single black node if @p count allows its two subtrees to fit under @p capacity,
+    /// or a black node with a red left child otherwise.
+    /// @param next_node The function returning the next node, red, without parent and with a left direction
+    /// @param count The number of nodes, at least `2^h - 1` if @p capacity is `3^h - 1`
+    /// @param capacity The maximum number of nodes a tree of the black height to build can hold
+    /// @return The root of the built tree, without parent, or @c nullptr if @p count is @c 0
+    /// @note If an exception is thrown, the nodes built so far are deleted
+    template <typename Next_node>
+    Node* build_tree(Next_node& next_node, std::size_t count, std::size_t capacity) {
+      if (count == 0)
+        return nullptr;
+
+      std::size_t subtree_capacity = (capacity - 2) / 3;
+      std::size_t node_count = count <= 2 * subtree_capacity + 1 ? 1 : 2;
+      std::size_t subtree_count = count - node_count;
+      Node* subtrees[3] = {nullptr, nullptr, nullptr};
+      Node* nodes[2] = {nullptr, nullptr};
+
+      try {
+        for (std::size_t i = 0; i <= node_count; ++i) {
+          std::size_t subtree_share = (subtree_count + (node_count - i)) / (node_count + 1 - i);
+          subtree_count -= subtree_share;
+          subtrees[i] = this->build_tree(next_node, subtree_share, subtree_capacity);
+
+          if (i == node_count)
+            break;
+
+          nodes[i] = next_node();
+        }
+      } catch (...) {
+        for (Node* subtree : subtrees) {
+          this->delete_tree(subtree);
         }
+
+        for (Node* node : nodes) {
+          if (node != nullptr)
+            this->delete_node(node);
+        }
+
+        throw;
       }
 
-      node = new Node{
-        key,
-        value,
-        {nullptr, nullptr},
-        parent,
-        node_direction,
-        RED,
-      };
+      nodes[0]->link(LEFT, subtrees[0]);
+      nodes[0]->link(RIGHT, subtrees[1]);
 
-      (parent != nullptr ? parent->children[node_direction] : this->_root) = node;
-      this->_count += 1;
+      if constexpr (Order_statistics)
+        nodes[0]->update_size();
+
+      if (node_count == 1) {
+        nodes[0]->set_color(BLACK);
+        return nodes[0];
+      } else {  // if (node_count == 2)
+        nodes[1]->link(LEFT, nodes[0]);
+        nodes[1]->link(RIGHT, subtrees[2]);
+        nodes[1]->set_color(BLACK);
+
+        if constexpr (Order_statistics)
+          nodes[1]->update_size();
+
+        return nodes[1];
+      }
+    }
+
+    /// @brief Associates a key to a value, assigning the value if the key is already associated
+    template <typename K, typename V>
+    std::pair<Node*, bool> insert_or_assign_key(K&& key, V&& value) {
+      // Top-down pass:
+
+      Node* parent;
+      Direction node_direction;
+      Node* node = this->find(key, parent, node_direction);
+
+      if (node != nullptr)
+        return {node, this->assign(node, std::forward<V>(value))};
+
+      node = this->new_node(parent, node_direction, RED, std::forward<K>(key), std::forward<V>(value));
+      this->attach(node);
+      return {node, true};
+    }
+
+    /// @brief Associates a key to a value, skipping the search if the key is greater than all keys of this map
+    template <typename K, typename V>
+    std::pair<Node*, bool> append_key(K&& key, V&& value) {
+      Node* rightmost_node = this->_xmost_nodes[RIGHT];
+
+      if (rightmost_node != nullptr && !this->is_less(rightmost_node->key, key))
+        return this->insert_or_assign_key(std::forward<K>(key), std::forward<V>(value));
+
+      Node* node = this->new_node(rightmost_node, RIGHT, RED, std::forward<K>(key), std::forward<V>(value));
+      this->attach(node);
+      return {node, true};
+    }
+
+    /// @brief Associates a key to a value, looking for the key next to a hinted node first
+    /// @param hint A node whose key is expected to be adjacent to @p key, or @c nullptr to hint at the end of this map
+    template <typename K, typename V>
+    std::pair<Node*, bool> insert_or_assign_near_key(Node* hint, K&& key, V&& value) {
+      if (hint == nullptr)
+        return this->append_key(std::forward<K>(key), std::forward<V>(value));
+
+      Direction direction;
 
+      if (this->is_less(key, hint->key)) {
+        direction = LEFT;
+      } else if (this->is_less(hint->key, key)) {
+        direction = RIGHT;
+      } else {
+        return {hint, this->assign(hint, std::forward<V>(value))};
+      }
+
+      // The key belongs between the hint and its in-order neighbor (if any) on the side of the key:
+
+      Node* neighbor = hint != this->_xmost_nodes[direction] ? hint->in_order_xcessor(direction) : nullptr;
+
+      if (neighbor != nullptr && !(direction == LEFT ? this->is_less(neighbor->key, key) : this->is_less(key, neighbor->key))) {
+        if (direction == LEFT ? this->is_less(key, neighbor->key) : this->is_less(neighbor->key, key))
+          return this->insert_or_assign_key(std::forward<K>(key), std::forward<V>(value));
+
+        return {neighbor, this->assign(neighbor, std::forward<V>(value))};
+      }
+
+      Node* node = hint->children[direction] == nullptr
+        ? this->new_node(hint, direction, RED, std::forward<K>(key), std::forward<V>(value))
+        : this->new_node(neighbor, static_cast<Direction>(1 - direction), RED, std::forward<K>(key), std::forward<V>(value));
+
+      this->attach(node);
+      return {node, true};
+    }
+
+    /// @brief Associates a key to a value constructed in place, unless the key is already associated
+    template <typename K, typename... Args>
+    std::pair<Value*, bool> try_emplace_key(K&& key, Args&&... args) {
+      Node* parent;
+      Direction node_direction;
+      Node* node = this->find(key, parent, node_direction);
+
+      if (node != nullptr) {
+        if constexpr (Tombstones) {
+          if (node->tombstone) {
+            node->value = Value(std::forward<Args>(args)...);
+            return {std::addressof(node->value), this->revive(node)};
+          }
+        }
+
+        return {std::addressof(node->value), false};
+      }
+
+      node = this->new_node(parent, node_direction, RED, std::forward<K>(key), std::forward<Args>(args)...);
+      this->attach(node);
+      return {std::addressof(node->value), true};
+    }
+
+    /// @brief Rebalances a tree after a red node is linked into it, without recoloring its root
+    /// @details Subtree sizes are maintained if order statistics are, but not updated for the linked node.
+    /// @param[in,out] root The root of the tree, updated if rotated
+    /// @pre The tree respects the invariants of 2-3 red-black trees, except that @p node may have a red parent, and its
+    /// root may be red
+    void fix_insertion(Node* node, Node*& root) const noexcept {
       // Bottom-up pass:
 
-      while (node->parent != nullptr) {
-        assert(node->color == RED);
+      while (node->parent() != nullptr) {
+        assert(node->color() == RED);
+        this->add_stat(&Map_stats::insertion_fixups);
 
-        if (node->parent->color == RED) {
-          if (node->direction != node->parent->direction) {
+        if (node->parent()->color() == RED) {
+          if (node->direction() != node->parent()->direction()) {
             //              Rule from Figure 9a:
             //   A           A        ╎        C           C
             // ┌─┶━┓       ┌─┶━┓      ╎      ┏━┵─┐       ┏━┵─┐
@@ -360,9 +883,9 @@ namespace cpp {
             //  →B   δ       b   C←   ╎   →A   c       a   B←
             // ┌─┴─┐           ┌─┴─┐  ╎  ┌─┴─┐           ┌─┴─┐
             // b   c           c   d  ╎  a   b           b   c
-            node = node->parent;
-            Node* B = node->rotate(node->direction);
-            B->parent->children[B->direction] = B;
+            node = node->parent();
+            Node* B = this->rotate(node, node->direction());
+            B->parent()->children[B->direction()] = B;
           }
 
           //                  Rule from Figure 9b:
@@ -373,11 +896,11 @@ namespace cpp {
           //  →A   c       ┌─┴─┐ ┌─┴─┐  ╎  ┌─┴─┐ ┌─┴─┐       b   C←
           // ┌─┴─┐         a   b c   d  ╎  a   b c   d         ┌─┴─┐
           // a   b                      ╎                      c   d
-          Node* B = node->parent->parent->rotate(static_cast<Direction>(1 - node->direction));
-          (B->parent != nullptr ? B->parent->children[B->direction] : this->_root) = B;
+          Node* B = this->rotate(node->parent()->parent(), static_cast<Direction>(1 - node->direction()));
+          (B->parent() != nullptr ? B->parent()->children[B->direction()] : root) = B;
         }
 
-        if (Node::is_red(node->parent->children[1 - node->direction])) {
+        if (Node::is_red(node->parent()->children[1 - node->direction()])) {
           //            Rule from Figure 9c:
           //      ╷               ╻               ╷
           //      B              →B               B
@@ -385,64 +908,103 @@ namespace cpp {
           //  →A     C         A     C         A     C←
           // ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐
           // a   b c   d     a   b c   d     a   b c   d
-          node->color = BLACK;
-          node->parent->children[1 - node->direction]->color = BLACK;
-          node->parent->color = RED;
-          node = node->parent;
-        } else {  // if (Node::is_black(node->parent->children[1 - node->direction]))
+          node->set_color(BLACK);
+          node->parent()->children[1 - node->direction()]->set_color(BLACK);
+          node->parent()->set_color(RED);
+          node = node->parent();
+        } else {  // if (Node::is_black(node->parent()->children[1 - node->direction()]))
           break;
         }
       }
+    }
+
+    /// @brief Links a new red node, with no children, to its parent, then rebalances the tree
+    void attach(Node* node) noexcept {
+      Node* parent = node->parent();
+
+      if (parent != nullptr) {
+        parent->children[node->direction()] = node;
+
+        if (parent == this->_xmost_nodes[node->direction()])
+          this->_xmost_nodes[node->direction()] = node;
+      } else {
+        this->_root = node;
+        this->_xmost_nodes[LEFT] = node;
+        this->_xmost_nodes[RIGHT] = node;
+      }
+
+      if constexpr (Order_statistics) {
+        for (Node* ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent()) {
+          ancestor->size += 1;
+        }
+      }
 
-      this->_root->color = BLACK;
+      this->_count += 1;
+      this->fix_insertion(node, this->_root);
+      this->_root->set_color(BLACK);
     }
 
     /// @brief Removes the value associated to a key, if any
     /// @return @c true if an association to the key existed prior to removal, @c false otherwise
-    bool remove(const Key& key) noexcept {
+    template <typename K>
+    bool remove_key(const K& key) noexcept {
       // Top-down pass:
 
-      Node* node = this->_root;
+      Node* parent;
+      Direction node_direction;
+      Node* node = this->find(key, parent, node_direction);
 
-      while (true) {
-        if (node != nullptr) {
-          if (this->_less(key, node->key)) {
-            node = node->children[LEFT];
-          } else if (this->_less(node->key, key)) {
-            node = node->children[RIGHT];
-          } else {
-            break;
-          }
-        } else {
-          return false;
-        }
+      if (node == nullptr || node->is_tombstone())
+        return false;
+
+      if constexpr (Tombstones) {
+        node->tombstone = true;
+        this->_tombstone_count += 1;
+        this->_count -= 1;
+        std::size_t node_count = this->_count + this->_tombstone_count;
+
+        if (static_cast<double>(this->_tombstone_count) > this->_tombstone_fraction * static_cast<double>(node_count))
+          this->compact();
+
+        return true;
       }
 
       if (node->children[LEFT] != nullptr && node->children[RIGHT] != nullptr) {
         Node* in_order_predecessor = node->children[LEFT]->xmost_node(RIGHT);
-        node->key = in_order_predecessor->key;
-        node->value = in_order_predecessor->value;
+        node->key = std::move(in_order_predecessor->key);
+        node->value = std::move(in_order_predecessor->value);
         node = in_order_predecessor;
       }
 
-      Node* parent = node->parent;
-      Direction node_direction = node->direction;
-      Color node_color = node->color;
+      for (std::size_t i = 0; i < 2; ++i) {
+        if (node == this->_xmost_nodes[i])
+          this->_xmost_nodes[i] = node->children[1 - i] != nullptr ? node->children[1 - i] : node->parent();
+      }
+
+      if constexpr (Order_statistics) {
+        for (Node* ancestor = node->parent(); ancestor != nullptr; ancestor = ancestor->parent()) {
+          ancestor->size -= 1;
+        }
+      }
+
+      parent = node->parent();
+      node_direction = node->direction();
+      Color node_color = node->color();
 
       for (std::size_t i = 0; i < 2; ++i) {
         if (node->children[i] != nullptr) {
           Node* child = node->children[i];
-          child->parent = parent;
-          child->direction = node_direction;
-          child->color = node_color;
-          delete node;
+          child->set_parent(parent);
+          child->set_direction(node_direction);
+          child->set_color(node_color);
+          this->delete_node(node);
           (parent != nullptr ? parent->children[node_direction] : this->_root) = child;
           this->_count -= 1;
           return true;
         }
       }
 
-      delete node;
+      this->delete_node(node);
       (parent != nullptr ? parent->children[node_direction] : this->_root) = nullptr;
       this->_count -= 1;
 
@@ -452,9 +1014,10 @@ namespace cpp {
         return true;
 
       do {
+        this->add_stat(&Map_stats::removal_fixups);
         Node* sibling = parent->children[1 - node_direction];
 
-        if (sibling->color == RED) {
+        if (sibling->color() == RED) {
           //                              Rule from Figure 13c:
           //          D                 B           ╎           D                 B
           //      ┏━━━┵───┐         ┌───┶━━━┓       ╎       ┏━━━┵───┐         ┌───┶━━━┓
@@ -463,8 +1026,8 @@ namespace cpp {
           //   A     C  e   f     a   b  C     E←   ╎   →A     C  e   f     a   b  C     E
           // ┌─┴─┐ ┌─┴─┐               ┌─┴─┐ ┌─┴─┐  ╎  ┌─┴─┐ ┌─┴─┐               ┌─┴─┐ ┌─┴─┐
           // a   b c   d               c   d e   f  ╎  a   b c   d               c   d e   f
-          Node* DB = parent->rotate(node_direction);
-          (DB->parent != nullptr ? DB->parent->children[DB->direction] : this->_root) = DB;
+          Node* DB = this->rotate(parent, node_direction);
+          (DB->parent() != nullptr ? DB->parent()->children[DB->direction()] : this->_root) = DB;
           sibling = parent->children[1 - node_direction];
         }
 
@@ -474,10 +1037,10 @@ namespace cpp {
         //  →A     C    ▷    A     C    ╎    A     C    ◁    A     C←
         // ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐  ╎  ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐
         // a   b c   d     a   b c   d  ╎  a   b c   d     a   b c   d
-        sibling->color = RED;
+        sibling->set_color(RED);
 
         if (Node::is_red(sibling->children[LEFT]) || Node::is_red(sibling->children[RIGHT])) {
-          if (Node::is_black(sibling->children[sibling->direction])) {
+          if (Node::is_black(sibling->children[sibling->direction()])) {
             //                     Rule from Figure 15a:
             //                    A          ╎          D
             //    A             ┌─┶━┓        ╎        ┏━┵─┐             D
@@ -488,8 +1051,8 @@ namespace cpp {
             // ┌─┴─┐ ┌─┴─┐          c   D    ╎    A   c          ┌─┴─┐ ┌─┴─┐
             // b   c d   e            ┌─┴─┐  ╎  ┌─┴─┐            a   b c   d
             //                        d   e  ╎  a   b
-            sibling = sibling->rotate(sibling->direction);
-            parent->children[sibling->direction] = sibling;
+            sibling = this->rotate(sibling, sibling->direction());
+            parent->children[sibling->direction()] = sibling;
           }
 
           //                    Rule from Figure 15b:
@@ -500,8 +1063,8 @@ namespace cpp {
           //   A   c        ┌─┴─┐ ┌─┴─┐   ╎   ┌─┴─┐ ┌─┴─┐        b   C
           // ┌─┴─┐          a   b c   d←  ╎  →a   b c   d          ┌─┴─┐
           // a   b                        ╎                        c   d
-          Node* B = parent->rotate(node_direction);
-          (B->parent != nullptr ? B->parent->children[B->direction] : this->_root) = B;
+          Node* B = this->rotate(parent, node_direction);
+          (B->parent() != nullptr ? B->parent()->children[B->direction()] : this->_root) = B;
 
           //    Rule from Figure 15c:
           //      B               B
@@ -509,41 +1072,1041 @@ namespace cpp {
           //   A     C    ▷    A     C
           // ┌─┴─┐ ┌─┴─┐     ┌─┴─┐ ┌─┴─┐
           // a   b c   d     a   b c   d
-          B->children[LEFT]->color = BLACK;
-          B->children[RIGHT]->color = BLACK;
+          B->children[LEFT]->set_color(BLACK);
+          B->children[RIGHT]->set_color(BLACK);
           return true;
         }
 
         node = parent;
-        parent = node->parent;
-        node_direction = node->direction;
-      } while (parent != nullptr && node->color == BLACK);
+        parent = node->parent();
+        node_direction = node->direction();
+      } while (parent != nullptr && node->color() == BLACK);
 
       // Rule from Figure 13a:
       //      ╻         ╷
       //      A    ▷    A
       //    ┌─┴─┐     ┌─┴─┐
       //    a   b     a   b
-      node->color = BLACK;
+      node->set_color(BLACK);
       return true;
     }
 
-    /// @brief Clears this map, removing all key-value associations
-    void clear() noexcept {
+    /// @brief A tree detached from a map, along with its black height
+    struct Subtree {
+      /// @brief The black root of the tree, without parent, or @c nullptr if the tree is empty
+      Node* root;
+
+      /// @brief The number of black nodes on any path from the root down to a leaf, excluding the leaf
+      std::size_t black_height;
+
+      /// @brief Detaches the subtree rooted at a child of the root of this tree, blackening its root
+      Subtree detach(Direction direction) const noexcept {
+        Subtree subtree = {this->root->children[direction], this->black_height - 1};
+        this->root->children[direction] = nullptr;
+
+        if (subtree.root != nullptr) {
+          subtree.root->set_parent(nullptr);
+
+          if (subtree.root->color() == RED) {
+            subtree.root->set_color(BLACK);
+            subtree.black_height += 1;
+          }
+        }
+
+        return subtree;
+      }
+    };
+
+    /// @brief Joins two trees on either side of a node, whose key is greater than all keys of the left tree and lesser
+    /// than all keys of the right tree, in `O(|h_L - h_R| + 1)` time for trees of black heights @c h_L and @c h_R
+    /// @details The node is linked as a black root if both trees are of equal black height. Otherwise, it is linked as a
+    /// red node along the spine of the taller tree facing the shorter one, in place of the black node of equal black
+    /// height to the shorter tree, which becomes its child along with the shorter tree; the tree is then rebalanced as if
+    /// the node had just been inserted.
+    /// @pre @p node has no children
+    Subtree join_subtrees(Subtree left, Node* node, Subtree right) const noexcept {
+      if (left.black_height == right.black_height) {
+        node->set_parent(nullptr);
+        node->set_color(BLACK);
+        node->link(LEFT, left.root);
+        node->link(RIGHT, right.root);
+
+        if constexpr (Order_statistics)
+          node->update_size();
+
+        return {node, left.black_height + 1};
+      }
+
+      Direction side = left.black_height > right.black_height ? RIGHT : LEFT;
+      Subtree taller = side == RIGHT ? left : right;
+      Subtree shorter = side == RIGHT ? right : left;
+
+      // The black node of the spine of equal black height to the shorter tree:
+      Node* parent = nullptr;
+      Node* child = taller.root;
+
+      for (std::size_t black_height = taller.black_height; black_height > shorter.black_height; --black_height) {
+        parent = child;
+        child = child->children[side];
+
+        if (Node::is_red(child)) {
+          parent = child;
+          child = child->children[side];
+        }
+      }
+
+      node->set_color(RED);
+      parent->link(side, node);
+      node->link(static_cast<Direction>(1 - side), child);
+      node->link(side, shorter.root);
+
+      if constexpr (Order_statistics) {
+        node->update_size();
+
+        for (Node* ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent()) {
+          ancestor->size += 1 + Node::subtree_size(shorter.root);
+        }
+      }
+
+      this->fix_insertion(node, taller.root);
+
+      if (taller.root->color() == RED) {
+        taller.root->set_color(BLACK);
+        taller.black_height += 1;
+      }
+
+      return taller;
+    }
+
+    /// @brief Detaches the node holding the greatest key of a non-empty tree
+    /// @param[out] last The detached node, without children
+    /// @return The rest of the tree
+    Subtree split_last(Subtree tree, Node*& last) const noexcept {
+      Node* root = tree.root;
+      Subtree left = tree.detach(LEFT);
+      Subtree right = tree.detach(RIGHT);
+
+      if (right.root == nullptr) {
+        last = root;
+        return left;
+      }
+
+      return this->join_subtrees(left, root, this->split_last(right, last));
+    }
+
+    /// @brief Joins two trees, the keys of the left tree being lesser than all keys of the right tree
+    Subtree concatenate_subtrees(Subtree left, Subtree right) const noexcept {
+      if (left.root == nullptr)
+        return right;
+
+      if (right.root == nullptr)
+        return left;
+
+      Node* last;
+      left = this->split_last(left, last);
+      return this->join_subtrees(left, last, right);
+    }
+
+    /// @brief Splits a tree around a key
+    /// @param[out] greater The tree of the nodes holding keys not lesser than @p key
+    /// @return The tree of the nodes holding keys lesser than @p key
+    Subtree split_subtree(Subtree tree, const Key& key, Subtree& greater) const noexcept {
+      if (tree.root == nullptr) {
+        greater = tree;
+        return tree;
+      }
+
+      Node* root = tree.root;
+      Subtree left = tree.detach(LEFT);
+      Subtree right = tree.detach(RIGHT);
+
+      if (!this->is_less(root->key, key)) {
+        Subtree lesser = this->split_subtree(left, key, left);
+        greater = this->join_subtrees(left, root, right);
+        return lesser;
+      } else {
+        Subtree lesser = this->split_subtree(right, key, greater);
+        return this->join_subtrees(left, root, lesser);
+      }
+    }
+
+    /// @brief Detaches the tree internal to this map, leaving this map empty
+    /// @pre This map holds no tombstones
+    Subtree detach_subtree() noexcept {
+      assert(this->_tombstone_count == 0);
+      Subtree tree = {this->_root, 0};
+
+      for (const Node* node = this->_root; node != nullptr; node = node->children[LEFT]) {
+        tree.black_height += node->color() == BLACK ? 1 : 0;
+      }
+
+      this->_root = nullptr;
+      this->_xmost_nodes[LEFT] = nullptr;
+      this->_xmost_nodes[RIGHT] = nullptr;
+      this->_count = 0;
+      return tree;
+    }
+
+    /// @brief Attaches a tree to this map, which is empty
+    void attach_subtree(Subtree tree, std::size_t count) noexcept {
+      this->_root = tree.root;
+      this->_count = count;
+
+      if (tree.root != nullptr) {
+        this->_xmost_nodes[LEFT] = tree.root->xmost_node(LEFT);
+        this->_xmost_nodes[RIGHT] = tree.root->xmost_node(RIGHT);
+      }
+    }
+
+    /// @brief Counts the nodes of a tree split in two, in time linear in the size of the smaller part
+    /// @param count The number of nodes of both parts
+    /// @return The number of nodes of the right part
+    static std::size_t count_right(const Node* left, const Node* right, std::size_t count) noexcept {
+      const Node* nodes[2] = {
+        left != nullptr ? left->xmost_leaf(LEFT) : nullptr,
+        right != nullptr ? right->xmost_leaf(LEFT) : nullptr,
+      };
+
+      std::size_t counts[2] = {0, 0};
+
+      while (nodes[LEFT] != nullptr && nodes[RIGHT] != nullptr) {
+        for (std::size_t i = 0; i < 2; ++i) {
+          counts[i] += 1;
+          nodes[i] = nodes[i]->post_order_xcessor(RIGHT);
+        }
+      }
+
+      return nodes[RIGHT] == nullptr ? counts[RIGHT] : count - counts[LEFT];
+    }
+
+    /// @brief Moves the key-value pairs of another map, along with a new node in between, into this map
+    void join_node(Node* node, Map& greater) noexcept {
+      std::size_t count = this->_count + 1 + greater._count;
+      Subtree left = this->detach_subtree();
+      this->attach_subtree(this->join_subtrees(left, node, greater.detach_subtree()), count);
+    }
+
+  public:
+    /// @brief Bidirectional iterator over the key-value pairs of a map, in key order
+    /// @details Dereferencing yields a pair of references to the key and the value.
+    /// Iterators remain valid until the next removal from the map.
+    /// @tparam Is_const @c true if values are read-only through the iterator
+    template <bool Is_const>
+    class Iterator {
+      friend class Map;
+
+      /// @brief The node of the iterated key-value pair, or @c nullptr past the end
+      std::conditional_t<Is_const, const Node*, Node*> _node;
+
+      /// @brief The iterated map
+      const Map* _map;
+
+      Iterator(std::conditional_t<Is_const, const Node*, Node*> node, const Map* map) noexcept : _node(node), _map(map) {}
+
+    public:
+      using iterator_category = std::bidirectional_iterator_tag;
+
+      using difference_type = std::ptrdiff_t;
+
+      using value_type = std::pair<const Key, Value>;
+
+      using reference = std::pair<const Key&, std::conditional_t<Is_const, const Value&, Value&>>;
+
+      /// @brief Pointer-like holder of a dereferenced iterator
+      struct pointer {
+        reference pair;
+
+        const reference* operator->() const noexcept {
+          return std::addressof(this->pair);
+        }
+      };
+
+      /// @brief Initializes a singular iterator
+      Iterator() noexcept : _node(nullptr), _map(nullptr) {}
+
+      /// @brief Converts an iterator to a read-only iterator
+      template <bool Was_const, std::enable_if_t<Is_const && !Was_const, int> = 0>
+      Iterator(const Iterator<Was_const>& other) noexcept : _node(other._node), _map(other._map) {}
+
+      /// @brief Returns the key of the iterated key-value pair
+      const Key& key() const noexcept {
+        return this->_node->key;
+      }
+
+      /// @brief Returns the value of the iterated key-value pair
+      std::conditional_t<Is_const, const Value&, Value&> value() const noexcept {
+        return this->_node->value;
+      }
+
+      reference operator*() const noexcept {
+        return {this->_node->key, this->_node->value};
+      }
+
+      pointer operator->() const noexcept {
+        return {**this};
+      }
+
+      /// @brief Steps to the in-order successor
+      Iterator& operator++() noexcept {
+        this->_node = this->_node != this->_map->_xmost_nodes[RIGHT]
+          ? Map::skip_tombstones(this->_node->in_order_xcessor(RIGHT), RIGHT)
+          : nullptr;
+        return *this;
+      }
+
+      Iterator operator++(int) noexcept {
+        Iterator iterator = *this;
+        ++*this;
+        return iterator;
+      }
+
+      /// @brief Steps to the in-order predecessor, or to the greatest key from past the end
+      Iterator& operator--() noexcept {
+        this->_node = Map::skip_tombstones(
+          this->_node != nullptr ? this->_node->in_order_xcessor(LEFT) : this->_map->_xmost_nodes[RIGHT],
+          LEFT
+        );
+        return *this;
+      }
+
+      Iterator operator--(int) noexcept {
+        Iterator iterator = *this;
+        --*this;
+        return iterator;
+      }
+
+      friend bool operator==(const Iterator& iterator0, const Iterator& iterator1) noexcept {
+        return iterator0._node == iterator1._node;
+      }
+
+      friend bool operator!=(const Iterator& iterator0, const Iterator& iterator1) noexcept {
+        return iterator0._node != iterator1._node;
+      }
+    };
+
+    using iterator = Iterator<false>;
+
+    using const_iterator = Iterator<true>;
+
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    /// @brief Initializes an empty map
+    Map(const Less& less = Less(), const Allocator& allocator = Allocator()) :
+      _root(nullptr),
+      _xmost_nodes{nullptr, nullptr},
+      _count(0),
+      _tombstone_count(0),
+      _tombstone_fraction(0.25),
+      _less(less),
+      _allocator(allocator) {}
+
+    /// @brief Initializes an empty map
+    explicit Map(const Allocator& allocator) : Map(Less(), allocator) {}
+
+    /// @brief Initializes a map holding key-value pairs sorted in strictly increasing key order, in linear time
+    /// @param first The beginning of the range of key-value pairs, which have @c first and @c second members
+    /// @param last The end of the range of key-value pairs
+    /// @note Keys and values are moved from if the iterators yield rvalues, as @c std::move_iterator does
+    template <
+      typename Iterator,
+      std::enable_if_t<std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>, int> = 0>
+    Map(Iterator first, Iterator last, const Less& less = Less(), const Allocator& allocator = Allocator()) : Map(less, allocator) {
+      std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+
+#ifndef NDEBUG
+      if (first != last) {
+        for (Iterator previous = first, next = std::next(first); next != last; previous = next++) {
+          assert(this->_less((*previous).first, (*next).first));
+        }
+      }
+#endif
+
+      auto next_node = [&] {
+        auto&& pair = *first;
+        Node* node = this->new_node(nullptr, LEFT, RED, std::forward<decltype(pair)>(pair).first, std::forward<decltype(pair)>(pair).second);
+        ++first;
+        return node;
+      };
+
+      this->_root = this->build_tree(next_node, count, Map::tree_capacity(count));
+
       if (this->_root != nullptr) {
-        Node* node = this->_root->xmost_leaf(LEFT);
+        this->_xmost_nodes[LEFT] = this->_root->xmost_node(LEFT);
+        this->_xmost_nodes[RIGHT] = this->_root->xmost_node(RIGHT);
+      }
 
-        do {
-          Node* post_order_successor = node->post_order_xcessor(RIGHT);
-          delete node;
-          node = post_order_successor;
-        } while (node != nullptr);
+      this->_count = count;
+    }
+
+    /// @brief Copies a map
+    Map(const Map& map) :
+      _root(nullptr),
+      _xmost_nodes{nullptr, nullptr},
+      _count(0),
+      _tombstone_count(0),
+      _tombstone_fraction(map._tombstone_fraction),
+      _less(map._less),
+      _allocator(Node_allocator_traits::select_on_container_copy_construction(map._allocator)) {
+      if (map._root != nullptr) {
+        try {
+          const Node* node0 = map._root;
+          Node* node1 = this->_root = this->new_node(nullptr, node0->direction(), node0->color(), node0->key, node0->value);
+
+          if constexpr (Order_statistics)
+            node1->size = node0->size;
+
+          if constexpr (Tombstones)
+            node1->tombstone = node0->tombstone;
+
+          while (true) {
+            Direction direction;
+
+            if (node0->children[LEFT] != nullptr) {
+              direction = LEFT;
+            } else {
+              while (node0->children[RIGHT] == nullptr || node1->children[RIGHT] != nullptr) {
+                if (node0->parent() == nullptr) {
+                  this->_xmost_nodes[LEFT] = this->_root->xmost_node(LEFT);
+                  this->_xmost_nodes[RIGHT] = this->_root->xmost_node(RIGHT);
+                  this->_count = map._count;
+                  this->_tombstone_count = map._tombstone_count;
+                  return;
+                }
+
+                node0 = node0->parent();
+                node1 = node1->parent();
+              }
+
+              direction = RIGHT;
+            }
+
+            const Node* child0 = node0->children[direction];
+            node1->children[direction] = this->new_node(node1, direction, child0->color(), child0->key, child0->value);
+            node0 = node0->children[direction];
+            node1 = node1->children[direction];
+
+            if constexpr (Order_statistics)
+              node1->size = node0->size;
+
+            if constexpr (Tombstones)
+              node1->tombstone = node0->tombstone;
+          }
+        } catch (...) {
+          this->clear();
+          throw;
+        }
+      }
+    }
+
+    /// @brief Moves a map
+    Map(Map&& other) noexcept :
+      _root(other._root),
+      _xmost_nodes{other._xmost_nodes[LEFT], other._xmost_nodes[RIGHT]},
+      _count(other._count),
+      _tombstone_count(other._tombstone_count),
+      _tombstone_fraction(other._tombstone_fraction),
+      _less(std::move(other._less)),
+      _allocator(std::move(other._allocator)) {
+      other._root = nullptr;
+      other._xmost_nodes[LEFT] = nullptr;
+      other._xmost_nodes[RIGHT] = nullptr;
+      other._count = 0;
+      other._tombstone_count = 0;
+    }
+
+    /// @brief Clears and deallocates this map
+    ~Map() noexcept {
+      this->clear();
+    }
+
+    /// @brief Verifies that this map is valid: that is, that no internal invariants are violated
+    /// @exception std::logic_error If an invariant is violated
+    void check() const {
+      if (Node::is_red(this->_root))
+        throw std::logic_error("Node::is_red(this->_root)");
+
+      Node::check(this->_root);
+
+      if (Node::count(this->_root) != this->_count + this->_tombstone_count)
+        throw std::logic_error("Node::count(this->_root) != this->_count + this->_tombstone_count");
+
+      if constexpr (Tombstones) {
+        std::size_t tombstone_count = 0;
+
+        for (const Node* node = this->_root != nullptr ? this->_root->xmost_leaf(LEFT) : nullptr; node != nullptr; node = node->post_order_xcessor(RIGHT)) {
+          tombstone_count += node->tombstone ? 1 : 0;
+        }
+
+        if (tombstone_count != this->_tombstone_count)
+          throw std::logic_error("tombstone_count != this->_tombstone_count");
+      }
+
+      for (Direction direction : {LEFT, RIGHT}) {
+        if (this->_xmost_nodes[direction] != (this->_root != nullptr ? this->_root->xmost_node(direction) : nullptr))
+          throw std::logic_error("this->_xmost_nodes[direction] != this->_root->xmost_node(direction)");
+      }
+
+      if constexpr (Order_statistics)
+        Node::check_sizes(this->_root);
+    }
+
+    /// @brief Returns the number of key-value pairs stored by a map
+    std::size_t count() const noexcept {
+      return this->_count;
+    }
+
+    /// @brief Returns the operation counts of this map, all zero in builds not defining @c MAP_STATS
+    Map_stats stats() const noexcept {
+#ifdef MAP_STATS
+      return this->_stats;
+#else
+      return {};
+#endif
+    }
+
+    /// @brief Resets the operation counts of this map to zero
+    void reset_stats() noexcept {
+#ifdef MAP_STATS
+      this->_stats = {};
+#endif
+    }
+
+    /// @brief Returns an iterator to the key-value pair with the least key
+    iterator begin() noexcept {
+      return iterator(Map::skip_tombstones(this->_xmost_nodes[LEFT], RIGHT), this);
+    }
+
+    /// @brief Returns an iterator to the key-value pair with the least key
+    const_iterator begin() const noexcept {
+      return const_iterator(Map::skip_tombstones(this->_xmost_nodes[LEFT], RIGHT), this);
+    }
+
+    /// @brief Returns an iterator to the key-value pair with the least key
+    const_iterator cbegin() const noexcept {
+      return this->begin();
+    }
+
+    /// @brief Returns an iterator past the key-value pair with the greatest key
+    iterator end() noexcept {
+      return iterator(nullptr, this);
+    }
+
+    /// @brief Returns an iterator past the key-value pair with the greatest key
+    const_iterator end() const noexcept {
+      return const_iterator(nullptr, this);
+    }
+
+    /// @brief Returns an iterator past the key-value pair with the greatest key
+    const_iterator cend() const noexcept {
+      return this->end();
+    }
+
+    /// @brief Returns a reverse iterator to the key-value pair with the greatest key
+    reverse_iterator rbegin() noexcept {
+      return reverse_iterator(this->end());
+    }
+
+    /// @brief Returns a reverse iterator to the key-value pair with the greatest key
+    const_reverse_iterator rbegin() const noexcept {
+      return const_reverse_iterator(this->end());
+    }
+
+    /// @brief Returns a reverse iterator to the key-value pair with the greatest key
+    const_reverse_iterator crbegin() const noexcept {
+      return this->rbegin();
+    }
+
+    /// @brief Returns a reverse iterator past the key-value pair with the least key
+    reverse_iterator rend() noexcept {
+      return reverse_iterator(this->begin());
+    }
+
+    /// @brief Returns a reverse iterator past the key-value pair with the least key
+    const_reverse_iterator rend() const noexcept {
+      return const_reverse_iterator(this->begin());
+    }
+
+    /// @brief Returns a reverse iterator past the key-value pair with the least key
+    const_reverse_iterator crend() const noexcept {
+      return this->rend();
+    }
+
+    /// @brief Finds the key-value pair holding a given key, if any
+    /// @return An iterator to the key-value pair, or @c end() if not found
+    iterator find(const Key& key) noexcept {
+      return iterator(this->find_live(key), this);
+    }
+
+    /// @brief Finds the key-value pair holding a given key, if any
+    /// @return An iterator to the key-value pair, or @c end() if not found
+    const_iterator find(const Key& key) const noexcept {
+      return const_iterator(this->find_live(key), this);
+    }
+
+    /// @brief Finds the key-value pair holding the least key greater than or equal to a given key, that is its ceiling
+    /// @return An iterator to the key-value pair, or @c end() if none
+    iterator lower_bound(const Key& key) noexcept {
+      return iterator(this->find_bound(key, RIGHT, true), this);
+    }
+
+    /// @brief Finds the key-value pair holding the least key greater than or equal to a given key, that is its ceiling
+    /// @return An iterator to the key-value pair, or @c end() if none
+    const_iterator lower_bound(const Key& key) const noexcept {
+      return const_iterator(this->find_bound(key, RIGHT, true), this);
+    }
+
+    /// @brief Finds the key-value pair holding the least key greater than a given key
+    /// @return An iterator to the key-value pair, or @c end() if none
+    iterator upper_bound(const Key& key) noexcept {
+      return iterator(this->find_bound(key, RIGHT, false), this);
+    }
+
+    /// @brief Finds the key-value pair holding the least key greater than a given key
+    /// @return An iterator to the key-value pair, or @c end() if none
+    const_iterator upper_bound(const Key& key) const noexcept {
+      return const_iterator(this->find_bound(key, RIGHT, false), this);
+    }
+
+    /// @brief Finds the key-value pair holding the greatest key less than or equal to a given key
+    /// @return An iterator to the key-value pair, or @c end() if none
+    iterator floor(const Key& key) noexcept {
+      return iterator(this->find_bound(key, LEFT, true), this);
+    }
+
+    /// @brief Finds the key-value pair holding the greatest key less than or equal to a given key
+    /// @return An iterator to the key-value pair, or @c end() if none
+    const_iterator floor(const Key& key) const noexcept {
+      return const_iterator(this->find_bound(key, LEFT, true), this);
+    }
+
+    /// @brief Finds the key-value pairs whose keys lie in a half-open range, in `O(log n)` time
+    /// @param low The inclusive lower bound of the range
+    /// @param high The exclusive upper bound of the range
+    /// @return The iterators to the first key-value pair in the range and past the last one
+    std::pair<iterator, iterator> range(const Key& low, const Key& high) noexcept {
+      if (!this->is_less(low, high))
+        return {this->end(), this->end()};
+
+      return {this->lower_bound(low), this->lower_bound(high)};
+    }
+
+    /// @brief Finds the key-value pairs whose keys lie in a half-open range, in `O(log n)` time
+    /// @param low The inclusive lower bound of the range
+    /// @param high The exclusive upper bound of the range
+    /// @return The iterators to the first key-value pair in the range and past the last one
+    std::pair<const_iterator, const_iterator> range(const Key& low, const Key& high) const noexcept {
+      if (!this->is_less(low, high))
+        return {this->end(), this->end()};
+
+      return {this->lower_bound(low), this->lower_bound(high)};
+    }
+
+    /// @brief Returns the number of keys less than a given key, in logarithmic time
+    /// @note Only available if order statistics are maintained
+    std::size_t rank(const Key& key) const noexcept {
+      static_assert(Order_statistics, "rank requires Order_statistics");
+      Node* parent;
+      Direction direction;
+      const Node* node = this->find(key, parent, direction);
+
+      if (node == nullptr) {
+        if (parent == nullptr)
+          return 0;
+
+        node = parent;
+      }
+
+      std::size_t rank = Node::subtree_size(node->children[LEFT]) + (node == parent && direction == RIGHT ? 1 : 0);
+
+      for (; node->parent() != nullptr; node = node->parent()) {
+        if (node->direction() == RIGHT)
+          rank += Node::subtree_size(node->parent()->children[LEFT]) + 1;
+      }
+
+      return rank;
+    }
+
+    /// @brief Finds the key-value pair holding the key preceded by @p index lesser keys, in logarithmic time
+    /// @return An iterator to the key-value pair, or @c end() if @p index is not less than the number of keys
+    /// @note Only available if order statistics are maintained
+    const_iterator select(std::size_t index) const noexcept {
+      static_assert(Order_statistics, "select requires Order_statistics");
+
+      if (index >= this->_count)
+        return this->end();
+
+      const Node* node = this->_root;
+
+      while (true) {
+        std::size_t left_size = Node::subtree_size(node->children[LEFT]);
+
+        if (index < left_size) {
+          node = node->children[LEFT];
+        } else if (index > left_size) {
+          index -= left_size + 1;
+          node = node->children[RIGHT];
+        } else {
+          return const_iterator(node, this);
+        }
+      }
+    }
+
+    /// @brief Finds the key-value pair holding the key preceded by @p index lesser keys, in logarithmic time
+    /// @return An iterator to the key-value pair, or @c end() if @p index is not less than the number of keys
+    /// @note Only available if order statistics are maintained
+    iterator select(std::size_t index) noexcept {
+      return iterator(const_cast<Node*>(const_cast<const Map*>(this)->select(index)._node), this);
+    }
+
+    /// @brief Counts the keys lying in a half-open range, in logarithmic time
+    /// @param low The inclusive lower bound of the range
+    /// @param high The exclusive upper bound of the range
+    /// @note Only available if order statistics are maintained
+    std::size_t count_range(const Key& low, const Key& high) const noexcept {
+      if (!this->is_less(low, high))
+        return 0;
+
+      return this->rank(high) - this->rank(low);
+    }
+
+    /// @brief Finds the value associated to a given key, if any
+    const Value* lookup(const Key& key) const noexcept {
+      const Node* node = this->find_live(key);
+      return node != nullptr ? std::addressof(node->value) : nullptr;
+    }
+
+    /// @brief Finds the value associated to a key, if any
+    Value* lookup(const Key& key) noexcept {
+      return const_cast<Value*>(const_cast<const Map*>(this)->lookup(key));
+    }
+
+    /// @brief Finds the value associated to a key orderly equivalent to a given value, if any
+    /// @note Only available if the comparator is transparent, sparing the construction of a temporary key
+    template <typename K, typename L = Less, std::enable_if_t<Is_transparent<L>::value, int> = 0>
+    const Value* lookup(const K& key) const noexcept {
+      const Node* node = this->find_live(key);
+      return node != nullptr ? std::addressof(node->value) : nullptr;
+    }
+
+    /// @brief Finds the value associated to a key orderly equivalent to a given value, if any
+    /// @note Only available if the comparator is transparent, sparing the construction of a temporary key
+    template <typename K, typename L = Less, std::enable_if_t<Is_transparent<L>::value, int> = 0>
+    Value* lookup(const K& key) noexcept {
+      return const_cast<Value*>(const_cast<const Map*>(this)->lookup(key));
+    }
+
+    /// @brief Finds the values associated to several keys, walking their searches in lockstep so that their cache misses
+    /// overlap
+    /// @param keys The array of @p count keys
+    /// @param[out] values The array of @p count values found, or @c nullptr for keys not found
+    void lookup_many(const Key* keys, std::size_t count, const Value** values) const noexcept {
+      this->lookup_many_values(keys, count, values);
+    }
+
+    /// @brief Finds the values associated to several keys, walking their searches in lockstep so that their cache misses
+    /// overlap
+    /// @param keys The array of @p count keys
+    /// @param[out] values The array of @p count values found, or @c nullptr for keys not found
+    void lookup_many(const Key* keys, std::size_t count, Value** values) noexcept {
+      this->lookup_many_values(keys, count, values);
+    }
+
+    /// @brief Associates a key to a value, forwarding the value into the map
+    template <typename V = Value>
+    void insert(const Key& key, V&& value) {
+      this->insert_or_assign(key, std::forward<V>(value));
+    }
+
+    /// @brief Associates a key to a value, moving the key and forwarding the value into the map
+    template <typename V = Value>
+    void insert(Key&& key, V&& value) {
+      this->insert_or_assign(std::move(key), std::forward<V>(value));
+    }
+
+    /// @brief Associates a key to a value, assigning the value if the key is already associated
+    /// @return The associated value, and @c true if the key was newly inserted or @c false if it was assigned
+    template <typename V>
+    std::pair<Value*, bool> insert_or_assign(const Key& key, V&& value) {
+      auto [node, inserted] = this->insert_or_assign_key(key, std::forward<V>(value));
+      return {std::addressof(node->value), inserted};
+    }
+
+    /// @brief Associates a key to a value, assigning the value if the key is already associated
+    /// @return The associated value, and @c true if the key was newly inserted or @c false if it was assigned
+    template <typename V>
+    std::pair<Value*, bool> insert_or_assign(Key&& key, V&& value) {
+      auto [node, inserted] = this->insert_or_assign_key(std::move(key), std::forward<V>(value));
+      return {std::addressof(node->value), inserted};
+    }
+
+    /// @brief Associates a key to a value, in amortized constant time if the key is greater than all keys of this map
+    /// @return The associated value, and @c true if the key was newly inserted or @c false if it was assigned
+    template <typename V>
+    std::pair<Value*, bool> append(const Key& key, V&& value) {
+      auto [node, inserted] = this->append_key(key, std::forward<V>(value));
+      return {std::addressof(node->value), inserted};
+    }
+
+    /// @brief Associates a key to a value, in amortized constant time if the key is greater than all keys of this map
+    /// @return The associated value, and @c true if the key was newly inserted or @c false if it was assigned
+    template <typename V>
+    std::pair<Value*, bool> append(Key&& key, V&& value) {
+      auto [node, inserted] = this->append_key(std::move(key), std::forward<V>(value));
+      return {std::addressof(node->value), inserted};
+    }
+
+    /// @brief Associates a key to a value, assigning the value if the key is already associated,
+    /// in amortized constant time if the key falls right before or after that of @p hint
+    /// @param hint An iterator to a key-value pair whose key is expected to be adjacent to @p key, or @c end() if @p key is
+    /// expected to be greater than all keys of this map
+    /// @return An iterator to the associated key-value pair, and @c true if the key was newly inserted or @c false if it was
+    /// assigned
+    template <typename V>
+    std::pair<iterator, bool> insert_near(const_iterator hint, const Key& key, V&& value) {
+      auto [node, inserted] = this->insert_or_assign_near_key(const_cast<Node*>(hint._node), key, std::forward<V>(value));
+      return {iterator(node, this), inserted};
+    }
+
+    /// @brief Associates a key to a value, assigning the value if the key is already associated,
+    /// in amortized constant time if the key falls right before or after that of @p hint
+    /// @param hint An iterator to a key-value pair whose key is expected to be adjacent to @p key, or @c end() if @p key is
+    /// expected to be greater than all keys of this map
+    /// @return An iterator to the associated key-value pair, and @c true if the key was newly inserted or @c false if it was
+    /// assigned
+    template <typename V>
+    std::pair<iterator, bool> insert_near(const_iterator hint, Key&& key, V&& value) {
+      auto [node, inserted] = this->insert_or_assign_near_key(const_cast<Node*>(hint._node), std::move(key), std::forward<V>(value));
+      return {iterator(node, this), inserted};
+    }
+
+    /// @brief Associates a key to a value constructed in place from some arguments, unless the key is already associated
+    /// @return The associated value, and @c true if the key was newly inserted or @c false if it was left untouched
+    /// @note If the key is already associated, the arguments are not used, and in particular not moved from
+    template <typename... Args>
+    std::pair<Value*, bool> try_emplace(const Key& key, Args&&... args) {
+      return this->try_emplace_key(key, std::forward<Args>(args)...);
+    }
+
+    /// @brief Associates a key to a value constructed in place from some arguments, unless the key is already associated
+    /// @return The associated value, and @c true if the key was newly inserted or @c false if it was left untouched
+    /// @note If the key is already associated, the arguments are not used, and in particular not moved from
+    template <typename... Args>
+    std::pair<Value*, bool> try_emplace(Key&& key, Args&&... args) {
+      return this->try_emplace_key(std::move(key), std::forward<Args>(args)...);
+    }
+
+    /// @brief Associates a key constructed in place to a value constructed in place, unless the key is already associated
+    /// @param key The argument from which the key is constructed
+    /// @param args The arguments from which the value is constructed
+    /// @return The associated value, and @c true if the key was newly inserted or @c false if it was left untouched
+    /// @note The key and value are constructed before searching for the key, and destroyed if it is already associated
+    template <typename K, typename... Args>
+    std::pair<Value*, bool> emplace(K&& key, Args&&... args) {
+      Node* node = this->new_node(nullptr, LEFT, RED, std::forward<K>(key), std::forward<Args>(args)...);
+      Node* parent;
+      Direction direction;
+      Node* found_node = this->find(node->key, parent, direction);
+
+      if (found_node != nullptr) {
+        bool revived = false;
+
+        if constexpr (Tombstones) {
+          if (found_node->tombstone) {
+            found_node->value = std::move(node->value);
+            revived = this->revive(found_node);
+          }
+        }
+
+        this->delete_node(node);
+        return {std::addressof(found_node->value), revived};
+      }
+
+      node->set_parent(parent);
+      node->set_direction(direction);
+      this->attach(node);
+      return {std::addressof(node->value), true};
+    }
+
+    /// @brief Removes the value associated to a key, if any
+    /// @return @c true if an association to the key existed prior to removal, @c false otherwise
+    bool remove(const Key& key) noexcept {
+      return this->remove_key(key);
+    }
+
+    /// @brief Removes the value associated to a key orderly equivalent to a given value, if any
+    /// @return @c true if an association to the key existed prior to removal, @c false otherwise
+    /// @note Only available if the comparator is transparent, sparing the construction of a temporary key
+    template <typename K, typename L = Less, std::enable_if_t<Is_transparent<L>::value, int> = 0>
+    bool remove(const K& key) noexcept {
+      return this->remove_key(key);
+    }
+
+    /// @brief Returns the fraction of the nodes which tombstones may make up before a removal compacts the tree, @c 0.25
+    /// unless set otherwise
+    /// @note Only meaningful if removals mark tombstones
+    double tombstone_fraction() const noexcept {
+      return this->_tombstone_fraction;
+    }
+
+    /// @brief Sets the fraction of the nodes which tombstones may make up before a removal compacts the tree
+    /// @pre `0 <= fraction && fraction <= 1`, @c 1 leaving compaction to @c compact
+    /// @note Only available if removals mark tombstones
+    void set_tombstone_fraction(double fraction) noexcept {
+      static_assert(Tombstones, "set_tombstone_fraction requires Tombstones");
+      assert(fraction >= 0 && fraction <= 1);
+      this->_tombstone_fraction = fraction;
+    }
+
+    /// @brief Frees the nodes marked as tombstones by the removals from this map, rebuilding its tree out of the other
+    /// nodes in linear time, without allocating memory
+    /// @note Splits and joins compact the maps they modify first
+    void compact() noexcept {
+      if (this->_tombstone_count == 0)
+        return;
+
+      // The nodes are sorted into a list of tombstones and a list of the other nodes in key order, linked through their
+      // right children, each successor being found before its node is relinked:
+
+      Node* tombstones = nullptr;
+      Node* nodes = nullptr;
+      Node** nodes_end = &nodes;
+
+      for (Node* node = this->_xmost_nodes[LEFT]; node != nullptr;) {
+        Node* in_order_successor = node->in_order_xcessor(RIGHT);
+
+        if (node->is_tombstone()) {
+          node->children[RIGHT] = tombstones;
+          tombstones = node;
+        } else {
+          *nodes_end = node;
+          nodes_end = &node->children[RIGHT];
+        }
+
+        node = in_order_successor;
+      }
+
+      *nodes_end = nullptr;
+
+      while (tombstones != nullptr) {
+        Node* next_tombstone = tombstones->children[RIGHT];
+        this->delete_node(tombstones);
+        tombstones = next_tombstone;
       }
 
+      auto next_node = [&]() noexcept {
+        Node* node = nodes;
+        nodes = node->children[RIGHT];
+        node->set_parent(nullptr);
+        node->set_direction(LEFT);
+        node->set_color(RED);
+        return node;
+      };
+
+      this->_root = this->build_tree(next_node, this->_count, Map::tree_capacity(this->_count));
+      this->_xmost_nodes[LEFT] = this->_root != nullptr ? this->_root->xmost_node(LEFT) : nullptr;
+      this->_xmost_nodes[RIGHT] = this->_root != nullptr ? this->_root->xmost_node(RIGHT) : nullptr;
+      this->_tombstone_count = 0;
+    }
+
+    /// @brief Moves the key-value pairs of this map whose keys are not lesser than a given key into a new map, in
+    /// `O(log n)` time if order statistics are maintained, or `O(log n + min(k, n - k))` time otherwise for @c k moved
+    /// key-value pairs out of @c n, which are then counted
+    /// @return The map of the moved key-value pairs, with copies of the comparator and allocator of this map
+    Map split(const Key& key) {
+      this->compact();
+      Map greater(this->_less, Allocator(this->_allocator));
+      greater._tombstone_fraction = this->_tombstone_fraction;
+      std::size_t count = this->_count;
+      Subtree right;
+      Subtree left = this->split_subtree(this->detach_subtree(), key, right);
+      std::size_t right_count;
+
+      if constexpr (Order_statistics) {
+        right_count = Node::subtree_size(right.root);
+      } else {
+        right_count = Map::count_right(left.root, right.root, count);
+      }
+
+      this->attach_subtree(left, count - right_count);
+      greater.attach_subtree(right, right_count);
+      return greater;
+    }
+
+    /// @brief Moves the key-value pairs of another map, along with a key-value pair in between, into this map, in
+    /// `O(log n)` time
+    /// @details The trees are joined along the black height of the shorter one, so that only the nodes on the facing
+    /// spine of the taller one are visited.
+    /// @param greater The map whose key-value pairs are moved, left empty
+    /// @pre The keys of this map are lesser than @p key, itself lesser than the keys of @p greater
+    /// @pre The allocators of both maps compare equal, so that they may exchange nodes
+    /// @note If an exception is thrown while constructing the key-value pair, neither map is modified
+    template <typename V>
+    void join(const Key& key, V&& value, Map& greater) {
+      this->compact();
+      greater.compact();
+      assert(this->_allocator == greater._allocator);
+      assert(this->_count == 0 || this->_less(this->_xmost_nodes[RIGHT]->key, key));
+      assert(greater._count == 0 || this->_less(key, greater._xmost_nodes[LEFT]->key));
+      this->join_node(this->new_node(nullptr, LEFT, BLACK, key, std::forward<V>(value)), greater);
+    }
+
+    /// @brief Moves the key-value pairs of another map, along with a key-value pair in between, into this map, in
+    /// `O(log n)` time
+    /// @see join(const Key&, V&&, Map&)
+    template <typename V>
+    void join(Key&& key, V&& value, Map& greater) {
+      this->compact();
+      greater.compact();
+      assert(this->_allocator == greater._allocator);
+      assert(this->_count == 0 || this->_less(this->_xmost_nodes[RIGHT]->key, key));
+      assert(greater._count == 0 || this->_less(key, greater._xmost_nodes[LEFT]->key));
+      this->join_node(this->new_node(nullptr, LEFT, BLACK, std::move(key), std::forward<V>(value)), greater);
+    }
+
+    /// @brief Moves the key-value pairs of another map into this map, in `O(log n)` time
+    /// @param greater The map whose key-value pairs are moved, left empty
+    /// @pre The keys of this map are lesser than the keys of @p greater
+    /// @pre The allocators of both maps compare equal, so that they may exchange nodes
+    void concatenate(Map& greater) noexcept {
+      this->compact();
+      greater.compact();
+      assert(this->_allocator == greater._allocator);
+      assert(this->_count == 0 || greater._count == 0 || this->_less(this->_xmost_nodes[RIGHT]->key, greater._xmost_nodes[LEFT]->key));
+      std::size_t count = this->_count + greater._count;
+      Subtree left = this->detach_subtree();
+      this->attach_subtree(this->concatenate_subtrees(left, greater.detach_subtree()), count);
+    }
+
+    /// @brief Clears this map, removing all key-value associations
+    /// @note If nodes need no destruction and the allocator can take them back at once, they are not visited
+    void clear() noexcept {
+      if constexpr (std::is_trivially_destructible_v<Node> && Is_releasable<Node_allocator>::value) {
+        if (this->_allocator.release()) {
+          this->_root = nullptr;
+          this->_xmost_nodes[LEFT] = nullptr;
+          this->_xmost_nodes[RIGHT] = nullptr;
+          this->_count = 0;
+          this->_tombstone_count = 0;
+          return;
+        }
+      }
+
+      this->delete_tree(this->_root);
       this->_root = nullptr;
+      this->_xmost_nodes[LEFT] = nullptr;
+      this->_xmost_nodes[RIGHT] = nullptr;
       this->_count = 0;
+      this->_tombstone_count = 0;
     }
   };
+
+  namespace pmr {
+    /// @brief Ordered map data type, associating keys to values, whose nodes are allocated from a memory resource
+    template <typename Key, typename Value, typename Less = std::less<Key>>
+    using Map = cpp::Map<Key, Value, Less, std::pmr::polymorphic_allocator<std::pair<const Key, Value>>>;
+  }
 }
 
 #endif
@@ -0,0 +1,464 @@
+#ifndef MAP_DEFINE_H
+#define MAP_DEFINE_H
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/// @file
+/// @brief Generator of ordered maps specialized at compile time for given key and value types
+/// @details @c MAP_DEFINE expands to a copy of the algorithms of @c map.c whose nodes have a fixed layout, holding
+/// keys and values as struct members: keys are compared inline by a given expression and assigned rather than moved
+/// by size, and nodes are allocated directly, sparing the indirect calls of @c Comparator and @c Allocator. For
+/// example, after
+///
+///     MAP_DEFINE(Int_map, int, double, (*a > *b) - (*a < *b))
+///
+/// @c Int_map_new, @c Int_map_insert, @c Int_map_lookup, @c Int_map_remove and the others operate on @c Int_map
+/// maps. The functions mirror those of @c map.h of the same names, taking pointers to keys and values of their types:
+///
+/// - `NAME* NAME_new(void)`, returning @c NULL if memory could not be allocated
+/// - `void NAME_destroy(NAME* map)` and `void NAME_clear(NAME* map)`
+/// - `void NAME_check(const NAME* map)` and `size_t NAME_count(const NAME* map)`
+/// - `VALUE* NAME_lookup(const NAME* map, const KEY* key)` and `VALUE* NAME_lower_bound(const NAME* map, const KEY* key)`
+/// - `VALUE* NAME_first(const NAME* map)`, `VALUE* NAME_last(const NAME* map)`,
+///   `VALUE* NAME_next(const NAME* map, const VALUE* value)` and `VALUE* NAME_previous(const NAME* map, const VALUE* value)`
+/// - `const KEY* NAME_key(const NAME* map, const VALUE* value)`
+/// - `size_t NAME_scan(const NAME* map, const KEY* low, const KEY* high, bool (*visit)(const KEY*, VALUE*, void*), void* data)`
+/// - `bool NAME_insert(NAME* map, const KEY* key, const VALUE* value)`, returning @c false if memory could not be
+///   allocated
+/// - `bool NAME_remove(NAME* map, const KEY* key)`
+///
+/// Generated functions are @c static, so that each translation unit expanding @c MAP_DEFINE gets its own copy, which
+/// the compiler is free to inline. Their type and function names are those of @c NAME followed by an underscore,
+/// including those of the internal @c NAME_node type and @c NAME_node_ functions.
+
+/// @brief Allocates memory for a generated map or node, defaulting to @c malloc
+/// @note May be defined before expanding @c MAP_DEFINE, along with @c MAP_DEFINE_FREE
+#ifndef MAP_DEFINE_ALLOCATE
+#define MAP_DEFINE_ALLOCATE(SIZE) malloc(SIZE)
+#endif
+
+/// @brief Frees memory allocated by @c MAP_DEFINE_ALLOCATE, defaulting to @c free
+#ifndef MAP_DEFINE_FREE
+#define MAP_DEFINE_FREE(POINTER) free(POINTER)
+#endif
+
+/// @brief Left-right directions of the nodes of generated maps
+enum { MAP_DEFINE_LEFT = 0, MAP_DEFINE_RIGHT = 1 };
+
+/// @brief Red-black colors of the nodes of generated maps
+enum { MAP_DEFINE_BLACK = 0, MAP_DEFINE_RED = 1 };
+
+/// @brief Defines an ordered map type specialized for given key and value types, along with its functions
+/// @param NAME The name of the map type, prefixing the names of its functions
+/// @param KEY The type of keys, copied by assignment
+/// @param VALUE The type of values, copied by assignment
+/// @param COMPARE An expression comparing the keys pointed to by @c a and @c b, of type `const KEY*`, evaluating to a
+/// negative, zero or positive @c int as the first key is less than, equivalent to or greater than the second
+#define MAP_DEFINE(NAME, KEY, VALUE, COMPARE)     \
+  MAP_DEFINE_TYPES(NAME, KEY, VALUE)              \
+  MAP_DEFINE_NODE_FUNCTIONS(NAME, VALUE)          \
+  MAP_DEFINE_FUNCTIONS(NAME, KEY, VALUE, COMPARE)
+
+/// @brief Defines the node and map types of @c MAP_DEFINE
+#define MAP_DEFINE_TYPES(NAME, KEY, VALUE) \
+typedef struct NAME##_node {               \
+  struct NAME##_node* children[2];         \
+  struct NAME##_node* parent;              \
+  unsigned char direction;                 \
+  unsigned char color;                     \
+  KEY key;                                 \
+  VALUE value;                             \
+} NAME##_node;                             \
+                                           \
+typedef struct NAME {                      \
+  NAME##_node* root;                       \
+  NAME##_node* xmost_nodes[2];             \
+  size_t count;                            \
+} NAME;
+
+/// @brief Defines the node and rebalancing functions of @c MAP_DEFINE, mirroring those of @c map.c
+#define MAP_DEFINE_NODE_FUNCTIONS(NAME, VALUE)                                                                               \
+static inline NAME##_node* NAME##_value_node(const VALUE* value) {                                                           \
+  return (NAME##_node*)((char*)value - offsetof(NAME##_node, value));                                                        \
+}                                                                                                                            \
+                                                                                                                             \
+static inline bool NAME##_node_is_red(const NAME##_node* node) {                                                             \
+  return node != NULL && node->color == MAP_DEFINE_RED;                                                                      \
+}                                                                                                                            \
+                                                                                                                             \
+static inline NAME##_node* NAME##_node_xmost_node(const NAME##_node* node, int direction) {                                  \
+  while (node->children[direction] != NULL) {                                                                                \
+    node = node->children[direction];                                                                                        \
+  }                                                                                                                          \
+                                                                                                                             \
+  return (NAME##_node*)node;                                                                                                 \
+}                                                                                                                            \
+                                                                                                                             \
+static inline NAME##_node* NAME##_node_xmost_leaf(const NAME##_node* node, int direction) {                                  \
+  while (true) {                                                                                                             \
+    if (node->children[direction] != NULL) {                                                                                 \
+      node = node->children[direction];                                                                                      \
+    } else if (node->children[1 - direction] != NULL) {                                                                      \
+      node = node->children[1 - direction];                                                                                  \
+    } else {                                                                                                                 \
+      return (NAME##_node*)node;                                                                                             \
+    }                                                                                                                        \
+  }                                                                                                                          \
+}                                                                                                                            \
+                                                                                                                             \
+static inline NAME##_node* NAME##_node_in_order_xcessor(const NAME##_node* node, int direction) {                            \
+  if (node->children[direction] != NULL)                                                                                     \
+    return NAME##_node_xmost_node(node->children[direction], 1 - direction);                                                 \
+                                                                                                                             \
+  while (node->parent != NULL && node->direction == direction) {                                                             \
+    node = node->parent;                                                                                                     \
+  }                                                                                                                          \
+                                                                                                                             \
+  return node->parent;                                                                                                       \
+}                                                                                                                            \
+                                                                                                                             \
+static inline NAME##_node* NAME##_node_rotate(NAME##_node* node, int direction) {                                            \
+  NAME##_node* B = node;                                                                                                     \
+  NAME##_node* CA = B->children[1 - direction];                                                                              \
+  NAME##_node* cb = CA->children[direction];                                                                                 \
+  unsigned char cb_color = CA->color;                                                                                        \
+                                                                                                                             \
+  if (cb != NULL) {                                                                                                          \
+    cb->parent = B;                                                                                                          \
+    cb->direction = (unsigned char)(1 - direction);                                                                          \
+  }                                                                                                                          \
+                                                                                                                             \
+  B->children[1 - direction] = cb;                                                                                           \
+  CA->parent = B->parent;                                                                                                    \
+  CA->direction = B->direction;                                                                                              \
+  CA->color = B->color;                                                                                                      \
+  CA->children[direction] = B;                                                                                               \
+  B->parent = CA;                                                                                                            \
+  B->direction = (unsigned char)direction;                                                                                   \
+  B->color = cb_color;                                                                                                       \
+  return CA;                                                                                                                 \
+}                                                                                                                            \
+                                                                                                                             \
+static inline void NAME##_node_link_parent(NAME* map, NAME##_node* node) {                                                   \
+  *(node->parent != NULL ? &node->parent->children[node->direction] : &map->root) = node;                                    \
+}                                                                                                                            \
+                                                                                                                             \
+static inline void NAME##_fix_insertion(NAME* map, NAME##_node* node) {                                                      \
+  while (node->parent != NULL) {                                                                                             \
+    if (node->parent->color == MAP_DEFINE_RED) {                                                                             \
+      if (node->direction != node->parent->direction) {                                                                      \
+        node = node->parent;                                                                                                 \
+        NAME##_node_link_parent(map, NAME##_node_rotate(node, node->direction));                                             \
+      }                                                                                                                      \
+                                                                                                                             \
+      NAME##_node_link_parent(map, NAME##_node_rotate(node->parent->parent, 1 - node->direction));                           \
+    }                                                                                                                        \
+                                                                                                                             \
+    if (!NAME##_node_is_red(node->parent->children[1 - node->direction]))                                                    \
+      break;                                                                                                                 \
+                                                                                                                             \
+    node->color = MAP_DEFINE_BLACK;                                                                                          \
+    node->parent->children[1 - node->direction]->color = MAP_DEFINE_BLACK;                                                   \
+    node->parent->color = MAP_DEFINE_RED;                                                                                    \
+    node = node->parent;                                                                                                     \
+  }                                                                                                                          \
+                                                                                                                             \
+  map->root->color = MAP_DEFINE_BLACK;                                                                                       \
+}                                                                                                                            \
+                                                                                                                             \
+static inline void NAME##_fix_removal(NAME* map, NAME##_node* parent, int node_direction) {                                  \
+  NAME##_node* node;                                                                                                         \
+                                                                                                                             \
+  do {                                                                                                                       \
+    NAME##_node* sibling = parent->children[1 - node_direction];                                                             \
+                                                                                                                             \
+    if (sibling->color == MAP_DEFINE_RED) {                                                                                  \
+      NAME##_node_link_parent(map, NAME##_node_rotate(parent, node_direction));                                              \
+      sibling = parent->children[1 - node_direction];                                                                        \
+    }                                                                                                                        \
+                                                                                                                             \
+    sibling->color = MAP_DEFINE_RED;                                                                                         \
+                                                                                                                             \
+    if (NAME##_node_is_red(sibling->children[MAP_DEFINE_LEFT]) || NAME##_node_is_red(sibling->children[MAP_DEFINE_RIGHT])) { \
+      if (!NAME##_node_is_red(sibling->children[sibling->direction])) {                                                      \
+        sibling = NAME##_node_rotate(sibling, sibling->direction);                                                           \
+        parent->children[sibling->direction] = sibling;                                                                      \
+      }                                                                                                                      \
+                                                                                                                             \
+      NAME##_node* B = NAME##_node_rotate(parent, node_direction);                                                           \
+      NAME##_node_link_parent(map, B);                                                                                       \
+      B->children[MAP_DEFINE_LEFT]->color = MAP_DEFINE_BLACK;                                                                \
+      B->children[MAP_DEFINE_RIGHT]->color = MAP_DEFINE_BLACK;                                                               \
+      return;                                                                                                                \
+    }                                                                                                                        \
+                                                                                                                             \
+    node = parent;                                                                                                           \
+    parent = node->parent;                                                                                                   \
+    node_direction = node->direction;                                                                                        \
+  } while (parent != NULL && node->color == MAP_DEFINE_BLACK);                                                               \
+                                                                                                                             \
+  node->color = MAP_DEFINE_BLACK;                                                                                            \
+}                                                                                                                            \
+                                                                                                                             \
+static inline size_t NAME##_node_check(const NAME##_node* node) {                                                            \
+  if (node == NULL)                                                                                                          \
+    return 1;                                                                                                                \
+                                                                                                                             \
+  if (node->parent != NULL) {                                                                                                \
+    assert(node->parent->children[node->direction] == node);                                                                 \
+    assert(node->color == MAP_DEFINE_BLACK || node->parent->color == MAP_DEFINE_BLACK);                                      \
+  }                                                                                                                          \
+                                                                                                                             \
+  assert(!NAME##_node_is_red(node->children[MAP_DEFINE_LEFT]) || !NAME##_node_is_red(node->children[MAP_DEFINE_RIGHT]));     \
+  size_t black_depth = NAME##_node_check(node->children[MAP_DEFINE_LEFT]);                                                   \
+  size_t right_black_depth = NAME##_node_check(node->children[MAP_DEFINE_RIGHT]);                                            \
+  assert(black_depth == right_black_depth);                                                                                  \
+  (void)right_black_depth;                                                                                                   \
+  return black_depth + (node->color == MAP_DEFINE_BLACK ? 1 : 0);                                                            \
+}
+
+/// @brief Defines the map functions of @c MAP_DEFINE
+#define MAP_DEFINE_FUNCTIONS(NAME, KEY, VALUE, COMPARE)                                                              \
+static inline NAME##_node* NAME##_find(const NAME* map, const KEY* key, NAME##_node** parent_p, int* direction_p) {  \
+  NAME##_node* node = map->root;                                                                                     \
+  NAME##_node* parent = NULL;                                                                                        \
+  int direction = MAP_DEFINE_LEFT;                                                                                   \
+                                                                                                                     \
+  while (node != NULL) {                                                                                             \
+    const KEY* a = key;                                                                                              \
+    const KEY* b = &node->key;                                                                                       \
+    int ordering = (COMPARE);                                                                                        \
+                                                                                                                     \
+    if (ordering == 0)                                                                                               \
+      break;                                                                                                         \
+                                                                                                                     \
+    parent = node;                                                                                                   \
+    direction = ordering < 0 ? MAP_DEFINE_LEFT : MAP_DEFINE_RIGHT;                                                   \
+    node = node->children[direction];                                                                                \
+  }                                                                                                                  \
+                                                                                                                     \
+  *parent_p = parent;                                                                                                \
+  *direction_p = direction;                                                                                          \
+  return node;                                                                                                       \
+}                                                                                                                    \
+                                                                                                                     \
+static inline NAME* NAME##_new(void) {                                                                               \
+  NAME* map = (NAME*)MAP_DEFINE_ALLOCATE(sizeof(NAME));                                                              \
+                                                                                                                     \
+  if (map != NULL) {                                                                                                 \
+    map->root = NULL;                                                                                                \
+    map->xmost_nodes[MAP_DEFINE_LEFT] = NULL;                                                                        \
+    map->xmost_nodes[MAP_DEFINE_RIGHT] = NULL;                                                                       \
+    map->count = 0;                                                                                                  \
+  }                                                                                                                  \
+                                                                                                                     \
+  return map;                                                                                                        \
+}                                                                                                                    \
+                                                                                                                     \
+static inline void NAME##_check(const NAME* map) {                                                                   \
+  assert(map->root == NULL || (map->root->parent == NULL && map->root->color == MAP_DEFINE_BLACK));                  \
+  NAME##_node_check(map->root);                                                                                      \
+  size_t count = 0;                                                                                                  \
+                                                                                                                     \
+  for (const NAME##_node* node = map->xmost_nodes[MAP_DEFINE_LEFT]; node != NULL; ) {                                \
+    const NAME##_node* next = NAME##_node_in_order_xcessor(node, MAP_DEFINE_RIGHT);                                  \
+                                                                                                                     \
+    if (next != NULL) {                                                                                              \
+      const KEY* a = &node->key;                                                                                     \
+      const KEY* b = &next->key;                                                                                     \
+      assert((COMPARE) < 0);                                                                                         \
+      (void)a;                                                                                                       \
+      (void)b;                                                                                                       \
+    } else {                                                                                                         \
+      assert(node == map->xmost_nodes[MAP_DEFINE_RIGHT]);                                                            \
+    }                                                                                                                \
+                                                                                                                     \
+    count += 1;                                                                                                      \
+    node = next;                                                                                                     \
+  }                                                                                                                  \
+                                                                                                                     \
+  assert(count == map->count);                                                                                       \
+  (void)count;                                                                                                       \
+}                                                                                                                    \
+                                                                                                                     \
+static inline size_t NAME##_count(const NAME* map) {                                                                 \
+  return map->count;                                                                                                 \
+}                                                                                                                    \
+                                                                                                                     \
+static inline VALUE* NAME##_lookup(const NAME* map, const KEY* key) {                                                \
+  NAME##_node* parent;                                                                                               \
+  int direction;                                                                                                     \
+  NAME##_node* node = NAME##_find(map, key, &parent, &direction);                                                    \
+  return node != NULL ? &node->value : NULL;                                                                         \
+}                                                                                                                    \
+                                                                                                                     \
+static inline VALUE* NAME##_lower_bound(const NAME* map, const KEY* key) {                                           \
+  NAME##_node* parent;                                                                                               \
+  int direction;                                                                                                     \
+  NAME##_node* node = NAME##_find(map, key, &parent, &direction);                                                    \
+                                                                                                                     \
+  if (node == NULL && parent != NULL)                                                                                \
+    node = direction == MAP_DEFINE_LEFT ? parent : NAME##_node_in_order_xcessor(parent, MAP_DEFINE_RIGHT);           \
+                                                                                                                     \
+  return node != NULL ? &node->value : NULL;                                                                         \
+}                                                                                                                    \
+                                                                                                                     \
+static inline VALUE* NAME##_first(const NAME* map) {                                                                 \
+  return map->xmost_nodes[MAP_DEFINE_LEFT] != NULL ? &map->xmost_nodes[MAP_DEFINE_LEFT]->value : NULL;               \
+}                                                                                                                    \
+                                                                                                                     \
+static inline VALUE* NAME##_last(const NAME* map) {                                                                  \
+  return map->xmost_nodes[MAP_DEFINE_RIGHT] != NULL ? &map->xmost_nodes[MAP_DEFINE_RIGHT]->value : NULL;             \
+}                                                                                                                    \
+                                                                                                                     \
+static inline VALUE* NAME##_next(const NAME* map, const VALUE* value) {                                              \
+  NAME##_node* node = NAME##_node_in_order_xcessor(NAME##_value_node(value), MAP_DEFINE_RIGHT);                      \
+  (void)map;                                                                                                         \
+  return node != NULL ? &node->value : NULL;                                                                         \
+}                                                                                                                    \
+                                                                                                                     \
+static inline VALUE* NAME##_previous(const NAME* map, const VALUE* value) {                                          \
+  NAME##_node* node = NAME##_node_in_order_xcessor(NAME##_value_node(value), MAP_DEFINE_LEFT);                       \
+  (void)map;                                                                                                         \
+  return node != NULL ? &node->value : NULL;                                                                         \
+}                                                                                                                    \
+                                                                                                                     \
+static inline const KEY* NAME##_key(const NAME* map, const VALUE* value) {                                           \
+  (void)map;                                                                                                         \
+  return &NAME##_value_node(value)->key;                                                                             \
+}                                                                                                                    \
+                                                                                                                     \
+static inline size_t NAME##_scan(                                                                                    \
+  const NAME* map,                                                                                                   \
+  const KEY* low,                                                                                                    \
+  const KEY* high,                                                                                                   \
+  bool (*visit)(const KEY* key, VALUE* value, void* data),                                                           \
+  void* data                                                                                                         \
+) {                                                                                                                  \
+  VALUE* value = low != NULL ? NAME##_lower_bound(map, low) : NAME##_first(map);                                     \
+  size_t count = 0;                                                                                                  \
+                                                                                                                     \
+  for (; value != NULL; value = NAME##_next(map, value)) {                                                           \
+    const KEY* a = NAME##_key(map, value);                                                                           \
+    const KEY* b = high;                                                                                             \
+                                                                                                                     \
+    if (b != NULL && (COMPARE) >= 0)                                                                                 \
+      break;                                                                                                         \
+                                                                                                                     \
+    count += 1;                                                                                                      \
+                                                                                                                     \
+    if (!visit(a, value, data))                                                                                      \
+      break;                                                                                                         \
+  }                                                                                                                  \
+                                                                                                                     \
+  return count;                                                                                                      \
+}                                                                                                                    \
+                                                                                                                     \
+static inline bool NAME##_insert(NAME* map, const KEY* key, const VALUE* value) {                                    \
+  NAME##_node* parent;                                                                                               \
+  int direction;                                                                                                     \
+  NAME##_node* node = NAME##_find(map, key, &parent, &direction);                                                    \
+                                                                                                                     \
+  if (node != NULL) {                                                                                                \
+    node->value = *value;                                                                                            \
+    return true;                                                                                                     \
+  }                                                                                                                  \
+                                                                                                                     \
+  node = (NAME##_node*)MAP_DEFINE_ALLOCATE(sizeof(NAME##_node));                                                     \
+                                                                                                                     \
+  if (node == NULL)                                                                                                  \
+    return false;                                                                                                    \
+                                                                                                                     \
+  node->children[MAP_DEFINE_LEFT] = NULL;                                                                            \
+  node->children[MAP_DEFINE_RIGHT] = NULL;                                                                           \
+  node->parent = parent;                                                                                             \
+  node->direction = (unsigned char)direction;                                                                        \
+  node->color = MAP_DEFINE_RED;                                                                                      \
+  node->key = *key;                                                                                                  \
+  node->value = *value;                                                                                              \
+                                                                                                                     \
+  if (parent != NULL) {                                                                                              \
+    parent->children[direction] = node;                                                                              \
+                                                                                                                     \
+    if (parent == map->xmost_nodes[direction])                                                                       \
+      map->xmost_nodes[direction] = node;                                                                            \
+  } else {                                                                                                           \
+    map->root = node;                                                                                                \
+    map->xmost_nodes[MAP_DEFINE_LEFT] = node;                                                                        \
+    map->xmost_nodes[MAP_DEFINE_RIGHT] = node;                                                                       \
+  }                                                                                                                  \
+                                                                                                                     \
+  map->count += 1;                                                                                                   \
+  NAME##_fix_insertion(map, node);                                                                                   \
+  return true;                                                                                                       \
+}                                                                                                                    \
+                                                                                                                     \
+static inline bool NAME##_remove(NAME* map, const KEY* key) {                                                        \
+  NAME##_node* parent;                                                                                               \
+  int direction;                                                                                                     \
+  NAME##_node* node = NAME##_find(map, key, &parent, &direction);                                                    \
+                                                                                                                     \
+  if (node == NULL)                                                                                                  \
+    return false;                                                                                                    \
+                                                                                                                     \
+  if (node->children[MAP_DEFINE_LEFT] != NULL && node->children[MAP_DEFINE_RIGHT] != NULL) {                         \
+    NAME##_node* predecessor = NAME##_node_xmost_node(node->children[MAP_DEFINE_LEFT], MAP_DEFINE_RIGHT);            \
+    node->key = predecessor->key;                                                                                    \
+    node->value = predecessor->value;                                                                                \
+    node = predecessor;                                                                                              \
+  }                                                                                                                  \
+                                                                                                                     \
+  for (int i = 0; i < 2; ++i) {                                                                                      \
+    if (node == map->xmost_nodes[i])                                                                                 \
+      map->xmost_nodes[i] = node->children[1 - i] != NULL ? node->children[1 - i] : node->parent;                    \
+  }                                                                                                                  \
+                                                                                                                     \
+  parent = node->parent;                                                                                             \
+  direction = node->direction;                                                                                       \
+  unsigned char color = node->color;                                                                                 \
+  NAME##_node* child = node->children[node->children[MAP_DEFINE_LEFT] != NULL ? MAP_DEFINE_LEFT : MAP_DEFINE_RIGHT]; \
+  MAP_DEFINE_FREE(node);                                                                                             \
+  *(parent != NULL ? &parent->children[direction] : &map->root) = child;                                             \
+  map->count -= 1;                                                                                                   \
+                                                                                                                     \
+  if (child != NULL) {                                                                                               \
+    child->parent = parent;                                                                                          \
+    child->direction = (unsigned char)direction;                                                                     \
+    child->color = color;                                                                                            \
+  } else if (color == MAP_DEFINE_BLACK && parent != NULL) {                                                          \
+    NAME##_fix_removal(map, parent, direction);                                                                      \
+  }                                                                                                                  \
+                                                                                                                     \
+  return true;                                                                                                       \
+}                                                                                                                    \
+                                                                                                                     \
+static inline void NAME##_clear(NAME* map) {                                                                         \
+  if (map->root != NULL) {                                                                                           \
+    NAME##_node* node = NAME##_node_xmost_leaf(map->root, MAP_DEFINE_LEFT);                                          \
+                                                                                                                     \
+    do {                                                                                                             \
+      NAME##_node* successor = node->parent;                                                                         \
+                                                                                                                     \
+      if (successor != NULL && node->direction == MAP_DEFINE_LEFT && successor->children[MAP_DEFINE_RIGHT] != NULL)  \
+        successor = NAME##_node_xmost_leaf(successor->children[MAP_DEFINE_RIGHT], MAP_DEFINE_LEFT);                  \
+                                                                                                                     \
+      MAP_DEFINE_FREE(node);                                                                                         \
+      node = successor;                                                                                              \
+    } while (node != NULL);                                                                                          \
+  }                                                                                                                  \
+                                                                                                                     \
+  map->root = NULL;                                                                                                  \
+  map->xmost_nodes[MAP_DEFINE_LEFT] = NULL;                                                                          \
+  map->xmost_nodes[MAP_DEFINE_RIGHT] = NULL;                                                                         \
+  map->count = 0;                                                                                                    \
+}                                                                                                                    \
+                                                                                                                     \
+static inline void NAME##_destroy(NAME* map) {                                                                       \
+  NAME##_clear(map);                                                                                                 \
+  MAP_DEFINE_FREE(map);                                                                                              \
+}
+
+#endif
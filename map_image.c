@@ -0,0 +1,437 @@
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#define MAP_IMAGE_MMAP
+#endif
+
+#include "map_image.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef MAP_IMAGE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// @brief The magic number beginning images
+#define MAP_IMAGE_MAGIC "MAPIMAGE"
+
+/// @brief The version of the image format
+#define MAP_IMAGE_VERSION 1
+
+/// @brief The value whose bytes record the byte order of the machine which wrote an image
+#define MAP_IMAGE_BYTE_ORDER 0x01020304
+
+/// @brief The greatest alignment of keys and values, which memory-mapped images are guaranteed to satisfy
+#define MAP_IMAGE_MAX_ALIGNMENT 4096
+
+/// @brief Header of an image, followed by the keys and values
+typedef struct Map_image_header {
+  /// @brief @c MAP_IMAGE_MAGIC, without its terminating null character
+  char magic[8];
+
+  /// @brief @c MAP_IMAGE_BYTE_ORDER
+  uint32_t byte_order;
+
+  /// @brief @c MAP_IMAGE_VERSION
+  uint32_t version;
+
+  uint64_t key_size;
+  uint64_t key_alignment;
+  uint64_t value_size;
+  uint64_t value_alignment;
+
+  /// @brief The number of key-value pairs
+  uint64_t count;
+
+  /// @brief The offset of the array of keys, relative to the beginning of the image
+  uint64_t keys_offset;
+
+  /// @brief The offset of the array of values, relative to the beginning of the image
+  uint64_t values_offset;
+} Map_image_header;
+
+/// @brief The ownership of the memory holding an image
+typedef enum Map_image_storage {
+  /// @brief Memory owned by the caller
+  MAP_IMAGE_VIEWED,
+
+  /// @brief Memory mapped by the image
+  MAP_IMAGE_MAPPED,
+
+  /// @brief Memory allocated by the image
+  MAP_IMAGE_READ,
+} Map_image_storage;
+
+struct Map_image {
+  /// @brief The memory holding the image
+  const char* data;
+
+  /// @brief The size of the image
+  size_t size;
+
+  /// @brief The ownership of the memory holding the image
+  Map_image_storage storage;
+
+  /// @brief The number of key-value pairs stored by the image
+  size_t count;
+
+  /// @brief The array of keys
+  const char* keys;
+
+  /// @brief The array of values
+  const char* values;
+
+  /// @brief The size of a key
+  size_t key_size;
+
+  /// @brief The size of a value
+  size_t value_size;
+
+  /// @brief The key comparator
+  Comparator comparator;
+};
+
+/// @brief Rounds up an offset to the nearest multiple of an alignment
+static inline uint64_t map_image_pad(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+/// @brief Determines if an alignment is a power of two that images may guarantee
+static inline bool map_image_is_alignment(uint64_t alignment) {
+  return alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= MAP_IMAGE_MAX_ALIGNMENT;
+}
+
+/// @brief Computes the header of the image of a given number of key-value pairs of given layouts
+static Map_image_header map_image_header(Layout key_layout, Layout value_layout, size_t count) {
+  Map_image_header header = {
+    .byte_order = MAP_IMAGE_BYTE_ORDER,
+    .version = MAP_IMAGE_VERSION,
+    .key_size = key_layout.size,
+    .key_alignment = key_layout.alignment,
+    .value_size = value_layout.size,
+    .value_alignment = value_layout.alignment,
+    .count = count,
+  };
+
+  memcpy(header.magic, MAP_IMAGE_MAGIC, sizeof(header.magic));
+  header.keys_offset = map_image_pad(sizeof(Map_image_header), key_layout.alignment);
+  header.values_offset = map_image_pad(header.keys_offset + count * header.key_size, value_layout.alignment);
+  return header;
+}
+
+/// @brief Writes zero bytes to a file until it reaches a given offset
+static bool map_image_write_padding(FILE* file, uint64_t* offset, uint64_t target) {
+  for (; *offset < target; *offset += 1) {
+    if (fputc(0, file) == EOF)
+      return false;
+  }
+
+  return true;
+}
+
+/// @brief The state of a scan writing keys or values to a file
+typedef struct Map_image_writer {
+  FILE* file;
+
+  /// @brief The size of the written keys or values
+  size_t size;
+
+  /// @brief @c true if written keys, @c false if written values
+  bool keys;
+
+  /// @brief @c false once a write failed
+  bool succeeded;
+} Map_image_writer;
+
+/// @brief Writes the key or the value of a key-value pair to the file of the writer pointed to by @p data
+static bool map_image_write_pair(const void* key, void* value, void* data) {
+  Map_image_writer* writer = data;
+
+  if (writer->size != 0 && fwrite(writer->keys ? key : value, writer->size, 1, writer->file) != 1)
+    writer->succeeded = false;
+
+  return writer->succeeded;
+}
+
+bool map_image_write(const Map* map, Layout key_layout, Layout value_layout, FILE* file) {
+  assert(map_image_is_alignment(key_layout.alignment) && map_image_is_alignment(value_layout.alignment));
+  size_t count = map_count(map);
+  Map_image_header header = map_image_header(key_layout, value_layout, count);
+
+  if (fwrite(&header, sizeof(header), 1, file) != 1)
+    return false;
+
+  uint64_t offset = sizeof(header);
+
+  if (!map_image_write_padding(file, &offset, header.keys_offset))
+    return false;
+
+  // The keys are followed by the values, each written by a scan of their own:
+
+  Map_image_writer writer = {.file = file, .size = key_layout.size, .keys = true, .succeeded = true};
+  map_scan(map, NULL, NULL, map_image_write_pair, &writer);
+  offset += count * header.key_size;
+
+  if (!writer.succeeded || !map_image_write_padding(file, &offset, header.values_offset))
+    return false;
+
+  writer.size = value_layout.size;
+  writer.keys = false;
+  map_scan(map, NULL, NULL, map_image_write_pair, &writer);
+  return writer.succeeded && fflush(file) == 0;
+}
+
+/// @brief Initializes an image over the memory holding it, checking that it is valid
+/// @return @c true on success, @c false if the image is not valid or holds keys or values of other layouts
+static bool map_image_init(Map_image* image, Layout key_layout, Layout value_layout, Comparator comparator) {
+  Map_image_header header;
+
+  if (image->size < sizeof(header))
+    return false;
+
+  memcpy(&header, image->data, sizeof(header));
+
+  if (
+    memcmp(header.magic, MAP_IMAGE_MAGIC, sizeof(header.magic)) != 0
+    || header.byte_order != MAP_IMAGE_BYTE_ORDER
+    || header.version != MAP_IMAGE_VERSION
+    || header.key_size != key_layout.size
+    || header.key_alignment != key_layout.alignment
+    || header.value_size != value_layout.size
+    || header.value_alignment != value_layout.alignment
+    || !map_image_is_alignment(header.key_alignment)
+    || !map_image_is_alignment(header.value_alignment)
+  )
+    return false;
+
+  // Bounding the count first, so that the offsets it determines do not overflow:
+
+  uint64_t pair_size = header.key_size + header.value_size;
+
+  if (pair_size != 0 && header.count > image->size / pair_size)
+    return false;
+
+  Map_image_header expected = map_image_header(key_layout, value_layout, (size_t)header.count);
+
+  if (
+    header.keys_offset != expected.keys_offset
+    || header.values_offset != expected.values_offset
+    || header.values_offset + header.count * header.value_size > image->size
+    || (uintptr_t)image->data % key_layout.alignment != 0
+    || (uintptr_t)image->data % value_layout.alignment != 0
+  )
+    return false;
+
+  image->count = (size_t)header.count;
+  image->keys = image->data + header.keys_offset;
+  image->values = image->data + header.values_offset;
+  image->key_size = key_layout.size;
+  image->value_size = value_layout.size;
+  image->comparator = comparator;
+  return true;
+}
+
+/// @brief Reads a whole file into memory allocated for an image
+/// @return @c true on success, @c false if the file could not be read or memory could not be allocated
+static bool map_image_read(Map_image* image, const char* path) {
+  FILE* file = fopen(path, "rb");
+
+  if (file == NULL)
+    return false;
+
+  char* data = NULL;
+  size_t size = 0;
+  size_t capacity = 0;
+
+  while (!feof(file)) {
+    if (size == capacity) {
+      capacity = capacity != 0 ? 2 * capacity : 4096;
+      char* grown = data != NULL ? allocator_reallocate(heap_allocator, data, capacity) : allocator_allocate(heap_allocator, capacity);
+
+      if (grown == NULL)
+        break;
+
+      data = grown;
+    }
+
+    size += fread(data + size, 1, capacity - size, file);
+
+    if (ferror(file))
+      break;
+  }
+
+  bool succeeded = feof(file) && !ferror(file);
+  fclose(file);
+
+  if (!succeeded) {
+    if (data != NULL)
+      allocator_free(heap_allocator, data);
+
+    return false;
+  }
+
+  image->data = data;
+  image->size = size;
+  image->storage = MAP_IMAGE_READ;
+  return true;
+}
+
+#ifdef MAP_IMAGE_MMAP
+/// @brief Maps a whole file into memory for an image
+/// @return @c true on success, @c false if the file could not be mapped
+static bool map_image_map(Map_image* image, const char* path) {
+  int descriptor = open(path, O_RDONLY);
+
+  if (descriptor == -1)
+    return false;
+
+  struct stat status;
+  void* data = MAP_FAILED;
+
+  if (fstat(descriptor, &status) == 0 && status.st_size > 0 && (uintmax_t)status.st_size <= SIZE_MAX)
+    data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+
+  close(descriptor);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  image->data = data;
+  image->size = (size_t)status.st_size;
+  image->storage = MAP_IMAGE_MAPPED;
+  return true;
+}
+#endif
+
+/// @brief Releases the memory holding an image, if owned by the image
+static void map_image_release(Map_image* image) {
+  switch (image->storage) {
+    case MAP_IMAGE_VIEWED:
+      break;
+
+    case MAP_IMAGE_MAPPED:
+#ifdef MAP_IMAGE_MMAP
+      munmap((void*)image->data, image->size);
+#endif
+      break;
+
+    case MAP_IMAGE_READ:
+      allocator_free(heap_allocator, (void*)image->data);
+      break;
+  }
+}
+
+Map_image* map_image_open(const char* path, Layout key_layout, Layout value_layout, Comparator comparator) {
+  Map_image* image = allocator_allocate(heap_allocator, sizeof(Map_image));
+
+  if (image == NULL)
+    return NULL;
+
+#ifdef MAP_IMAGE_MMAP
+  bool opened = map_image_map(image, path) || map_image_read(image, path);
+#else
+  bool opened = map_image_read(image, path);
+#endif
+
+  if (!opened) {
+    allocator_free(heap_allocator, image);
+    return NULL;
+  }
+
+  if (!map_image_init(image, key_layout, value_layout, comparator)) {
+    map_image_close(image);
+    return NULL;
+  }
+
+  return image;
+}
+
+Map_image* map_image_view(const void* data, size_t size, Layout key_layout, Layout value_layout, Comparator comparator) {
+  Map_image* image = allocator_allocate(heap_allocator, sizeof(Map_image));
+
+  if (image == NULL)
+    return NULL;
+
+  image->data = data;
+  image->size = size;
+  image->storage = MAP_IMAGE_VIEWED;
+
+  if (!map_image_init(image, key_layout, value_layout, comparator)) {
+    allocator_free(heap_allocator, image);
+    return NULL;
+  }
+
+  return image;
+}
+
+size_t map_image_count(const Map_image* image) {
+  return image->count;
+}
+
+const void* map_image_keys(const Map_image* image) {
+  return image->keys;
+}
+
+const void* map_image_values(const Map_image* image) {
+  return image->values;
+}
+
+/// @brief Returns the index of the least key greater than or equal to a given key, or the count if none
+static size_t map_image_lower_bound(const Map_image* image, const void* key) {
+  size_t low = 0;
+  size_t high = image->count;
+
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+
+    if (comparator_compare(image->comparator, image->keys + middle * image->key_size, key) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+const void* map_image_lookup(const Map_image* image, const void* key) {
+  size_t index = map_image_lower_bound(image, key);
+
+  if (index == image->count || comparator_compare(image->comparator, key, image->keys + index * image->key_size) != 0)
+    return NULL;
+
+  return image->values + index * image->value_size;
+}
+
+size_t map_image_scan(
+  const Map_image* image,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, const void* value, void* data),
+  void* data
+) {
+  size_t count = 0;
+
+  for (size_t index = low != NULL ? map_image_lower_bound(image, low) : 0; index < image->count; index += 1) {
+    const void* key = image->keys + index * image->key_size;
+
+    if (high != NULL && comparator_compare(image->comparator, key, high) >= 0)
+      break;
+
+    count += 1;
+
+    if (!visit(key, image->values + index * image->value_size, data))
+      break;
+  }
+
+  return count;
+}
+
+void map_image_close(Map_image* image) {
+  map_image_release(image);
+  allocator_free(heap_allocator, image);
+}
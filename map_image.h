@@ -0,0 +1,69 @@
+#ifndef MAP_IMAGE_H
+#define MAP_IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "comparator.h"
+#include "layout.h"
+#include "map.h"
+
+/// @brief Read-only ordered map stored as a binary image, looked up in place without deserializing
+/// @details An image holds a header describing the key and value layouts, followed by the array of keys in increasing
+/// order and by the array of their values, each aligned for its elements. Lookups binary search the keys where they
+/// lie, such as in a memory-mapped file. Images are written in the byte order of the writing machine, which readers
+/// check, and only suit keys and values which are trivially copyable and hold no pointers.
+typedef struct Map_image Map_image;
+
+/// @brief Writes the image of a map to a file, in linear time
+/// @param key_layout The layout of the keys the map was created with
+/// @param value_layout The layout of the values the map was created with
+/// @return @c true on success, @c false if the file could not be written
+/// @pre Alignments are powers of two no greater than 4096
+bool map_image_write(const Map* map, Layout key_layout, Layout value_layout, FILE* file);
+
+/// @brief Opens the image stored in a file, memory-mapping it where supported and reading it in memory otherwise
+/// @param key_layout The layout of the keys the image is expected to hold
+/// @param value_layout The layout of the values the image is expected to hold
+/// @param comparator The comparator the keys of the image are ordered by
+/// @return The opened image, or @c NULL if the file could not be read, is not a valid image, or holds keys or values
+/// of other layouts
+Map_image* map_image_open(const char* path, Layout key_layout, Layout value_layout, Comparator comparator);
+
+/// @brief Opens an image stored in memory, which must remain valid and unchanged until the image is closed
+/// @return The opened image, or @c NULL if memory could not be allocated, the image is not valid, or it holds keys or
+/// values of other layouts
+/// @pre @p data is aligned for keys and values
+Map_image* map_image_view(const void* data, size_t size, Layout key_layout, Layout value_layout, Comparator comparator);
+
+/// @brief Returns the number of key-value pairs stored by an image
+size_t map_image_count(const Map_image* image);
+
+/// @brief Returns the array of the keys stored by an image, in strictly increasing order
+/// @note Along with @c map_image_values, suited to @c map_from_sorted or @c map_build, rebuilding a map in linear time
+const void* map_image_keys(const Map_image* image);
+
+/// @brief Returns the array of the values stored by an image, in the order of their keys
+const void* map_image_values(const Map_image* image);
+
+/// @brief Finds the value associated to a given key, if any, in logarithmic time
+const void* map_image_lookup(const Map_image* image, const void* key);
+
+/// @brief Visits the key-value pairs whose keys lie in a half-open range, in key order
+/// @param low The inclusive lower bound of the range, or @c NULL if unbounded
+/// @param high The exclusive upper bound of the range, or @c NULL if unbounded
+/// @param visit The function called on each key-value pair along with @p data, returning @c false to stop the scan
+/// @return The number of visited key-value pairs
+size_t map_image_scan(
+  const Map_image* image,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, const void* value, void* data),
+  void* data
+);
+
+/// @brief Closes an image, unmapping or freeing the memory it was read into, if any
+void map_image_close(Map_image* image);
+
+#endif
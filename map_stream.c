@@ -0,0 +1,162 @@
+#include "map_stream.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/// @brief The magic number beginning streams
+#define MAP_STREAM_MAGIC "MAPSTRM1"
+
+/// @brief The version of the stream format
+#define MAP_STREAM_VERSION 1
+
+/// @brief The value whose bytes record the byte order of the machine which wrote a stream
+#define MAP_STREAM_BYTE_ORDER 0x01020304
+
+/// @brief Header of a stream, followed by the key-value pairs
+typedef struct Map_stream_header {
+  /// @brief @c MAP_STREAM_MAGIC, without its terminating null character
+  char magic[8];
+
+  /// @brief @c MAP_STREAM_BYTE_ORDER
+  uint32_t byte_order;
+
+  /// @brief @c MAP_STREAM_VERSION
+  uint32_t version;
+
+  uint64_t key_size;
+  uint64_t value_size;
+
+  /// @brief The number of key-value pairs
+  uint64_t count;
+} Map_stream_header;
+
+/// @brief The state of a scan writing key-value pairs to a stream
+typedef struct Map_stream_writer {
+  bool (*write)(void* data, const void* bytes, size_t size);
+  void* data;
+
+  size_t key_size;
+  size_t value_size;
+
+  /// @brief @c true once the stream could not be written
+  bool failed;
+} Map_stream_writer;
+
+/// @brief Writes a key-value pair to the stream of the writer passed as @p data
+/// @return @c true to continue the scan, @c false if the stream could not be written
+static bool map_stream_write_pair(const void* key, void* value, void* data) {
+  Map_stream_writer* writer = data;
+  writer->failed =
+    !writer->write(writer->data, key, writer->key_size) || !writer->write(writer->data, value, writer->value_size);
+
+  return !writer->failed;
+}
+
+bool map_dump(
+  const Map* map,
+  Layout key_layout,
+  Layout value_layout,
+  bool (*write)(void* data, const void* bytes, size_t size),
+  void* data
+) {
+  size_t count = map_count(map);
+
+  Map_stream_header header = {
+    .byte_order = MAP_STREAM_BYTE_ORDER,
+    .version = MAP_STREAM_VERSION,
+    .key_size = key_layout.size,
+    .value_size = value_layout.size,
+    .count = count,
+  };
+
+  memcpy(header.magic, MAP_STREAM_MAGIC, sizeof(header.magic));
+
+  if (!write(data, &header, sizeof(header)))
+    return false;
+
+  Map_stream_writer writer = {
+    .write = write,
+    .data = data,
+    .key_size = key_layout.size,
+    .value_size = value_layout.size,
+    .failed = false,
+  };
+
+  map_scan(map, NULL, NULL, map_stream_write_pair, &writer);
+  return !writer.failed;
+}
+
+/// @brief Writes bytes to the file passed as @p data
+static bool map_stream_write_file(void* data, const void* bytes, size_t size) {
+  return fwrite(bytes, 1, size, data) == size;
+}
+
+bool map_dump_file(const Map* map, Layout key_layout, Layout value_layout, FILE* file) {
+  return map_dump(map, key_layout, value_layout, map_stream_write_file, file) && fflush(file) == 0;
+}
+
+/// @brief The state of a build reading key-value pairs from a stream
+typedef struct Map_stream_reader {
+  size_t (*read)(void* data, void* bytes, size_t size);
+  void* data;
+
+  size_t key_size;
+  size_t value_size;
+} Map_stream_reader;
+
+/// @brief Reads an exact number of bytes from the stream of a reader, across as many reads as needed
+/// @return @c true on success, @c false if the stream ended or could not be read
+static bool map_stream_read_bytes(const Map_stream_reader* reader, void* bytes, size_t size) {
+  for (size_t read_size = 0; read_size < size;) {
+    size_t chunk_size = reader->read(reader->data, (char*)bytes + read_size, size - read_size);
+
+    if (chunk_size == 0)
+      return false;
+
+    read_size += chunk_size;
+  }
+
+  return true;
+}
+
+/// @brief Reads a key-value pair from the stream of the reader passed as @p data
+static bool map_stream_read_pair(void* data, void* key, void* value) {
+  const Map_stream_reader* reader = data;
+  return map_stream_read_bytes(reader, key, reader->key_size) && map_stream_read_bytes(reader, value, reader->value_size);
+}
+
+bool map_load(
+  Map* map,
+  Layout key_layout,
+  Layout value_layout,
+  size_t (*read)(void* data, void* bytes, size_t size),
+  void* data
+) {
+  Map_stream_reader reader = {.read = read, .data = data, .key_size = key_layout.size, .value_size = value_layout.size};
+  Map_stream_header header;
+  map_clear(map);
+
+  if (!map_stream_read_bytes(&reader, &header, sizeof(header)))
+    return false;
+
+  // The number of key-value pairs is bounded by the memory their nodes would take, so that a corrupted count fails to
+  // be read rather than to be built for:
+  size_t pair_size = key_layout.size + value_layout.size;
+  size_t max_count = SIZE_MAX / 4 / (pair_size != 0 ? pair_size : 1);
+
+  if (memcmp(header.magic, MAP_STREAM_MAGIC, sizeof(header.magic)) != 0 ||
+      header.byte_order != MAP_STREAM_BYTE_ORDER || header.version != MAP_STREAM_VERSION ||
+      header.key_size != key_layout.size || header.value_size != value_layout.size || header.count > max_count)
+    return false;
+
+  return map_build_from(map, (size_t)header.count, map_stream_read_pair, &reader);
+}
+
+/// @brief Reads up to a number of bytes from the file passed as @p data
+static size_t map_stream_read_file(void* data, void* bytes, size_t size) {
+  return fread(bytes, 1, size, data);
+}
+
+bool map_load_file(Map* map, Layout key_layout, Layout value_layout, FILE* file) {
+  return map_load(map, key_layout, value_layout, map_stream_read_file, file);
+}
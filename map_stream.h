@@ -0,0 +1,59 @@
+#ifndef MAP_STREAM_H
+#define MAP_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "layout.h"
+#include "map.h"
+
+/// @brief Streams of the key-value pairs of maps, written and read sequentially in key order
+/// @details A stream holds a header describing the key and value layouts and the number of key-value pairs, followed
+/// by each key immediately followed by its value, in increasing key order. Unlike images, streams may be written to
+/// and read from pipes or sockets: a map is rebuilt from a stream as it is read, in linear time, without holding the
+/// whole stream in memory. Streams are written in the byte order of the writing machine, which readers check, and
+/// only suit keys and values which are trivially copyable and hold no pointers.
+
+/// @brief Writes the key-value pairs of a map to a stream through a function, in key order and in linear time
+/// @param key_layout The layout of the keys the map was created with
+/// @param value_layout The layout of the values the map was created with
+/// @param write The function called along with @p data to write bytes to the stream, returning @c false if it could
+/// not write them all
+/// @return @c true on success, @c false if @p write failed
+bool map_dump(
+  const Map* map,
+  Layout key_layout,
+  Layout value_layout,
+  bool (*write)(void* data, const void* bytes, size_t size),
+  void* data
+);
+
+/// @brief Writes the key-value pairs of a map to a stream held by a file, in key order and in linear time
+/// @return @c true on success, @c false if the file could not be written
+bool map_dump_file(const Map* map, Layout key_layout, Layout value_layout, FILE* file);
+
+/// @brief Replaces the key-value pairs of a map with those read from a stream through a function, in linear time
+/// @param key_layout The layout of the keys the map was created with
+/// @param value_layout The layout of the values the map was created with
+/// @param read The function called along with @p data to read up to a number of bytes from the stream, returning the
+/// number of bytes read, or @c 0 at the end of the stream or if it could not be read
+/// @return @c true on success, @c false if memory could not be allocated, the stream could not be read, is not a
+/// valid stream, holds keys or values of other layouts, or keys not in strictly increasing order, in which case the map
+/// is left empty
+/// @note Bytes are read up to the end of the stream exactly, so that further data may follow it
+bool map_load(
+  Map* map,
+  Layout key_layout,
+  Layout value_layout,
+  size_t (*read)(void* data, void* bytes, size_t size),
+  void* data
+);
+
+/// @brief Replaces the key-value pairs of a map with those read from a stream held by a file, in linear time
+/// @return @c true on success, @c false if memory could not be allocated, the file could not be read, is not a valid
+/// stream, holds keys or values of other layouts, or keys not in strictly increasing order, in which case the map is
+/// left empty
+bool map_load_file(Map* map, Layout key_layout, Layout value_layout, FILE* file);
+
+#endif
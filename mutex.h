@@ -0,0 +1,76 @@
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include <stdbool.h>
+
+/// @file
+/// @brief Internal mutex and yielding primitives over the threads of the platform, since C11 threads are missing
+/// from some C libraries
+
+#ifdef _WIN32
+#include <windows.h>
+
+/// @brief Non-recursive mutex
+typedef SRWLOCK Mutex;
+
+/// @brief Initializes a mutex
+/// @return @c true on success, @c false if resources could not be allocated
+static inline bool mutex_init(Mutex* mutex) {
+  InitializeSRWLock(mutex);
+  return true;
+}
+
+/// @brief Locks a mutex, waiting for it to be unlocked
+static inline void mutex_lock(Mutex* mutex) {
+  AcquireSRWLockExclusive(mutex);
+}
+
+/// @brief Unlocks a mutex locked by the calling thread
+static inline void mutex_unlock(Mutex* mutex) {
+  ReleaseSRWLockExclusive(mutex);
+}
+
+/// @brief Releases the resources of an unlocked mutex
+static inline void mutex_destroy(Mutex* mutex) {
+  (void)mutex;
+}
+
+/// @brief Lets other threads run before the calling thread resumes
+static inline void thread_yield(void) {
+  SwitchToThread();
+}
+#else
+#include <pthread.h>
+#include <sched.h>
+
+/// @brief Non-recursive mutex
+typedef pthread_mutex_t Mutex;
+
+/// @brief Initializes a mutex
+/// @return @c true on success, @c false if resources could not be allocated
+static inline bool mutex_init(Mutex* mutex) {
+  return pthread_mutex_init(mutex, NULL) == 0;
+}
+
+/// @brief Locks a mutex, waiting for it to be unlocked
+static inline void mutex_lock(Mutex* mutex) {
+  pthread_mutex_lock(mutex);
+}
+
+/// @brief Unlocks a mutex locked by the calling thread
+static inline void mutex_unlock(Mutex* mutex) {
+  pthread_mutex_unlock(mutex);
+}
+
+/// @brief Releases the resources of an unlocked mutex
+static inline void mutex_destroy(Mutex* mutex) {
+  pthread_mutex_destroy(mutex);
+}
+
+/// @brief Lets other threads run before the calling thread resumes
+static inline void thread_yield(void) {
+  sched_yield();
+}
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+#include "persistent_map.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "cow_tree.h"
+
+struct Persistent_map {
+  /// @brief The red-black tree internal to the map, whose nodes only it references are modified in place
+  Cow_tree tree;
+
+  /// @brief The number of key-value pairs stored by the map
+  size_t count;
+
+  /// @brief The spare nodes, linked through their left child, from which updates take the nodes they allocate
+  Cow_node* spares;
+
+  /// @brief The number of spare nodes
+  size_t spare_count;
+
+  /// @brief The allocator
+  Allocator allocator;
+};
+
+/// @brief Adds a reference to a node, if any
+static inline void persistent_map_retain(Cow_node* node) {
+  if (node != NULL)
+    atomic_fetch_add_explicit(&node->references, 1, memory_order_relaxed);
+}
+
+/// @brief Drops a reference to a node, if any, freeing it along with the nodes only it referenced once unreferenced
+static void persistent_map_release(Persistent_map* map, Cow_node* node) {
+  while (node != NULL) {
+    if (atomic_fetch_sub_explicit(&node->references, 1, memory_order_release) != 1)
+      return;
+
+    // Synchronizes with the releases by other threads, so that their reads of the node happen before it is freed:
+    atomic_thread_fence(memory_order_acquire);
+
+    persistent_map_release(map, node->children[LEFT]);
+    Cow_node* right = node->children[RIGHT];
+    allocator_free(map->allocator, node);
+    node = right;
+  }
+}
+
+/// @brief Determines if a node is only referenced by a map, through its parent, hence may be modified in place
+static inline bool persistent_map_is_exclusive(const Cow_node* node) {
+  return atomic_load_explicit(&((Cow_node*)node)->references, memory_order_acquire) == 1;
+}
+
+/// @brief Grows the spare nodes, if needed, to a given number, as a @c Cow_ownership
+/// @return @c true on success, @c false if memory could not be allocated
+static bool persistent_map_reserve(void* owner, size_t count) {
+  Persistent_map* map = owner;
+
+  while (map->spare_count < count) {
+    Cow_node* node = allocator_allocate(map->allocator, map->tree.node_size);
+
+    if (node == NULL)
+      return false;
+
+    node->children[LEFT] = map->spares;
+    map->spares = node;
+    map->spare_count += 1;
+  }
+
+  return true;
+}
+
+/// @brief Takes a spare node, referenced once by the caller, as a @c Cow_ownership
+/// @pre `map->spare_count != 0`
+static Cow_node* persistent_map_allocate(void* owner) {
+  Persistent_map* map = owner;
+  assert(map->spare_count != 0);
+  Cow_node* node = map->spares;
+  map->spares = node->children[LEFT];
+  map->spare_count -= 1;
+  atomic_init(&node->references, 1);
+  return node;
+}
+
+/// @brief Gets a node the map may modify in place, copying a shared node in place of which the copy is to be linked,
+/// as a @c Cow_ownership
+/// @return The modifiable node
+/// @pre The caller holds the reference to the node it replaces, and there are enough spare nodes
+static Cow_node* persistent_map_own(void* owner, Cow_node* node) {
+  Persistent_map* map = owner;
+
+  if (persistent_map_is_exclusive(node))
+    return node;
+
+  Cow_node* copy = persistent_map_allocate(map);
+  copy->children[LEFT] = node->children[LEFT];
+  copy->children[RIGHT] = node->children[RIGHT];
+  copy->color = node->color;
+  memcpy(copy->data, node->data, map->tree.node_size - offsetof(Cow_node, data));
+  persistent_map_retain(copy->children[LEFT]);
+  persistent_map_retain(copy->children[RIGHT]);
+  persistent_map_release(map, node);
+  return copy;
+}
+
+/// @brief Drops the reference to a node no longer in the tree, whose references to its children the caller takes
+/// over, as a @c Cow_ownership
+static void persistent_map_unlink(void* owner, Cow_node* node) {
+  Persistent_map* map = owner;
+
+  if (persistent_map_is_exclusive(node)) {
+    allocator_free(map->allocator, node);
+  } else {
+    persistent_map_retain(node->children[LEFT]);
+    persistent_map_retain(node->children[RIGHT]);
+    persistent_map_release(map, node);
+  }
+}
+
+/// @brief Checks that a node is referenced, as a @c Cow_ownership
+static void persistent_map_check_references(const void* owner, const Cow_node* node) {
+  assert(atomic_load_explicit(&((Cow_node*)node)->references, memory_order_relaxed) != 0);
+  (void)owner;
+  (void)node;
+}
+
+/// @brief The ownership of the trees of persistent maps, whose nodes may be modified in place once only referenced by
+/// their parent, and which reserve as spare nodes all those an update may allocate before modifying the tree
+static const Cow_ownership persistent_ownership = {
+  .reserve = persistent_map_reserve,
+  .allocate = persistent_map_allocate,
+  .own = persistent_map_own,
+  .unlink = persistent_map_unlink,
+  .check = persistent_map_check_references,
+};
+
+Persistent_map* persistent_map_new(Layout key_layout, Layout value_layout, Comparator comparator) {
+  return persistent_map_new_with(key_layout, value_layout, comparator, heap_allocator);
+}
+
+Persistent_map* persistent_map_new_with(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator) {
+  Persistent_map* map = allocator_allocate(allocator, sizeof(Persistent_map));
+
+  if (map != NULL) {
+    cow_tree_init(&map->tree, key_layout, value_layout, comparator);
+    map->count = 0;
+    map->spares = NULL;
+    map->spare_count = 0;
+    map->allocator = allocator;
+  }
+
+  return map;
+}
+
+void persistent_map_check(const Persistent_map* map) {
+  assert(cow_tree_check(&map->tree, map->tree.root, &persistent_ownership, map) == map->count);
+  (void)map;
+}
+
+size_t persistent_map_count(const Persistent_map* map) {
+  return map->count;
+}
+
+const void* persistent_map_lookup(const Persistent_map* map, const void* key) {
+  const Cow_node* node = cow_tree_lookup(&map->tree, map->tree.root, key);
+  return node != NULL ? cow_tree_value(&map->tree, node) : NULL;
+}
+
+size_t persistent_map_scan(
+  const Persistent_map* map,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, const void* value, void* data),
+  void* data
+) {
+  return cow_tree_scan(&map->tree, map->tree.root, low, high, visit, data);
+}
+
+bool persistent_map_insert(Persistent_map* map, const void* key, const void* value) {
+  // Spare nodes are reserved before the tree is modified, so that the insertion cannot fail halfway:
+  return cow_tree_insert(&map->tree, &persistent_ownership, map, key, value, &map->count);
+}
+
+bool persistent_map_remove(Persistent_map* map, const void* key) {
+  // Spare nodes are reserved before the tree is modified, so that the removal cannot fail halfway:
+  return cow_tree_remove(&map->tree, &persistent_ownership, map, key, &map->count);
+}
+
+Persistent_map* persistent_map_snapshot(const Persistent_map* map) {
+  Persistent_map* snapshot = allocator_allocate(map->allocator, sizeof(Persistent_map));
+
+  if (snapshot != NULL) {
+    *snapshot = *map;
+    snapshot->spares = NULL;
+    snapshot->spare_count = 0;
+    persistent_map_retain(map->tree.root);
+  }
+
+  return snapshot;
+}
+
+void persistent_map_clear(Persistent_map* map) {
+  persistent_map_release(map, map->tree.root);
+  map->tree.root = NULL;
+  map->count = 0;
+}
+
+void persistent_map_destroy(Persistent_map* map) {
+  persistent_map_release(map, map->tree.root);
+
+  while (map->spares != NULL) {
+    Cow_node* next = map->spares->children[LEFT];
+    allocator_free(map->allocator, map->spares);
+    map->spares = next;
+  }
+
+  allocator_free(map->allocator, map);
+}
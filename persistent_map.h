@@ -0,0 +1,73 @@
+#ifndef PERSISTENT_MAP_H
+#define PERSISTENT_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "allocator.h"
+#include "comparator.h"
+#include "layout.h"
+
+/// @brief Abstract ordered map data type, associating keys to values, whose snapshots share their nodes
+/// @details Nodes are reference counted, and shared between a map and its snapshots. Insertions and removals modify
+/// the nodes only referenced once in place, and copy the shared nodes they touch, which lie along the path from the
+/// root, so that snapshots are taken in constant time and diverge by a logarithmic number of nodes per update. Each
+/// map keeps a few spare nodes, so that updates allocate all they may need before modifying anything.
+/// A map and its snapshots may be used by different threads, provided that each of them is used by one thread at a
+/// time, and that the allocator may be called concurrently.
+typedef struct Persistent_map Persistent_map;
+
+/// @brief Allocates an empty map
+/// @returns The new map, or @c NULL if memory could not be allocated
+Persistent_map* persistent_map_new(Layout key_layout, Layout value_layout, Comparator comparator);
+
+/// @brief Allocates an empty map
+/// @param allocator The allocator of the map, of its nodes, and of its snapshots
+/// @returns The new map, or @c NULL if memory could not be allocated
+Persistent_map* persistent_map_new_with(Layout key_layout, Layout value_layout, Comparator comparator, Allocator allocator);
+
+/// @brief Verifies that a map is valid: that is, that no internal invariants are violated
+void persistent_map_check(const Persistent_map* map);
+
+/// @brief Returns the number of key-value pairs stored by a map
+size_t persistent_map_count(const Persistent_map* map);
+
+/// @brief Finds the value associated to a given key, if any
+/// @return The value, pointed to until the next insertion into or removal from the map, or @c NULL if not found
+/// @note The value may be shared with snapshots, hence cannot be modified in place
+const void* persistent_map_lookup(const Persistent_map* map, const void* key);
+
+/// @brief Visits the key-value pairs whose keys lie in a half-open range, in key order
+/// @param low The inclusive lower bound of the range, or @c NULL if unbounded
+/// @param high The exclusive upper bound of the range, or @c NULL if unbounded
+/// @param visit The function called on each key-value pair along with @p data, returning @c false to stop the scan
+/// @return The number of visited key-value pairs
+size_t persistent_map_scan(
+  const Persistent_map* map,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, const void* value, void* data),
+  void* data
+);
+
+/// @brief Associates a key to a value
+/// @return @c true on success, @c false if memory could not be allocated, in which case the map is left unchanged
+bool persistent_map_insert(Persistent_map* map, const void* key, const void* value);
+
+/// @brief Removes the value associated to a key, if any
+/// @return @c true if an association to the key existed prior to removal, @c false otherwise or if memory could not be
+/// allocated, in which case the map is left unchanged
+bool persistent_map_remove(Persistent_map* map, const void* key);
+
+/// @brief Takes a snapshot of a map in constant time, sharing all of its nodes
+/// @details The snapshot is a map of its own, unaffected by later updates of the map, and conversely.
+/// @return The snapshot, or @c NULL if memory could not be allocated
+Persistent_map* persistent_map_snapshot(const Persistent_map* map);
+
+/// @brief Clears a map, removing all key-value associations
+void persistent_map_clear(Persistent_map* map);
+
+/// @brief Clears and deallocates a map
+void persistent_map_destroy(Persistent_map* map);
+
+#endif
@@ -0,0 +1,347 @@
+#include "sharded_map.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "mutex.h"
+
+/// @brief A shard, holding the keys of a hash bucket or of a range along with its lock
+typedef struct Shard {
+  /// @brief The lock guarding the map
+  Mutex lock;
+
+  /// @brief The map holding the key-value pairs of the shard
+  Map* map;
+} Shard;
+
+struct Sharded_map {
+  /// @brief The shards, allocated apart so that readers lock them through a map they do not modify
+  Shard* shards;
+
+  /// @brief The number of shards
+  size_t shard_count;
+
+  /// @brief The partition of keys, whose bounds are copied into memory owned by the map
+  Sharded_map_partition partition;
+
+  /// @brief The size of keys
+  size_t key_size;
+
+  /// @brief The size of values
+  size_t value_size;
+
+  /// @brief The key comparator
+  Comparator comparator;
+};
+
+/// @brief Gets the pointer to a bound separating the ranges of consecutive shards
+static inline const void* sharded_map_bound(const Sharded_map* map, size_t index) {
+  return (const char*)map->partition.bounds + index * map->key_size;
+}
+
+/// @brief Returns the index of the shard holding a key
+static size_t sharded_map_shard_index(const Sharded_map* map, const void* key) {
+  if (map->partition.hash != NULL)
+    return map->partition.hash(map->partition.data, key) % map->shard_count;
+
+  // The number of bounds lesser than or equal to the key:
+
+  size_t low = 0;
+  size_t high = map->shard_count - 1;
+
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+
+    if (comparator_compare(map->comparator, key, sharded_map_bound(map, middle)) < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  return low;
+}
+
+/// @brief Gets the shard holding a key
+static inline Shard* sharded_map_shard(const Sharded_map* map, const void* key) {
+  return &map->shards[sharded_map_shard_index(map, key)];
+}
+
+/// @brief Determines if a key lies below the exclusive upper bound of a range
+static inline bool sharded_map_is_below(const Sharded_map* map, const void* key, const void* high) {
+  return high == NULL || comparator_compare(map->comparator, key, high) < 0;
+}
+
+Sharded_map* sharded_map_new(
+  Layout key_layout,
+  Layout value_layout,
+  Comparator comparator,
+  size_t shard_count,
+  Sharded_map_partition partition,
+  Map_options options
+) {
+  assert(shard_count != 0 && shard_count <= SHARDED_MAP_MAX_SHARDS);
+  assert(partition.hash == NULL || !options.b_tree);
+  Sharded_map* map = allocator_allocate(heap_allocator, sizeof(Sharded_map));
+
+  if (map == NULL)
+    return NULL;
+
+  map->shard_count = 0;
+  map->partition = partition;
+  map->key_size = key_layout.size;
+  map->value_size = value_layout.size;
+  map->comparator = comparator;
+  map->shards = allocator_allocate(heap_allocator, shard_count * sizeof(Shard));
+  void* bounds = NULL;
+
+  if (map->shards == NULL)
+    goto failure;
+
+  if (partition.hash == NULL && shard_count > 1) {
+    bounds = allocator_allocate(heap_allocator, (shard_count - 1) * key_layout.size);
+
+    if (bounds == NULL)
+      goto failure;
+
+    memcpy(bounds, partition.bounds, (shard_count - 1) * key_layout.size);
+    map->partition.bounds = bounds;
+
+    for (size_t i = 1; i + 1 < shard_count; i += 1)
+      assert(comparator_compare(comparator, sharded_map_bound(map, i - 1), sharded_map_bound(map, i)) < 0);
+  }
+
+  for (; map->shard_count < shard_count; map->shard_count += 1) {
+    Shard* shard = &map->shards[map->shard_count];
+    shard->map = map_new_with_options(key_layout, value_layout, comparator, heap_allocator, options);
+
+    if (shard->map == NULL)
+      goto failure;
+
+    if (!mutex_init(&shard->lock)) {
+      map_destroy(shard->map);
+      goto failure;
+    }
+  }
+
+  return map;
+
+failure:
+  if (map->shards != NULL) {
+    for (size_t i = 0; i < map->shard_count; i += 1) {
+      mutex_destroy(&map->shards[i].lock);
+      map_destroy(map->shards[i].map);
+    }
+
+    allocator_free(heap_allocator, map->shards);
+  }
+
+  if (bounds != NULL)
+    allocator_free(heap_allocator, bounds);
+
+  allocator_free(heap_allocator, map);
+  return NULL;
+}
+
+/// @brief A shard of a sharded map whose keys are verified to belong to it
+typedef struct Sharded_map_checked_shard {
+  const Sharded_map* map;
+  size_t index;
+} Sharded_map_checked_shard;
+
+/// @brief Verifies that the key of a key-value pair belongs to the shard checked along @p data
+static bool sharded_map_check_key(const void* key, void* value, void* data) {
+  const Sharded_map_checked_shard* checked_shard = data;
+  assert(sharded_map_shard_index(checked_shard->map, key) == checked_shard->index);
+  (void)key;
+  (void)value;
+  (void)checked_shard;
+  return true;
+}
+
+void sharded_map_check(const Sharded_map* map) {
+  for (size_t i = 0; i < map->shard_count; i += 1) {
+    Shard* shard = &map->shards[i];
+    mutex_lock(&shard->lock);
+    map_check(shard->map);
+    Sharded_map_checked_shard checked_shard = {.map = map, .index = i};
+    map_scan(shard->map, NULL, NULL, sharded_map_check_key, &checked_shard);
+    mutex_unlock(&shard->lock);
+  }
+}
+
+size_t sharded_map_shard_count(const Sharded_map* map) {
+  return map->shard_count;
+}
+
+size_t sharded_map_count(const Sharded_map* map) {
+  size_t count = 0;
+
+  for (size_t i = 0; i < map->shard_count; i += 1) {
+    Shard* shard = &map->shards[i];
+    mutex_lock(&shard->lock);
+    count += map_count(shard->map);
+    mutex_unlock(&shard->lock);
+  }
+
+  return count;
+}
+
+bool sharded_map_lookup(const Sharded_map* map, const void* key, void* value) {
+  Shard* shard = sharded_map_shard(map, key);
+  mutex_lock(&shard->lock);
+  const void* found = map_lookup(shard->map, key);
+
+  if (found != NULL && value != NULL)
+    memcpy(value, found, map->value_size);
+
+  mutex_unlock(&shard->lock);
+  return found != NULL;
+}
+
+bool sharded_map_insert(Sharded_map* map, const void* key, const void* value) {
+  Shard* shard = sharded_map_shard(map, key);
+  mutex_lock(&shard->lock);
+  bool inserted = map_insert(shard->map, key, value);
+  mutex_unlock(&shard->lock);
+  return inserted;
+}
+
+bool sharded_map_remove(Sharded_map* map, const void* key) {
+  Shard* shard = sharded_map_shard(map, key);
+  mutex_lock(&shard->lock);
+  bool removed = map_remove(shard->map, key);
+  mutex_unlock(&shard->lock);
+  return removed;
+}
+
+/// @brief A scan of the shards of a sharded map, forwarding key-value pairs to the visit of the scan
+typedef struct Sharded_map_visit {
+  bool (*visit)(const void* key, void* value, void* data);
+  void* data;
+
+  /// @brief @c true once the visit stopped the scan
+  bool stopped;
+} Sharded_map_visit;
+
+/// @brief Forwards a key-value pair of a shard to the visit of a scan, recording whether it stops the scan
+static bool sharded_map_visit(const void* key, void* value, void* data) {
+  Sharded_map_visit* shard_visit = data;
+  shard_visit->stopped = !shard_visit->visit(key, value, shard_visit->data);
+  return !shard_visit->stopped;
+}
+
+/// @brief Restores the order of a heap of shard cursors, whose root holds the least key, after the key of one of its
+/// nodes grew
+/// @param shards The indices of the shards in the heap
+/// @param cursors The cursors of all shards, as values of their maps
+/// @param index The index of the node in the heap
+static void sharded_map_sift_down(
+  const Sharded_map* map,
+  unsigned short* shards,
+  size_t shard_count,
+  void* const* cursors,
+  size_t index
+) {
+  while (true) {
+    size_t least = index;
+
+    for (size_t child = 2 * index + 1; child <= 2 * index + 2 && child < shard_count; child += 1) {
+      const void* child_key = map_key(map->shards[shards[child]].map, cursors[shards[child]]);
+      const void* least_key = map_key(map->shards[shards[least]].map, cursors[shards[least]]);
+
+      if (comparator_compare(map->comparator, child_key, least_key) < 0)
+        least = child;
+    }
+
+    if (least == index)
+      return;
+
+    unsigned short shard = shards[index];
+    shards[index] = shards[least];
+    shards[least] = shard;
+    index = least;
+  }
+}
+
+size_t sharded_map_scan(
+  const Sharded_map* map,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, void* value, void* data),
+  void* data
+) {
+  if (low != NULL && high != NULL && comparator_compare(map->comparator, low, high) >= 0)
+    return 0;
+
+  // Locking the shards in ascending order, as every scan does, so that scans do not deadlock:
+
+  bool by_range = map->partition.hash == NULL;
+  size_t first = by_range && low != NULL ? sharded_map_shard_index(map, low) : 0;
+  size_t last = by_range && high != NULL ? sharded_map_shard_index(map, high) : map->shard_count - 1;
+  size_t count = 0;
+
+  for (size_t i = first; i <= last; i += 1)
+    mutex_lock(&map->shards[i].lock);
+
+  if (by_range) {
+    // The ranges of the shards follow one another:
+
+    Sharded_map_visit shard_visit = {.visit = visit, .data = data, .stopped = false};
+
+    for (size_t i = first; i <= last && !shard_visit.stopped; i += 1)
+      count += map_scan(map->shards[i].map, low, high, sharded_map_visit, &shard_visit);
+  } else {
+    // The shards are merged through a heap of cursors, whose root holds the least key:
+
+    void* cursors[SHARDED_MAP_MAX_SHARDS];
+    unsigned short shards[SHARDED_MAP_MAX_SHARDS];
+    size_t shard_count = 0;
+
+    for (size_t i = 0; i < map->shard_count; i += 1) {
+      const Map* shard_map = map->shards[i].map;
+      cursors[i] = low != NULL ? map_lower_bound(shard_map, low) : map_first(shard_map);
+
+      if (cursors[i] != NULL && sharded_map_is_below(map, map_key(shard_map, cursors[i]), high))
+        shards[shard_count++] = (unsigned short)i;
+    }
+
+    for (size_t i = shard_count / 2; i-- != 0;)
+      sharded_map_sift_down(map, shards, shard_count, cursors, i);
+
+    while (shard_count != 0) {
+      size_t i = shards[0];
+      const Map* shard_map = map->shards[i].map;
+      count += 1;
+
+      if (!visit(map_key(shard_map, cursors[i]), cursors[i], data))
+        break;
+
+      cursors[i] = map_next(shard_map, cursors[i]);
+
+      if (cursors[i] == NULL || !sharded_map_is_below(map, map_key(shard_map, cursors[i]), high))
+        shards[0] = shards[--shard_count];
+
+      sharded_map_sift_down(map, shards, shard_count, cursors, 0);
+    }
+  }
+
+  for (size_t i = first; i <= last; i += 1)
+    mutex_unlock(&map->shards[i].lock);
+
+  return count;
+}
+
+void sharded_map_destroy(Sharded_map* map) {
+  for (size_t i = 0; i < map->shard_count; i += 1) {
+    mutex_destroy(&map->shards[i].lock);
+    map_destroy(map->shards[i].map);
+  }
+
+  allocator_free(heap_allocator, map->shards);
+
+  if (map->partition.hash == NULL && map->shard_count > 1)
+    allocator_free(heap_allocator, (void*)map->partition.bounds);
+
+  allocator_free(heap_allocator, map);
+}
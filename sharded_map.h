@@ -0,0 +1,90 @@
+#ifndef SHARDED_MAP_H
+#define SHARDED_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "comparator.h"
+#include "layout.h"
+#include "map.h"
+
+/// @brief The maximum number of shards of a sharded map
+#define SHARDED_MAP_MAX_SHARDS 256
+
+/// @brief Abstract ordered map data type, partitioning its keys among independently locked maps, its shards, so that
+/// writers of different shards run concurrently
+/// @details Keys are partitioned either by hash, spreading writers evenly among shards, or by range, so that scans of a
+/// range only lock the shards it overlaps. Scans of maps partitioned by hash merge the shards in key order.
+typedef struct Sharded_map Sharded_map;
+
+/// @brief Partition of keys among the shards of a sharded map
+typedef struct Sharded_map_partition {
+  /// @brief The hash of keys, from which their shard is taken, or @c NULL to partition keys by range
+  size_t (*hash)(void* data, const void* key);
+
+  /// @brief The data passed along to @c hash
+  void* data;
+
+  /// @brief If @c hash is @c NULL, the array of the keys separating the ranges of consecutive shards, in ascending
+  /// order: the shard following a bound holds the keys from the bound up to the next bound, excluded
+  const void* bounds;
+} Sharded_map_partition;
+
+/// @brief Allocates an empty sharded map
+/// @param shard_count The number of shards, such as the number of writer threads or more, which is one more than the
+/// number of bounds if keys are partitioned by range
+/// @param options The options of the map of each shard: a nonzero @c pool_chunk_size draws the nodes of each shard
+/// from a pool of its own
+/// @returns The new map, or @c NULL if memory or locks could not be allocated
+/// @pre `1 <= shard_count && shard_count <= SHARDED_MAP_MAX_SHARDS`, and @c options.b_tree is @c false if keys are
+/// partitioned by hash
+Sharded_map* sharded_map_new(
+  Layout key_layout,
+  Layout value_layout,
+  Comparator comparator,
+  size_t shard_count,
+  Sharded_map_partition partition,
+  Map_options options
+);
+
+/// @brief Verifies that a sharded map is valid: that is, that no internal invariants are violated
+void sharded_map_check(const Sharded_map* map);
+
+/// @brief Returns the number of shards of a sharded map
+size_t sharded_map_shard_count(const Sharded_map* map);
+
+/// @brief Returns the number of key-value pairs stored by a sharded map, summing those of the shards in turn
+size_t sharded_map_count(const Sharded_map* map);
+
+/// @brief Finds the value associated to a given key, if any, locking its shard
+/// @param[out] value The memory the value is copied into if found, or @c NULL
+/// @return @c true if the key was found, @c false otherwise
+bool sharded_map_lookup(const Sharded_map* map, const void* key, void* value);
+
+/// @brief Associates a key to a value, locking its shard
+/// @return @c true on success, @c false if memory could not be allocated
+bool sharded_map_insert(Sharded_map* map, const void* key, const void* value);
+
+/// @brief Removes the value associated to a key, if any, locking its shard
+/// @return @c true if an association to the key existed prior to removal, @c false otherwise
+bool sharded_map_remove(Sharded_map* map, const void* key);
+
+/// @brief Visits the key-value pairs whose keys lie in a half-open range, in key order, locking the shards which may
+/// hold such keys for the duration of the scan
+/// @param low The inclusive lower bound of the range, or @c NULL if unbounded
+/// @param high The exclusive upper bound of the range, or @c NULL if unbounded
+/// @param visit The function called on each key-value pair along with @p data, returning @c false to stop the scan.
+/// It must not use the sharded map.
+/// @return The number of visited key-value pairs
+size_t sharded_map_scan(
+  const Sharded_map* map,
+  const void* low,
+  const void* high,
+  bool (*visit)(const void* key, void* value, void* data),
+  void* data
+);
+
+/// @brief Clears and deallocates a sharded map
+void sharded_map_destroy(Sharded_map* map);
+
+#endif
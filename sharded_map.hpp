@@ -0,0 +1,338 @@
+#ifndef SHARDED_MAP_HPP
+#define SHARDED_MAP_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "allocator.hpp"
+#include "map.hpp"
+
+namespace cpp {
+  /// @brief Ordered map data type, partitioning its keys among independently locked maps, its shards, so that writers of
+  /// different shards run concurrently
+  /// @details Keys are partitioned either by hash, spreading writers evenly among shards, or by range, so that ordered
+  /// scans of a range only lock the shards it overlaps. Each shard draws its nodes from pools of its own. Ordered views
+  /// merge the iterators of the shards they lock.
+  /// @tparam Key The type of keys
+  /// @tparam Value The type of values
+  /// @tparam Less The type of the key comparator
+  /// @tparam Hash The type of the key hash, used if keys are partitioned by hash
+  template <typename Key, typename Value, typename Less = std::less<Key>, typename Hash = std::hash<Key>>
+  class Sharded_map {
+  public:
+    /// @brief The type of the map held by each shard
+    using Shard_map = Map<Key, Value, Less, Pool_allocator<std::pair<const Key, Value>>>;
+
+  private:
+    /// @brief The assumed size of cache lines, on which shards are aligned so that their locks do not contend
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    /// @brief A shard, holding the keys of a hash bucket or of a range along with its lock
+    struct alignas(CACHE_LINE_SIZE) Shard {
+      /// @brief The lock guarding the map
+      mutable std::mutex mutex;
+
+      /// @brief The map holding the key-value pairs of the shard
+      Shard_map map;
+
+      Shard(const Less& less, std::size_t chunk_size) : map(less, Pool_allocator<std::pair<const Key, Value>>(chunk_size)) {}
+    };
+
+    /// @brief The shards, with stable addresses
+    std::deque<Shard> _shards;
+
+    /// @brief If keys are partitioned by range, the keys separating the ranges of consecutive shards, in ascending order
+    std::vector<Key> _bounds;
+
+    /// @brief @c true if keys are partitioned by range, @c false if by hash
+    bool _by_range;
+
+    /// @brief The key hash
+    Hash _hash;
+
+    /// @brief The key comparator
+    Less _less;
+
+    /// @brief Returns the index of the shard holding a key
+    std::size_t shard_index(const Key& key) const {
+      if (this->_by_range)
+        return std::upper_bound(this->_bounds.begin(), this->_bounds.end(), key, this->_less) - this->_bounds.begin();
+
+      return this->_hash(key) % this->_shards.size();
+    }
+
+  public:
+    /// @brief Read-only view of the key-value pairs of some shards, in key order, holding their locks while alive
+    /// @details Writers of the viewed shards wait for the view to be destroyed, so that its iterators remain valid.
+    class Ordered_view {
+      friend class Sharded_map;
+
+      /// @brief The iterators of a shard, to the next key-value pair to merge and past its last one
+      using Cursor = std::pair<typename Shard_map::const_iterator, typename Shard_map::const_iterator>;
+
+      /// @brief The locks of the viewed shards, taken in the order of the shards
+      std::vector<std::unique_lock<std::mutex>> _locks;
+
+      /// @brief The cursors of the viewed shards which are not past the end of their range
+      std::vector<Cursor> _cursors;
+
+      /// @brief The key comparator
+      Less _less;
+
+      Ordered_view(const Less& less) : _less(less) {}
+
+    public:
+      /// @brief Forward iterator merging the ranges of the viewed shards, in key order
+      /// @details Dereferencing yields a pair of references to the key and the value.
+      class iterator {
+        friend class Ordered_view;
+
+        /// @brief The cursors not past the end, kept as a heap whose front holds the least key
+        std::vector<Cursor> _heap;
+
+        /// @brief The key comparator, held by value so that the iterator outlives moves of its view
+        Less _less;
+
+        /// @brief Determines if the key of a cursor is greater than that of another, ordering the heap
+        struct Greater {
+          const Less& less;
+
+          bool operator()(const Cursor& x, const Cursor& y) const {
+            return this->less(y.first.key(), x.first.key());
+          }
+        };
+
+        iterator(std::vector<Cursor> heap, const Less& less) : _heap(std::move(heap)), _less(less) {
+          std::make_heap(this->_heap.begin(), this->_heap.end(), Greater{this->_less});
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+
+        using difference_type = std::ptrdiff_t;
+
+        using value_type = std::pair<const Key, Value>;
+
+        using reference = typename Shard_map::const_iterator::reference;
+
+        using pointer = typename Shard_map::const_iterator::pointer;
+
+        /// @brief Initializes an iterator past the end
+        iterator() : _heap(), _less() {}
+
+        const Key& key() const noexcept {
+          return this->_heap.front().first.key();
+        }
+
+        const Value& value() const noexcept {
+          return this->_heap.front().first.value();
+        }
+
+        reference operator*() const noexcept {
+          return *this->_heap.front().first;
+        }
+
+        pointer operator->() const noexcept {
+          return this->_heap.front().first.operator->();
+        }
+
+        iterator& operator++() {
+          std::pop_heap(this->_heap.begin(), this->_heap.end(), Greater{this->_less});
+
+          if (++this->_heap.back().first != this->_heap.back().second) {
+            std::push_heap(this->_heap.begin(), this->_heap.end(), Greater{this->_less});
+          } else {
+            this->_heap.pop_back();
+          }
+
+          return *this;
+        }
+
+        iterator operator++(int) {
+          iterator old = *this;
+          ++*this;
+          return old;
+        }
+
+        friend bool operator==(const iterator& x, const iterator& y) noexcept {
+          return x._heap.empty() ? y._heap.empty() : !y._heap.empty() && x._heap.front().first == y._heap.front().first;
+        }
+
+        friend bool operator!=(const iterator& x, const iterator& y) noexcept {
+          return !(x == y);
+        }
+      };
+
+      iterator begin() const {
+        return iterator(this->_cursors, this->_less);
+      }
+
+      iterator end() const {
+        return iterator(std::vector<Cursor>(), this->_less);
+      }
+    };
+
+    /// @brief Initializes an empty map, partitioning keys by hash
+    /// @param shard_count The number of shards, such as the number of writer threads or more
+    /// @param chunk_size The number of nodes per chunk of the pools of each shard
+    /// @pre `shard_count != 0`
+    explicit Sharded_map(std::size_t shard_count, const Hash& hash = Hash(), const Less& less = Less(), std::size_t chunk_size = 1024) :
+      _shards(),
+      _bounds(),
+      _by_range(false),
+      _hash(hash),
+      _less(less) {
+      assert(shard_count != 0);
+
+      for (std::size_t i = 0; i < shard_count; ++i) {
+        this->_shards.emplace_back(less, chunk_size);
+      }
+    }
+
+    /// @brief Initializes an empty map, partitioning keys by range
+    /// @param bounds The keys separating the ranges of consecutive shards, in ascending order: the shard following a
+    /// bound holds the keys from the bound up to the next bound, excluded
+    /// @param chunk_size The number of nodes per chunk of the pools of each shard
+    explicit Sharded_map(std::vector<Key> bounds, const Less& less = Less(), std::size_t chunk_size = 1024) :
+      _shards(),
+      _bounds(std::move(bounds)),
+      _by_range(true),
+      _hash(),
+      _less(less) {
+      assert(std::adjacent_find(this->_bounds.begin(), this->_bounds.end(), [&](const Key& x, const Key& y) {
+        return !this->_less(x, y);
+      }) == this->_bounds.end());
+
+      for (std::size_t i = 0; i <= this->_bounds.size(); ++i) {
+        this->_shards.emplace_back(less, chunk_size);
+      }
+    }
+
+    Sharded_map(const Sharded_map&) = delete;
+
+    Sharded_map& operator=(const Sharded_map&) = delete;
+
+    /// @brief Verifies that this map is valid: that is, that no internal invariants are violated
+    void check() const {
+      for (std::size_t i = 0; i < this->_shards.size(); ++i) {
+        const Shard& shard = this->_shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.map.check();
+
+        for (const auto& [key, value] : shard.map) {
+          assert(this->shard_index(key) == i);
+          (void)value;
+        }
+      }
+    }
+
+    /// @brief Returns the number of shards
+    std::size_t shard_count() const noexcept {
+      return this->_shards.size();
+    }
+
+    /// @brief Returns the number of key-value pairs stored by this map, summing those of the shards in turn
+    std::size_t count() const {
+      std::size_t count = 0;
+
+      for (const Shard& shard : this->_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.map.count();
+      }
+
+      return count;
+    }
+
+    /// @brief Finds the value associated to a given key, if any
+    /// @return A copy of the value, or @c std::nullopt if not found
+    std::optional<Value> lookup(const Key& key) const {
+      const Shard& shard = this->_shards[this->shard_index(key)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      const Value* value = shard.map.lookup(key);
+      return value != nullptr ? std::optional<Value>(*value) : std::nullopt;
+    }
+
+    /// @brief Associates a key to a value, replacing any value the key was associated to
+    /// @return @c true if the key was inserted, @c false if assigned
+    /// @exception std::bad_alloc If memory could not be allocated
+    template <typename V>
+    bool insert_or_assign(const Key& key, V&& value) {
+      Shard& shard = this->_shards[this->shard_index(key)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      return shard.map.insert_or_assign(key, std::forward<V>(value)).second;
+    }
+
+    /// @brief Removes the value associated to a key, if any
+    /// @return @c true if an association to the key existed prior to removal, @c false otherwise
+    bool remove(const Key& key) {
+      Shard& shard = this->_shards[this->shard_index(key)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      return shard.map.remove(key);
+    }
+
+    /// @brief Calls a function on the map of the shard holding a key, along with the key, while holding its lock
+    /// @details The function may look up, insert or remove the key, but must not use this sharded map.
+    template <typename Function>
+    decltype(auto) with_shard(const Key& key, Function&& function) {
+      Shard& shard = this->_shards[this->shard_index(key)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      return std::forward<Function>(function)(shard.map, key);
+    }
+
+    /// @brief Views all key-value pairs, in key order, locking all shards until the view is destroyed
+    Ordered_view ordered() const {
+      Ordered_view view(this->_less);
+
+      for (const Shard& shard : this->_shards) {
+        view._locks.emplace_back(shard.mutex);
+
+        if (shard.map.begin() != shard.map.end())
+          view._cursors.emplace_back(shard.map.begin(), shard.map.end());
+      }
+
+      return view;
+    }
+
+    /// @brief Views the key-value pairs whose keys lie in a half-open range, in key order, locking the shards which may
+    /// hold such keys until the view is destroyed
+    /// @details If keys are partitioned by range, only the shards overlapping the range are locked.
+    Ordered_view ordered(const Key& low, const Key& high) const {
+      Ordered_view view(this->_less);
+
+      if (!this->_less(low, high))
+        return view;
+
+      std::size_t first = this->_by_range ? this->shard_index(low) : 0;
+      std::size_t last = this->_by_range ? this->shard_index(high) : this->_shards.size() - 1;
+
+      for (std::size_t i = first; i <= last; ++i) {
+        const Shard& shard = this->_shards[i];
+        view._locks.emplace_back(shard.mutex);
+        auto range = shard.map.range(low, high);
+
+        if (range.first != range.second)
+          view._cursors.push_back(range);
+      }
+
+      return view;
+    }
+
+    /// @brief Clears this map, removing all key-value associations, one shard at a time
+    void clear() noexcept {
+      for (Shard& shard : this->_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.map.clear();
+      }
+    }
+  };
+}
+
+#endif
@@ -1,465 +1,2387 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <chrono>
 #include <cstddef>
+#include <cstdio>
 #include <cstdlib>
-#include <iomanip>
+#include <cstring>
+#include <filesystem>
+#include <functional>
 #include <iostream>
-#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <numeric>
+#include <optional>
 #include <random>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 extern "C" {
+#include "allocator.h"
 #include "comparator.h"
+#include "concurrent_map.h"
+#include "index_map.h"
 #include "layout.h"
 #include "map.h"
+#include "map_define.h"
+#include "map_image.h"
+#include "map_stream.h"
+#include "persistent_map.h"
+#include "sharded_map.h"
 }
 
+#include "allocator.hpp"
 #include "map.hpp"
+#include "sharded_map.hpp"
 
 namespace {
   volatile int value;
   int* volatile value_p;
 
+  /// @brief Key of the map generated by @c MAP_DEFINE, ordered by increasing major and decreasing minor
+  struct Defined_key {
+    int major;
+    int minor;
+  };
+
+  MAP_DEFINE(
+    Defined_map,
+    Defined_key,
+    long,
+    a->major != b->major ? (a->major > b->major) - (a->major < b->major) : (a->minor < b->minor) - (a->minor > b->minor)
+  )
+
 #ifndef NDEBUG
-  void check(std::size_t count, std::default_random_engine& engine) {
+  void check(Map* c_map, std::size_t count, std::default_random_engine& engine) {
     {
-      cpp::Map<int, int> cpp_map;
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
 
-      {
-        std::vector<int> keys(count);
-        std::iota(keys.begin(), keys.end(), 0);
-        std::shuffle(keys.begin(), keys.end(), engine);
+      for (int key : keys) {
+        value = -key;
+        map_insert(c_map, &key, const_cast<int*>(&value));
+        map_check(c_map);
+        value_p = static_cast<int*>(map_lookup(c_map, &key));
+        assert(value_p != NULL && *value_p == value);
+      }
 
-        for (int key : keys) {
-          cpp_map.insert(key, -key);
-          cpp_map.check();
-          value_p = cpp_map.lookup(key);
-          assert(value_p != nullptr && *value_p == -key);
-        }
+      std::shuffle(keys.begin(), keys.end(), engine);
 
-        std::shuffle(keys.begin(), keys.end(), engine);
+      for (int key : keys) {
+        value_p = static_cast<int*>(map_lookup(c_map, &key));
+        assert(value_p != NULL && *value_p == -key);
+      }
 
-        for (int key : keys) {
-          value_p = cpp_map.lookup(key);
-          assert(value_p != nullptr && *value_p == -key);
+      {
+        std::vector<int> probes(2 * count + 1);
+        std::iota(probes.begin(), probes.end(), -static_cast<int>(count));
+        std::shuffle(probes.begin(), probes.end(), engine);
+        std::vector<void*> values(probes.size());
+        map_lookup_many(c_map, probes.data(), probes.size(), values.data());
+
+        for (std::size_t i = 0; i < probes.size(); ++i) {
+          value_p = static_cast<int*>(values[i]);
+          assert(probes[i] >= 0 && probes[i] < static_cast<int>(count) ? value_p != NULL && *value_p == -probes[i] : value_p == NULL);
         }
+      }
 
-        {
-          cpp::Map<int, int> cpp_map_copy(cpp_map);
-          cpp_map_copy.check();
+      {
+        struct Map* c_map_copy = map_copy(c_map);
+        map_check(c_map_copy);
 
-          for (int key : keys) {
-            value_p = cpp_map_copy.lookup(key);
-            assert(value_p != nullptr && *value_p == -key);
-          }
+        for (int key : keys) {
+          value_p = static_cast<int*>(map_lookup(c_map_copy, &key));
+          assert(value_p != NULL && *value_p == -key);
         }
 
-        std::shuffle(keys.begin(), keys.end(), engine);
+        map_clear(c_map_copy);
+        map_check(c_map_copy);
+        assert(map_count(c_map_copy) == 0);
 
         for (int key : keys) {
-          cpp_map.remove(key);
-          cpp_map.check();
-          assert(cpp_map.lookup(key) == nullptr);
+          value = key;
+          map_insert(c_map_copy, &key, const_cast<int*>(&value));
         }
 
-        assert(cpp_map.count() == 0);
+        map_check(c_map_copy);
+        assert(map_count(c_map_copy) == count);
+        map_destroy(c_map_copy);
       }
 
-      {
-        enum Operation {
-          INSERT,
-          LOOKUP,
-          REMOVE,
-        };
+      std::shuffle(keys.begin(), keys.end(), engine);
 
-        std::vector<std::pair<Operation, int>> operation_key_pairs;
+      for (int key : keys) {
+        map_remove(c_map, &key);
+        map_check(c_map);
+        assert(map_lookup(c_map, &key) == NULL);
+      }
 
-        for (std::size_t i = 0; i < count; ++i) {
-          operation_key_pairs.emplace_back(INSERT, i);
-          operation_key_pairs.emplace_back(LOOKUP, i);
-          operation_key_pairs.emplace_back(REMOVE, i);
-        }
+      assert(map_count(c_map) == 0);
+    }
 
-        std::shuffle(operation_key_pairs.begin(), operation_key_pairs.end(), engine);
+    {
+      enum Operation {
+        INSERT,
+        LOOKUP,
+        REMOVE,
+      };
 
-        for (auto [operation, key] : operation_key_pairs) {
-          switch (operation) {
-            case LOOKUP:
-              value_p = cpp_map.lookup(key);
-              assert(value_p == nullptr || *value_p == -key);
-              break;
+      std::vector<std::pair<Operation, int>> operation_key_pairs;
 
-            case INSERT:
-              cpp_map.insert(key, -key);
-              cpp_map.check();
-              value_p = cpp_map.lookup(key);
-              assert(value_p != nullptr && *value_p == -key);
-              break;
+      for (std::size_t i = 0; i < count; ++i) {
+        operation_key_pairs.emplace_back(INSERT, i);
+        operation_key_pairs.emplace_back(LOOKUP, i);
+        operation_key_pairs.emplace_back(REMOVE, i);
+      }
 
-            case REMOVE:
-              cpp_map.remove(key);
-              cpp_map.check();
-              assert(cpp_map.lookup(key) == nullptr);
-              break;
-          }
+      std::shuffle(operation_key_pairs.begin(), operation_key_pairs.end(), engine);
+
+      for (auto [operation, key] : operation_key_pairs) {
+        switch (operation) {
+          case LOOKUP:
+            value_p = static_cast<int*>(map_lookup(c_map, &key));
+            assert(value_p == NULL || *value_p == -key);
+            break;
+
+          case INSERT:
+            value = -key;
+            map_insert(c_map, &key, const_cast<int*>(&value));
+            map_check(c_map);
+            value_p = static_cast<int*>(map_lookup(c_map, &key));
+            assert(value_p != NULL && *value_p == value);
+            break;
+
+          case REMOVE:
+            map_remove(c_map, &key);
+            map_check(c_map);
+            assert(map_lookup(c_map, &key) == NULL);
+            break;
         }
       }
     }
 
     {
-      Map* c_map = map_new(
-        Layout{sizeof(int), alignof(int)},
-        Layout{sizeof(int), alignof(int)},
-        int_comparator
-      );
+      map_clear(c_map);
+      int n = static_cast<int>(count);
 
-      {
-        std::vector<int> keys(count);
-        std::iota(keys.begin(), keys.end(), 0);
-        std::shuffle(keys.begin(), keys.end(), engine);
+      for (int key = 0; key < n; ++key) {
+        value = -key;
+        map_append(c_map, &key, const_cast<int*>(&value));
+      }
 
-        for (int key : keys) {
-          value = -key;
-          map_insert(c_map, &key, const_cast<int*>(&value));
-          map_check(c_map);
-          value_p = static_cast<int*>(map_lookup(c_map, &key));
-          assert(value_p != NULL && *value_p == value);
-        }
+      map_check(c_map);
+      int zero = 0;
+      void* hint = map_lookup(c_map, &zero);
 
-        std::shuffle(keys.begin(), keys.end(), engine);
+      for (int key = -1; key >= -n; --key) {
+        value = -key;
+        hint = map_insert_near(c_map, hint, &key, const_cast<int*>(&value));
+        assert(hint != NULL && *static_cast<int*>(hint) == -key);
+      }
 
-        for (int key : keys) {
+      map_check(c_map);
+
+      for (int key = 2 * n; key >= n; --key) {
+        value = -key;
+        map_append(c_map, &key, const_cast<int*>(&value));
+        value_p = static_cast<int*>(map_insert_near(c_map, map_lookup(c_map, &zero), &key, &zero));
+        assert(value_p != NULL && *value_p == 0);
+      }
+
+      map_check(c_map);
+      assert(map_count(c_map) == 3 * count + 1);
+
+      for (int key = -n; key <= 2 * n; ++key) {
+        value_p = static_cast<int*>(map_lookup(c_map, &key));
+        assert(value_p != NULL && *value_p == (key < n ? -key : 0));
+      }
+
+      int key = -n;
+
+      for (void* cursor = map_first(c_map); cursor != NULL; cursor = map_next(c_map, cursor)) {
+        assert(*static_cast<const int*>(map_key(c_map, cursor)) == key);
+        assert(*static_cast<int*>(cursor) == (key < n ? -key : 0));
+        key += 1;
+      }
+
+      assert(key == 2 * n + 1);
+
+      for (void* cursor = map_last(c_map); cursor != NULL; cursor = map_previous(c_map, cursor)) {
+        key -= 1;
+        assert(*static_cast<const int*>(map_key(c_map, cursor)) == key);
+      }
+
+      assert(key == -n);
+
+      map_clear(c_map);
+    }
+
+    {
+      std::vector<int> keys(count);
+      std::vector<int> values(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::transform(keys.begin(), keys.end(), values.begin(), std::negate<int>());
+
+      for (std::size_t n = 0; n <= count; n = n < 64 ? n + 1 : n + count / 4) {
+        assert(map_build(c_map, keys.data(), values.data(), n));
+        map_check(c_map);
+        assert(map_count(c_map) == n);
+
+        for (int key = -1; key <= static_cast<int>(count); ++key) {
           value_p = static_cast<int*>(map_lookup(c_map, &key));
-          assert(value_p != NULL && *value_p == -key);
+          assert(value_p == NULL ? key < 0 || key >= static_cast<int>(n) : *value_p == -key);
         }
+      }
 
-        {
-          struct Map* c_map_copy = map_copy(c_map);
-          map_check(c_map_copy);
+      map_clear(c_map);
+    }
 
-          for (int key : keys) {
-            value_p = static_cast<int*>(map_lookup(c_map_copy, &key));
-            assert(value_p != NULL && *value_p == -key);
+    {
+      std::map<int, int> std_map;
+      std::uniform_int_distribution<int> key_distribution(0, 2 * static_cast<int>(count));
+      std::bernoulli_distribution removal_distribution(0.25);
+
+      for (std::size_t batch_size = 1; batch_size <= 2 * count + 1; batch_size = 2 * batch_size + 1) {
+        std::vector<int> keys(batch_size);
+        std::generate(keys.begin(), keys.end(), [&] { return key_distribution(engine); });
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        std::vector<int> values(keys.size());
+        std::unique_ptr<bool[]> removals(new bool[keys.size()]);
+
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+          values[i] = -keys[i] - static_cast<int>(batch_size);
+          removals[i] = removal_distribution(engine);
+
+          if (removals[i]) {
+            std_map.erase(keys[i]);
+          } else {
+            std_map[keys[i]] = values[i];
           }
-
-          map_destroy(c_map_copy);
         }
 
-        std::shuffle(keys.begin(), keys.end(), engine);
+        assert(map_apply(c_map, keys.data(), values.data(), removals.get(), keys.size()));
+        map_check(c_map);
+        assert(map_count(c_map) == std_map.size());
 
-        for (int key : keys) {
-          map_remove(c_map, &key);
-          map_check(c_map);
-          assert(map_lookup(c_map, &key) == NULL);
+        for (int key = -1; key <= 2 * static_cast<int>(count) + 1; ++key) {
+          auto it = std_map.find(key);
+          value_p = static_cast<int*>(map_lookup(c_map, &key));
+          assert(it != std_map.end() ? value_p != NULL && *value_p == it->second : value_p == NULL);
         }
+      }
+
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      assert(map_apply(c_map, keys.data(), keys.data(), NULL, count));
+      map_check(c_map);
 
-        assert(map_count(c_map) == 0);
+      for (int key : keys) {
+        value_p = static_cast<int*>(map_lookup(c_map, &key));
+        assert(value_p != NULL && *value_p == key);
       }
 
-      {
-        enum Operation {
-          INSERT,
-          LOOKUP,
-          REMOVE,
-        };
+      map_clear(c_map);
+    }
 
-        std::vector<std::pair<Operation, int>> operation_key_pairs;
+    {
+      int n = static_cast<int>(count);
+      std::vector<int> keys(count);
+      std::vector<int> values(count);
 
-        for (std::size_t i = 0; i < count; ++i) {
-          operation_key_pairs.emplace_back(INSERT, i);
-          operation_key_pairs.emplace_back(LOOKUP, i);
-          operation_key_pairs.emplace_back(REMOVE, i);
-        }
+      for (int i = 0; i < n; ++i) {
+        keys[i] = 2 * i;
+        values[i] = -2 * i;
+      }
 
-        std::shuffle(operation_key_pairs.begin(), operation_key_pairs.end(), engine);
+      assert(map_build(c_map, keys.data(), values.data(), count));
+
+      for (int key = -1; key <= 2 * n; ++key) {
+        int ceiling = key <= 0 ? 0 : (key + 1) / 2 * 2;
+        int successor = key < 0 ? 0 : key / 2 * 2 + 2;
+        int floor = key < 0 ? -1 : std::min(key / 2 * 2, 2 * n - 2);
+        value_p = static_cast<int*>(map_lower_bound(c_map, &key));
+        assert(ceiling < 2 * n ? value_p != NULL && *value_p == -ceiling : value_p == NULL);
+        value_p = static_cast<int*>(map_upper_bound(c_map, &key));
+        assert(successor < 2 * n ? value_p != NULL && *value_p == -successor : value_p == NULL);
+        value_p = static_cast<int*>(map_floor(c_map, &key));
+        assert(floor >= 0 ? value_p != NULL && *value_p == -floor : value_p == NULL);
+      }
 
-        for (auto [operation, key] : operation_key_pairs) {
-          switch (operation) {
-            case LOOKUP:
-              value_p = static_cast<int*>(map_lookup(c_map, &key));
-              assert(value_p == NULL || *value_p == -key);
-              break;
+      struct Scan {
+        int next_key;
+        int last_key;
+      };
 
-            case INSERT:
-              value = -key;
-              map_insert(c_map, &key, const_cast<int*>(&value));
-              map_check(c_map);
-              value_p = static_cast<int*>(map_lookup(c_map, &key));
-              assert(value_p != NULL && *value_p == value);
-              break;
+      auto visit = [](const void* key, void* value, void* data) {
+        Scan* scan = static_cast<Scan*>(data);
+        assert(*static_cast<const int*>(key) == scan->next_key && *static_cast<int*>(value) == -scan->next_key);
+        scan->next_key += 2;
+        return scan->next_key <= scan->last_key;
+      };
 
-            case REMOVE:
-              map_remove(c_map, &key);
-              map_check(c_map);
-              assert(map_lookup(c_map, &key) == NULL);
-              break;
-          }
+      for (int low = -1; low <= 2 * n; low += 3) {
+        for (int high = low; high <= 2 * n + 1; high += 5) {
+          std::size_t scanned = std::count_if(keys.begin(), keys.end(), [=](int key) { return low <= key && key < high; });
+          Scan scan = {low <= 0 ? 0 : (low + 1) / 2 * 2, 2 * n};
+          assert(map_scan(c_map, &low, &high, visit, &scan) == scanned);
         }
       }
 
-      map_destroy(c_map);
+      Scan scan = {0, 4};
+      assert(map_scan(c_map, NULL, NULL, visit, &scan) == std::min(count, std::size_t(3)));
+      map_clear(c_map);
     }
   }
-#else
-#define check(count, engine)
-#endif
-
-  template <typename Rep, typename Period>
-  std::ostream& operator<<(std::ostream& os, std::chrono::duration<Rep, Period> duration) {
-    return os << std::right << std::setw(std::numeric_limits<Rep>::digits10) << duration.count();
-  }
-
-  void bench(std::size_t count, std::default_random_engine& engine) {
-    std::map<int, int> std_map;
-    cpp::Map<int, int> cpp_map;
-
-    Map* c_map = map_new(
-      Layout{sizeof(int), alignof(int)},
-      Layout{sizeof(int), alignof(int)},
-      int_comparator
-    );
 
+  template <typename M>
+  void check(M& cpp_map, std::size_t count, std::default_random_engine& engine) {
     {
       std::vector<int> keys(count);
       std::iota(keys.begin(), keys.end(), 0);
       std::shuffle(keys.begin(), keys.end(), engine);
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
+      for (int key : keys) {
+        cpp_map.insert(key, -key);
+        cpp_map.check();
+        value_p = cpp_map.lookup(key);
+        assert(value_p != nullptr && *value_p == -key);
+      }
 
-        for (int key : keys) {
-          std_map[key] = -key;
-        }
+      std::shuffle(keys.begin(), keys.end(), engine);
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "       std::map insertions: " << t1 - t0 << std::endl;
+      for (int key : keys) {
+        value_p = cpp_map.lookup(key);
+        assert(value_p != nullptr && *value_p == -key);
       }
 
       {
-        auto t0 = std::chrono::high_resolution_clock::now();
-
-        for (int key : keys) {
-          cpp_map.insert(key, -key);
+        std::vector<int> probes(2 * count + 1);
+        std::iota(probes.begin(), probes.end(), -static_cast<int>(count));
+        std::shuffle(probes.begin(), probes.end(), engine);
+        std::vector<const int*> values(probes.size());
+        static_cast<const M&>(cpp_map).lookup_many(probes.data(), probes.size(), values.data());
+
+        for (std::size_t i = 0; i < probes.size(); ++i) {
+          assert(probes[i] >= 0 && probes[i] < static_cast<int>(count) ? values[i] != nullptr && *values[i] == -probes[i] : values[i] == nullptr);
         }
-
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "       cpp::Map insertions: " << t1 - t0 << std::endl;
       }
 
       {
-        auto t0 = std::chrono::high_resolution_clock::now();
+        M cpp_map_copy(cpp_map);
+        cpp_map_copy.check();
 
         for (int key : keys) {
-          value = -key;
-          map_insert(c_map, &key, const_cast<int*>(&value));
+          value_p = cpp_map_copy.lookup(key);
+          assert(value_p != nullptr && *value_p == -key);
         }
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "            Map insertions: " << t1 - t0 << std::endl;
-      }
-
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
-        std::map<int, int> std_map_copy(std_map);
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "             std::map copy: " << t1 - t0 << std::endl;
-
-        t0 = std::chrono::high_resolution_clock::now();
-        cpp::Map<int, int> cpp_map_copy(cpp_map);
-        t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "             cpp::Map copy: " << t1 - t0 << std::endl;
-
-        t0 = std::chrono::high_resolution_clock::now();
-        Map* c_map_copy = map_copy(c_map);
-        t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "                  Map copy: " << t1 - t0 << std::endl;
-
-        t0 = std::chrono::high_resolution_clock::now();
-        std_map_copy.clear();
-        t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "            std::map clear: " << t1 - t0 << std::endl;
-
-        t0 = std::chrono::high_resolution_clock::now();
         cpp_map_copy.clear();
-        t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "            cpp::Map clear: " << t1 - t0 << std::endl;
+        cpp_map_copy.check();
+        assert(cpp_map_copy.count() == 0);
 
-        t0 = std::chrono::high_resolution_clock::now();
-        map_clear(c_map_copy);
-        t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "                 Map clear: " << t1 - t0 << std::endl;
+        for (int key : keys) {
+          cpp_map_copy.insert(key, key);
+        }
 
-        map_destroy(c_map_copy);
+        cpp_map_copy.check();
+        assert(cpp_map_copy.count() == count);
       }
 
       std::shuffle(keys.begin(), keys.end(), engine);
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
+      for (int key : keys) {
+        cpp_map.remove(key);
+        cpp_map.check();
+        assert(cpp_map.lookup(key) == nullptr);
+      }
 
-        for (int key : keys) {
-          value = std_map[key];
-        }
+      assert(cpp_map.count() == 0);
+    }
+
+    {
+      enum Operation {
+        INSERT,
+        LOOKUP,
+        REMOVE,
+      };
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "          std::map lookups: " << t1 - t0 << std::endl;
+      std::vector<std::pair<Operation, int>> operation_key_pairs;
+
+      for (std::size_t i = 0; i < count; ++i) {
+        operation_key_pairs.emplace_back(INSERT, i);
+        operation_key_pairs.emplace_back(LOOKUP, i);
+        operation_key_pairs.emplace_back(REMOVE, i);
       }
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
+      std::shuffle(operation_key_pairs.begin(), operation_key_pairs.end(), engine);
 
-        for (int key : keys) {
-          value_p = cpp_map.lookup(key);
+      for (auto [operation, key] : operation_key_pairs) {
+        switch (operation) {
+          case LOOKUP:
+            value_p = cpp_map.lookup(key);
+            assert(value_p == nullptr || *value_p == -key);
+            break;
+
+          case INSERT:
+            cpp_map.insert(key, -key);
+            cpp_map.check();
+            value_p = cpp_map.lookup(key);
+            assert(value_p != nullptr && *value_p == -key);
+            break;
+
+          case REMOVE:
+            cpp_map.remove(key);
+            cpp_map.check();
+            assert(cpp_map.lookup(key) == nullptr);
+            break;
         }
+      }
+    }
+
+    {
+      cpp_map.clear();
+      int n = static_cast<int>(count);
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "          cpp::Map lookups: " << t1 - t0 << std::endl;
+      for (int key = 0; key < n; ++key) {
+        cpp_map.append(key, -key);
       }
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
+      cpp_map.check();
 
-        for (int key : keys) {
-          value_p = static_cast<int*>(map_lookup(c_map, &key));
-        }
+      for (int key = -1; key >= -n; --key) {
+        auto [value_p, inserted] = cpp_map.append(key, -key);
+        assert(inserted && *value_p == -key);
+      }
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "               Map lookups: " << t1 - t0 << std::endl;
+      cpp_map.check();
+      assert(cpp_map.count() == 2 * count);
+
+      for (int key = -n; key < n; ++key) {
+        value_p = cpp_map.lookup(key);
+        assert(value_p != nullptr && *value_p == -key);
       }
 
-      std::shuffle(keys.begin(), keys.end(), engine);
+      auto hint = cpp_map.find(-n);
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
+      for (int key = 2 * n; key >= n; --key) {
+        assert(cpp_map.insert_near(cpp_map.end(), key, 0).second);
+        std::tie(hint, std::ignore) = cpp_map.insert_near(hint, -n - 1 - (key - n), key);
+        assert(hint.key() == -n - 1 - (key - n) && hint.value() == key);
+      }
 
-        for (int key : keys) {
-          std_map.erase(key);
-        }
+      assert(!cpp_map.insert_near(cpp_map.find(n), n - 1, 1 - n).second);
+      cpp_map.check();
+      assert(cpp_map.count() == 4 * count + 2);
+
+      int key = -2 * n - 1;
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "         std::map removals: " << t1 - t0 << std::endl;
+      for (auto [k, v] : cpp_map) {
+        assert(k == key && v == (key < -n ? -1 - key : key < n ? -key : 0));
+        key += 1;
       }
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
+      assert(key == 2 * n + 1);
 
-        for (int key : keys) {
-          cpp_map.remove(key);
-        }
+      for (auto iterator = cpp_map.crbegin(); iterator != cpp_map.crend(); ++iterator) {
+        key -= 1;
+        assert(iterator->first == key);
+      }
+
+      assert(key == -2 * n - 1);
+      assert((--cpp_map.end()).key() == 2 * n);
+
+      cpp_map.clear();
+    }
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "         cpp::Map removals: " << t1 - t0 << std::endl;
+    {
+      std::vector<std::pair<int, int>> pairs;
+
+      for (int key = 0; key < static_cast<int>(count); ++key) {
+        pairs.emplace_back(key, -key);
       }
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
+      for (std::size_t n = 0; n <= count; n = n < 64 ? n + 1 : n + count / 4) {
+        M cpp_map_built(pairs.begin(), pairs.begin() + n);
+        cpp_map_built.check();
+        assert(cpp_map_built.count() == n);
 
-        for (int key : keys) {
-          map_remove(c_map, &key);
+        for (int key = -1; key <= static_cast<int>(count); ++key) {
+          value_p = cpp_map_built.lookup(key);
+          assert(value_p == nullptr ? key < 0 || key >= static_cast<int>(n) : *value_p == -key);
         }
-
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "              Map removals: " << t1 - t0 << std::endl;
       }
     }
 
     {
-      enum Operation {
-        INSERT,
-        LOOKUP,
-        REMOVE,
-      };
+      int n = static_cast<int>(count);
 
-      std::vector<std::pair<Operation, int>> operation_key_pairs;
+      for (int key = 0; key < n; ++key) {
+        cpp_map.append(2 * key, -2 * key);
+      }
 
-      for (std::size_t i = 0; i < count; ++i) {
-        operation_key_pairs.emplace_back(INSERT, i);
-        operation_key_pairs.emplace_back(LOOKUP, i);
-        operation_key_pairs.emplace_back(REMOVE, i);
+      for (int key = -1; key <= 2 * n; ++key) {
+        int ceiling = key <= 0 ? 0 : (key + 1) / 2 * 2;
+        int successor = key < 0 ? 0 : key / 2 * 2 + 2;
+        int floor = key < 0 ? -1 : std::min(key / 2 * 2, 2 * n - 2);
+        auto iterator = cpp_map.lower_bound(key);
+        assert(ceiling < 2 * n ? iterator != cpp_map.end() && iterator.key() == ceiling : iterator == cpp_map.end());
+        iterator = cpp_map.upper_bound(key);
+        assert(successor < 2 * n ? iterator != cpp_map.end() && iterator.key() == successor : iterator == cpp_map.end());
+        iterator = cpp_map.floor(key);
+        assert(floor >= 0 ? iterator != cpp_map.end() && iterator.key() == floor : iterator == cpp_map.end());
       }
 
-      std::shuffle(operation_key_pairs.begin(), operation_key_pairs.end(), engine);
+      for (int low = -1; low <= 2 * n; low += 3) {
+        for (int high = low - 1; high <= 2 * n + 1; high += 5) {
+          auto [first, last] = cpp_map.range(low, high);
+          int key = low <= 0 ? 0 : (low + 1) / 2 * 2;
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
+          for (; first != last; ++first) {
+            assert(first.key() == key && first.value() == -key && key < high);
+            key += 2;
+          }
 
-        for (auto [operation, key] : operation_key_pairs) {
-          switch (operation) {
-            case LOOKUP:
-              value = std_map[key];
-              break;
+          assert(key >= std::min(high, 2 * n));
+        }
+      }
 
-            case INSERT:
-              std_map[key] = -key;
-              break;
+      cpp_map.clear();
+    }
 
-            case REMOVE:
-              std_map.erase(key);
-              break;
-          }
+    {
+      int n = static_cast<int>(count);
+
+      for (int key = 0; key < n; ++key) {
+        cpp_map.append(2 * key, -2 * key);
+      }
+
+      for (int key = -1; key <= 2 * n; key += 1 + n / 8) {
+        M cpp_map_greater = cpp_map.split(key);
+        cpp_map.check();
+        cpp_map_greater.check();
+        std::size_t split_count = static_cast<std::size_t>(std::clamp((key + 1) / 2, 0, n));
+        assert(cpp_map.count() == split_count && cpp_map_greater.count() == count - split_count);
+        assert(cpp_map.count() == 0 || (--cpp_map.end()).key() < key);
+        assert(cpp_map_greater.count() == 0 || cpp_map_greater.begin().key() >= key);
+
+        if (key % 2 != 0) {
+          cpp_map.join(key, 0, cpp_map_greater);
+          cpp_map.check();
+          assert(cpp_map.count() == count + 1 && *cpp_map.lookup(key) == 0);
+          cpp_map.remove(key);
+        } else {
+          cpp_map.concatenate(cpp_map_greater);
         }
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "std::map random operations: " << t1 - t0 << std::endl;
+        cpp_map.check();
+        assert(cpp_map.count() == count && cpp_map_greater.count() == 0);
+        int next_key = 0;
+
+        for (auto [k, v] : cpp_map) {
+          assert(k == next_key && v == -k);
+          next_key += 2;
+        }
       }
 
       {
-        auto t0 = std::chrono::high_resolution_clock::now();
+        M cpp_map_greater = cpp_map.split(n);
+        M cpp_map_greatest = cpp_map_greater.split(n + n / 2);
+        cpp_map_greater.concatenate(cpp_map_greatest);
+        cpp_map.concatenate(cpp_map_greater);
+      }
 
-        for (auto [operation, key] : operation_key_pairs) {
-          switch (operation) {
-            case LOOKUP:
-              value_p = cpp_map.lookup(key);
-              break;
+      cpp_map.check();
+      assert(cpp_map.count() == count);
+      cpp_map.clear();
+    }
+  }
 
-            case INSERT:
-              cpp_map.insert(key, -key);
-              break;
+  void check(std::size_t count, std::default_random_engine& engine) {
+    {
+      cpp::Map<int, int> cpp_map;
+      check(cpp_map, count, engine);
+    }
 
-            case REMOVE:
-              cpp_map.remove(key);
-              break;
-          }
+    {
+      cpp::Map<int, int, std::less<int>, cpp::Pool_allocator<std::pair<const int, int>>> cpp_map;
+      check(cpp_map, count, engine);
+    }
+
+    {
+      cpp::Map<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, true> cpp_map;
+      check(cpp_map, count, engine);
+      int n = static_cast<int>(count);
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        cpp_map.insert(2 * key, -2 * key);
+      }
+
+      cpp_map.check();
+
+      for (int key = -1; key <= 2 * n; ++key) {
+        assert(cpp_map.rank(key) == static_cast<std::size_t>(std::min(n, (key + 1) / 2)));
+      }
+
+      for (std::size_t i = 0; i <= count; ++i) {
+        auto iterator = cpp_map.select(i);
+        assert(i < count ? iterator != cpp_map.end() && iterator.value() == -2 * static_cast<int>(i) : iterator == cpp_map.end());
+      }
+
+      for (int low = -1; low <= 2 * n; low += 3) {
+        for (int high = low - 1; high <= 2 * n + 1; high += 5) {
+          std::size_t counted = std::count_if(keys.begin(), keys.end(), [=](int key) { return low <= 2 * key && 2 * key < high; });
+          assert(cpp_map.count_range(low, high) == counted);
         }
+      }
+    }
+
+    {
+      cpp::Map<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, false, true> cpp_map;
+      check(cpp_map, count, engine);
+    }
+
+    {
+      cpp::Map<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, true, true> cpp_map;
+      check(cpp_map, count, engine);
+    }
+
+    {
+      cpp::Map<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, false, false, true> cpp_map;
+      check(cpp_map, count, engine);
+    }
+
+    for (double fraction : {0.25, 1.0}) {
+      cpp::Map<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, false, true, true> cpp_map;
+      cpp_map.set_tombstone_fraction(fraction);
+      check(cpp_map, count, engine);
+
+      int n = static_cast<int>(count);
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "cpp::Map random operations: " << t1 - t0 << std::endl;
+      for (int key : keys) {
+        cpp_map.insert(key, key);
       }
 
-      {
-        auto t0 = std::chrono::high_resolution_clock::now();
-
-        for (auto [operation, key] : operation_key_pairs) {
-          switch (operation) {
-            case LOOKUP:
-              value_p = static_cast<int*>(map_lookup(c_map, &key));
-              break;
-
-            case INSERT: {
-              value = -key;
-              map_insert(c_map, &key, const_cast<int*>(&value));
-              break;
-            }
+      // Removing the odd keys, and reviving every fourth one through each way of inserting:
 
-            case REMOVE:
-              map_remove(c_map, &key);
-              break;
-          }
+      for (int key : keys) {
+        if (key % 2 == 1)
+          assert(cpp_map.remove(key) && !cpp_map.remove(key));
+      }
+
+      cpp_map.check();
+      assert(cpp_map.count() == (count + 1) / 2);
+
+      for (int key = 3; key < n; key += 4) {
+        switch (key / 4 % 4) {
+        case 0:
+          assert(cpp_map.insert_or_assign(key, -key).second);
+          break;
+        case 1:
+          assert(cpp_map.try_emplace(key, -key).second);
+          break;
+        case 2:
+          assert(cpp_map.emplace(key, -key).second);
+          break;
+        default:
+          assert(cpp_map.insert_near(cpp_map.lower_bound(key), key, -key).second);
+          break;
         }
+      }
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        std::cout << "     Map random operations: " << t1 - t0 << std::endl;
+      cpp_map.check();
+      std::vector<int> expected;
+
+      for (int key = 0; key < n; ++key) {
+        if (key % 2 == 0 || key % 4 == 3)
+          expected.push_back(key);
       }
-    }
 
-    map_destroy(c_map);
-  }
+      assert(cpp_map.count() == expected.size());
+      std::vector<int> visited;
+
+      for (auto [k, v] : cpp_map) {
+        assert(v == (k % 4 == 3 ? -k : k));
+        visited.push_back(k);
+      }
+
+      assert(visited == expected);
+      visited.clear();
+
+      for (auto it = cpp_map.crbegin(); it != cpp_map.crend(); ++it) {
+        visited.push_back(it->first);
+      }
+
+      assert(std::equal(visited.begin(), visited.end(), expected.rbegin(), expected.rend()));
+      std::vector<const int*> values(count);
+      cpp_map.lookup_many(keys.data(), count, values.data());
+
+      for (std::size_t i = 0; i < count; ++i) {
+        int key = keys[i];
+        bool found = key % 2 == 0 || key % 4 == 3;
+        assert((cpp_map.lookup(key) != nullptr) == found && (values[i] != nullptr) == found);
+        assert((cpp_map.find(key) != cpp_map.end()) == found);
+        auto lower = std::lower_bound(expected.begin(), expected.end(), key);
+        auto upper = std::upper_bound(expected.begin(), expected.end(), key);
+        auto lower_it = cpp_map.lower_bound(key);
+        auto upper_it = cpp_map.upper_bound(key);
+        auto floor_it = cpp_map.floor(key);
+        assert(lower == expected.end() ? lower_it == cpp_map.end() : lower_it != cpp_map.end() && lower_it.key() == *lower);
+        assert(upper == expected.end() ? upper_it == cpp_map.end() : upper_it != cpp_map.end() && upper_it.key() == *upper);
+        assert(upper == expected.begin() ? floor_it == cpp_map.end() : floor_it != cpp_map.end() && floor_it.key() == *std::prev(upper));
+      }
+
+      // Copies keep tombstones, and splits and joins compact first:
+
+      auto copy = cpp_map;
+      copy.check();
+      assert(copy.count() == expected.size());
+
+      for (int key = 0; key < n; key += 4) {
+        copy.remove(key);
+      }
+
+      copy.check();
+      int middle = n / 2;
+      auto greater = copy.split(middle);
+      copy.check();
+      greater.check();
+      assert(copy.count() + greater.count() == expected.size() - (count + 3) / 4);
+      copy.concatenate(greater);
+      copy.check();
+
+      cpp_map.compact();
+      cpp_map.check();
+      assert(cpp_map.count() == expected.size());
+
+      for (int key : keys) {
+        assert((cpp_map.lookup(key) != nullptr) == (key % 2 == 0 || key % 4 == 3));
+        cpp_map.remove(key);
+      }
+
+      cpp_map.check();
+      assert(cpp_map.count() == 0 && cpp_map.begin() == cpp_map.end());
+      cpp_map.clear();
+      cpp_map.check();
+    }
+
+    {
+      cpp::Map<std::string, int, std::less<>> cpp_map;
+
+      for (std::size_t i = 0; i < count; ++i) {
+        cpp_map.insert(std::to_string(i), static_cast<int>(i));
+      }
+
+      for (std::size_t i = 0; i < count; ++i) {
+        std::string key = std::to_string(i);
+        value_p = cpp_map.lookup(std::string_view(key));
+        assert(value_p != nullptr && *value_p == static_cast<int>(i));
+        value_p = cpp_map.lookup(key.c_str());
+        assert(value_p != nullptr && *value_p == static_cast<int>(i));
+      }
+
+      assert(cpp_map.lookup("-1") == nullptr);
+
+      for (std::size_t i = 0; i < count; ++i) {
+        std::string key = std::to_string(i);
+        assert(cpp_map.remove(std::string_view(key)));
+        assert(!cpp_map.remove(key.c_str()));
+      }
+
+      cpp_map.check();
+      assert(cpp_map.count() == 0);
+    }
+
+    {
+      cpp::Map<int, std::unique_ptr<int>> cpp_map;
+
+      for (std::size_t i = 0; i < count; ++i) {
+        int key = static_cast<int>(i);
+        auto [value_p, inserted] = cpp_map.try_emplace(key, std::make_unique<int>(-key));
+        assert(inserted && **value_p == -key);
+      }
+
+      {
+        auto value = std::make_unique<int>(0);
+        auto [value_p, inserted] = cpp_map.try_emplace(0, std::move(value));
+        assert(!inserted && value != nullptr && **value_p == 0);
+      }
+
+      {
+        auto [value_p, inserted] = cpp_map.insert_or_assign(0, std::make_unique<int>(1));
+        assert(!inserted && **value_p == 1);
+      }
+
+      {
+        auto [value_p, inserted] = cpp_map.emplace(-1, new int(1));
+        assert(inserted && **value_p == 1);
+        std::tie(value_p, inserted) = cpp_map.emplace(-1, new int(2));
+        assert(!inserted && **value_p == 1);
+      }
+
+      cpp_map.insert(-2, std::make_unique<int>(2));
+
+      {
+        // An lvalue key along with an rvalue value moves the value:
+        int key = -3;
+        std::unique_ptr<int> value = std::make_unique<int>(3);
+        cpp_map.insert(key, std::move(value));
+        assert(value == nullptr && **cpp_map.lookup(key) == 3);
+      }
+
+      cpp_map.check();
+      assert(cpp_map.count() == count + 3);
+
+      for (std::size_t i = 0; i < count; i += 2) {
+        cpp_map.remove(static_cast<int>(i));
+      }
+
+      cpp_map.check();
+
+      for (std::size_t i = 1; i < count; i += 2) {
+        int key = static_cast<int>(i);
+        assert(**cpp_map.lookup(key) == -key);
+      }
+    }
+
+    {
+      std::pmr::monotonic_buffer_resource resource;
+      cpp::pmr::Map<int, int> cpp_map(&resource);
+      check(cpp_map, count, engine);
+    }
+
+    {
+      int n = static_cast<int>(count);
+      cpp::Sharded_map<int, int> hashed(4);
+      cpp::Sharded_map<int, int> ranged(std::vector<int>{n / 4, n / 2 + 1, 3 * n / 4 + 2});
+      std::size_t remaining = static_cast<std::size_t>(n / 8 * 4 + std::max(n % 8 - 4, 0));
+
+      for (cpp::Sharded_map<int, int>* sharded_map : {&hashed, &ranged}) {
+        // Writers insert interleaved keys concurrently, then remove every other key:
+
+        std::vector<std::thread> writers;
+
+        for (int i = 0; i < 4; ++i) {
+          writers.emplace_back([=] {
+            for (int key = i; key < n; key += 4) {
+              assert(sharded_map->insert_or_assign(key, key));
+              assert(!sharded_map->insert_or_assign(key, -key));
+            }
+
+            for (int key = i; key < n; key += 8) {
+              assert(sharded_map->remove(key));
+            }
+          });
+        }
+
+        for (std::thread& writer : writers) {
+          writer.join();
+        }
+
+        sharded_map->check();
+        assert(sharded_map->count() == remaining);
+
+        for (int key = -1; key <= n; ++key) {
+          std::optional<int> found = sharded_map->lookup(key);
+          assert(key >= 0 && key < n && key % 8 >= 4 ? found == -key : !found.has_value());
+        }
+
+        int key = 4;
+
+        for (auto [found_key, found] : sharded_map->ordered()) {
+          assert(found_key == key && found == -key);
+          key += key % 8 == 7 ? 5 : 1;
+        }
+
+        assert(key >= n);
+
+        for (int low = -1; low <= n; low += n / 4 + 1) {
+          for (int high = low; high <= n + 1; high += n / 8 + 1) {
+            auto view = sharded_map->ordered(low, high);
+            std::size_t counted = std::count_if(view.begin(), view.end(), [](const auto&) { return true; });
+            std::size_t expected = 0;
+
+            for (int i = std::max(low, 0); i < std::min(high, n); ++i) {
+              expected += i % 8 >= 4 ? 1 : 0;
+            }
+
+            assert(counted == expected);
+          }
+        }
+
+        assert(sharded_map->with_shard(-2, [](auto& shard_map, int key) { return shard_map.insert_or_assign(key, 2).second; }));
+        assert(sharded_map->lookup(-2) == 2 && sharded_map->ordered().begin().key() == -2);
+
+        {
+          // Iterators remain valid when their view is moved:
+          std::size_t expected = sharded_map->count();
+          auto view = sharded_map->ordered();
+          auto iterator = view.begin();
+          auto moved_view = std::move(view);
+          std::size_t visited = 0;
+
+          for (; iterator != moved_view.end(); ++iterator) {
+            visited += 1;
+          }
+
+          assert(visited == expected);
+        }
+
+        sharded_map->clear();
+        assert(sharded_map->count() == 0);
+        auto view = sharded_map->ordered();
+        assert(view.begin() == view.end());
+      }
+    }
+
+    {
+      int n = static_cast<int>(count);
+      int bounds[] = {n / 4, n / 2 + 1, 3 * n / 4 + 2};
+      std::size_t remaining = static_cast<std::size_t>(n / 8 * 4 + std::max(n % 8 - 4, 0));
+      Sharded_map_partition partitions[] = {
+        {[](void*, const void* key) { return static_cast<std::size_t>(*static_cast<const int*>(key)) * 2654435761u; }, NULL, NULL},
+        {NULL, NULL, bounds},
+      };
+
+      for (const Sharded_map_partition& partition : partitions) {
+        Sharded_map* sharded_map = sharded_map_new(
+          Layout{sizeof(int), alignof(int)},
+          Layout{sizeof(int), alignof(int)},
+          int_comparator,
+          4,
+          partition,
+          Map_options{64, false, false, false, 0}
+        );
+
+        std::vector<std::thread> writers;
+
+        for (int i = 0; i < 4; ++i) {
+          writers.emplace_back([=] {
+            for (int key = i; key < n; key += 4) {
+              int found = -key;
+              assert(sharded_map_insert(sharded_map, &key, &found));
+            }
+
+            for (int key = i; key < n; key += 8) {
+              assert(sharded_map_remove(sharded_map, &key));
+              assert(!sharded_map_remove(sharded_map, &key));
+            }
+          });
+        }
+
+        for (std::thread& writer : writers) {
+          writer.join();
+        }
+
+        sharded_map_check(sharded_map);
+        assert(sharded_map_count(sharded_map) == remaining);
+
+        for (int key = -1; key <= n; ++key) {
+          int found;
+          bool present = sharded_map_lookup(sharded_map, &key, &found);
+          assert(key >= 0 && key < n && key % 8 >= 4 ? present && found == -key : !present);
+        }
+
+        for (int low = -1; low <= n; low += n / 4 + 1) {
+          for (int high = low; high <= n + 1; high += n / 8 + 1) {
+            std::vector<int> scanned;
+
+            sharded_map_scan(sharded_map, &low, &high, [](const void* key, void* found, void* data) {
+              assert(*static_cast<int*>(found) == -*static_cast<const int*>(key));
+              static_cast<std::vector<int>*>(data)->push_back(*static_cast<const int*>(key));
+              return true;
+            }, &scanned);
+
+            std::vector<int> expected;
+
+            for (int i = std::max(low, 0); i < std::min(high, n); ++i) {
+              if (i % 8 >= 4) {
+                expected.push_back(i);
+              }
+            }
+
+            assert(scanned == expected);
+          }
+        }
+
+        std::size_t visited = sharded_map_scan(sharded_map, NULL, NULL, [](const void* key, void*, void*) {
+          return *static_cast<const int*>(key) < 12;
+        }, NULL);
+
+        assert(visited == std::min<std::size_t>(5, remaining));
+        sharded_map_destroy(sharded_map);
+      }
+    }
+
+    for (bool b_tree : {false, true}) {
+      Layout int_layout{sizeof(int), alignof(int)};
+      Layout long_layout{sizeof(long), alignof(long)};
+      Map* c_map = map_new_with_options(int_layout, long_layout, int_comparator, heap_allocator, Map_options{0, false, b_tree, false, 0});
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        long found = -2L * key;
+        key *= 2;
+        assert(map_insert(c_map, &key, &found));
+      }
+
+      // The file is named uniquely to the process and removed once read, before any assertion on its contents:
+
+      std::string name = "map_image_" + std::to_string(std::random_device()()) + "_" + std::to_string(b_tree);
+      std::string path = (std::filesystem::temp_directory_path() / name).string();
+      FILE* file = std::fopen(path.c_str(), "wb");
+      bool written = file != NULL && map_image_write(c_map, int_layout, long_layout, file);
+
+      if (file != NULL) {
+        std::fclose(file);
+      }
+
+      Map_image* mismatched = map_image_open(path.c_str(), long_layout, long_layout, int_comparator);
+      Map_image* image = map_image_open(path.c_str(), int_layout, long_layout, int_comparator);
+      std::error_code error;
+      std::vector<long> buffer((std::filesystem::file_size(path, error) + sizeof(long) - 1) / sizeof(long));
+      file = std::fopen(path.c_str(), "rb");
+      std::size_t size = file != NULL ? std::fread(buffer.data(), 1, buffer.size() * sizeof(long), file) : 0;
+
+      if (file != NULL) {
+        std::fclose(file);
+      }
+
+      std::filesystem::remove(path, error);
+      assert(written && !error && mismatched == NULL);
+      assert(image != NULL && map_image_count(image) == count);
+
+      for (int key = -1; key <= 2 * static_cast<int>(count); ++key) {
+        const long* found = static_cast<const long*>(map_image_lookup(image, &key));
+        assert(key >= 0 && key % 2 == 0 && key < 2 * static_cast<int>(count) ? found != NULL && *found == -key : found == NULL);
+      }
+
+      int low = static_cast<int>(count / 2);
+      int high = static_cast<int>(3 * count / 2);
+      std::vector<int> scanned;
+
+      map_image_scan(image, &low, &high, [](const void* key, const void* found, void* data) {
+        assert(*static_cast<const long*>(found) == -*static_cast<const int*>(key));
+        static_cast<std::vector<int>*>(data)->push_back(*static_cast<const int*>(key));
+        return true;
+      }, &scanned);
+
+      assert(scanned.size() == static_cast<std::size_t>((high + 1) / 2 - (low + 1) / 2));
+
+      for (std::size_t i = 0; i < scanned.size(); ++i) {
+        assert(scanned[i] == (low + 1) / 2 * 2 + 2 * static_cast<int>(i));
+      }
+
+      Map* loaded = map_from_sorted(int_layout, long_layout, int_comparator, map_image_keys(image), map_image_values(image), map_image_count(image));
+      map_check(loaded);
+      assert(map_count(loaded) == count);
+
+      for (int key : keys) {
+        key *= 2;
+        value_p = static_cast<int*>(map_lookup(loaded, &key));
+        assert(value_p != NULL && *reinterpret_cast<long*>(value_p) == -key);
+      }
+
+      map_destroy(loaded);
+      map_image_close(image);
+
+      // Views in memory reject truncated images:
+
+      image = map_image_view(buffer.data(), size, int_layout, long_layout, int_comparator);
+      assert(image != NULL && map_image_count(image) == count);
+      map_image_close(image);
+      assert(map_image_view(buffer.data(), size - 1, int_layout, long_layout, int_comparator) == NULL);
+      assert(map_image_view(buffer.data(), 8, int_layout, long_layout, int_comparator) == NULL);
+
+      // Streams rebuild maps as they are read, in short reads as from a pipe:
+
+      std::string stream;
+
+      assert(map_dump(c_map, int_layout, long_layout, [](void* data, const void* bytes, std::size_t size) {
+        static_cast<std::string*>(data)->append(static_cast<const char*>(bytes), size);
+        return true;
+      }, &stream));
+
+      struct Stream_source {
+        std::string bytes;
+        std::size_t offset;
+
+        static std::size_t read(void* data, void* bytes, std::size_t size) {
+          Stream_source* source = static_cast<Stream_source*>(data);
+          size = std::min({size, source->bytes.size() - source->offset, std::size_t{7}});
+          std::memcpy(bytes, source->bytes.data() + source->offset, size);
+          source->offset += size;
+          return size;
+        }
+      };
+
+      Map* streamed = map_new_with_options(int_layout, long_layout, int_comparator, heap_allocator, Map_options{0, !b_tree, b_tree, false, 0});
+      Stream_source source{stream + "tail", 0};
+      assert(map_load(streamed, int_layout, long_layout, Stream_source::read, &source));
+      assert(source.offset == stream.size());
+      map_check(streamed);
+      assert(map_count(streamed) == count);
+
+      for (int key = -1; key <= 2 * static_cast<int>(count); ++key) {
+        const long* found = static_cast<const long*>(map_lookup(streamed, &key));
+        assert(key >= 0 && key % 2 == 0 && key < 2 * static_cast<int>(count) ? found != NULL && *found == -key : found == NULL);
+      }
+
+      std::FILE* stream_file = std::tmpfile();
+      assert(stream_file != NULL && map_dump_file(streamed, int_layout, long_layout, stream_file));
+      std::rewind(stream_file);
+      assert(map_load_file(c_map, int_layout, long_layout, stream_file));
+      std::fclose(stream_file);
+      map_check(c_map);
+      assert(map_count(c_map) == count);
+
+      // Streams which are truncated, of other layouts, or out of order leave maps empty:
+
+      source = Stream_source{stream.substr(0, stream.size() - 1), 0};
+      assert(!map_load(streamed, int_layout, long_layout, Stream_source::read, &source) && map_count(streamed) == 0);
+      source = Stream_source{stream, 0};
+      assert(!map_load(streamed, long_layout, long_layout, Stream_source::read, &source) && map_count(streamed) == 0);
+
+      if (count >= 2) {
+        std::size_t pair_size = sizeof(int) + sizeof(long);
+        std::string swapped = stream;
+        std::swap_ranges(swapped.end() - pair_size, swapped.end(), swapped.end() - 2 * pair_size);
+        source = Stream_source{swapped, 0};
+        assert(!map_load(streamed, int_layout, long_layout, Stream_source::read, &source) && map_count(streamed) == 0);
+        map_check(streamed);
+      }
+
+      map_destroy(streamed);
+      map_destroy(c_map);
+    }
+
+    for (Map_options options : {
+      Map_options{0, false, false, true, 0},
+      Map_options{64, false, false, true, 0},
+      Map_options{0, true, false, true, 0},
+      Map_options{0, false, false, true, 0.25},
+      Map_options{64, false, false, true, 1},
+    }) {
+      // String keys, inline or not, are ordered as strings and copied by maps:
+
+      Layout string_layout{sizeof(Map_string), alignof(Map_string)};
+      Layout int_layout{sizeof(int), alignof(int)};
+      Map* c_map = map_new_with_options(string_layout, int_layout, map_string_comparator, heap_allocator, options);
+      std::map<std::string, int> strings;
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        std::string chars = std::string(key % 17, 'k') + std::to_string(key);
+
+        if (key % 2 == 0 && static_cast<std::size_t>(key % 3) < chars.size())
+          chars[key % 3] = '\0';
+
+        Map_string string = map_string(chars.data(), chars.size());
+        assert(map_insert(c_map, &string, &key));
+        assert(map_insert(c_map, &string, &key));
+        strings[chars] = key;
+      }
+
+      map_check(c_map);
+      assert(map_count(c_map) == strings.size());
+
+      auto check_strings = [&](const Map* string_map) {
+        auto it = strings.begin();
+
+        for (void* value = map_first(string_map); value != NULL; value = map_next(string_map, value), ++it) {
+          char buffer[MAP_STRING_INLINE_LENGTH];
+          const Map_string* string = static_cast<const Map_string*>(map_key(string_map, value));
+          assert(std::string(map_string_chars(string, buffer), string->length) == it->first);
+          assert(*static_cast<int*>(value) == it->second);
+        }
+
+        assert(it == strings.end());
+
+        for (const auto& [chars, key] : strings) {
+          std::string looked_up = chars;
+          Map_string string = map_string(looked_up.data(), looked_up.size());
+          void* value = map_lookup(string_map, &string);
+          assert(value != NULL && *static_cast<int*>(value) == key);
+          looked_up += 'x';
+          string = map_string(looked_up.data(), looked_up.size());
+          assert(map_lookup(string_map, &string) == NULL || strings.count(looked_up) != 0);
+        }
+      };
+
+      check_strings(c_map);
+
+      std::vector<std::pair<std::string, int>> removed;
+
+      for (auto it = strings.begin(); it != strings.end();) {
+        Map_string string = map_string(it->first.data(), it->first.size());
+
+        if (it->second % 2 == 0) {
+          assert(map_remove(c_map, &string));
+          removed.push_back(*it);
+          it = strings.erase(it);
+        } else {
+          ++it;
+        }
+      }
+
+      map_check(c_map);
+      check_strings(c_map);
+
+      if (options.tombstone_fraction != 0) {
+        // Revived tombstones keep their copies of the keys, not the keys passed to revive them:
+
+        for (auto& [chars, key] : removed) {
+          std::string revived = chars;
+          Map_string string = map_string(revived.data(), revived.size());
+          key = -key;
+          assert(map_insert(c_map, &string, &key));
+          std::fill(revived.begin(), revived.end(), 'x');
+          strings[chars] = key;
+        }
+
+        map_check(c_map);
+        check_strings(c_map);
+
+        for (const auto& [chars, key] : removed) {
+          Map_string string = map_string(chars.data(), chars.size());
+          assert(map_remove(c_map, &string));
+          strings.erase(chars);
+        }
+
+        map_compact(c_map);
+        map_check(c_map);
+        check_strings(c_map);
+      }
+      Map* copy = map_copy(c_map);
+      map_clear(c_map);
+      map_check(copy);
+      check_strings(copy);
+
+      // Bulk builds copy long keys too:
+
+      std::vector<Map_string> sorted_keys;
+      std::vector<int> sorted_values;
+
+      for (const auto& [chars, key] : strings) {
+        sorted_keys.push_back(map_string(chars.data(), chars.size()));
+        sorted_values.push_back(key);
+      }
+
+      assert(map_build(c_map, sorted_keys.data(), sorted_values.data(), sorted_keys.size()));
+      map_check(c_map);
+      check_strings(c_map);
+      map_destroy(copy);
+      map_destroy(c_map);
+    }
+
+    {
+      Map* c_map = map_new(
+        Layout{sizeof(int), alignof(int)},
+        Layout{sizeof(int), alignof(int)},
+        int_comparator
+      );
+
+      check(c_map, count, engine);
+      map_destroy(c_map);
+    }
+
+    {
+      Defined_map* defined_map = Defined_map_new();
+      auto less = [](const std::pair<int, int>& x, const std::pair<int, int>& y) {
+        return x.first != y.first ? x.first < y.first : x.second > y.second;
+      };
+      std::map<std::pair<int, int>, long, decltype(less)> std_map(less);
+      std::uniform_int_distribution<int> distribution(0, static_cast<int>(count));
+
+      for (std::size_t i = 0; i < 4 * count; ++i) {
+        int key = distribution(engine);
+        Defined_key defined_key = {key / 4, key % 4};
+        long value = -key;
+
+        if (i % 3 == 2) {
+          assert(Defined_map_remove(defined_map, &defined_key) == (std_map.erase({key / 4, key % 4}) != 0));
+        } else {
+          assert(Defined_map_insert(defined_map, &defined_key, &value));
+          std_map.insert_or_assign({key / 4, key % 4}, value);
+        }
+
+        if (i % 64 == 0)
+          Defined_map_check(defined_map);
+      }
+
+      Defined_map_check(defined_map);
+      assert(Defined_map_count(defined_map) == std_map.size());
+      auto it = std_map.begin();
+
+      for (long* found = Defined_map_first(defined_map); found != NULL; found = Defined_map_next(defined_map, found), ++it) {
+        const Defined_key* key = Defined_map_key(defined_map, found);
+        assert(it != std_map.end() && key->major == it->first.first && key->minor == it->first.second && *found == it->second);
+        assert(Defined_map_lookup(defined_map, key) == found);
+      }
+
+      assert(it == std_map.end());
+
+      if (!std_map.empty()) {
+        const Defined_key* last = Defined_map_key(defined_map, Defined_map_last(defined_map));
+        assert(last->major == std::prev(std_map.end())->first.first && last->minor == std::prev(std_map.end())->first.second);
+        assert(Defined_map_previous(defined_map, Defined_map_first(defined_map)) == NULL);
+      }
+
+      for (int key = 0; key <= static_cast<int>(count); ++key) {
+        Defined_key low = {key / 4, key % 4};
+        Defined_key high = {key / 4 + 2, 0};
+        auto lower = std_map.lower_bound({low.major, low.minor});
+        long* found = Defined_map_lower_bound(defined_map, &low);
+        assert(lower == std_map.end() ? found == NULL : found != NULL && *found == lower->second);
+
+        std::size_t visited = Defined_map_scan(defined_map, &low, &high, [](const Defined_key*, long*, void*) {
+          return true;
+        }, NULL);
+        assert(visited == static_cast<std::size_t>(std::distance(lower, std_map.lower_bound({high.major, high.minor}))));
+      }
+
+      Defined_map_clear(defined_map);
+      Defined_map_check(defined_map);
+      assert(Defined_map_count(defined_map) == 0 && Defined_map_first(defined_map) == NULL);
+      Defined_key key = {0, 0};
+      long value = 1;
+      assert(Defined_map_insert(defined_map, &key, &value) && *Defined_map_lookup(defined_map, &key) == 1);
+      Defined_map_destroy(defined_map);
+    }
+
+    {
+      Map* c_map = map_new(Layout{sizeof(int), alignof(int)}, Layout{sizeof(int), alignof(int)}, int_comparator);
+      cpp::Map<int, int> cpp_map;
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        map_insert(c_map, &key, &key);
+        cpp_map.insert(key, key);
+      }
+
+      for (int key : keys) {
+        assert(map_lookup(c_map, &key) != NULL);
+        assert(cpp_map.lookup(key) != nullptr);
+      }
+
+      std::size_t max_depth = 2;
+
+      for (std::size_t n = count + 1; n > 1; n >>= 1)
+        max_depth += 2;
+
+      Map_stats c_stats;
+      bool gathered = map_stats(c_map, &c_stats);
+      cpp::Map_stats cpp_stats = cpp_map.stats();
+
+      auto check_stats = [&](const auto& stats) {
+#ifdef MAP_STATS
+        assert(gathered);
+        assert(stats.allocations == count && stats.deallocations == 0);
+        assert(stats.searches >= 2 * count && stats.total_depth >= count);
+        assert(stats.max_depth <= max_depth && stats.total_depth <= stats.searches * stats.max_depth);
+        assert(stats.comparisons >= stats.total_depth);
+        assert(count < 2 || stats.insertion_fixups > 0);
+        assert(stats.rotations <= 2 * count);
+#else
+        assert(!gathered);
+        assert(stats.comparisons == 0 && stats.rotations == 0 && stats.allocations == 0 && stats.searches == 0);
+#endif
+        assert(stats.removal_fixups == 0);
+      };
+
+      check_stats(c_stats);
+      check_stats(cpp_stats);
+
+      map_reset_stats(c_map);
+      cpp_map.reset_stats();
+
+      for (int key : keys) {
+        assert(map_remove(c_map, &key));
+        assert(cpp_map.remove(key));
+      }
+
+      map_stats(c_map, &c_stats);
+      cpp_stats = cpp_map.stats();
+#ifdef MAP_STATS
+      assert(c_stats.allocations == 0 && c_stats.deallocations == count && c_stats.insertion_fixups == 0);
+      assert(cpp_stats.allocations == 0 && cpp_stats.deallocations == count && cpp_stats.insertion_fixups == 0);
+#else
+      assert(c_stats.deallocations == 0 && cpp_stats.deallocations == 0);
+#endif
+      map_destroy(c_map);
+    }
+
+    {
+      Allocator pool_allocator = pool_allocator_new(
+        map_node_layout(Layout{sizeof(int), alignof(int)}, Layout{sizeof(int), alignof(int)}),
+        64
+      );
+
+      Map* c_map = map_new_with(
+        Layout{sizeof(int), alignof(int)},
+        Layout{sizeof(int), alignof(int)},
+        int_comparator,
+        pool_allocator
+      );
+
+      check(c_map, count, engine);
+      map_destroy(c_map);
+      pool_allocator_destroy(pool_allocator);
+    }
+
+    {
+      Map* c_map = map_new_with_options(
+        Layout{sizeof(int), alignof(int)},
+        Layout{sizeof(int), alignof(int)},
+        int_comparator,
+        heap_allocator,
+        Map_options{64, false, false, false, 0}
+      );
+
+      check(c_map, count, engine);
+      map_destroy(c_map);
+    }
+
+    for (Map_options options : {Map_options{0, false, false, false, 0.25}, Map_options{64, false, false, false, 1}}) {
+      Layout int_layout = {sizeof(int), alignof(int)};
+      Map* c_map = map_new_with_options(int_layout, int_layout, int_comparator, heap_allocator, options);
+      check(c_map, count, engine);
+
+      int n = static_cast<int>(count);
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        assert(map_insert(c_map, &key, &key));
+      }
+
+      // Removing the odd keys, and reinserting every fourth one:
+
+      for (int key : keys) {
+        if (key % 2 == 1)
+          assert(map_remove(c_map, &key) && !map_remove(c_map, &key));
+      }
+
+      map_check(c_map);
+      assert(map_count(c_map) == (count + 1) / 2);
+
+      for (int key = 3; key < n; key += 4) {
+        int value = -key;
+        assert(map_insert(c_map, &key, &value));
+      }
+
+      map_check(c_map);
+      std::vector<int> expected;
+
+      for (int key = 0; key < n; ++key) {
+        if (key % 2 == 0 || key % 4 == 3)
+          expected.push_back(key);
+      }
+
+      assert(map_count(c_map) == expected.size());
+      std::vector<int> visited;
+      map_scan(c_map, NULL, NULL, [](const void* key, void*, void* data) {
+        static_cast<std::vector<int>*>(data)->push_back(*static_cast<const int*>(key));
+        return true;
+      }, &visited);
+      assert(visited == expected);
+
+      visited.clear();
+
+      for (void* value = map_first(c_map); value != NULL; value = map_next(c_map, value)) {
+        visited.push_back(*static_cast<const int*>(map_key(c_map, value)));
+      }
+
+      assert(visited == expected);
+      std::vector<void*> values(count);
+      map_lookup_many(c_map, keys.data(), count, values.data());
+
+      for (std::size_t i = 0; i < count; ++i) {
+        int key = keys[i];
+        bool found = key % 2 == 0 || key % 4 == 3;
+        assert((map_lookup(c_map, &key) != NULL) == found && (values[i] != NULL) == found);
+        auto lower = std::lower_bound(expected.begin(), expected.end(), key);
+        auto upper = std::upper_bound(expected.begin(), expected.end(), key);
+        int* lower_value = static_cast<int*>(map_lower_bound(c_map, &key));
+        int* upper_value = static_cast<int*>(map_upper_bound(c_map, &key));
+        assert(lower == expected.end() ? lower_value == NULL : lower_value != NULL && std::abs(*lower_value) == *lower);
+        assert(upper == expected.end() ? upper_value == NULL : upper_value != NULL && std::abs(*upper_value) == *upper);
+        int* floor_value = static_cast<int*>(map_floor(c_map, &key));
+        assert(upper == expected.begin() ? floor_value == NULL : floor_value != NULL && std::abs(*floor_value) == *std::prev(upper));
+      }
+
+      if (!expected.empty()) {
+        assert(*static_cast<const int*>(map_key(c_map, map_last(c_map))) == expected.back());
+        assert(map_previous(c_map, map_first(c_map)) == NULL);
+      }
+
+      // Combining with a copy holding tombstones of its own:
+
+      Map* copy = map_copy(c_map);
+      map_check(copy);
+      assert(map_count(copy) == expected.size());
+
+      for (int key = 0; key < n; key += 4) {
+        map_remove(copy, &key);
+      }
+
+      map_check(copy);
+      Map* intersection = map_copy(c_map);
+      map_intersection(intersection, copy);
+      map_check(intersection);
+      Map* difference = map_copy(c_map);
+      map_difference(difference, copy);
+      map_check(difference);
+      assert(map_count(intersection) + map_count(difference) == expected.size());
+
+      for (int key : expected) {
+        assert((map_lookup(intersection, &key) != NULL) == (key % 4 != 0));
+        assert((map_lookup(difference, &key) != NULL) == (key % 4 == 0));
+      }
+
+      assert(map_union(difference, copy, NULL, NULL));
+      map_check(difference);
+      assert(map_count(difference) == expected.size());
+      map_destroy(intersection);
+      map_destroy(difference);
+
+      if (options.pool_chunk_size == 0) {
+        Map* greater = map_new_with_options(int_layout, int_layout, int_comparator, heap_allocator, options);
+        int middle = n / 2;
+        map_split(copy, &middle, greater);
+        map_check(copy);
+        map_check(greater);
+        assert(map_count(copy) + map_count(greater) == expected.size() - (count + 3) / 4);
+        map_concatenate(copy, greater);
+        map_check(copy);
+        map_destroy(greater);
+      }
+
+      map_destroy(copy);
+
+      // Streams and images hold the key-value pairs only, not the tombstones:
+
+      std::string stream;
+
+      assert(map_dump(c_map, int_layout, int_layout, [](void* data, const void* bytes, std::size_t size) {
+        static_cast<std::string*>(data)->append(static_cast<const char*>(bytes), size);
+        return true;
+      }, &stream));
+
+      std::pair<const std::string*, std::size_t> source{&stream, 0};
+      Map* loaded = map_new_with_options(int_layout, int_layout, int_comparator, heap_allocator, options);
+
+      assert(map_load(loaded, int_layout, int_layout, [](void* data, void* bytes, std::size_t size) {
+        auto* source = static_cast<std::pair<const std::string*, std::size_t>*>(data);
+        size = std::min(size, source->first->size() - source->second);
+        std::memcpy(bytes, source->first->data() + source->second, size);
+        source->second += size;
+        return size;
+      }, &source));
+
+      map_check(loaded);
+      assert(map_count(loaded) == expected.size());
+      FILE* file = std::tmpfile();
+      assert(file != NULL && map_image_write(c_map, int_layout, int_layout, file));
+      std::vector<long> buffer((static_cast<std::size_t>(std::ftell(file)) + sizeof(long) - 1) / sizeof(long));
+      std::rewind(file);
+      std::size_t size = std::fread(buffer.data(), 1, buffer.size() * sizeof(long), file);
+      std::fclose(file);
+      Map_image* image = map_image_view(buffer.data(), size, int_layout, int_layout, int_comparator);
+      assert(image != NULL && map_image_count(image) == expected.size());
+
+      for (int key = -1; key <= n; ++key) {
+        bool found = std::binary_search(expected.begin(), expected.end(), key);
+        value_p = static_cast<int*>(map_lookup(loaded, &key));
+        assert(found ? value_p != NULL && *value_p == (key % 4 == 3 ? -key : key) : value_p == NULL);
+        const int* image_value = static_cast<const int*>(map_image_lookup(image, &key));
+        assert(found ? image_value != NULL && *image_value == *value_p : image_value == NULL);
+      }
+
+      map_image_close(image);
+      map_destroy(loaded);
+
+      // Batches revive tombstones and remove keys alongside them:
+
+      Map* applied = map_copy(c_map);
+      std::vector<int> batch(count);
+      std::iota(batch.begin(), batch.end(), 0);
+      std::vector<int> batch_values(count);
+      std::unique_ptr<bool[]> removals(new bool[count]);
+
+      for (int key = 0; key < n; ++key) {
+        batch_values[key] = 10 * key;
+        removals[key] = key % 3 == 0;
+      }
+
+      assert(map_apply(applied, batch.data(), batch_values.data(), removals.get(), count));
+      map_check(applied);
+      assert(map_count(applied) == count - (count + 2) / 3);
+
+      for (int key = -1; key <= n; ++key) {
+        value_p = static_cast<int*>(map_lookup(applied, &key));
+        assert(key >= 0 && key < n && key % 3 != 0 ? value_p != NULL && *value_p == 10 * key : value_p == NULL);
+      }
+
+      map_destroy(applied);
+
+      map_compact(c_map);
+      map_check(c_map);
+      assert(map_count(c_map) == expected.size());
+
+      for (int key : keys) {
+        assert((map_lookup(c_map, &key) != NULL) == (key % 2 == 0 || key % 4 == 3));
+        map_remove(c_map, &key);
+      }
+
+      map_check(c_map);
+      assert(map_count(c_map) == 0 && map_first(c_map) == NULL && map_last(c_map) == NULL);
+      map_clear(c_map);
+      map_check(c_map);
+      map_destroy(c_map);
+    }
+
+    {
+      Map* c_map = map_new_with_options(
+        Layout{sizeof(int), alignof(int)},
+        Layout{sizeof(int), alignof(int)},
+        int_comparator,
+        heap_allocator,
+        Map_options{0, true, false, false, 0}
+      );
+
+      check(c_map, count, engine);
+      int n = static_cast<int>(count);
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        value = -2 * key;
+        key *= 2;
+        map_insert(c_map, &key, const_cast<int*>(&value));
+      }
+
+      map_check(c_map);
+
+      for (int key = -1; key <= 2 * n; ++key) {
+        assert(map_rank(c_map, &key) == static_cast<std::size_t>(std::min(n, (key + 1) / 2)));
+      }
+
+      for (std::size_t i = 0; i <= count; ++i) {
+        value_p = static_cast<int*>(map_select(c_map, i));
+        assert(i < count ? value_p != NULL && *value_p == -2 * static_cast<int>(i) : value_p == NULL);
+      }
+
+      for (int low = -1; low <= 2 * n; low += 3) {
+        for (int high = low - 1; high <= 2 * n + 1; high += 5) {
+          std::size_t counted = std::count_if(keys.begin(), keys.end(), [=](int key) { return low <= 2 * key && 2 * key < high; });
+          assert(map_count_range(c_map, &low, &high) == counted);
+        }
+      }
+
+      assert(map_count_range(c_map, NULL, NULL) == count);
+      map_destroy(c_map);
+    }
+
+    for (bool order_statistics : {false, true}) {
+      Map* c_maps[2];
+
+      for (Map*& c_map : c_maps) {
+        c_map = map_new_with_options(
+          Layout{sizeof(int), alignof(int)},
+          Layout{sizeof(int), alignof(int)},
+          int_comparator,
+          heap_allocator,
+          Map_options{0, order_statistics, false, false, 0}
+        );
+      }
+
+      int n = static_cast<int>(count);
+      std::vector<int> keys(count);
+      std::vector<int> values(count);
+
+      for (int i = 0; i < n; ++i) {
+        keys[i] = 2 * i;
+        values[i] = -2 * i;
+      }
+
+      assert(map_build(c_maps[0], keys.data(), values.data(), count));
+
+      for (int key = -1; key <= 2 * n; key += 1 + n / 8) {
+        map_split(c_maps[0], &key, c_maps[1]);
+        map_check(c_maps[0]);
+        map_check(c_maps[1]);
+        std::size_t split_count = static_cast<std::size_t>(std::clamp((key + 1) / 2, 0, n));
+        assert(map_count(c_maps[0]) == split_count && map_count(c_maps[1]) == count - split_count);
+
+        for (int k = -1; k <= 2 * n; ++k) {
+          assert((map_lookup(c_maps[0], &k) != NULL) == (k >= 0 && k < key && k < 2 * n && k % 2 == 0));
+          assert((map_lookup(c_maps[1], &k) != NULL) == (k >= key && k >= 0 && k < 2 * n && k % 2 == 0));
+        }
+
+        if (key % 2 != 0) {
+          value = 0;
+          assert(map_join(c_maps[0], &key, const_cast<int*>(&value), c_maps[1]));
+          map_check(c_maps[0]);
+          assert(map_count(c_maps[0]) == count + 1);
+          assert(map_remove(c_maps[0], &key));
+        } else {
+          map_concatenate(c_maps[0], c_maps[1]);
+        }
+
+        map_check(c_maps[0]);
+        map_check(c_maps[1]);
+        assert(map_count(c_maps[0]) == count && map_count(c_maps[1]) == 0);
+
+        for (int k : keys) {
+          value_p = static_cast<int*>(map_lookup(c_maps[0], &k));
+          assert(value_p != NULL && *value_p == -k);
+        }
+      }
+
+      for (Map* c_map : c_maps) {
+        map_destroy(c_map);
+      }
+    }
+
+    for (Map_options options : {Map_options{0, false, false, false, 0}, Map_options{64, false, false, false, 0}, Map_options{0, true, false, false, 0}}) {
+      std::uniform_int_distribution<int> key_distribution(0, 2 * static_cast<int>(count));
+
+      for (std::size_t other_count = 0; other_count <= 2 * count; other_count = 2 * other_count + 1) {
+        Map* c_maps[2];
+        std::map<int, int> std_maps[2];
+
+        for (std::size_t i = 0; i < 2; ++i) {
+          c_maps[i] = map_new_with_options(
+            Layout{sizeof(int), alignof(int)},
+            Layout{sizeof(int), alignof(int)},
+            int_comparator,
+            heap_allocator,
+            i == 0 ? options : Map_options{0, false, false, false, 0}
+          );
+
+          for (std::size_t j = 0; j < (i == 0 ? count : other_count); ++j) {
+            int key = key_distribution(engine);
+            value = static_cast<int>(i + 1) * key;
+            map_insert(c_maps[i], &key, const_cast<int*>(&value));
+            std_maps[i][key] = value;
+          }
+        }
+
+        auto check_map = [&](const std::map<int, int>& std_map) {
+          map_check(c_maps[0]);
+          map_check(c_maps[1]);
+          assert(map_count(c_maps[0]) == std_map.size() && map_count(c_maps[1]) == std_maps[1].size());
+
+          for (int key = -1; key <= 2 * static_cast<int>(count) + 1; ++key) {
+            auto it = std_map.find(key);
+            value_p = static_cast<int*>(map_lookup(c_maps[0], &key));
+            assert(it != std_map.end() ? value_p != NULL && *value_p == it->second : value_p == NULL);
+          }
+        };
+
+        Map* c_map = map_copy(c_maps[0]);
+        std::map<int, int> std_map = std_maps[0];
+
+        for (auto [key, value] : std_maps[1]) {
+          std_map.erase(key);
+        }
+
+        map_difference(c_maps[0], c_maps[1]);
+        check_map(std_map);
+        map_destroy(c_maps[0]);
+
+        c_maps[0] = map_copy(c_map);
+        std_map.clear();
+
+        for (auto [key, value] : std_maps[0]) {
+          if (std_maps[1].count(key) != 0)
+            std_map[key] = value;
+        }
+
+        map_intersection(c_maps[0], c_maps[1]);
+        check_map(std_map);
+        map_destroy(c_maps[0]);
+
+        c_maps[0] = c_map;
+        std_map = std_maps[0];
+
+        for (auto [key, value] : std_maps[1]) {
+          auto [it, inserted] = std_map.emplace(key, value);
+
+          if (!inserted)
+            it->second += value;
+        }
+
+        auto merge = [](const void* key, void* value, const void* other_value, void* data) {
+          assert(*static_cast<int*>(value) == *static_cast<const int*>(key) && data == nullptr);
+          *static_cast<int*>(value) += *static_cast<const int*>(other_value);
+        };
+
+        assert(map_union(c_maps[0], c_maps[1], merge, nullptr));
+        check_map(std_map);
+
+        for (Map* c_map : c_maps) {
+          map_destroy(c_map);
+        }
+      }
+    }
+
+    for (bool order_statistics : {false, true}) {
+      std::atomic<std::size_t> runs(0);
+
+      auto run = [](void* data, void (*task)(void* argument), void* const* arguments, std::size_t count) {
+        static_cast<std::atomic<std::size_t>*>(data)->fetch_add(1);
+        std::vector<std::thread> threads;
+
+        for (std::size_t i = 1; i < count; ++i) {
+          threads.emplace_back(task, arguments[i]);
+        }
+
+        task(arguments[0]);
+
+        for (std::thread& thread : threads) {
+          thread.join();
+        }
+      };
+
+      Map_executor executor{run, &runs, 4};
+      Map* c_maps[2];
+
+      for (Map*& c_map : c_maps) {
+        c_map = map_new_with_options(
+          Layout{sizeof(int), alignof(int)},
+          Layout{sizeof(int), alignof(int)},
+          int_comparator,
+          heap_allocator,
+          Map_options{0, order_statistics, false, false, 0}
+        );
+      }
+
+      // Enough keys for subtrees to be built concurrently:
+      int n = 16384 + static_cast<int>(count);
+      std::vector<int> keys(n);
+      std::iota(keys.begin(), keys.end(), 0);
+      assert(map_build_parallel(c_maps[0], keys.data(), keys.data(), n, &executor));
+      map_check(c_maps[0]);
+      assert(map_count(c_maps[0]) == static_cast<std::size_t>(n) && runs.load() != 0);
+
+      for (int key : keys) {
+        value_p = static_cast<int*>(map_lookup(c_maps[0], &key));
+        assert(value_p != NULL && *value_p == key);
+      }
+
+      std::vector<int> other_keys;
+
+      for (int key = 0; key < 2 * n; key += 3) {
+        other_keys.push_back(key);
+      }
+
+      assert(map_build(c_maps[1], other_keys.data(), other_keys.data(), other_keys.size()));
+      runs = 0;
+
+      auto merge = [](const void* key, void* value, const void* other_value, void*) {
+        assert(*static_cast<int*>(value) == *static_cast<const int*>(key));
+        *static_cast<int*>(value) += *static_cast<const int*>(other_value);
+      };
+
+      assert(map_union_parallel(c_maps[0], c_maps[1], merge, nullptr, &executor));
+      map_check(c_maps[0]);
+      assert(map_count(c_maps[0]) == static_cast<std::size_t>(n) + other_keys.size() - (n + 2) / 3 && runs.load() != 0);
+
+      for (int key = 0; key < 2 * n; ++key) {
+        value_p = static_cast<int*>(map_lookup(c_maps[0], &key));
+        assert(key < n || key % 3 == 0 ? value_p != NULL && *value_p == (key < n && key % 3 == 0 ? 2 * key : key) : value_p == NULL);
+      }
+
+      Map* c_map_copy = map_copy(c_maps[0]);
+      map_intersection_parallel(c_maps[0], c_maps[1], &executor);
+      map_check(c_maps[0]);
+      assert(map_count(c_maps[0]) == other_keys.size());
+      map_difference_parallel(c_map_copy, c_maps[1], &executor);
+      map_check(c_map_copy);
+      assert(map_count(c_map_copy) == static_cast<std::size_t>(n) - (n + 2) / 3);
+
+      for (int key = 0; key < 2 * n; ++key) {
+        assert((map_lookup(c_maps[0], &key) != NULL) == (key % 3 == 0));
+        assert((map_lookup(c_map_copy, &key) != NULL) == (key < n && key % 3 != 0));
+      }
+
+      map_destroy(c_map_copy);
+
+      // Small maps are combined without going through the executor:
+      map_clear(c_maps[0]);
+      map_clear(c_maps[1]);
+
+      for (int key = 0; key < 64; ++key) {
+        int other_key = key + 32;
+        assert(map_insert(c_maps[0], &key, &key) && map_insert(c_maps[1], &other_key, &other_key));
+      }
+
+      runs = 0;
+      assert(map_union_parallel(c_maps[0], c_maps[1], NULL, nullptr, &executor));
+      map_check(c_maps[0]);
+      assert(map_count(c_maps[0]) == 96 && runs.load() == 0);
+
+      for (Map* c_map : c_maps) {
+        map_destroy(c_map);
+      }
+    }
+
+    {
+      Map* c_map = map_new_with_options(
+        Layout{sizeof(int), alignof(int)},
+        Layout{sizeof(int), alignof(int)},
+        int_comparator,
+        heap_allocator,
+        Map_options{0, false, true, false, 0}
+      );
+
+      int n = static_cast<int>(count);
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        value = -2 * key;
+        key *= 2;
+        assert(map_insert(c_map, &key, const_cast<int*>(&value)));
+        map_check(c_map);
+      }
+
+      assert(map_count(c_map) == count);
+      assert(count == 0 || (*static_cast<int*>(map_first(c_map)) == 0 && *static_cast<int*>(map_last(c_map)) == 2 - 2 * n));
+
+      {
+        std::vector<int> probes(2 * count + 1);
+        std::iota(probes.begin(), probes.end(), 0);
+        std::shuffle(probes.begin(), probes.end(), engine);
+        std::vector<void*> values(probes.size());
+        map_lookup_many(c_map, probes.data(), probes.size(), values.data());
+
+        for (std::size_t i = 0; i < probes.size(); ++i) {
+          value_p = static_cast<int*>(values[i]);
+          assert(probes[i] < 2 * n && probes[i] % 2 == 0 ? value_p != NULL && *value_p == -probes[i] : value_p == NULL);
+        }
+      }
+
+      for (int key = -1; key <= 2 * n; ++key) {
+        int ceiling = key <= 0 ? 0 : (key + 1) / 2 * 2;
+        int successor = key < 0 ? 0 : key / 2 * 2 + 2;
+        int floor = key < 0 ? -1 : std::min(key / 2 * 2, 2 * n - 2);
+        value_p = static_cast<int*>(map_lookup(c_map, &key));
+        assert(key >= 0 && key < 2 * n && key % 2 == 0 ? value_p != NULL && *value_p == -key : value_p == NULL);
+        value_p = static_cast<int*>(map_lower_bound(c_map, &key));
+        assert(ceiling < 2 * n ? value_p != NULL && *value_p == -ceiling : value_p == NULL);
+        value_p = static_cast<int*>(map_upper_bound(c_map, &key));
+        assert(successor < 2 * n ? value_p != NULL && *value_p == -successor : value_p == NULL);
+        value_p = static_cast<int*>(map_floor(c_map, &key));
+        assert(floor >= 0 ? value_p != NULL && *value_p == -floor : value_p == NULL);
+      }
+
+      auto visit = [](const void* key, void* value, void* data) {
+        int* next_key = static_cast<int*>(data);
+        assert(*static_cast<const int*>(key) == *next_key && *static_cast<int*>(value) == -*next_key);
+        *next_key += 2;
+        return true;
+      };
+
+      for (int low = -1; low <= 2 * n; low += 3) {
+        for (int high = low; high <= 2 * n + 1; high += 5) {
+          int next_key = std::max(0, (low + 1) / 2 * 2);
+          std::size_t expected = std::count_if(keys.begin(), keys.end(), [=](int key) { return low <= 2 * key && 2 * key < high; });
+          assert(map_scan(c_map, &low, &high, visit, &next_key) == expected);
+        }
+      }
+
+      Map* c_map_copy = map_copy(c_map);
+      map_check(c_map_copy);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        key *= 2;
+        assert(map_remove(c_map, &key));
+        assert(!map_remove(c_map, &key));
+        map_check(c_map);
+        value_p = static_cast<int*>(map_lookup(c_map_copy, &key));
+        assert(value_p != NULL && *value_p == -key);
+      }
+
+      assert(map_count(c_map) == 0 && map_count(c_map_copy) == count);
+      map_destroy(c_map_copy);
+
+      std::sort(keys.begin(), keys.end());
+      assert(map_build(c_map, keys.data(), keys.data(), count));
+      map_check(c_map);
+      assert(map_count(c_map) == count);
+
+      for (int key : keys) {
+        value_p = static_cast<int*>(map_lookup(c_map, &key));
+        assert(value_p != NULL && *value_p == key);
+      }
+
+      {
+        std::vector<int> batch(2 * count);
+        std::vector<int> values(batch.size());
+        std::unique_ptr<bool[]> removals(new bool[batch.size()]);
+
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+          batch[i] = static_cast<int>(i);
+          values[i] = -batch[i];
+          removals[i] = i % 3 == 0;
+        }
+
+        assert(map_apply(c_map, batch.data(), values.data(), removals.get(), batch.size()));
+        map_check(c_map);
+        assert(map_count(c_map) == batch.size() - (batch.size() + 2) / 3);
+
+        for (int key : batch) {
+          value_p = static_cast<int*>(map_lookup(c_map, &key));
+          assert(key % 3 == 0 ? value_p == NULL : value_p != NULL && *value_p == -key);
+        }
+      }
+
+      map_destroy(c_map);
+    }
+
+    {
+      // Keys straddling the sign bit, whose searches within nodes compare unsigned and 64-bit keys specifically:
+
+      Map* c_maps[2] = {
+        map_new_with_options(Layout{sizeof(unsigned), alignof(unsigned)}, Layout{sizeof(int), alignof(int)}, uint_comparator, heap_allocator, Map_options{0, false, true, false, 0}),
+        map_new_with_options(Layout{sizeof(long), alignof(long)}, Layout{sizeof(int), alignof(int)}, long_comparator, heap_allocator, Map_options{0, false, true, false, 0}),
+      };
+
+      int n = static_cast<int>(count);
+
+      for (int i = -n; i < n; i += 2) {
+        unsigned uint_key = 0x80000000u + static_cast<unsigned>(i);
+        long long_key = static_cast<long>(i) * 0x100000000l / 2;
+        value = i;
+        assert(map_insert(c_maps[0], &uint_key, const_cast<int*>(&value)));
+        assert(map_insert(c_maps[1], &long_key, const_cast<int*>(&value)));
+      }
+
+      map_check(c_maps[0]);
+      map_check(c_maps[1]);
+
+      for (int i = -n - 1; i <= n; ++i) {
+        unsigned uint_key = 0x80000000u + static_cast<unsigned>(i);
+        long long_key = static_cast<long>(i) * 0x100000000l / 2;
+        int ceiling = i <= -n ? -n : (i + n + 1) / 2 * 2 - n;
+
+        for (std::size_t j = 0; j < 2; ++j) {
+          const void* key = j == 0 ? static_cast<const void*>(&uint_key) : &long_key;
+          value_p = static_cast<int*>(map_lookup(c_maps[j], key));
+          assert((i - n) % 2 == 0 && i >= -n && i < n ? value_p != NULL && *value_p == i : value_p == NULL);
+          value_p = static_cast<int*>(map_lower_bound(c_maps[j], key));
+          assert(ceiling < n ? value_p != NULL && *value_p == ceiling : value_p == NULL);
+        }
+      }
+
+      map_destroy(c_maps[0]);
+      map_destroy(c_maps[1]);
+    }
+
+    {
+      // Containers growing their arrays through pool allocators, past a block and past their first oversized array:
+
+      Layout int_layout{sizeof(int), alignof(int)};
+      Allocator pool_allocator = pool_allocator_new(Layout{4 * sizeof(void*), alignof(void*)}, 64);
+      Index_map* index_map = index_map_new_with(int_layout, int_layout, int_comparator, pool_allocator);
+      Concurrent_map* concurrent_map = concurrent_map_new_with(int_layout, int_layout, int_comparator, pool_allocator);
+      int n = 256;
+
+      for (int key = 0; key < n; ++key) {
+        int found = -key;
+        assert(index_map_insert(index_map, &key, &found));
+        assert(concurrent_map_insert(concurrent_map, &key, &found));
+      }
+
+      index_map_check(index_map);
+      concurrent_map_check(concurrent_map);
+      assert(index_map_count(index_map) == static_cast<std::size_t>(n));
+      assert(concurrent_map_count(concurrent_map) == static_cast<std::size_t>(n));
+
+      for (int key = 0; key < n; ++key) {
+        int found;
+        value_p = static_cast<int*>(index_map_lookup(index_map, &key));
+        assert(value_p != NULL && *value_p == -key);
+        assert(concurrent_map_lookup(concurrent_map, &key, &found) && found == -key);
+      }
+
+      index_map_destroy(index_map);
+      concurrent_map_destroy(concurrent_map);
+      pool_allocator_destroy(pool_allocator);
+    }
+
+    {
+      Index_map* index_map = index_map_new(Layout{sizeof(int), alignof(int)}, Layout{sizeof(int), alignof(int)}, int_comparator);
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        value = -key;
+        assert(index_map_insert(index_map, &key, const_cast<int*>(&value)));
+      }
+
+      index_map_check(index_map);
+      assert(index_map_count(index_map) == count);
+
+      for (int key : keys) {
+        value_p = static_cast<int*>(index_map_lookup(index_map, &key));
+        assert(value_p != NULL && *value_p == -key);
+      }
+
+      Index_map* index_map_copied = index_map_copy(index_map);
+      std::vector<int> scanned;
+      int low = static_cast<int>(count / 4);
+      int high = static_cast<int>(3 * count / 4);
+
+      index_map_scan(index_map_copied, &low, &high, [](const void* key, void*, void* data) {
+        static_cast<std::vector<int>*>(data)->push_back(*static_cast<const int*>(key));
+        return true;
+      }, &scanned);
+
+      assert(scanned.size() == static_cast<std::size_t>(high - low));
+
+      for (std::size_t i = 0; i < scanned.size(); ++i) {
+        assert(scanned[i] == low + static_cast<int>(i));
+      }
+
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (std::size_t i = 0; i < count; i += 2) {
+        assert(index_map_remove(index_map, &keys[i]));
+        assert(!index_map_remove(index_map, &keys[i]));
+      }
+
+      index_map_check(index_map);
+      assert(index_map_count(index_map) == count / 2);
+
+      for (std::size_t i = 0; i < count; ++i) {
+        value_p = static_cast<int*>(index_map_lookup(index_map, &keys[i]));
+        assert(i % 2 == 0 ? value_p == NULL : value_p != NULL && *value_p == -keys[i]);
+        value_p = static_cast<int*>(index_map_lookup(index_map_copied, &keys[i]));
+        assert(value_p != NULL && *value_p == -keys[i]);
+      }
+
+      index_map_destroy(index_map_copied);
+
+      for (std::size_t i = 1; i < count; i += 2) {
+        assert(index_map_remove(index_map, &keys[i]));
+      }
+
+      index_map_check(index_map);
+      assert(index_map_count(index_map) == 0);
+      index_map_clear(index_map);
+      index_map_destroy(index_map);
+    }
+
+    {
+      Concurrent_map* concurrent_map = concurrent_map_new(Layout{sizeof(int), alignof(int)}, Layout{sizeof(int), alignof(int)}, int_comparator);
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        int found = key;
+        assert(concurrent_map_insert(concurrent_map, &key, &found));
+        found = -key;
+        assert(concurrent_map_insert(concurrent_map, &key, &found));
+      }
+
+      concurrent_map_check(concurrent_map);
+      assert(concurrent_map_count(concurrent_map) == count);
+
+      for (int key : keys) {
+        int found;
+        assert(concurrent_map_lookup(concurrent_map, &key, &found) && found == -key);
+      }
+
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        if (key % 2 == 0) {
+          assert(concurrent_map_remove(concurrent_map, &key));
+          assert(!concurrent_map_remove(concurrent_map, &key));
+        }
+      }
+
+      concurrent_map_check(concurrent_map);
+      assert(concurrent_map_count(concurrent_map) == count / 2);
+
+      // Readers find the odd keys, which stay in the map, while the writer inserts and removes the even keys:
+
+      std::atomic<bool> writing{true};
+      std::vector<std::thread> readers;
+
+      for (std::size_t i = 0; i < 2; ++i) {
+        readers.emplace_back([&, i] {
+          do {
+            for (std::size_t j = i; j < count; j += 2) {
+              int key = static_cast<int>(j | 1);
+              int found;
+              assert(key >= static_cast<int>(count) || (concurrent_map_lookup(concurrent_map, &key, &found) && found == -key));
+              (void)found;
+            }
+
+            std::vector<int> scanned;
+
+            concurrent_map_scan(concurrent_map, NULL, NULL, [](const void* key, const void* found, void* data) {
+              assert(*static_cast<const int*>(found) == -*static_cast<const int*>(key));
+              static_cast<std::vector<int>*>(data)->push_back(*static_cast<const int*>(key));
+              return true;
+            }, &scanned);
+
+            assert(std::is_sorted(scanned.begin(), scanned.end()));
+            assert(static_cast<std::size_t>(std::count_if(scanned.begin(), scanned.end(), [](int key) {
+              return key % 2 != 0;
+            })) == count / 2);
+          } while (writing.load());
+        });
+      }
+
+      for (std::size_t round = 0; round < 4; ++round) {
+        for (int key : keys) {
+          if (key % 2 == 0) {
+            int found = -key;
+            assert(round % 2 == 0 ? concurrent_map_insert(concurrent_map, &key, &found) : concurrent_map_remove(concurrent_map, &key));
+          }
+        }
+      }
+
+      writing.store(false);
+
+      for (std::thread& reader : readers) {
+        reader.join();
+      }
+
+      concurrent_map_check(concurrent_map);
+      assert(concurrent_map_count(concurrent_map) == count / 2);
+      int low = static_cast<int>(count / 4);
+      int high = static_cast<int>(3 * count / 4);
+      std::size_t scanned = 0;
+
+      concurrent_map_scan(concurrent_map, &low, &high, [](const void* key, const void*, void* data) {
+        assert(*static_cast<const int*>(key) % 2 != 0);
+        ++*static_cast<std::size_t*>(data);
+        return true;
+      }, &scanned);
+
+      assert(scanned == static_cast<std::size_t>(high / 2 - low / 2));
+      concurrent_map_destroy(concurrent_map);
+    }
+
+    {
+      Persistent_map* persistent_map = persistent_map_new(Layout{sizeof(int), alignof(int)}, Layout{sizeof(int), alignof(int)}, int_comparator);
+      std::vector<int> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      std::shuffle(keys.begin(), keys.end(), engine);
+      std::vector<Persistent_map*> snapshots;
+
+      for (std::size_t i = 0; i < count; ++i) {
+        int found = -keys[i];
+        assert(persistent_map_insert(persistent_map, &keys[i], &found));
+
+        if ((i & (i + 1)) == 0) {
+          snapshots.push_back(persistent_map_snapshot(persistent_map));
+        }
+      }
+
+      persistent_map_check(persistent_map);
+      assert(persistent_map_count(persistent_map) == count);
+      Persistent_map* snapshot = persistent_map_snapshot(persistent_map);
+
+      // A reader scans the snapshot while the map is updated, which copies the nodes they share:
+
+      std::thread reader([&] {
+        for (std::size_t round = 0; round < 4; ++round) {
+          int key = 0;
+
+          persistent_map_scan(snapshot, NULL, NULL, [](const void* found_key, const void* found, void* data) {
+            int& key = *static_cast<int*>(data);
+            assert(*static_cast<const int*>(found_key) == key && *static_cast<const int*>(found) == -key);
+            key += 1;
+            return true;
+          }, &key);
+
+          assert(key == static_cast<int>(count));
+        }
+      });
+
+      std::shuffle(keys.begin(), keys.end(), engine);
+
+      for (int key : keys) {
+        if (key % 2 == 0) {
+          assert(persistent_map_remove(persistent_map, &key));
+          assert(!persistent_map_remove(persistent_map, &key));
+        } else {
+          assert(persistent_map_insert(persistent_map, &key, &key));
+        }
+      }
+
+      reader.join();
+      persistent_map_check(persistent_map);
+      assert(persistent_map_count(persistent_map) == count / 2);
+      persistent_map_check(snapshot);
+      assert(persistent_map_count(snapshot) == count);
+
+      for (int key : keys) {
+        const int* found = static_cast<const int*>(persistent_map_lookup(persistent_map, &key));
+        assert(key % 2 == 0 ? found == NULL : found != NULL && *found == key);
+        found = static_cast<const int*>(persistent_map_lookup(snapshot, &key));
+        assert(found != NULL && *found == -key);
+      }
+
+      persistent_map_destroy(persistent_map);
+
+      for (std::size_t i = 0; i < snapshots.size(); ++i) {
+        persistent_map_check(snapshots[i]);
+        assert(persistent_map_count(snapshots[i]) == (std::size_t{1} << i));
+        std::size_t visited = persistent_map_scan(snapshots[i], NULL, NULL, [](const void*, const void*, void*) {
+          return true;
+        }, NULL);
+        assert(visited == (std::size_t{1} << i));
+        persistent_map_clear(snapshots[i]);
+        persistent_map_destroy(snapshots[i]);
+      }
+
+      for (int key : keys) {
+        assert(persistent_map_remove(snapshot, &key));
+      }
+
+      persistent_map_check(snapshot);
+      assert(persistent_map_count(snapshot) == 0);
+      persistent_map_destroy(snapshot);
+    }
+  }
+#else
+  void check(std::size_t, std::default_random_engine&) {}
+#endif
 }
 
 int main(int argc, char* argv[]) {
@@ -488,6 +2410,5 @@ int main(int argc, char* argv[]) {
 
   std::default_random_engine engine((std::random_device()()));
   check(count, engine);
-  bench(count, engine);
   return EXIT_SUCCESS;
 }